@@ -0,0 +1,146 @@
+#include "AdmissionControl.h"
+
+#include "BufferPool.h"
+
+// 输出尺寸最多缩小两次，宽不小于320
+#define ADMISSION_MAX_SCALE 2
+#define ADMISSION_MIN_WIDTH 320
+
+AdmissionControl* AdmissionControl::getInstance() {
+    static AdmissionControl s_instance;
+    return &s_instance;
+}
+
+uint64_t AdmissionControl::estimate(const StStage& stStage) {
+    const ImagePara& stPara = stStage.stPara;
+    size_t nFrame = 0;
+    if (v4l2fmtIsCompressed(stPara.v4l2Fmt)) {
+        // 码流缓冲区按每像素半字节估算
+        nFrame = (size_t)stPara.width * stPara.height / 2;
+    } else {
+        nFrame = BufferPool::frameSize(stPara);
+    }
+    if (nFrame == 0) {
+        return 0;
+    }
+    return (uint64_t)BufferPool::sizeClass(nFrame) * stStage.nBuffers;
+}
+
+uint64_t AdmissionControl::estimate(const std::vector<StStage>& vStages) {
+    uint64_t nTotal = 0;
+    for (const StStage& stStage : vStages) {
+        nTotal += estimate(stStage);
+    }
+    return nTotal;
+}
+
+ImagePara AdmissionControl::decodedPara(const ImagePara& stInput) {
+    ImagePara stPara = stInput;
+    stPara.v4l2Fmt = V4L2_PIX_FMT_NV12;
+    stPara.hstride = (stInput.width + 15) & ~15;
+    stPara.vstride = (stInput.height + 15) & ~15;
+    return stPara;
+}
+
+// 先减缓冲区个数(每次减单个缓冲区最大的)，再缩小输出尺寸
+bool AdmissionControl::degrade(std::vector<StStage>& vStages, uint64_t nAvailable) {
+    while (estimate(vStages) > nAvailable) {
+        StStage* pLargest = nullptr;
+        uint64_t nLargest = 0;
+        for (StStage& stStage : vStages) {
+            if (stStage.nBuffers <= stStage.nMinBuffers || stStage.nBuffers == 0) {
+                continue;
+            }
+            uint64_t nBytes = estimate(stStage) / stStage.nBuffers;
+            if (pLargest == nullptr || nBytes > nLargest) {
+                pLargest = &stStage;
+                nLargest = nBytes;
+            }
+        }
+        if (pLargest == nullptr) {
+            break;
+        }
+        pLargest->nBuffers--;
+    }
+    for (int i = 0; i < ADMISSION_MAX_SCALE && estimate(vStages) > nAvailable; ++i) {
+        bool bScaled = false;
+        for (StStage& stStage : vStages) {
+            ImagePara& stPara = stStage.stPara;
+            if (!stStage.bScalable || stPara.width / 2 < ADMISSION_MIN_WIDTH) {
+                continue;
+            }
+            stPara.width = (stPara.width / 2) & ~15;
+            stPara.height = (stPara.height / 2) & ~1;
+            stPara.hstride = stPara.width;
+            stPara.vstride = stPara.height;
+            bScaled = true;
+        }
+        if (!bScaled) {
+            break;
+        }
+    }
+    return estimate(vStages) <= nAvailable;
+}
+
+void AdmissionControl::setBudget(uint64_t nBytes, bool bDegrade) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nBudget = nBytes;
+    m_bDegrade = bDegrade;
+}
+
+int AdmissionControl::admit(const std::string& sSession, std::vector<StStage>& vStages) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    uint64_t nBytes = estimate(vStages);
+    int nRet = 0;
+    if (m_nBudget != 0 && m_nReserved + nBytes > m_nBudget) {
+        uint64_t nAvailable = m_nBudget > m_nReserved ? m_nBudget - m_nReserved : 0;
+        std::vector<StStage> vDegraded = vStages;
+        if (!m_bDegrade || !degrade(vDegraded, nAvailable)) {
+            m_nRejected++;
+            ff_error("admission: reject %s, needs %llu bytes, %llu of %llu available\n", sSession.c_str(),
+                     (unsigned long long)nBytes, (unsigned long long)nAvailable, (unsigned long long)m_nBudget);
+            return -1;
+        }
+        for (size_t i = 0; i < vStages.size(); ++i) {
+            const StStage& stOld = vStages[i];
+            const StStage& stNew = vDegraded[i];
+            if (stOld.nBuffers != stNew.nBuffers || stOld.stPara.width != stNew.stPara.width) {
+                ff_warn("admission: %s/%s degraded to %u buffers %ux%u\n", sSession.c_str(), stNew.sName.c_str(),
+                        stNew.nBuffers, stNew.stPara.width, stNew.stPara.height);
+            }
+        }
+        vStages = vDegraded;
+        nBytes = estimate(vStages);
+        m_nDegraded++;
+        nRet = 1;
+    }
+    if (m_mSessions.find(sSession) == m_mSessions.end()) {
+        m_nAdmitted++;
+    }
+    m_mSessions[sSession] += nBytes;
+    m_nReserved += nBytes;
+    return nRet;
+}
+
+void AdmissionControl::release(const std::string& sSession) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    auto it = m_mSessions.find(sSession);
+    if (it == m_mSessions.end()) {
+        return;
+    }
+    m_nReserved -= it->second;
+    m_mSessions.erase(it);
+}
+
+AdmissionControl::StStats AdmissionControl::getStats() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    StStats stStats;
+    stStats.nBudget = m_nBudget;
+    stStats.nReserved = m_nReserved;
+    stStats.nHeadroom = m_nBudget > m_nReserved ? m_nBudget - m_nReserved : 0;
+    stStats.nSessions = m_mSessions.size();
+    stStats.nAdmitted = m_nAdmitted;
+    stStats.nDegraded = m_nDegraded;
+    stStats.nRejected = m_nRejected;
+    return stStats;
+}
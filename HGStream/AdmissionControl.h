@@ -0,0 +1,79 @@
+#ifndef ADMISSIONCONTROL_H
+#define ADMISSIONCONTROL_H
+
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+
+// 新建会话(拉流、推流、管道)前按各组件的输出参数和缓冲区个数估算占用的DRM/CMA内存，
+// 与已接入会话的估算之和比较预算：放得下直接接入；放不下时先减少可降级组件的缓冲区个数，
+// 再缩小可缩放组件的输出尺寸(每次宽高减半，最多两次)，仍放不下则拒绝，不去申请注定失败的缓冲区。
+// 估算只是规划用的上限，实际申请由BufferPool的预算兜底。
+// 用法：
+//   std::vector<AdmissionControl::StStage> vStages = { {"rga", stOutPara, pRga->getBufferCount(), 2, true} };
+//   if (AdmissionControl::getInstance()->admit("pull", vStages) < 0) { 拒绝 }
+//   pRga->setBufferCount(vStages[0].nBuffers);  // 按降级后的个数和尺寸创建
+//   ...
+//   AdmissionControl::getInstance()->release("pull");  // 会话结束
+class AdmissionControl {
+public:
+    struct StStage {
+        std::string sName;
+        // 输出参数，码流按宽高估算
+        ImagePara stPara;
+        uint16_t nBuffers;
+        // 降级时至少保留的个数，与nBuffers相同则不降级
+        uint16_t nMinBuffers;
+        // 可缩小输出尺寸
+        bool bScalable;
+    };
+
+    struct StStats {
+        // 0为不限制
+        uint64_t nBudget;
+        uint64_t nReserved;
+        // 不限制时为0
+        uint64_t nHeadroom;
+        uint32_t nSessions;
+        // 接入的会话数，降级、拒绝的次数
+        uint64_t nAdmitted;
+        uint64_t nDegraded;
+        uint64_t nRejected;
+    };
+
+public:
+    static AdmissionControl* getInstance();
+
+    // bDegrade为false时放不下直接拒绝
+    void setBudget(uint64_t nBytes, bool bDegrade = true);
+    // 会话已存在时追加，返回0接入，1降级后接入(vStages已修改)，-1拒绝(不计入)
+    int admit(const std::string& sSession, std::vector<StStage>& vStages);
+    void release(const std::string& sSession);
+    StStats getStats();
+
+    static uint64_t estimate(const StStage& stStage);
+    static uint64_t estimate(const std::vector<StStage>& vStages);
+    // 解码器输出参数：NV12，宽高16对齐
+    static ImagePara decodedPara(const ImagePara& stInput);
+
+private:
+    AdmissionControl() {}
+    bool degrade(std::vector<StStage>& vStages, uint64_t nAvailable);
+
+private:
+    std::mutex m_mutex;
+    std::map<std::string, uint64_t> m_mSessions;
+    uint64_t m_nBudget = 0;
+    bool m_bDegrade = true;
+    uint64_t m_nReserved = 0;
+    uint64_t m_nAdmitted = 0;
+    uint64_t m_nDegraded = 0;
+    uint64_t m_nRejected = 0;
+};
+
+#endif // ADMISSIONCONTROL_H
@@ -0,0 +1,101 @@
+#include "AnnexBFile.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/ff_log.h"
+#include "NaluUtil.h"
+
+AnnexBFile::AnnexBFile() {
+}
+
+AnnexBFile::~AnnexBFile() {
+    close();
+}
+
+int AnnexBFile::open(const std::string& sPath, bool bHevc, size_t nReserve) {
+    close();
+    m_nFd = ::open(sPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_nFd < 0) {
+        ff_error("annexb: failed to open %s: %s\n", sPath.c_str(), strerror(errno));
+        return -1;
+    }
+    m_sPath = sPath;
+    m_bHevc = bHevc;
+    struct stat st;
+    fstat(m_nFd, &st);
+    size_t nMapSize = std::max((size_t)st.st_size, nReserve);
+    if (nMapSize == 0) {
+        return 0;
+    }
+    // 超过文件长度的部分在文件增长前不可访问
+    void* pMap = mmap(nullptr, nMapSize, PROT_READ, MAP_SHARED, m_nFd, 0);
+    if (pMap == MAP_FAILED) {
+        ff_error("annexb: mmap %s failed: %s\n", sPath.c_str(), strerror(errno));
+        close();
+        return -1;
+    }
+    // 顺序读取，让内核提前预读
+    madvise(pMap, nMapSize, MADV_SEQUENTIAL);
+    m_pData = (const uint8_t*)pMap;
+    m_nMapSize = nMapSize;
+    m_nSize = st.st_size;
+    return 0;
+}
+
+void AnnexBFile::close() {
+    if (m_pData != nullptr) {
+        munmap((void*)m_pData, m_nMapSize);
+        m_pData = nullptr;
+    }
+    for (auto& stRetired : m_vRetired) {
+        munmap((void*)stRetired.first, stRetired.second);
+    }
+    m_vRetired.clear();
+    m_nSize = 0;
+    m_nMapSize = 0;
+    if (m_nFd >= 0) {
+        ::close(m_nFd);
+        m_nFd = -1;
+    }
+}
+
+bool AnnexBFile::remap() {
+    struct stat st;
+    if (m_nFd < 0 || fstat(m_nFd, &st) < 0 || (size_t)st.st_size <= m_nSize) {
+        return false;
+    }
+    if ((size_t)st.st_size <= m_nMapSize) {
+        m_nSize = st.st_size;
+        return true;
+    }
+    void* pMap = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, m_nFd, 0);
+    if (pMap == MAP_FAILED) {
+        ff_error("annexb: mmap %s failed: %s\n", m_sPath.c_str(), strerror(errno));
+        return false;
+    }
+    madvise(pMap, st.st_size, MADV_SEQUENTIAL);
+    if (m_pData != nullptr) {
+        m_vRetired.push_back({m_pData, m_nMapSize});
+    }
+    m_pData = (const uint8_t*)pMap;
+    m_nSize = st.st_size;
+    m_nMapSize = st.st_size;
+    return true;
+}
+
+size_t AnnexBFile::accessUnit(size_t nOffset, bool* pKey, bool* pAtEnd) const {
+    if (m_pData == nullptr || nOffset >= m_nSize) {
+        return 0;
+    }
+    size_t nLen = NaluUtil::nextAccessUnit(m_pData + nOffset, m_nSize - nOffset, m_bHevc, pKey);
+    if (pAtEnd != nullptr) {
+        *pAtEnd = nOffset + nLen == m_nSize;
+    }
+    return nLen;
+}
@@ -0,0 +1,42 @@
+#ifndef ANNEXBFILE_H
+#define ANNEXBFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// 只读映射的Annex-B裸流文件(.h264/.h265)，按访问单元切分，返回的指针直接指向映射内存。
+// 文件仍在写入时(当前录像分段)可按nReserve预留更大的映射区间，之后remap只更新大小，地址不变，
+// 已交给下游的缓冲区仍然有效。
+class AnnexBFile {
+public:
+    AnnexBFile();
+    ~AnnexBFile();
+
+    int open(const std::string& sPath, bool bHevc, size_t nReserve = 0);
+    void close();
+    // 文件变大时更新可读范围，返回是否有新数据
+    bool remap();
+
+    const uint8_t* data() const { return m_pData; }
+    size_t size() const { return m_nSize; }
+    bool isHevc() const { return m_bHevc; }
+    const std::string& path() const { return m_sPath; }
+
+    // 取nOffset处开始的访问单元，返回长度，没有完整的帧返回0。
+    // 到达映射末尾的帧在文件仍在写入时可能不完整，bAtEnd返回true由调用方决定是否等待
+    size_t accessUnit(size_t nOffset, bool* pKey, bool* pAtEnd = nullptr) const;
+
+private:
+    std::string m_sPath;
+    int m_nFd = -1;
+    const uint8_t* m_pData = nullptr;
+    size_t m_nSize = 0;
+    size_t m_nMapSize = 0;
+    // 超出预留区间后重新映射，旧映射保留到关闭
+    std::vector<std::pair<const uint8_t*, size_t>> m_vRetired;
+    bool m_bHevc = false;
+};
+
+#endif // ANNEXBFILE_H
@@ -0,0 +1,164 @@
+#include "BufferPool.h"
+
+#include <algorithm>
+
+#define BUFFER_POOL_MIN_CLASS 4096
+
+BufferPool* BufferPool::getInstance() {
+    // 缓冲区的释放回调引用池，进程退出前不析构
+    static BufferPool* s_pInstance = new BufferPool();
+    return s_pInstance;
+}
+
+size_t BufferPool::frameSize(const ImagePara& stPara) {
+    uint32_t nWidth = std::max(stPara.hstride, stPara.width);
+    uint32_t nHeight = std::max(stPara.vstride, stPara.height);
+    return v4l2GetFrameSize(stPara.v4l2Fmt, nWidth, nHeight);
+}
+
+// 每个2的幂区间分8档，浪费不超过1/8
+size_t BufferPool::sizeClass(size_t nBytes) {
+    if (nBytes <= BUFFER_POOL_MIN_CLASS) {
+        return BUFFER_POOL_MIN_CLASS;
+    }
+    int nShift = 63 - __builtin_clzll(nBytes) - 3;
+    size_t nStep = (size_t)1 << nShift;
+    return (nBytes + nStep - 1) & ~(nStep - 1);
+}
+
+// 调用时已加锁，预算不够时释放空闲缓冲区，从大的开始
+bool BufferPool::reserve(size_t nBytes) {
+    if (m_nBudget == 0 || m_nAllocated + nBytes <= m_nBudget) {
+        return true;
+    }
+    for (auto it = m_mIdle.rbegin(); it != m_mIdle.rend() && m_nAllocated + nBytes > m_nBudget; ++it) {
+        std::vector<VideoBuffer*>& vIdle = it->second;
+        while (!vIdle.empty() && m_nAllocated + nBytes > m_nBudget) {
+            delete vIdle.back();
+            vIdle.pop_back();
+            m_nAllocated -= it->first.second;
+            m_nIdle -= it->first.second;
+            m_nBuffers--;
+        }
+    }
+    return m_nAllocated + nBytes <= m_nBudget;
+}
+
+shared_ptr<VideoBuffer> BufferPool::acquire(const ImagePara& stPara, VideoBuffer::BUFFER_TYPE eType) {
+    size_t nFrame = frameSize(stPara);
+    if (nFrame == 0) {
+        ff_error("buffer pool: invalid para %ux%u\n", stPara.width, stPara.height);
+        return nullptr;
+    }
+    Key key(eType, sizeClass(nFrame));
+    VideoBuffer* pBuffer = nullptr;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        std::vector<VideoBuffer*>& vIdle = m_mIdle[key];
+        if (!vIdle.empty()) {
+            pBuffer = vIdle.back();
+            vIdle.pop_back();
+            m_nIdle -= key.second;
+            m_nHits++;
+        } else if (!reserve(key.second)) {
+            m_nFailures++;
+            ff_warn("buffer pool: budget exceeded, %llu of %llu bytes in use\n",
+                    (unsigned long long)(m_nAllocated - m_nIdle), (unsigned long long)m_nBudget);
+            return nullptr;
+        } else {
+            // 先计入，申请在锁外进行
+            m_nAllocated += key.second;
+            m_nBuffers++;
+            m_nMisses++;
+        }
+    }
+    if (pBuffer == nullptr) {
+        pBuffer = new VideoBuffer(eType);
+        pBuffer->allocBuffer(key.second);
+        if (pBuffer->getData() == nullptr || pBuffer->getSize() < key.second) {
+            // CMA不足时allocBuffer不报错，只是大小为0
+            ff_error("buffer pool: failed to alloc %zu bytes\n", key.second);
+            delete pBuffer;
+            std::lock_guard<std::mutex> locker(m_mutex);
+            m_nAllocated -= key.second;
+            m_nBuffers--;
+            m_nFailures++;
+            return nullptr;
+        }
+    }
+    // 复用的缓冲区恢复为新建时的状态
+    pBuffer->setImagePara(stPara);
+    pBuffer->setActiveData(pBuffer->getData());
+    pBuffer->setActiveSize(nFrame);
+    pBuffer->setIndex(0);
+    pBuffer->setEos(false);
+    pBuffer->setPUstimestamp(0);
+    pBuffer->setDUstimestamp(0);
+    pBuffer->setPrivateData(nullptr);
+    pBuffer->setExtraData(nullptr);
+    pBuffer->setStatus(false);
+    pBuffer->setRefCount(0);
+    pBuffer->setMediaBufferType(BUFFER_TYPE_VIDEO);
+    return shared_ptr<VideoBuffer>(pBuffer, [this, key](VideoBuffer* p) { recycle(p, key); });
+}
+
+void BufferPool::recycle(VideoBuffer* pBuffer, Key key) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_nBudget != 0 && m_nAllocated > m_nBudget) {
+        // 预算被调小，超出的部分不再保留
+        delete pBuffer;
+        m_nAllocated -= key.second;
+        m_nBuffers--;
+        return;
+    }
+    m_mIdle[key].push_back(pBuffer);
+    m_nIdle += key.second;
+}
+
+int BufferPool::fill(std::vector<shared_ptr<MediaBuffer>>& vPool, std::vector<shared_ptr<MediaBuffer>>& vQueue,
+                     uint16_t nCount, const ImagePara& stPara, VideoBuffer::BUFFER_TYPE eType) {
+    while (vPool.size() < nCount) {
+        shared_ptr<VideoBuffer> pBuffer = acquire(stPara, eType);
+        if (pBuffer == nullptr) {
+            return -1;
+        }
+        // 与ModuleMedia::initBuffer一致，序号为在池中的位置
+        pBuffer->setIndex(vPool.size());
+        vPool.push_back(pBuffer);
+        vQueue.push_back(pBuffer);
+    }
+    return 0;
+}
+
+void BufferPool::setBudget(uint64_t nBytes) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nBudget = nBytes;
+    reserve(0);
+}
+
+void BufferPool::trim() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    for (auto& it : m_mIdle) {
+        for (VideoBuffer* pBuffer : it.second) {
+            delete pBuffer;
+            m_nAllocated -= it.first.second;
+            m_nBuffers--;
+        }
+        it.second.clear();
+    }
+    m_nIdle = 0;
+}
+
+BufferPool::StStats BufferPool::getStats() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    StStats stStats;
+    stStats.nBudget = m_nBudget;
+    stStats.nAllocated = m_nAllocated;
+    stStats.nIdle = m_nIdle;
+    stStats.nInUse = m_nAllocated - m_nIdle;
+    stStats.nBuffers = m_nBuffers;
+    stStats.nHits = m_nHits;
+    stStats.nMisses = m_nMisses;
+    stStats.nFailures = m_nFailures;
+    return stStats;
+}
@@ -0,0 +1,91 @@
+#ifndef BUFFERPOOL_H
+#define BUFFERPOOL_H
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "module/module_media.hpp"
+#include "base/video_buffer.hpp"
+
+// 进程内共享的图像缓冲区池。按缓冲区类型和大小档位(每档最多多出1/8)分桶，
+// 释放时放回空闲列表，下次同档位的申请直接复用，重连或增减路数时不再反复向CMA申请和释放。
+// 全部缓冲区(使用中及空闲)受总预算限制，超出时先释放空闲的，仍不够则申请失败。
+// 用法：
+//   shared_ptr<VideoBuffer> pBuffer = BufferPool::getInstance()->acquire(stPara);  // 最后一个引用释放时自动放回
+//   auto pRga = make_shared<PooledModule<ModuleRga>>(stInPara, stOutPara, RGA_ROTATE_NONE);  // 组件输出缓冲区从池中取
+class BufferPool {
+public:
+    struct StStats {
+        // 0为不限制
+        uint64_t nBudget;
+        // 已申请的总字节数，包括空闲的
+        uint64_t nAllocated;
+        uint64_t nInUse;
+        uint64_t nIdle;
+        uint32_t nBuffers;
+        // 复用次数、新申请次数、失败次数
+        uint64_t nHits;
+        uint64_t nMisses;
+        uint64_t nFailures;
+    };
+
+public:
+    static BufferPool* getInstance();
+
+    // 返回的缓冲区已设置图像参数，有效大小为一帧大小，失败返回nullptr
+    shared_ptr<VideoBuffer> acquire(const ImagePara& stPara, VideoBuffer::BUFFER_TYPE eType = VideoBuffer::DRM_BUFFER_CACHEABLE);
+    // 补足组件的输出缓冲区到nCount个，之后ModuleMedia::initBuffer不再另外申请
+    int fill(std::vector<shared_ptr<MediaBuffer>>& vPool, std::vector<shared_ptr<MediaBuffer>>& vQueue,
+             uint16_t nCount, const ImagePara& stPara, VideoBuffer::BUFFER_TYPE eType);
+    // 总预算(字节)，0为不限制
+    void setBudget(uint64_t nBytes);
+    // 释放全部空闲缓冲区
+    void trim();
+    StStats getStats();
+
+    static size_t frameSize(const ImagePara& stPara);
+    static size_t sizeClass(size_t nBytes);
+
+private:
+    BufferPool() {}
+    typedef std::pair<int, size_t> Key;
+    void recycle(VideoBuffer* pBuffer, Key key);
+    bool reserve(size_t nBytes);
+
+private:
+    std::mutex m_mutex;
+    std::map<Key, std::vector<VideoBuffer*>> m_mIdle;
+    uint64_t m_nBudget = 0;
+    uint64_t m_nAllocated = 0;
+    uint64_t m_nIdle = 0;
+    uint32_t m_nBuffers = 0;
+    uint64_t m_nHits = 0;
+    uint64_t m_nMisses = 0;
+    uint64_t m_nFailures = 0;
+};
+
+// 输出缓冲区从BufferPool取的组件，T为ModuleRga等由ModuleMedia::initBuffer申请输出缓冲区的组件。
+// ModuleMppDec/ModuleMppEnc的缓冲区由mpp管理，不适用。
+template <class T>
+class PooledModule : public T {
+public:
+    using T::T;
+
+protected:
+    int initBuffer() override {
+        VideoBuffer::BUFFER_TYPE eType = v4l2fmtIsCompressed(this->output_para.v4l2Fmt) ? VideoBuffer::MALLOC_BUFFER
+                                                                                        : VideoBuffer::DRM_BUFFER_CACHEABLE;
+        if (BufferPool::getInstance()->fill(this->buffer_pool, this->buffer_ptr_queue, this->buffer_count,
+                                            this->output_para, eType) < 0) {
+            return -1;
+        }
+        return T::initBuffer();
+    }
+};
+
+#endif // BUFFERPOOL_H
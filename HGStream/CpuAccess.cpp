@@ -0,0 +1,211 @@
+#include "CpuAccess.h"
+
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <linux/dma-buf.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include "base/ff_log.h"
+
+#ifndef DMA_BUF_IOCTL_SYNC_PARTIAL
+// Rockchip内核扩展，按区间同步
+struct dma_buf_sync_partial {
+    __u64 flags;
+    __u32 offset;
+    __u32 len;
+};
+#define DMA_BUF_IOCTL_SYNC_PARTIAL _IOW(DMA_BUF_BASE, 2, struct dma_buf_sync_partial)
+#endif
+
+// 区间按缓存行对齐
+#define CPU_ACCESS_CACHE_LINE 64
+
+namespace {
+
+std::atomic<uint64_t> g_nSyncs{0};
+std::atomic<uint64_t> g_nPartial{0};
+std::atomic<uint64_t> g_nSkipped{0};
+std::atomic<uint64_t> g_nBytes{0};
+std::atomic<uint64_t> g_nTimeUs{0};
+// 内核不支持按区间同步时不再尝试
+std::atomic<bool> g_bPartial{true};
+
+uint64_t nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool isSemiPlanar(uint32_t nFmt) {
+    return nFmt == V4L2_PIX_FMT_NV12 || nFmt == V4L2_PIX_FMT_NV21 ||
+           nFmt == V4L2_PIX_FMT_NV16 || nFmt == V4L2_PIX_FMT_NV61;
+}
+
+} // namespace
+
+CpuAccess::CpuAccess(VideoBuffer* pBuffer, Mode eMode) : m_pBuffer(pBuffer), m_eMode(eMode) {
+    if (pBuffer != nullptr && pBuffer->getData() != nullptr) {
+        size_t nBase = (uint8_t*)pBuffer->getActiveData() - (uint8_t*)pBuffer->getData();
+        m_vRanges[0] = {nBase, pBuffer->getActiveSize()};
+        m_nRanges = 1;
+    }
+    begin();
+}
+
+CpuAccess::CpuAccess(VideoBuffer* pBuffer, Mode eMode, const StRange* pRanges, int nRanges)
+    : m_pBuffer(pBuffer), m_eMode(eMode) {
+    if (nRanges <= MAX_RANGES) {
+        std::copy(pRanges, pRanges + nRanges, m_vRanges);
+        m_nRanges = nRanges;
+    } else {
+        size_t nBegin = pRanges[0].nOffset;
+        size_t nEnd = pRanges[0].nOffset + pRanges[0].nLen;
+        for (int i = 1; i < nRanges; ++i) {
+            nBegin = std::min(nBegin, pRanges[i].nOffset);
+            nEnd = std::max(nEnd, pRanges[i].nOffset + pRanges[i].nLen);
+        }
+        m_vRanges[0] = {nBegin, nEnd - nBegin};
+        m_nRanges = 1;
+    }
+    begin();
+}
+
+CpuAccess::~CpuAccess() {
+    end();
+}
+
+uint8_t* CpuAccess::data() const {
+    return m_pBuffer != nullptr ? (uint8_t*)m_pBuffer->getData() : nullptr;
+}
+
+void CpuAccess::begin() {
+    if (m_pBuffer == nullptr) {
+        return;
+    }
+    m_bActive = true;
+    if (!(m_eMode & READ)) {
+        // 只写不读，开始时不需要同步
+        return;
+    }
+    uint64_t nFlags = DMA_BUF_SYNC_START | (m_eMode == READ_WRITE ? DMA_BUF_SYNC_RW : DMA_BUF_SYNC_READ);
+    for (int i = 0; i < m_nRanges; ++i) {
+        sync(m_pBuffer, nFlags, m_vRanges[i].nOffset, m_vRanges[i].nLen);
+    }
+}
+
+void CpuAccess::end() {
+    if (!m_bActive) {
+        return;
+    }
+    m_bActive = false;
+    if (!(m_eMode & WRITE)) {
+        return;
+    }
+    for (int i = 0; i < m_nRanges; ++i) {
+        sync(m_pBuffer, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE, m_vRanges[i].nOffset, m_vRanges[i].nLen);
+    }
+}
+
+void CpuAccess::beginRead(VideoBuffer* pBuffer, size_t nOffset, size_t nLen) {
+    sync(pBuffer, DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ, nOffset, nLen);
+}
+
+void CpuAccess::endWrite(VideoBuffer* pBuffer, size_t nOffset, size_t nLen) {
+    sync(pBuffer, DMA_BUF_SYNC_END | DMA_BUF_SYNC_WRITE, nOffset, nLen);
+}
+
+bool CpuAccess::needSync(VideoBuffer* pBuffer) {
+    // 不可缓存的映射没有缓存行，malloc缓冲区不经过DMA
+    VideoBuffer::BUFFER_TYPE eType = pBuffer->getBufferType();
+    return eType != VideoBuffer::DRM_BUFFER_NONCACHEABLE && eType != VideoBuffer::MALLOC_BUFFER;
+}
+
+void CpuAccess::sync(VideoBuffer* pBuffer, uint64_t nFlags, size_t nOffset, size_t nLen) {
+    if (pBuffer == nullptr || nLen == 0) {
+        return;
+    }
+    if (!needSync(pBuffer)) {
+        g_nSkipped++;
+        return;
+    }
+    uint64_t nStart = nowUs();
+    size_t nSize = pBuffer->getSize();
+    int nFd = pBuffer->getBufFd();
+    size_t nBegin = std::min(nOffset, nSize) & ~(size_t)(CPU_ACCESS_CACHE_LINE - 1);
+    size_t nEnd = std::min((nOffset + nLen + CPU_ACCESS_CACHE_LINE - 1) & ~(size_t)(CPU_ACCESS_CACHE_LINE - 1), nSize);
+    bool bDone = false;
+    if (nFd > 0 && nEnd > nBegin && nEnd - nBegin < nSize && g_bPartial) {
+        struct dma_buf_sync_partial stSync;
+        stSync.flags = nFlags;
+        stSync.offset = nBegin;
+        stSync.len = nEnd - nBegin;
+        if (ioctl(nFd, DMA_BUF_IOCTL_SYNC_PARTIAL, &stSync) == 0) {
+            bDone = true;
+            g_nPartial++;
+            g_nBytes += nEnd - nBegin;
+        } else if (errno == ENOTTY || errno == EINVAL) {
+            g_bPartial = false;
+            ff_warn("cpu access: partial dma-buf sync unsupported, syncing whole buffers\n");
+        }
+    }
+    if (!bDone) {
+        if (nFd > 0) {
+            struct dma_buf_sync stSync;
+            stSync.flags = nFlags;
+            ioctl(nFd, DMA_BUF_IOCTL_SYNC, &stSync);
+        } else if (nFlags & DMA_BUF_SYNC_END) {
+            pBuffer->flushDrmBuf();
+        } else {
+            pBuffer->invalidateDrmBuf();
+        }
+        g_nBytes += nSize;
+    }
+    g_nSyncs++;
+    g_nTimeUs += nowUs() - nStart;
+}
+
+int CpuAccess::rowRanges(const ImagePara& stPara, size_t nBase, int y0, int y1, StRange* pRanges) {
+    uint32_t nHStride = std::max(stPara.hstride, stPara.width);
+    uint32_t nVStride = std::max(stPara.vstride, stPara.height);
+    if (nVStride == 0) {
+        return -1;
+    }
+    y0 = std::max(y0, 0);
+    y1 = std::min(y1, (int)stPara.height);
+    if (y1 <= y0) {
+        return 0;
+    }
+    if (isSemiPlanar(stPara.v4l2Fmt)) {
+        // Y平面和UV平面各一段，4:2:0的UV每两行一行
+        size_t nUV = (size_t)nHStride * nVStride;
+        int nShift = (stPara.v4l2Fmt == V4L2_PIX_FMT_NV12 || stPara.v4l2Fmt == V4L2_PIX_FMT_NV21) ? 1 : 0;
+        int u0 = y0 >> nShift;
+        int u1 = (y1 + nShift) >> nShift;
+        pRanges[0] = {nBase + (size_t)y0 * nHStride, (size_t)(y1 - y0) * nHStride};
+        pRanges[1] = {nBase + nUV + (size_t)u0 * nHStride, (size_t)(u1 - u0) * nHStride};
+        return 2;
+    }
+    if (v4l2fmtIsCompressed(stPara.v4l2Fmt)) {
+        return -1;
+    }
+    // 打包格式每行字节数是行宽的整数倍，平面格式(如I420)不是
+    size_t nRow = v4l2GetFrameSize(stPara.v4l2Fmt, nHStride, nVStride) / nVStride;
+    if (nRow == 0 || nRow % nHStride != 0) {
+        return -1;
+    }
+    pRanges[0] = {nBase + (size_t)y0 * nRow, (size_t)(y1 - y0) * nRow};
+    return 1;
+}
+
+CpuAccess::StStats CpuAccess::getStats() {
+    StStats stStats;
+    stStats.nSyncs = g_nSyncs;
+    stStats.nPartial = g_nPartial;
+    stStats.nSkipped = g_nSkipped;
+    stStats.nBytes = g_nBytes;
+    stStats.nTimeUs = g_nTimeUs;
+    return stStats;
+}
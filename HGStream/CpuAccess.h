@@ -0,0 +1,80 @@
+#ifndef CPUACCESS_H
+#define CPUACCESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+#include "base/video_buffer.hpp"
+
+// CPU访问DRM缓冲区时的缓存同步。VideoBuffer::invalidateDrmBuf/flushDrmBuf每次同步整个缓冲区，
+// 这里只同步实际读写的区间(Rockchip内核的DMA_BUF_IOCTL_SYNC_PARTIAL，不支持时退回整个缓冲区)：
+//   读：开始前无效化读取区间，结束时不再同步(ARM上END|READ会再无效化一次，没有必要)
+//   写：只写不读的开始时不同步，结束时回写脏区间；读改写(如在帧上叠加)开始时先无效化脏区间
+// 不可缓存的DRM缓冲区和malloc缓冲区不同步。
+// 用法：
+//   { CpuAccess access(pFrameBuf.get(), CpuAccess::READ); use(access.data()); }  // 整个有效数据
+//   CpuAccess::StRange vRanges[2];
+//   int n = CpuAccess::rowRanges(pFrameBuf->getImagePara(), nBase, y0, y1, vRanges);  // 只同步y0~y1行
+//   { CpuAccess access(pFrameBuf.get(), CpuAccess::READ_WRITE, vRanges, n); draw(); }  // 析构时回写
+class CpuAccess {
+public:
+    enum Mode {
+        READ = 1,
+        WRITE = 2,
+        READ_WRITE = 3,
+    };
+
+    // 相对getData()的字节区间
+    struct StRange {
+        size_t nOffset;
+        size_t nLen;
+    };
+
+    // 同步次数和耗时，进程内累计
+    struct StStats {
+        uint64_t nSyncs;
+        // 其中按区间同步的次数
+        uint64_t nPartial;
+        // 不可缓存或malloc缓冲区跳过的次数
+        uint64_t nSkipped;
+        uint64_t nBytes;
+        uint64_t nTimeUs;
+    };
+
+    static const int MAX_RANGES = 4;
+
+public:
+    // 整个有效数据(getActiveData起getActiveSize字节)
+    CpuAccess(VideoBuffer* pBuffer, Mode eMode);
+    // 多于MAX_RANGES个区间时合并为一个
+    CpuAccess(VideoBuffer* pBuffer, Mode eMode, const StRange* pRanges, int nRanges);
+    ~CpuAccess();
+
+    uint8_t* data() const;
+    // 提前结束访问，之后析构不再同步
+    void end();
+
+    // 读开始/写结束的单次同步，供跨越作用域的访问使用
+    static void beginRead(VideoBuffer* pBuffer, size_t nOffset, size_t nLen);
+    static void endWrite(VideoBuffer* pBuffer, size_t nOffset, size_t nLen);
+    // 图像y0到y1行(不含y1)在各平面上的区间(最多2个)，nBase为图像相对getData()的偏移，
+    // 返回区间个数，不支持的格式(码流、三平面)返回-1
+    static int rowRanges(const ImagePara& stPara, size_t nBase, int y0, int y1, StRange* pRanges);
+    static StStats getStats();
+
+private:
+    static bool needSync(VideoBuffer* pBuffer);
+    static void sync(VideoBuffer* pBuffer, uint64_t nFlags, size_t nOffset, size_t nLen);
+    void begin();
+
+private:
+    VideoBuffer* m_pBuffer;
+    Mode m_eMode;
+    StRange m_vRanges[MAX_RANGES];
+    int m_nRanges = 0;
+    bool m_bActive = false;
+};
+
+#endif // CPUACCESS_H
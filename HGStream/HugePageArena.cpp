@@ -0,0 +1,129 @@
+#include "HugePageArena.h"
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "base/ff_log.h"
+
+#define HUGE_PAGE_SIZE ((size_t)2 << 20)
+
+HugePageArena* HugePageArena::getInstance() {
+    // 池中的缓冲区在进程退出前都可能指向内存区，不析构
+    static HugePageArena* s_pInstance = new HugePageArena();
+    return s_pInstance;
+}
+
+int HugePageArena::init(size_t nSlotBytes, uint32_t nSlots) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_vFree.size() != m_nSlots) {
+        ff_error("huge page arena: %zu slots still in use\n", m_nSlots - m_vFree.size());
+        return -1;
+    }
+    release();
+    if (nSlots == 0 || nSlotBytes == 0) {
+        return 0;
+    }
+    size_t nSlot = (nSlotBytes + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    size_t nBytes = nSlot * nSlots;
+    void* pBase = mmap(nullptr, nBytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    m_bHugeTlb = pBase != MAP_FAILED;
+    if (pBase == MAP_FAILED) {
+        // 没有预留大页，多映射一页用来按2MB对齐，交给透明大页
+        size_t nMap = nBytes + HUGE_PAGE_SIZE;
+        uint8_t* pMap = (uint8_t*)mmap(nullptr, nMap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pMap == MAP_FAILED) {
+            ff_error("huge page arena: failed to map %zu bytes\n", nBytes);
+            return -1;
+        }
+        uint8_t* pAligned = (uint8_t*)(((uintptr_t)pMap + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1));
+        if (pAligned > pMap) {
+            munmap(pMap, pAligned - pMap);
+        }
+        size_t nTail = (pMap + nMap) - (pAligned + nBytes);
+        if (nTail > 0) {
+            munmap(pAligned + nBytes, nTail);
+        }
+        if (madvise(pAligned, nBytes, MADV_HUGEPAGE) != 0) {
+            ff_warn("huge page arena: transparent huge pages unavailable\n");
+        }
+        // 先写一遍，缺页和合并大页在启动时完成
+        memset(pAligned, 0, nBytes);
+        pBase = pAligned;
+    }
+    m_pBase = (uint8_t*)pBase;
+    m_nMapBytes = nBytes;
+    m_nSlotBytes = nSlot;
+    m_nSlots = nSlots;
+    m_vFree.clear();
+    m_vInUse.assign(nSlots, false);
+    for (uint32_t i = nSlots; i > 0; --i) {
+        m_vFree.push_back(i - 1);
+    }
+    ff_info("huge page arena: %u slots of %zu bytes (%s)\n", nSlots, nSlot, m_bHugeTlb ? "hugetlb" : "thp");
+    return 0;
+}
+
+void HugePageArena::release() {
+    if (m_pBase != nullptr) {
+        munmap(m_pBase, m_nMapBytes);
+    }
+    m_pBase = nullptr;
+    m_nMapBytes = 0;
+    m_nSlotBytes = 0;
+    m_nSlots = 0;
+    m_vFree.clear();
+    m_vInUse.clear();
+}
+
+void* HugePageArena::alloc(size_t nBytes) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_pBase == nullptr) {
+        return nullptr;
+    }
+    // 小于半个槽的交给malloc，避免浪费整个槽
+    if (nBytes > m_nSlotBytes || nBytes <= m_nSlotBytes / 2 || m_vFree.empty()) {
+        m_nFallbacks++;
+        return nullptr;
+    }
+    uint32_t nSlot = m_vFree.back();
+    m_vFree.pop_back();
+    m_vInUse[nSlot] = true;
+    m_nAllocs++;
+    return m_pBase + (size_t)nSlot * m_nSlotBytes;
+}
+
+bool HugePageArena::free(void* pData) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    uint8_t* p = (uint8_t*)pData;
+    if (m_pBase == nullptr || p < m_pBase || p >= m_pBase + m_nMapBytes) {
+        return false;
+    }
+    // 不是槽起始或槽已空闲时不归还，否则同一个槽会被分配两次
+    size_t nOffset = p - m_pBase;
+    uint32_t nSlot = nOffset / m_nSlotBytes;
+    if (nOffset % m_nSlotBytes != 0 || !m_vInUse[nSlot]) {
+        ff_error("huge page arena: invalid free of %p\n", pData);
+        return true;
+    }
+    m_vInUse[nSlot] = false;
+    m_vFree.push_back(nSlot);
+    return true;
+}
+
+bool HugePageArena::isEnabled() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_pBase != nullptr;
+}
+
+HugePageArena::StStats HugePageArena::getStats() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    StStats stStats;
+    stStats.nSlotBytes = m_nSlotBytes;
+    stStats.nSlots = m_nSlots;
+    stStats.nFreeSlots = m_vFree.size();
+    stStats.bHugeTlb = m_bHugeTlb;
+    stStats.nAllocs = m_nAllocs;
+    stStats.nFallbacks = m_nFallbacks;
+    return stStats;
+}
@@ -0,0 +1,60 @@
+#ifndef HUGEPAGEARENA_H
+#define HUGEPAGEARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <vector>
+
+// 2MB大页内存区，启动时一次申请nSlots个固定大小的帧槽，每个槽按2MB对齐。
+// 1080p/4K的一帧在4K页上要占上千个页表项，CPU做格式转换、拷贝时TLB缺失明显，放在大页上只占几个。
+// 优先使用hugetlbfs预留的大页(需要先设置/proc/sys/vm/nr_hugepages)，没有时退回透明大页(madvise)。
+// HG_AllocFrameBuffer(应用侧送推流前的帧缓冲)申请大小在(槽大小/2, 槽大小]之间时先从这里取，槽用完后退回malloc。
+// 用法：
+//   HugePageArena::getInstance()->init(1920 * 1080 * 3, 8);  // 8个1080p BGR帧槽
+//   void* p = HugePageArena::getInstance()->alloc(nBytes);      // 不合适或用完时返回nullptr
+//   HugePageArena::getInstance()->free(p);
+class HugePageArena {
+public:
+    struct StStats {
+        // 按2MB取整后的槽大小
+        size_t nSlotBytes;
+        uint32_t nSlots;
+        uint32_t nFreeSlots;
+        // true为hugetlbfs大页，false为透明大页
+        bool bHugeTlb;
+        uint64_t nAllocs;
+        // 槽用完或大小不合适退回malloc的次数
+        uint64_t nFallbacks;
+    };
+
+public:
+    static HugePageArena* getInstance();
+
+    // 重新设置前全部槽必须已释放，nSlots为0时释放内存区
+    int init(size_t nSlotBytes, uint32_t nSlots);
+    void* alloc(size_t nBytes);
+    // 不属于内存区的指针返回false；属于内存区但不是槽起始或重复释放时报错并忽略，仍返回true
+    bool free(void* pData);
+    bool isEnabled();
+    StStats getStats();
+
+private:
+    HugePageArena() {}
+    void release();
+
+private:
+    std::mutex m_mutex;
+    uint8_t* m_pBase = nullptr;
+    size_t m_nMapBytes = 0;
+    size_t m_nSlotBytes = 0;
+    uint32_t m_nSlots = 0;
+    std::vector<uint32_t> m_vFree;
+    std::vector<bool> m_vInUse;
+    bool m_bHugeTlb = false;
+    uint64_t m_nAllocs = 0;
+    uint64_t m_nFallbacks = 0;
+};
+
+#endif // HUGEPAGEARENA_H
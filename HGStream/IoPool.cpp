@@ -0,0 +1,163 @@
+#include "IoPool.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// 每次最多连续执行的任务数，之后重新投递，同一磁盘上的多个队列轮流执行
+#define IOQUEUE_BATCH 4
+
+IoPool::IoPool(uint32_t nThreads, uint32_t nPerDisk) : m_nThreads(std::max(nThreads, 1u)), m_nPerDisk(std::max(nPerDisk, 1u)) {
+}
+
+IoPool::~IoPool() {
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_bExit = true;
+    }
+    m_cond.notify_all();
+    for (std::thread& thread : m_vThreads) {
+        thread.join();
+    }
+}
+
+IoPool& IoPool::shared() {
+    static IoPool pool;
+    return pool;
+}
+
+uint64_t IoPool::diskOf(const std::string& sPath) {
+    struct stat st;
+    if (stat(sPath.c_str(), &st) < 0) {
+        return 0;
+    }
+    return (uint64_t)st.st_dev;
+}
+
+void IoPool::post(uint64_t nDisk, Task task) {
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (m_vThreads.empty()) {
+            for (uint32_t i = 0; i < m_nThreads; ++i) {
+                m_vThreads.emplace_back(&IoPool::workerLoop, this);
+                std::string sName = "hg-io-" + std::to_string(i);
+                pthread_setname_np(m_vThreads.back().native_handle(), sName.c_str());
+            }
+        }
+        m_mapDisks[nDisk].dqTasks.push_back(std::move(task));
+    }
+    m_cond.notify_one();
+}
+
+void IoPool::prefetch(uint64_t nDisk, std::shared_ptr<const void> pOwner, const uint8_t* pData, size_t nSize) {
+    if (pData == nullptr || nSize == 0) {
+        return;
+    }
+    post(nDisk, [pOwner, pData, nSize]() {
+        // 每页读一个字节
+        uintptr_t nPage = (uintptr_t)sysconf(_SC_PAGESIZE);
+        for (uintptr_t p = (uintptr_t)pData; p < (uintptr_t)(pData + nSize); p = (p & ~(nPage - 1)) + nPage) {
+            (void)*(const volatile uint8_t*)p;
+        }
+    });
+}
+
+void IoPool::setPerDiskLimit(uint32_t nLimit) {
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_nPerDisk = std::max(nLimit, 1u);
+    }
+    m_cond.notify_all();
+}
+
+// 调用时已持有m_mutex，从上次的磁盘之后开始找有任务且未达上限的磁盘
+bool IoPool::popTask(Task& task, uint64_t& nDisk) {
+    auto it = m_mapDisks.upper_bound(m_nLastDisk);
+    for (size_t i = 0; i < m_mapDisks.size(); ++i, ++it) {
+        if (it == m_mapDisks.end()) {
+            it = m_mapDisks.begin();
+        }
+        StDisk& stDisk = it->second;
+        if (!stDisk.dqTasks.empty() && stDisk.nRunning < m_nPerDisk) {
+            task = std::move(stDisk.dqTasks.front());
+            stDisk.dqTasks.pop_front();
+            stDisk.nRunning++;
+            nDisk = it->first;
+            m_nLastDisk = nDisk;
+            return true;
+        }
+    }
+    return false;
+}
+
+void IoPool::workerLoop() {
+    std::unique_lock<std::mutex> locker(m_mutex);
+    Task task;
+    uint64_t nDisk = 0;
+    while (true) {
+        if (popTask(task, nDisk)) {
+            locker.unlock();
+            task();
+            task = nullptr;
+            locker.lock();
+            // 本线程接着取任务，磁盘名额释放后不需要唤醒其他线程
+            m_mapDisks[nDisk].nRunning--;
+            continue;
+        }
+        if (m_bExit) {
+            break;
+        }
+        m_cond.wait(locker);
+    }
+}
+
+IoQueue::IoQueue(IoPool& pool) : m_pool(pool) {
+}
+
+IoQueue::~IoQueue() {
+    drain();
+}
+
+void IoQueue::post(IoPool::Task task) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_dqTasks.push_back(std::move(task));
+    if (!m_bRunning) {
+        m_bRunning = true;
+        m_pool.post(m_nDisk, [this]() { run(); });
+    }
+}
+
+void IoQueue::drain() {
+    std::unique_lock<std::mutex> locker(m_mutex);
+    m_cond.wait(locker, [this]() { return !m_bRunning; });
+}
+
+void IoQueue::run() {
+    std::unique_lock<std::mutex> locker(m_mutex);
+    for (int i = 0; i < IOQUEUE_BATCH && !m_dqTasks.empty(); ++i) {
+        IoPool::Task task = std::move(m_dqTasks.front());
+        m_dqTasks.pop_front();
+        locker.unlock();
+        task();
+        locker.lock();
+    }
+    if (m_dqTasks.empty()) {
+        m_bRunning = false;
+        m_cond.notify_all();
+    } else {
+        m_pool.post(m_nDisk, [this]() { run(); });
+    }
+}
+
+void IoReadAhead::advance(std::shared_ptr<const void> pOwner, const uint8_t* pBase, size_t nSize, size_t nOffset) {
+    if (m_nEnd < nOffset || m_nEnd > nOffset + 2 * m_nWindow) {
+        m_nEnd = nOffset;
+    }
+    if (m_nEnd >= nOffset + m_nWindow || m_nEnd >= nSize) {
+        return;
+    }
+    size_t nLen = std::min(m_nWindow, nSize - m_nEnd);
+    IoPool::shared().prefetch(m_nDisk, std::move(pOwner), pBase + m_nEnd, nLen);
+    m_nEnd += nLen;
+}
@@ -0,0 +1,102 @@
+#ifndef IOPOOL_H
+#define IOPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 进程内共享的磁盘IO线程池，线程数固定(默认4)，不随路数增长，用来代替每个组件一个的写盘/读盘线程。
+// 任务按所在磁盘(st_dev)分组，每块磁盘同时执行的任务数有上限(默认2)，
+// 一块磁盘变慢只占住它自己的名额，其余线程继续处理其他磁盘的任务。
+// 线程在第一次投递时创建，继承投递线程的绑核和调度设置。
+class IoPool {
+public:
+    typedef std::function<void()> Task;
+
+public:
+    explicit IoPool(uint32_t nThreads = 4, uint32_t nPerDisk = 2);
+    ~IoPool();
+
+    // nDisk为diskOf的返回值，同一磁盘的任务按投递顺序开始执行
+    void post(uint64_t nDisk, Task task);
+    // 预读[pData, pData + nSize)所在的页，缺页阻塞在池中的线程而不是调用者；pOwner保证执行时映射仍有效
+    void prefetch(uint64_t nDisk, std::shared_ptr<const void> pOwner, const uint8_t* pData, size_t nSize);
+    // 每块磁盘同时执行的任务数上限，最小为1
+    void setPerDiskLimit(uint32_t nLimit);
+
+    // 路径所在的设备号，获取失败返回0(所有失败的路径共用一组名额)
+    static uint64_t diskOf(const std::string& sPath);
+    static IoPool& shared();
+
+private:
+    struct StDisk {
+        std::deque<Task> dqTasks;
+        uint32_t nRunning = 0;
+    };
+
+    void workerLoop();
+    bool popTask(Task& task, uint64_t& nDisk);
+
+private:
+    uint32_t m_nThreads;
+    uint32_t m_nPerDisk;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::map<uint64_t, StDisk> m_mapDisks;
+    // 上一次取任务的磁盘，下一次从它之后开始找，各磁盘轮流
+    uint64_t m_nLastDisk = 0;
+    bool m_bExit = false;
+    std::vector<std::thread> m_vThreads;
+};
+
+// 在IoPool上按投递顺序逐个执行的任务队列，同一队列的任务不会并发，
+// 有任务时才占用线程，用来代替每个组件一个的后台IO线程。
+class IoQueue {
+public:
+    explicit IoQueue(IoPool& pool = IoPool::shared());
+    ~IoQueue();
+
+    // 设置所在磁盘，需在第一次post之前调用
+    void setDisk(uint64_t nDisk) { m_nDisk = nDisk; }
+    void post(IoPool::Task task);
+    // 等待已投递的任务全部执行完，不能在本队列的任务中调用
+    void drain();
+
+private:
+    void run();
+
+private:
+    IoPool& m_pool;
+    uint64_t m_nDisk = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<IoPool::Task> m_dqTasks;
+    bool m_bRunning = false;
+};
+
+// 顺序读取映射文件时让前方保持一个窗口已在页缓存中，由IoPool预读，读取线程不再阻塞在磁盘上。
+// 位置跳变(seek、循环)时从新位置重新开始，切换文件时调用reset。
+class IoReadAhead {
+public:
+    explicit IoReadAhead(size_t nWindow = 1 << 20) : m_nWindow(nWindow) {}
+
+    void setDisk(uint64_t nDisk) { m_nDisk = nDisk; }
+    void reset() { m_nEnd = 0; }
+    // pBase为映射起始地址，nSize为可读大小，nOffset为当前读取位置，pOwner持有映射
+    void advance(std::shared_ptr<const void> pOwner, const uint8_t* pBase, size_t nSize, size_t nOffset);
+
+private:
+    size_t m_nWindow;
+    uint64_t m_nDisk = 0;
+    // 已投递预读的范围末尾
+    size_t m_nEnd = 0;
+};
+
+#endif // IOPOOL_H
@@ -0,0 +1,363 @@
+#include "JsonValue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+class JsonParser {
+public:
+    JsonParser(const std::string& sText) : m_sText(sText) {}
+
+    bool parse(JsonValue& stValue, std::string& sError) {
+        if (!parseValue(stValue, 0)) {
+            sError = m_sError;
+            return false;
+        }
+        skipSpace();
+        if (m_nPos != m_sText.size()) {
+            fail("unexpected trailing data");
+            sError = m_sError;
+            return false;
+        }
+        return true;
+    }
+
+private:
+    bool fail(const char* pReason) {
+        // 报告行号，便于修改配置
+        size_t nLine = 1;
+        for (size_t i = 0; i < m_nPos && i < m_sText.size(); ++i) {
+            nLine += m_sText[i] == '\n';
+        }
+        m_sError = std::string(pReason) + " at line " + std::to_string(nLine);
+        return false;
+    }
+
+    void skipSpace() {
+        while (m_nPos < m_sText.size()) {
+            char c = m_sText[m_nPos];
+            if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                m_nPos++;
+            } else if (c == '/' && m_nPos + 1 < m_sText.size() && m_sText[m_nPos + 1] == '/') {
+                // 允许//注释
+                while (m_nPos < m_sText.size() && m_sText[m_nPos] != '\n') {
+                    m_nPos++;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+
+    bool match(const char* pWord) {
+        size_t n = strlen(pWord);
+        if (m_sText.compare(m_nPos, n, pWord) == 0) {
+            m_nPos += n;
+            return true;
+        }
+        return false;
+    }
+
+    bool parseValue(JsonValue& stValue, int nDepth) {
+        if (nDepth > 64) {
+            return fail("nesting too deep");
+        }
+        skipSpace();
+        if (m_nPos >= m_sText.size()) {
+            return fail("unexpected end");
+        }
+        char c = m_sText[m_nPos];
+        if (c == '{') {
+            return parseObject(stValue, nDepth);
+        }
+        if (c == '[') {
+            return parseArray(stValue, nDepth);
+        }
+        if (c == '"') {
+            std::string s;
+            if (!parseString(s)) {
+                return false;
+            }
+            stValue = JsonValue::makeString(s);
+            return true;
+        }
+        if (match("true")) {
+            stValue = JsonValue::makeBool(true);
+            return true;
+        }
+        if (match("false")) {
+            stValue = JsonValue::makeBool(false);
+            return true;
+        }
+        if (match("null")) {
+            stValue = JsonValue();
+            return true;
+        }
+        const char* pBegin = m_sText.c_str() + m_nPos;
+        char* pEnd = nullptr;
+        double f = strtod(pBegin, &pEnd);
+        if (pEnd == pBegin) {
+            return fail("invalid value");
+        }
+        m_nPos += pEnd - pBegin;
+        stValue = JsonValue::makeNumber(f);
+        return true;
+    }
+
+    bool parseString(std::string& s) {
+        m_nPos++;
+        while (m_nPos < m_sText.size()) {
+            char c = m_sText[m_nPos++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                s += c;
+                continue;
+            }
+            if (m_nPos >= m_sText.size()) {
+                break;
+            }
+            char e = m_sText[m_nPos++];
+            switch (e) {
+            case 'n': s += '\n'; break;
+            case 't': s += '\t'; break;
+            case 'r': s += '\r'; break;
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'u': {
+                if (m_nPos + 4 > m_sText.size()) {
+                    return fail("invalid escape");
+                }
+                unsigned nCode = strtoul(m_sText.substr(m_nPos, 4).c_str(), nullptr, 16);
+                m_nPos += 4;
+                // 只处理BMP内的字符，按UTF-8输出
+                if (nCode < 0x80) {
+                    s += (char)nCode;
+                } else if (nCode < 0x800) {
+                    s += (char)(0xc0 | (nCode >> 6));
+                    s += (char)(0x80 | (nCode & 0x3f));
+                } else {
+                    s += (char)(0xe0 | (nCode >> 12));
+                    s += (char)(0x80 | ((nCode >> 6) & 0x3f));
+                    s += (char)(0x80 | (nCode & 0x3f));
+                }
+                break;
+            }
+            default: s += e; break;
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseArray(JsonValue& stValue, int nDepth) {
+        m_nPos++;
+        stValue = JsonValue::makeArray();
+        skipSpace();
+        if (m_nPos < m_sText.size() && m_sText[m_nPos] == ']') {
+            m_nPos++;
+            return true;
+        }
+        while (true) {
+            JsonValue stItem;
+            if (!parseValue(stItem, nDepth + 1)) {
+                return false;
+            }
+            stValue.append(stItem);
+            skipSpace();
+            if (m_nPos < m_sText.size() && m_sText[m_nPos] == ',') {
+                m_nPos++;
+                continue;
+            }
+            if (m_nPos < m_sText.size() && m_sText[m_nPos] == ']') {
+                m_nPos++;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parseObject(JsonValue& stValue, int nDepth) {
+        m_nPos++;
+        stValue = JsonValue::makeObject();
+        skipSpace();
+        if (m_nPos < m_sText.size() && m_sText[m_nPos] == '}') {
+            m_nPos++;
+            return true;
+        }
+        while (true) {
+            skipSpace();
+            std::string sKey;
+            if (m_nPos >= m_sText.size() || m_sText[m_nPos] != '"' || !parseString(sKey)) {
+                return fail("expected key");
+            }
+            skipSpace();
+            if (m_nPos >= m_sText.size() || m_sText[m_nPos] != ':') {
+                return fail("expected ':'");
+            }
+            m_nPos++;
+            JsonValue stItem;
+            if (!parseValue(stItem, nDepth + 1)) {
+                return false;
+            }
+            stValue.set(sKey, stItem);
+            skipSpace();
+            if (m_nPos < m_sText.size() && m_sText[m_nPos] == ',') {
+                m_nPos++;
+                continue;
+            }
+            if (m_nPos < m_sText.size() && m_sText[m_nPos] == '}') {
+                m_nPos++;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+private:
+    const std::string& m_sText;
+    size_t m_nPos = 0;
+    std::string m_sError;
+};
+
+} // namespace
+
+bool JsonValue::parse(const std::string& sText, JsonValue& stValue, std::string& sError) {
+    JsonParser parser(sText);
+    return parser.parse(stValue, sError);
+}
+
+bool JsonValue::parseFile(const std::string& sPath, JsonValue& stValue, std::string& sError) {
+    std::ifstream file(sPath);
+    if (!file.is_open()) {
+        sError = "can't open " + sPath;
+        return false;
+    }
+    std::stringstream ss;
+    ss << file.rdbuf();
+    return parse(ss.str(), stValue, sError);
+}
+
+bool JsonValue::asBool(bool bDefault) const {
+    if (m_eType == TYPE_BOOL) {
+        return m_bValue;
+    }
+    if (m_eType == TYPE_NUMBER) {
+        return m_fValue != 0;
+    }
+    return bDefault;
+}
+
+double JsonValue::asDouble(double fDefault) const {
+    if (m_eType == TYPE_NUMBER) {
+        return m_fValue;
+    }
+    if (m_eType == TYPE_STRING && !m_sValue.empty()) {
+        // 模板展开后的数字是字符串
+        char* pEnd = nullptr;
+        double f = strtod(m_sValue.c_str(), &pEnd);
+        if (*pEnd == '\0') {
+            return f;
+        }
+    }
+    return fDefault;
+}
+
+int JsonValue::asInt(int nDefault) const {
+    return (int)asDouble(nDefault);
+}
+
+std::string JsonValue::asString(const std::string& sDefault) const {
+    if (m_eType == TYPE_STRING) {
+        return m_sValue;
+    }
+    if (m_eType == TYPE_NUMBER) {
+        char szBuf[32];
+        snprintf(szBuf, sizeof(szBuf), "%g", m_fValue);
+        return szBuf;
+    }
+    return sDefault;
+}
+
+size_t JsonValue::size() const {
+    return m_vItems.size();
+}
+
+const JsonValue& JsonValue::operator[](size_t nIndex) const {
+    static const JsonValue s_null;
+    return nIndex < m_vItems.size() ? m_vItems[nIndex] : s_null;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& sKey) const {
+    static const JsonValue s_null;
+    for (size_t i = 0; i < m_vKeys.size(); ++i) {
+        if (m_vKeys[i] == sKey) {
+            return m_vItems[i];
+        }
+    }
+    return s_null;
+}
+
+bool JsonValue::has(const std::string& sKey) const {
+    for (const std::string& sName : m_vKeys) {
+        if (sName == sKey) {
+            return true;
+        }
+    }
+    return false;
+}
+
+JsonValue JsonValue::makeBool(bool b) {
+    JsonValue stValue;
+    stValue.m_eType = TYPE_BOOL;
+    stValue.m_bValue = b;
+    return stValue;
+}
+
+JsonValue JsonValue::makeNumber(double f) {
+    JsonValue stValue;
+    stValue.m_eType = TYPE_NUMBER;
+    stValue.m_fValue = f;
+    return stValue;
+}
+
+JsonValue JsonValue::makeString(const std::string& s) {
+    JsonValue stValue;
+    stValue.m_eType = TYPE_STRING;
+    stValue.m_sValue = s;
+    return stValue;
+}
+
+JsonValue JsonValue::makeArray() {
+    JsonValue stValue;
+    stValue.m_eType = TYPE_ARRAY;
+    return stValue;
+}
+
+JsonValue JsonValue::makeObject() {
+    JsonValue stValue;
+    stValue.m_eType = TYPE_OBJECT;
+    return stValue;
+}
+
+void JsonValue::set(const std::string& sKey, const JsonValue& stValue) {
+    m_eType = TYPE_OBJECT;
+    for (size_t i = 0; i < m_vKeys.size(); ++i) {
+        if (m_vKeys[i] == sKey) {
+            m_vItems[i] = stValue;
+            return;
+        }
+    }
+    m_vKeys.push_back(sKey);
+    m_vItems.push_back(stValue);
+}
+
+void JsonValue::append(const JsonValue& stValue) {
+    m_eType = TYPE_ARRAY;
+    m_vItems.push_back(stValue);
+}
@@ -0,0 +1,65 @@
+#ifndef JSONVALUE_H
+#define JSONVALUE_H
+
+#include <string>
+#include <vector>
+
+// 简单的JSON解析，用于读取配置文件。对象保留键的原始顺序，数字统一按double保存。
+class JsonValue {
+public:
+    enum Type {
+        TYPE_NULL = 0,
+        TYPE_BOOL,
+        TYPE_NUMBER,
+        TYPE_STRING,
+        TYPE_ARRAY,
+        TYPE_OBJECT,
+    };
+
+public:
+    JsonValue() {}
+
+    // 解析失败返回false，sError为出错位置及原因
+    static bool parse(const std::string& sText, JsonValue& stValue, std::string& sError);
+    static bool parseFile(const std::string& sPath, JsonValue& stValue, std::string& sError);
+
+    Type type() const { return m_eType; }
+    bool isNull() const { return m_eType == TYPE_NULL; }
+    bool isNumber() const { return m_eType == TYPE_NUMBER; }
+    bool isString() const { return m_eType == TYPE_STRING; }
+    bool isArray() const { return m_eType == TYPE_ARRAY; }
+    bool isObject() const { return m_eType == TYPE_OBJECT; }
+
+    // 类型不符时返回默认值
+    bool asBool(bool bDefault = false) const;
+    double asDouble(double fDefault = 0) const;
+    int asInt(int nDefault = 0) const;
+    std::string asString(const std::string& sDefault = "") const;
+
+    // 数组或对象的元素个数
+    size_t size() const;
+    const JsonValue& operator[](size_t nIndex) const;
+    // 不存在时返回null
+    const JsonValue& operator[](const std::string& sKey) const;
+    bool has(const std::string& sKey) const;
+    const std::vector<std::string>& keys() const { return m_vKeys; }
+
+    // 构造及修改，用于展开模板
+    static JsonValue makeBool(bool b);
+    static JsonValue makeNumber(double f);
+    static JsonValue makeString(const std::string& s);
+    static JsonValue makeArray();
+    static JsonValue makeObject();
+    void set(const std::string& sKey, const JsonValue& stValue);
+    void append(const JsonValue& stValue);
+
+private:
+    Type m_eType = TYPE_NULL;
+    bool m_bValue = false;
+    double m_fValue = 0;
+    std::string m_sValue;
+    std::vector<JsonValue> m_vItems;
+    std::vector<std::string> m_vKeys;
+};
+
+#endif // JSONVALUE_H
@@ -0,0 +1,340 @@
+#include "LatencyProbe.h"
+
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+#include "base/ff_log.h"
+#include "base/pixel_fmt.hpp"
+#include "CpuAccess.h"
+
+// 同步字节 + 16位序号 + 校验字节，高位在左
+#define PROBE_SYNC 0xA5
+#define PROBE_BITS 32
+// 编码队列超过这个长度说明对应关系已经乱了，清空重来
+#define PROBE_MAX_PENDING 64
+// 用帧尾部的字节识别同一帧码流
+#define PROBE_TAIL_BYTES 16
+
+namespace {
+
+const char* g_vStageNames[LatencyProbe::STAGE_NUM] = {
+    "push rga", "encode", "network", "decode", "pull rga", "total",
+};
+
+uint32_t encodeCode(uint16_t nSeq) {
+    uint8_t nCheck = (uint8_t)((nSeq ^ (nSeq >> 8) ^ 0x5A) & 0xFF);
+    return ((uint32_t)PROBE_SYNC << 24) | ((uint32_t)nSeq << 8) | nCheck;
+}
+
+int decodeCode(uint32_t nCode) {
+    uint16_t nSeq = (nCode >> 8) & 0xFFFF;
+    return encodeCode(nSeq) == nCode ? nSeq : -1;
+}
+
+// 块的位置只和图像宽高有关，拉流端缩放后按同样的比例找到
+void layout(uint32_t nWidth, uint32_t nHeight, uint32_t& nBlock, uint32_t& x0, uint32_t& y0) {
+    nBlock = std::max(nWidth / 64, 4u);
+    x0 = nBlock;
+    y0 = nHeight > nBlock * 2 ? nHeight - nBlock * 2 : 0;
+}
+
+uint64_t tailKey(shared_ptr<MediaBuffer> pBuffer) {
+    const uint8_t* pData = (const uint8_t*)pBuffer->getActiveData();
+    size_t nSize = pBuffer->getActiveSize();
+    if (pData == nullptr || nSize < PROBE_TAIL_BYTES) {
+        return 0;
+    }
+    // FNV-1a
+    uint64_t nKey = 1469598103934665603ull;
+    for (size_t i = nSize - PROBE_TAIL_BYTES; i < nSize; ++i) {
+        nKey = (nKey ^ pData[i]) * 1099511628211ull;
+    }
+    return nKey;
+}
+
+bool isLuma(uint32_t nFmt) {
+    return nFmt == V4L2_PIX_FMT_NV12 || nFmt == V4L2_PIX_FMT_NV21 || nFmt == V4L2_PIX_FMT_NV16 ||
+           nFmt == V4L2_PIX_FMT_NV61 || nFmt == V4L2_PIX_FMT_YUV420;
+}
+
+} // namespace
+
+LatencyProbe::LatencyProbe() {
+    memset(&m_stStats, 0, sizeof(m_stStats));
+    memset(m_vKeys, 0, sizeof(m_vKeys));
+}
+
+int64_t LatencyProbe::nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void LatencyProbe::setEnable(bool bEnable) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (bEnable && !m_bEnable) {
+        memset(&m_stStats, 0, sizeof(m_stStats));
+        for (StEntry& stEntry : m_vEntries) {
+            stEntry.nSeq = -1;
+        }
+        m_dEncoding.clear();
+        memset(m_vKeys, 0, sizeof(m_vKeys));
+    }
+    m_bEnable = bEnable;
+}
+
+LatencyProbe::StEntry* LatencyProbe::entry(int nSeq) {
+    StEntry& stEntry = m_vEntries[nSeq % (sizeof(m_vEntries) / sizeof(m_vEntries[0]))];
+    return stEntry.nSeq == nSeq ? &stEntry : nullptr;
+}
+
+void LatencyProbe::stamp(uint8_t* pData, uint32_t nStride, uint32_t nBpp, uint32_t nWidth, uint32_t nHeight) {
+    if (!m_bEnable || pData == nullptr) {
+        return;
+    }
+    uint32_t nBlock, x0, y0;
+    layout(nWidth, nHeight, nBlock, x0, y0);
+    if (x0 + nBlock * PROBE_BITS > nWidth || y0 + nBlock > nHeight) {
+        return;
+    }
+    std::lock_guard<std::mutex> locker(m_mutex);
+    uint16_t nSeq = m_nSeq++;
+    uint32_t nCode = encodeCode(nSeq);
+    for (uint32_t y = y0; y < y0 + nBlock; ++y) {
+        uint8_t* pRow = pData + (size_t)y * nStride + (size_t)x0 * nBpp;
+        for (int i = 0; i < PROBE_BITS; ++i) {
+            uint8_t nValue = (nCode >> (PROBE_BITS - 1 - i)) & 1 ? 0xFF : 0;
+            memset(pRow + (size_t)i * nBlock * nBpp, nValue, (size_t)nBlock * nBpp);
+        }
+    }
+    StEntry& stEntry = m_vEntries[nSeq % (sizeof(m_vEntries) / sizeof(m_vEntries[0]))];
+    if (stEntry.nSeq >= 0) {
+        // 上一轮的序号没有走完全程
+        m_stStats.nMissed++;
+    }
+    stEntry.nSeq = nSeq;
+    std::fill(stEntry.vTimeUs, stEntry.vTimeUs + STAGE_NUM, 0);
+    stEntry.vTimeUs[STAGE_TOTAL] = nowUs();
+    m_stStats.nStamped++;
+}
+
+int LatencyProbe::detect(shared_ptr<MediaBuffer> pBuffer) {
+    if (pBuffer == nullptr || pBuffer->getMediaBufferType() != BUFFER_TYPE_VIDEO) {
+        return -1;
+    }
+    std::shared_ptr<VideoBuffer> pFrameBuf = static_pointer_cast<VideoBuffer>(pBuffer);
+    ImagePara stPara = pFrameBuf->getImagePara();
+    const uint8_t* pData = (const uint8_t*)pFrameBuf->getActiveData();
+    if (pData == nullptr || stPara.width == 0 || stPara.height == 0) {
+        return -1;
+    }
+    // 亮度格式读Y平面，打包的RGB格式读第二个字节(3/4字节排列中都是颜色通道)
+    uint32_t nHStride = std::max(stPara.hstride, stPara.width);
+    uint32_t nVStride = std::max(stPara.vstride, stPara.height);
+    uint32_t nBpp = 1;
+    uint32_t nChannel = 0;
+    if (!isLuma(stPara.v4l2Fmt)) {
+        if (v4l2fmtIsCompressed(stPara.v4l2Fmt)) {
+            return -1;
+        }
+        nBpp = v4l2GetFrameSize(stPara.v4l2Fmt, nHStride, nVStride) / nVStride / nHStride;
+        if (nBpp != 3 && nBpp != 4) {
+            return -1;
+        }
+        nChannel = 1;
+    }
+    uint32_t nBlock, x0, y0;
+    layout(stPara.width, stPara.height, nBlock, x0, y0);
+    if (x0 + nBlock * PROBE_BITS > stPara.width || y0 + nBlock > stPara.height) {
+        return -1;
+    }
+    size_t nBase = pData - (const uint8_t*)pFrameBuf->getData();
+    CpuAccess::StRange vRanges[2];
+    int nRanges = CpuAccess::rowRanges(stPara, nBase, y0, y0 + nBlock, vRanges);
+    if (nRanges > 0) {
+        CpuAccess::beginRead(pFrameBuf.get(), vRanges[0].nOffset, vRanges[0].nLen);
+    }
+    size_t nRow = (size_t)nHStride * nBpp;
+    // 每块取中心附近4点，避开编码后块边缘的振铃
+    uint32_t nQuarter = nBlock / 4;
+    uint32_t nCode = 0;
+    for (int i = 0; i < PROBE_BITS; ++i) {
+        uint32_t cx = x0 + i * nBlock + nBlock / 2;
+        uint32_t cy = y0 + nBlock / 2;
+        uint32_t nSum = 0;
+        for (uint32_t y : {cy - nQuarter, cy + nQuarter - 1}) {
+            for (uint32_t x : {cx - nQuarter, cx + nQuarter - 1}) {
+                nSum += pData[y * nRow + (size_t)x * nBpp + nChannel];
+            }
+        }
+        nCode = (nCode << 1) | (nSum >= 4 * 128 ? 1 : 0);
+    }
+    return decodeCode(nCode);
+}
+
+void LatencyProbe::onEncodeInput(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    LatencyProbe* pProbe = static_cast<LatencyProbe*>(pCtx);
+    if (!pProbe->m_bEnable) {
+        return;
+    }
+    int nSeq = detect(pBuffer);
+    int64_t nNow = nowUs();
+    std::lock_guard<std::mutex> locker(pProbe->m_mutex);
+    StEntry* pEntry = nSeq >= 0 ? pProbe->entry(nSeq) : nullptr;
+    if (pEntry != nullptr) {
+        pEntry->vTimeUs[STAGE_PUSH_RGA] = nNow;
+    }
+    if (pProbe->m_dEncoding.size() >= PROBE_MAX_PENDING) {
+        pProbe->m_dEncoding.clear();
+    }
+    // 未识别的也占一个位置，保持和编码输出一一对应
+    pProbe->m_dEncoding.push_back(pEntry != nullptr ? nSeq : -1);
+}
+
+void LatencyProbe::onEncodeOutput(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    LatencyProbe* pProbe = static_cast<LatencyProbe*>(pCtx);
+    if (!pProbe->m_bEnable || pBuffer == nullptr) {
+        return;
+    }
+    int64_t nNow = nowUs();
+    uint64_t nKey = tailKey(pBuffer);
+    std::lock_guard<std::mutex> locker(pProbe->m_mutex);
+    if (pProbe->m_dEncoding.empty()) {
+        return;
+    }
+    int nSeq = pProbe->m_dEncoding.front();
+    pProbe->m_dEncoding.pop_front();
+    StEntry* pEntry = nSeq >= 0 ? pProbe->entry(nSeq) : nullptr;
+    if (pEntry == nullptr || nKey == 0) {
+        return;
+    }
+    pEntry->vTimeUs[STAGE_ENCODE] = nNow;
+    StKey& stKey = pProbe->m_vKeys[pProbe->m_nKeyPos++ % (sizeof(pProbe->m_vKeys) / sizeof(pProbe->m_vKeys[0]))];
+    stKey.nKey = nKey;
+    stKey.nSeq = nSeq;
+}
+
+void LatencyProbe::onReceive(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    LatencyProbe* pProbe = static_cast<LatencyProbe*>(pCtx);
+    if (!pProbe->m_bEnable || pBuffer == nullptr) {
+        return;
+    }
+    int64_t nNow = nowUs();
+    uint64_t nKey = tailKey(pBuffer);
+    if (nKey == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> locker(pProbe->m_mutex);
+    for (StKey& stKey : pProbe->m_vKeys) {
+        if (stKey.nKey != nKey) {
+            continue;
+        }
+        StEntry* pEntry = pProbe->entry(stKey.nSeq);
+        if (pEntry != nullptr) {
+            pEntry->vTimeUs[STAGE_NETWORK] = nNow;
+        }
+        stKey.nKey = 0;
+        break;
+    }
+}
+
+void LatencyProbe::onDecodeOutput(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    LatencyProbe* pProbe = static_cast<LatencyProbe*>(pCtx);
+    if (!pProbe->m_bEnable) {
+        return;
+    }
+    int nSeq = detect(pBuffer);
+    int64_t nNow = nowUs();
+    std::lock_guard<std::mutex> locker(pProbe->m_mutex);
+    StEntry* pEntry = nSeq >= 0 ? pProbe->entry(nSeq) : nullptr;
+    if (pEntry != nullptr) {
+        pEntry->vTimeUs[STAGE_DECODE] = nNow;
+    }
+}
+
+void LatencyProbe::onPullOutput(shared_ptr<MediaBuffer> pBuffer) {
+    if (!m_bEnable) {
+        return;
+    }
+    int nSeq = detect(pBuffer);
+    int64_t nNow = nowUs();
+    std::lock_guard<std::mutex> locker(m_mutex);
+    StEntry* pEntry = nSeq >= 0 ? entry(nSeq) : nullptr;
+    if (pEntry == nullptr) {
+        return;
+    }
+    pEntry->vTimeUs[STAGE_PULL_RGA] = nNow;
+    finish(*pEntry);
+    pEntry->nSeq = -1;
+}
+
+void LatencyProbe::finish(StEntry& stEntry) {
+    // vTimeUs[STAGE_TOTAL]是打标时间，其余为各阶段结束时间，缺失的阶段(未识别)不计入
+    int64_t nPrev = stEntry.vTimeUs[STAGE_TOTAL];
+    bool bComplete = true;
+    for (int i = STAGE_PUSH_RGA; i <= STAGE_PULL_RGA; ++i) {
+        int64_t nEnd = stEntry.vTimeUs[i];
+        if (nEnd == 0 || nEnd < nPrev) {
+            bComplete = false;
+            continue;
+        }
+        record(m_stStats.vStages[i], nEnd - nPrev);
+        nPrev = nEnd;
+    }
+    record(m_stStats.vStages[STAGE_TOTAL], stEntry.vTimeUs[STAGE_PULL_RGA] - stEntry.vTimeUs[STAGE_TOTAL]);
+    if (bComplete) {
+        m_stStats.nMeasured++;
+    }
+}
+
+void LatencyProbe::record(StStage& stStage, int64_t nUs) {
+    uint64_t nValue = nUs > 0 ? nUs : 0;
+    if (stStage.nCount == 0 || nValue < stStage.nMinUs) {
+        stStage.nMinUs = nValue;
+    }
+    stStage.nMaxUs = std::max(stStage.nMaxUs, nValue);
+    stStage.nCount++;
+    stStage.nSumUs += nValue;
+    int nBucket = 0;
+    for (uint64_t nMs = nValue / 1000; nMs > 0 && nBucket < BUCKET_NUM - 1; nMs >>= 1) {
+        nBucket++;
+    }
+    stStage.vBuckets[nBucket]++;
+}
+
+double LatencyProbe::percentileMs(const StStage& stStage, double fRatio) {
+    if (stStage.nCount == 0) {
+        return 0;
+    }
+    uint64_t nTarget = (uint64_t)(stStage.nCount * fRatio + 0.5);
+    uint64_t nSum = 0;
+    for (int i = 0; i < BUCKET_NUM - 1; ++i) {
+        nSum += stStage.vBuckets[i];
+        if (nSum >= nTarget) {
+            return std::min((double)(1u << i), stStage.nMaxUs / 1000.0);
+        }
+    }
+    return stStage.nMaxUs / 1000.0;
+}
+
+LatencyProbe::StStats LatencyProbe::getStats() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_stStats;
+}
+
+void LatencyProbe::dump() {
+    StStats stStats = getStats();
+    ff_info("latency probe: stamped %llu, measured %llu, missed %llu\n", (unsigned long long)stStats.nStamped,
+            (unsigned long long)stStats.nMeasured, (unsigned long long)stStats.nMissed);
+    for (int i = 0; i < STAGE_NUM; ++i) {
+        const StStage& stStage = stStats.vStages[i];
+        if (stStage.nCount == 0) {
+            continue;
+        }
+        ff_info("  %-8s n=%llu avg=%.2fms min=%.2fms p50<=%.0fms p99<=%.0fms max=%.2fms\n", g_vStageNames[i],
+                (unsigned long long)stStage.nCount, stStage.nSumUs / 1000.0 / stStage.nCount, stStage.nMinUs / 1000.0,
+                percentileMs(stStage, 0.5), percentileMs(stStage, 0.99), stStage.nMaxUs / 1000.0);
+    }
+}
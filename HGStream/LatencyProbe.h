@@ -0,0 +1,106 @@
+#ifndef LATENCYPROBE_H
+#define LATENCYPROBE_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include "module/module_media.hpp"
+
+// 回环延迟探针：推流时在送入的图像左下角画一行黑白块(同步字节、16位序号、校验)，拉回本进程后从像素中识别出序号，
+// 按序号汇总各阶段耗时，不需要额外硬件。能看到像素的位置直接识别序号(推流RGA/叠加后、拉流解码后、拉流RGA后)，
+// 编码输出没有像素，按先后顺序对应编码输入(编码器一进一出)；拉流收到的码流按帧尾字节对应编码输出，
+// RTP打包/解包不改变最后一个nal的内容。
+// 阶段：推流RGA(含叠加) -> 编码 -> 网络(推流服务、传输、拉流收包) -> 解码 -> 拉流RGA。
+// 黑白块边长为宽度的1/64，编码码率过低时可能识别失败，计入未识别。
+// 用法：
+//   LatencyProbe probe; probe.setEnable(true);
+//   probe.stamp(pData, nStride, 3, nWidth, nHeight);          // 推流送数时
+//   pOsd->addExternalConsumer("probe", &probe, LatencyProbe::onEncodeInput);  // 各阶段挂外部消费者
+class LatencyProbe {
+public:
+    enum Stage {
+        STAGE_PUSH_RGA = 0,
+        STAGE_ENCODE,
+        STAGE_NETWORK,
+        STAGE_DECODE,
+        STAGE_PULL_RGA,
+        STAGE_TOTAL,
+        STAGE_NUM,
+    };
+    // 直方图按毫秒2的幂分档：[0,1) [1,2) [2,4) ... 最后一档为更大的值
+    static const int BUCKET_NUM = 16;
+
+    struct StStage {
+        uint64_t nCount;
+        uint64_t nSumUs;
+        uint64_t nMinUs;
+        uint64_t nMaxUs;
+        uint32_t vBuckets[BUCKET_NUM];
+    };
+
+    struct StStats {
+        StStage vStages[STAGE_NUM];
+        // 打标、完整测到、推流或拉流未识别的帧数
+        uint64_t nStamped;
+        uint64_t nMeasured;
+        uint64_t nMissed;
+    };
+
+public:
+    LatencyProbe();
+
+    // 开启时清空统计
+    void setEnable(bool bEnable);
+    bool isEnabled() const { return m_bEnable; }
+
+    // 在BGR/RGB打包图像上打标，nBpp为每像素字节数
+    void stamp(uint8_t* pData, uint32_t nStride, uint32_t nBpp, uint32_t nWidth, uint32_t nHeight);
+
+    // 外部消费者回调，pCtx为LatencyProbe*
+    static void onEncodeInput(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    static void onEncodeOutput(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    static void onReceive(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    static void onDecodeOutput(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    // 拉流RGA输出，在输出回调中调用
+    void onPullOutput(shared_ptr<MediaBuffer> pBuffer);
+
+    StStats getStats();
+    // 以毫秒打印各阶段的次数、平均、最大值及p50/p99
+    void dump();
+    // 直方图估计分位数(毫秒)，取所在档的上界
+    static double percentileMs(const StStage& stStage, double fRatio);
+
+private:
+    struct StEntry {
+        int nSeq = -1;
+        int64_t vTimeUs[STAGE_NUM];
+    };
+
+    static int64_t nowUs();
+    // 从视频帧中识别序号，识别不到返回-1
+    static int detect(shared_ptr<MediaBuffer> pBuffer);
+    StEntry* entry(int nSeq);
+    void record(StStage& stStage, int64_t nUs);
+    void finish(StEntry& stEntry);
+
+private:
+    std::atomic<bool> m_bEnable{false};
+    std::mutex m_mutex;
+    uint16_t m_nSeq = 0;
+    StEntry m_vEntries[1024];
+    // 进入编码器的序号，未识别的为-1
+    std::deque<int> m_dEncoding;
+    // 编码输出帧尾字节与序号的对应，供拉流收包查找
+    struct StKey {
+        uint64_t nKey;
+        int nSeq;
+    };
+    StKey m_vKeys[64];
+    uint32_t m_nKeyPos = 0;
+    StStats m_stStats;
+};
+
+#endif // LATENCYPROBE_H
@@ -0,0 +1,195 @@
+#include "ModuleAnnexBSource.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <thread>
+
+namespace {
+
+std::mutex g_mutexStreams;
+std::map<std::string, std::weak_ptr<ModuleAnnexBSource::StStream>> g_mapStreams;
+
+bool endsWith(const std::string& s, const char* pSuffix) {
+    size_t n = strlen(pSuffix);
+    return s.size() >= n && strcasecmp(s.c_str() + s.size() - n, pSuffix) == 0;
+}
+
+// 扩展名不能确定时看第一个nal是否为H265的VPS/SPS/PPS/AUD
+bool isHevcStream(const std::string& sPath, const uint8_t* pData, size_t nSize) {
+    if (endsWith(sPath, ".h265") || endsWith(sPath, ".265") || endsWith(sPath, ".hevc")) {
+        return true;
+    }
+    if (endsWith(sPath, ".h264") || endsWith(sPath, ".264")) {
+        return false;
+    }
+    bool bHevc = false;
+    NaluUtil::forEachNalu(pData, nSize, [&](const uint8_t* pNalu, size_t nLen) {
+        int nType = NaluUtil::naluType(pNalu, true);
+        bHevc = nLen > 2 && pNalu[1] == 1 && nType >= NALU_H265_VPS && nType <= NALU_H265_AUD;
+        return false;
+    });
+    return bHevc;
+}
+
+} // namespace
+
+ModuleAnnexBSource::ModuleAnnexBSource(const std::string& sPath, double fFps, bool bLoop)
+    : ModuleMedia("ModuleAnnexBSource"), m_sPath(sPath), m_fFps(fFps), m_bLoop(bLoop) {
+    buffer_count = 4;
+}
+
+ModuleAnnexBSource::~ModuleAnnexBSource() {
+}
+
+shared_ptr<ModuleAnnexBSource::StStream> ModuleAnnexBSource::loadStream(const std::string& sPath, bool bHevc) {
+    std::lock_guard<std::mutex> locker(g_mutexStreams);
+    auto it = g_mapStreams.find(sPath);
+    if (it != g_mapStreams.end()) {
+        shared_ptr<StStream> pStream = it->second.lock();
+        if (pStream != nullptr) {
+            return pStream;
+        }
+    }
+    shared_ptr<StStream> pStream = std::make_shared<StStream>();
+    if (pStream->file.open(sPath, bHevc) < 0 || !buildIndex(*pStream, bHevc)) {
+        return nullptr;
+    }
+    // 索引建好后各路从不同位置循环读取，不再按顺序预读
+    madvise((void*)pStream->file.data(), pStream->file.size(), MADV_NORMAL);
+    pStream->nDisk = IoPool::diskOf(sPath);
+    g_mapStreams[sPath] = pStream;
+    return pStream;
+}
+
+// 扫描一遍文件，每个nal只解析头部，slice之后遇到非slice或新一帧的第一个slice时切分
+bool ModuleAnnexBSource::buildIndex(StStream& stStream, bool bHevc) {
+    const uint8_t* pData = stStream.file.data();
+    size_t nSize = stStream.file.size();
+    if (pData == nullptr || nSize == 0) {
+        ff_error("annexb source: %s is empty\n", stStream.file.path().c_str());
+        return false;
+    }
+    if (!NaluUtil::parseStreamInfo(pData, nSize, bHevc, stStream.stInfo)) {
+        ff_error("annexb source: no sps in %s\n", stStream.file.path().c_str());
+        return false;
+    }
+
+    // 每个nal的起始码紧接在上一个nal之后
+    const uint8_t* pUnit = pData;
+    const uint8_t* pPrevEnd = pData;
+    bool bHasVcl = false;
+    bool bKey = false;
+    stStream.vUnits.reserve(nSize / 4096);
+    NaluUtil::forEachNalu(pData, nSize, [&](const uint8_t* pNalu, size_t nLen) {
+        int nType = NaluUtil::naluType(pNalu, bHevc);
+        bool bVcl = NaluUtil::isVcl(nType, bHevc);
+        if (bHasVcl && (!bVcl || NaluUtil::isFirstSlice(pNalu, nLen, bHevc))) {
+            stStream.vUnits.push_back({(uint64_t)(pUnit - pData), (uint32_t)(pPrevEnd - pUnit), bKey});
+            pUnit = pPrevEnd;
+            bHasVcl = false;
+            bKey = false;
+        }
+        if (bVcl) {
+            bHasVcl = true;
+            bKey = bKey || NaluUtil::isKeyNalu(nType, bHevc);
+        }
+        pPrevEnd = pNalu + nLen;
+        return true;
+    });
+    if (bHasVcl) {
+        stStream.vUnits.push_back({(uint64_t)(pUnit - pData), (uint32_t)(pData + nSize - pUnit), bKey});
+    }
+    stStream.vUnits.shrink_to_fit();
+
+    // 从第一个关键帧开始解码，循环时也回到这里
+    auto it = std::find_if(stStream.vUnits.begin(), stStream.vUnits.end(), [](const StUnit& st) { return st.bKey != 0; });
+    if (it == stStream.vUnits.end()) {
+        ff_error("annexb source: no key frame in %s\n", stStream.file.path().c_str());
+        return false;
+    }
+    stStream.nFirstKey = it - stStream.vUnits.begin();
+    ff_info("annexb source: %s %ux%u, %zu frames, fps %.2f\n", stStream.file.path().c_str(), stStream.stInfo.nWidth,
+            stStream.stInfo.nHeight, stStream.vUnits.size(), stStream.stInfo.fFps);
+    return true;
+}
+
+int ModuleAnnexBSource::init() {
+    AnnexBFile probe;
+    if (probe.open(m_sPath, false) < 0) {
+        return -1;
+    }
+    bool bHevc = isHevcStream(m_sPath, probe.data(), std::min(probe.size(), (size_t)4096));
+    probe.close();
+
+    m_pStream = loadStream(m_sPath, bHevc);
+    if (m_pStream == nullptr) {
+        return -1;
+    }
+    if (m_fFps <= 0) {
+        m_fFps = m_pStream->stInfo.fFps > 0 ? m_pStream->stInfo.fFps : 25;
+    }
+    m_nFrameUs = (int64_t)(1000000 / m_fFps);
+    uint32_t nWidth = m_pStream->stInfo.nWidth;
+    uint32_t nHeight = m_pStream->stInfo.nHeight;
+    output_para = ImagePara(nWidth, nHeight, nWidth, nHeight, bHevc ? V4L2_PIX_FMT_HEVC : V4L2_PIX_FMT_H264);
+    input_para = output_para;
+    // 输出缓冲区只是外壳，指向文件映射
+    return initBuffer(VideoBuffer::EXTERNAL_BUFFER);
+}
+
+void ModuleAnnexBSource::setStartFrame(size_t nFrame) {
+    m_nStartFrame = nFrame;
+}
+
+bool ModuleAnnexBSource::setup() {
+    // 起始位置向前取关键帧
+    const std::vector<StUnit>& vUnits = m_pStream->vUnits;
+    m_nPos = std::min(m_nStartFrame % vUnits.size(), vUnits.size() - 1);
+    while (m_nPos > m_pStream->nFirstKey && !vUnits[m_nPos].bKey) {
+        m_nPos--;
+    }
+    m_nPos = std::max(m_nPos, m_pStream->nFirstKey);
+    m_readAhead.setDisk(m_pStream->nDisk);
+    m_readAhead.reset();
+    m_nextTick = std::chrono::steady_clock::now();
+    return true;
+}
+
+ModuleMedia::ProduceResult ModuleAnnexBSource::doProduce(shared_ptr<MediaBuffer> output_buffer) {
+    const std::vector<StUnit>& vUnits = m_pStream->vUnits;
+    if (m_nPos >= vUnits.size()) {
+        if (!m_bLoop) {
+            return PRODUCE_EOS;
+        }
+        m_nPos = m_pStream->nFirstKey;
+    }
+    const StUnit& stUnit = vUnits[m_nPos++];
+    void* pData = (void*)(m_pStream->file.data() + stUnit.nOffset);
+    m_readAhead.advance(m_pStream, m_pStream->file.data(), m_pStream->file.size(), stUnit.nOffset + stUnit.nSize);
+
+    shared_ptr<VideoBuffer> pOutput = static_pointer_cast<VideoBuffer>(output_buffer);
+    pOutput->initWithExternalBuffer(pData, stUnit.nSize, -1);
+    pOutput->setActiveData(pData);
+    pOutput->setActiveSize(stUnit.nSize);
+    pOutput->setPUstimestamp(m_nPts);
+    pOutput->setImagePara(output_para);
+    pOutput->setMediaBufferType(BUFFER_TYPE_VIDEO);
+    m_nPts += m_nFrameUs;
+    m_nOutputCount++;
+
+    if (m_bRealtime) {
+        auto now = std::chrono::steady_clock::now();
+        auto interval = std::chrono::microseconds(m_nFrameUs);
+        m_nextTick += interval;
+        if (m_nextTick < now - interval * 2) {
+            // 下游阻塞过久，不追赶
+            m_nextTick = now;
+        }
+        std::this_thread::sleep_until(m_nextTick);
+    }
+    return PRODUCE_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#ifndef MODULEANNEXBSOURCE_H
+#define MODULEANNEXBSOURCE_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+#include "AnnexBFile.h"
+#include "IoPool.h"
+#include "NaluUtil.h"
+
+// 裸流文件(.h264/.h265)回放数据源，用于压测，可接ModuleMppDec或直接接推流服务。
+// 整个文件只读映射，打开时扫描一次建立访问单元索引，输出缓冲区直接指向映射内存，不拷贝。
+// 同一文件的多个实例共享映射和索引，每路只占一个按帧率休眠的线程，可以模拟上百路摄像头。
+// 读盘缺页由共享的IoPool提前预读，慢盘只拖慢预读，不会打乱各路的输出节奏。
+// 帧率取构造参数，为0时用码流中记录的帧率(H264 SPS/H265 VPS)，都没有按25。
+// 用法：
+//   auto pSource = make_shared<ModuleAnnexBSource>("/data/cam.h264");
+//   pSource->init();
+//   pMppDec = make_shared<ModuleMppDec>(pSource->getOutputImagePara()); pMppDec->setProductor(pSource); ...
+class ModuleAnnexBSource : public ModuleMedia {
+public:
+    struct StUnit {
+        uint64_t nOffset;
+        uint32_t nSize;
+        uint32_t bKey;
+    };
+
+    // 映射和索引，按路径共享
+    struct StStream {
+        AnnexBFile file;
+        std::vector<StUnit> vUnits;
+        NaluUtil::StStreamInfo stInfo;
+        size_t nFirstKey;
+        // 所在磁盘，预读时按磁盘限流
+        uint64_t nDisk;
+    };
+
+public:
+    ModuleAnnexBSource(const std::string& sPath, double fFps = 0, bool bLoop = true);
+    ~ModuleAnnexBSource();
+
+    int init() override;
+
+    // 从第nFrame帧之前的关键帧开始，多路回放同一文件时错开画面和码率峰值
+    void setStartFrame(size_t nFrame);
+    // 按帧率输出(默认)，关闭后按下游处理速度输出
+    void setRealtime(bool bRealtime) { m_bRealtime = bRealtime; }
+    double getFps() const { return m_fFps; }
+    size_t getFrameCount() const { return m_pStream != nullptr ? m_pStream->vUnits.size() : 0; }
+    // 已输出的帧数，循环播放时累计
+    uint64_t getOutputCount() const { return m_nOutputCount; }
+
+    // 打开并建立索引，已被其他实例打开时直接共享
+    static shared_ptr<StStream> loadStream(const std::string& sPath, bool bHevc);
+
+protected:
+    virtual ProduceResult doProduce(shared_ptr<MediaBuffer> output_buffer) override;
+    virtual bool setup() override;
+
+private:
+    static bool buildIndex(StStream& stStream, bool bHevc);
+
+private:
+    std::string m_sPath;
+    double m_fFps;
+    bool m_bLoop;
+    bool m_bRealtime = true;
+    size_t m_nStartFrame = 0;
+    shared_ptr<StStream> m_pStream;
+
+    // 以下只在工作线程中访问
+    size_t m_nPos = 0;
+    int64_t m_nPts = 0;
+    int64_t m_nFrameUs = 40000;
+    std::atomic<uint64_t> m_nOutputCount{0};
+    std::chrono::steady_clock::time_point m_nextTick;
+    IoReadAhead m_readAhead;
+};
+
+#endif // MODULEANNEXBSOURCE_H
@@ -0,0 +1,263 @@
+#include "ModuleEventRecorder.h"
+
+#include "NaluUtil.h"
+
+ModuleEventRecorder::ModuleEventRecorder(uint32_t nPreRollMs, size_t nMaxBytes)
+    : ModuleMedia("ModuleEventRecorder"), m_nPreRollUs(nPreRollMs * 1000) {
+    buffer_count = 4;
+    m_vRing.resize(nMaxBytes);
+}
+
+ModuleEventRecorder::~ModuleEventRecorder() {
+}
+
+int ModuleEventRecorder::init() {
+    shared_ptr<ModuleMedia> pProductor = getProductor();
+    if (pProductor != nullptr) {
+        input_para = pProductor->getOutputImagePara();
+    }
+    if (input_para.v4l2Fmt != V4L2_PIX_FMT_H264 && input_para.v4l2Fmt != V4L2_PIX_FMT_HEVC) {
+        ff_error("event recorder: input must be h264/h265\n");
+        return -1;
+    }
+    m_bHevc = input_para.v4l2Fmt == V4L2_PIX_FMT_HEVC;
+    output_para = input_para;
+    // 输出缓冲区只是外壳，指向环形缓冲区中的码流
+    return initBuffer(VideoBuffer::EXTERNAL_BUFFER);
+}
+
+void ModuleEventRecorder::setWriter(shared_ptr<ModuleFileWriter> pWriter) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_pWriter = pWriter;
+    if (m_pWriter != nullptr) {
+        m_pWriter->setProductor(shared_from_this());
+    }
+}
+
+void ModuleEventRecorder::setPreRoll(uint32_t nPreRollMs) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nPreRollUs = nPreRollMs * 1000;
+}
+
+int ModuleEventRecorder::trigger(const std::string& sFile, uint32_t nPostMs) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_pWriter == nullptr) {
+        ff_error("event recorder: no writer\n");
+        return -1;
+    }
+    m_sPendingFile = sFile;
+    m_nPendingPostMs = nPostMs;
+    m_bTriggerPending = true;
+    return 0;
+}
+
+bool ModuleEventRecorder::isRecording() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_bRecording || m_bTriggerPending;
+}
+
+int ModuleEventRecorder::getBufferedFrames() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return (int)m_dqFrames.size();
+}
+
+int64_t ModuleEventRecorder::getBufferedMs() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_dqFrames.empty()) {
+        return 0;
+    }
+    return (m_dqFrames.back().nPts - m_dqFrames.front().nPts) / 1000;
+}
+
+// 以下调用时已持有m_mutex
+
+// 最旧的一个GOP可以释放时整体移出，写文件组件还未释放的帧和录像中待输出的帧不能释放
+bool ModuleEventRecorder::evictGop() {
+    if (m_dqFrames.empty()) {
+        return false;
+    }
+    size_t nEnd = 1;
+    while (nEnd < m_dqFrames.size() && !m_dqFrames[nEnd].bKey) {
+        nEnd++;
+    }
+    for (size_t i = 0; i < nEnd; ++i) {
+        uint64_t nSeq = m_dqFrames[i].nSeq;
+        bool bPending = m_bRecording && nSeq >= m_nEmitSeq;
+        bool bInFlight = !m_dqInFlight.empty() && nSeq >= m_dqInFlight.front() && nSeq < m_nEmitSeq;
+        if (bPending || bInFlight) {
+            return false;
+        }
+    }
+    m_dqFrames.erase(m_dqFrames.begin(), m_dqFrames.begin() + nEnd);
+    return true;
+}
+
+// 第二个GOP已经覆盖预录时长时丢掉第一个GOP
+void ModuleEventRecorder::trimPreRoll() {
+    while (m_dqFrames.size() > 1) {
+        int64_t nNewest = m_dqFrames.back().nPts;
+        size_t i = 1;
+        while (i < m_dqFrames.size() && !m_dqFrames[i].bKey) {
+            i++;
+        }
+        if (i == m_dqFrames.size() || m_dqFrames[i].nPts > nNewest - (int64_t)m_nPreRollUs) {
+            return;
+        }
+        if (!evictGop()) {
+            return;
+        }
+    }
+}
+
+// 每帧在环形缓冲区中连续存放，尾部放不下时从头开始
+bool ModuleEventRecorder::allocSpace(size_t nSize, size_t& nOffset) {
+    size_t nCapacity = m_vRing.size();
+    if (nSize > nCapacity) {
+        return false;
+    }
+    do {
+        if (m_dqFrames.empty()) {
+            nOffset = 0;
+            return true;
+        }
+        size_t nHead = m_dqFrames.front().nOffset;
+        size_t nTail = m_dqFrames.back().nOffset + m_dqFrames.back().nSize;
+        if (m_dqFrames.back().nOffset >= nHead) {
+            // 未回绕，数据在[nHead, nTail)
+            if (nCapacity - nTail >= nSize) {
+                nOffset = nTail;
+                return true;
+            }
+            if (nHead >= nSize) {
+                nOffset = 0;
+                return true;
+            }
+        } else if (nHead - nTail >= nSize) {
+            // 已回绕，空闲区为[nTail, nHead)
+            nOffset = nTail;
+            return true;
+        }
+    } while (evictGop());
+    return false;
+}
+
+void ModuleEventRecorder::storeFrame(shared_ptr<MediaBuffer> pBuffer) {
+    const uint8_t* pData = (const uint8_t*)pBuffer->getActiveData();
+    size_t nSize = pBuffer->getActiveSize();
+    if (pData == nullptr || nSize == 0) {
+        return;
+    }
+    bool bKey = NaluUtil::isKeyFrame(pData, nSize, m_bHevc);
+
+    // 参数集优先取编码器附加数据，没有时从关键帧中提取
+    shared_ptr<MediaBuffer> pExtra = pBuffer->getExtraData();
+    std::vector<uint8_t> vHeader;
+    if (pExtra != nullptr && pExtra->getActiveData() != nullptr && pExtra->getActiveSize() > 0) {
+        const uint8_t* pExtraData = (const uint8_t*)pExtra->getActiveData();
+        vHeader.assign(pExtraData, pExtraData + pExtra->getActiveSize());
+    } else if (bKey) {
+        NaluUtil::extractParamSets(pData, nSize, m_bHevc, vHeader);
+    }
+    if (!vHeader.empty() && vHeader != m_vHeader) {
+        m_vHeader.swap(vHeader);
+        // 已输出的帧可能还引用旧的参数集，重新分配而不是覆盖
+        m_pHeader = std::make_shared<VideoBuffer>(VideoBuffer::MALLOC_BUFFER);
+        m_pHeader->allocBuffer(m_vHeader.size());
+        memcpy(m_pHeader->getData(), m_vHeader.data(), m_vHeader.size());
+        m_pHeader->setActiveData(m_pHeader->getData());
+        m_pHeader->setActiveSize(m_vHeader.size());
+    }
+
+    if (m_bGap && !bKey) {
+        return;
+    }
+    size_t nOffset = 0;
+    if (!allocSpace(nSize, nOffset)) {
+        if (!m_bGap) {
+            ff_warn("event recorder: ring buffer full, drop until next keyframe\n");
+        }
+        m_bGap = true;
+        return;
+    }
+    m_bGap = false;
+    memcpy(m_vRing.data() + nOffset, pData, nSize);
+    StFrame stFrame = {m_nNextSeq++, nOffset, nSize, pBuffer->getPUstimestamp(), bKey};
+    m_dqFrames.push_back(stFrame);
+    if (bKey) {
+        trimPreRoll();
+    }
+}
+
+void ModuleEventRecorder::startClip(int64_t nPts) {
+    m_bTriggerPending = false;
+    m_nStopPts = nPts + (int64_t)m_nPendingPostMs * 1000;
+    if (m_bRecording) {
+        // 录像中再次触发，只延长
+        return;
+    }
+    if (!m_vHeader.empty()) {
+        m_pWriter->setVideoExtraData(m_vHeader.data(), m_vHeader.size());
+    }
+    if (m_pWriter->changeFileName(m_sPendingFile) < 0) {
+        ff_error("event recorder: failed to open %s\n", m_sPendingFile.c_str());
+        return;
+    }
+    // 缓冲区总是从关键帧开始，为空时下一个存入的也是关键帧
+    m_nEmitSeq = m_dqFrames.empty() ? m_nNextSeq : m_dqFrames.front().nSeq;
+    m_bRecording = true;
+    ff_info("event recorder: start %s, pre-roll %d frames\n", m_sPendingFile.c_str(), (int)m_dqFrames.size());
+}
+
+// 输出缓冲区按顺序被所有消费者用完后回调
+void ModuleEventRecorder::bufferReleaseCallBack(shared_ptr<MediaBuffer> buffer) {
+    (void)buffer;
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (!m_dqInFlight.empty()) {
+        m_dqInFlight.pop_front();
+    }
+}
+
+ModuleMedia::ConsumeResult ModuleEventRecorder::doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (!m_bRepeating && input_buffer != nullptr) {
+        storeFrame(input_buffer);
+        if (m_bTriggerPending) {
+            startClip(input_buffer->getPUstimestamp());
+        }
+    }
+    m_bRepeating = false;
+
+    if (!m_bRecording || m_dqFrames.empty() || m_nEmitSeq >= m_nNextSeq) {
+        return CONSUME_SKIP;
+    }
+    if (m_nEmitSeq < m_dqFrames.front().nSeq) {
+        // 待输出的帧不会被释放，正常不会出现
+        m_nEmitSeq = m_dqFrames.front().nSeq;
+    }
+    const StFrame& stFrame = m_dqFrames[m_nEmitSeq - m_dqFrames.front().nSeq];
+    if (stFrame.nPts > m_nStopPts) {
+        m_bRecording = false;
+        ff_info("event recorder: stop\n");
+        return CONSUME_SKIP;
+    }
+
+    shared_ptr<VideoBuffer> pOutput = static_pointer_cast<VideoBuffer>(output_buffer);
+    uint8_t* pData = m_vRing.data() + stFrame.nOffset;
+    pOutput->initWithExternalBuffer(pData, stFrame.nSize, -1);
+    pOutput->setActiveData(pData);
+    pOutput->setActiveSize(stFrame.nSize);
+    pOutput->setPUstimestamp(stFrame.nPts);
+    pOutput->setImagePara(output_para);
+    pOutput->setMediaBufferType(BUFFER_TYPE_VIDEO);
+    pOutput->setExtraData(m_pHeader);
+    m_dqInFlight.push_back(m_nEmitSeq);
+    // 输出缓冲区只有buffer_count个，更早的一定已经释放
+    while (m_dqInFlight.size() > buffer_count) {
+        m_dqInFlight.pop_front();
+    }
+    m_nEmitSeq++;
+
+    // 预录部分每次输入输出多帧，直到追上实时帧
+    m_bRepeating = m_nEmitSeq < m_nNextSeq;
+    return m_bRepeating ? CONSUME_NEED_REPEAT : CONSUME_SUCCESS;
+}
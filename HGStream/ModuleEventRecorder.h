@@ -0,0 +1,91 @@
+#ifndef MODULEEVENTRECORDER_H
+#define MODULEEVENTRECORDER_H
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+#include "module/vo/module_fileWriter.hpp"
+
+// 事件录像组件，接在ModuleMppEnc(或ModuleGopCache)之后，下游接ModuleFileWriter。
+// 平时把编码后的帧拷贝进固定大小的环形缓冲区，按GOP保留最近nPreRollMs的码流；
+// 触发后从缓冲区中最早的关键帧开始，连同之后的实时帧一起交给写文件组件，直到触发后nPostMs。
+// 码流只在进入环形缓冲区时拷贝一次，输出缓冲区直接指向环形缓冲区，不重新编码。
+// 用法：
+//   auto pRecorder = make_shared<ModuleEventRecorder>(5000);
+//   pRecorder->setProductor(pMppEnc); pRecorder->init();
+//   auto pWriter = make_shared<ModuleFileWriter>("/data/event.ts");
+//   pRecorder->setWriter(pWriter); pWriter->init();
+//   ...
+//   pRecorder->trigger("/data/alarm_0001.ts", 10000);
+// 写文件组件在下一次换文件或停止时才结束当前文件，mp4在此之前不完整，需要立即可用时建议使用ts。
+class ModuleEventRecorder : public ModuleMedia {
+public:
+    ModuleEventRecorder(uint32_t nPreRollMs = 5000, size_t nMaxBytes = 16 << 20);
+    ~ModuleEventRecorder();
+
+    int init() override;
+
+    // 设置写文件组件，并把它接为本组件的消费者
+    void setWriter(shared_ptr<ModuleFileWriter> pWriter);
+    void setPreRoll(uint32_t nPreRollMs);
+
+    // 触发录像，写入sFile，录到触发后nPostMs为止，线程安全。
+    // 录像过程中再次触发只延长结束时间，不换文件
+    int trigger(const std::string& sFile, uint32_t nPostMs);
+    bool isRecording();
+
+    // 环形缓冲区中的帧数及时长(毫秒)
+    int getBufferedFrames();
+    int64_t getBufferedMs();
+
+protected:
+    virtual ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override;
+    virtual void bufferReleaseCallBack(shared_ptr<MediaBuffer> buffer) override;
+
+private:
+    struct StFrame {
+        uint64_t nSeq;
+        size_t nOffset;
+        size_t nSize;
+        int64_t nPts;
+        bool bKey;
+    };
+
+    void storeFrame(shared_ptr<MediaBuffer> pBuffer);
+    bool allocSpace(size_t nSize, size_t& nOffset);
+    bool evictGop();
+    void trimPreRoll();
+    void startClip(int64_t nPts);
+
+private:
+    uint32_t m_nPreRollUs;
+    bool m_bHevc = false;
+
+    std::mutex m_mutex;
+    std::vector<uint8_t> m_vRing;
+    std::deque<StFrame> m_dqFrames;
+    uint64_t m_nNextSeq = 0;
+    // 缓冲区溢出后丢帧直到下一个关键帧
+    bool m_bGap = true;
+    std::vector<uint8_t> m_vHeader;
+    shared_ptr<VideoBuffer> m_pHeader;
+
+    shared_ptr<ModuleFileWriter> m_pWriter;
+    std::string m_sPendingFile;
+    uint32_t m_nPendingPostMs = 0;
+    bool m_bTriggerPending = false;
+
+    bool m_bRecording = false;
+    // 下一个要输出的帧
+    uint64_t m_nEmitSeq = 0;
+    int64_t m_nStopPts = 0;
+    // 已输出但写文件组件还未释放的帧，这些帧不能被覆盖
+    std::deque<uint64_t> m_dqInFlight;
+    // 上一次返回CONSUME_NEED_REPEAT，本次输入已经入缓冲区
+    bool m_bRepeating = false;
+};
+
+#endif // MODULEEVENTRECORDER_H
@@ -0,0 +1,248 @@
+#include "ModuleGopCache.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "NaluUtil.h"
+
+ModuleGopCache::ModuleGopCache() : ModuleMedia("ModuleGopCache") {
+    buffer_count = 0;
+}
+
+ModuleGopCache::~ModuleGopCache() {
+}
+
+int ModuleGopCache::init() {
+    shared_ptr<ModuleMedia> pProductor = getProductor();
+    if (pProductor != nullptr) {
+        input_para = pProductor->getOutputImagePara();
+    }
+    output_para = input_para;
+    if (input_para.v4l2Fmt != V4L2_PIX_FMT_H264 && input_para.v4l2Fmt != V4L2_PIX_FMT_HEVC) {
+        ff_warn("gop cache: input is not h264/h265, cache disabled\n");
+    }
+    m_bHevc = input_para.v4l2Fmt == V4L2_PIX_FMT_HEVC;
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_vHeader.clear();
+    m_vData.clear();
+    m_vFrames.clear();
+    m_bValid = false;
+    return 0;
+}
+
+void ModuleGopCache::setMaxCacheSize(size_t nBytes) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nMaxCacheSize = nBytes;
+}
+
+void ModuleGopCache::setCacheEnable(bool bEnable) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_bCache = bEnable;
+    if (!bEnable) {
+        m_bValid = false;
+        std::vector<uint8_t>().swap(m_vData);
+        std::vector<StFrame>().swap(m_vFrames);
+    }
+}
+
+void ModuleGopCache::setClientWatch(ClientCountProvider provider, std::function<void()> onJoin, uint32_t nPollMs) {
+    m_clientCountProvider = provider;
+    m_onClientJoin = onJoin;
+    m_nPollMs = nPollMs;
+    m_nLastClientCount = 0;
+}
+
+int ModuleGopCache::tcpClientCount(int nPort) {
+    int nCount = 0;
+    const char* vPaths[] = {"/proc/net/tcp", "/proc/net/tcp6"};
+    for (const char* pPath : vPaths) {
+        FILE* pFile = fopen(pPath, "r");
+        if (pFile == nullptr) {
+            continue;
+        }
+        char sLine[256];
+        // 跳过表头
+        fgets(sLine, sizeof(sLine), pFile);
+        while (fgets(sLine, sizeof(sLine), pFile) != nullptr) {
+            // sl local_address(地址:端口) rem_address st，均为十六进制，st为01即ESTABLISHED
+            char sLocal[64];
+            unsigned int nState = 0;
+            if (sscanf(sLine, "%*s %63s %*s %x", sLocal, &nState) != 2 || nState != 1) {
+                continue;
+            }
+            const char* pColon = strrchr(sLocal, ':');
+            if (pColon != nullptr && (int)strtol(pColon + 1, nullptr, 16) == nPort) {
+                nCount++;
+            }
+        }
+        fclose(pFile);
+    }
+    return nCount;
+}
+
+int ModuleGopCache::addSubscriber(void_object_p pCtx, callback_handler callback) {
+    // 持有m_deliverMutex期间组件线程不会回调，回放与之后的实时帧之间不丢帧也不重复
+    std::lock_guard<std::mutex> deliver(m_deliverMutex);
+    StSubscriber stSubscriber;
+    std::vector<uint8_t> vData;
+    std::vector<StFrame> vFrames;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        stSubscriber = {m_nNextId++, pCtx, callback};
+        m_vSubscribers.push_back(stSubscriber);
+        // 回放不持有m_mutex，先复制缓存，只在订阅者加入时发生一次
+        if (m_bValid) {
+            vData = m_vData;
+            vFrames = m_vFrames;
+        }
+    }
+    m_deliverThread = std::this_thread::get_id();
+    replay(stSubscriber, vData, vFrames);
+    m_deliverThread = std::thread::id();
+    return stSubscriber.nId;
+}
+
+void ModuleGopCache::removeSubscriber(int nId) {
+    // 回调中移除时已持有m_deliverMutex
+    std::unique_lock<std::mutex> deliver(m_deliverMutex, std::defer_lock);
+    if (m_deliverThread != std::this_thread::get_id()) {
+        deliver.lock();
+    }
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_vSubscribers.erase(std::remove_if(m_vSubscribers.begin(), m_vSubscribers.end(),
+                                        [nId](const StSubscriber& s) { return s.nId == nId; }),
+                         m_vSubscribers.end());
+}
+
+bool ModuleGopCache::isSubscribed(int nId) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return std::any_of(m_vSubscribers.begin(), m_vSubscribers.end(), [nId](const StSubscriber& s) { return s.nId == nId; });
+}
+
+int ModuleGopCache::getSubscriberCount() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return (int)m_vSubscribers.size();
+}
+
+void ModuleGopCache::dropCache() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_bValid = false;
+}
+
+int ModuleGopCache::getCachedFrames() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_bValid ? (int)m_vFrames.size() : 0;
+}
+
+size_t ModuleGopCache::getCachedBytes() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    return m_bValid ? m_vData.size() : 0;
+}
+
+void ModuleGopCache::replay(StSubscriber& stSubscriber, const std::vector<uint8_t>& vData,
+                            const std::vector<StFrame>& vFrames) {
+    if (!stSubscriber.callback) {
+        return;
+    }
+    for (const StFrame& stFrame : vFrames) {
+        // 只包装缓存副本，不再拷贝
+        shared_ptr<VideoBuffer> pShell = std::make_shared<VideoBuffer>(VideoBuffer::EXTERNAL_BUFFER);
+        uint8_t* pData = (uint8_t*)vData.data() + stFrame.nOffset;
+        pShell->initWithExternalBuffer(pData, stFrame.nSize, -1);
+        pShell->setActiveData(pData);
+        pShell->setActiveSize(stFrame.nSize);
+        pShell->setPUstimestamp(stFrame.nPts);
+        pShell->setImagePara(output_para);
+        pShell->setMediaBufferType(BUFFER_TYPE_VIDEO);
+        stSubscriber.callback(stSubscriber.pCtx, pShell);
+    }
+}
+
+// 调用时已持有m_mutex
+void ModuleGopCache::cacheFrame(shared_ptr<MediaBuffer> pBuffer, const uint8_t* pData, size_t nSize) {
+    shared_ptr<MediaBuffer> pExtra = pBuffer->getExtraData();
+    if (pExtra != nullptr && pExtra->getActiveData() != nullptr && pExtra->getActiveSize() > 0) {
+        const uint8_t* pExtraData = (const uint8_t*)pExtra->getActiveData();
+        m_vHeader.assign(pExtraData, pExtraData + pExtra->getActiveSize());
+    }
+
+    if (NaluUtil::isKeyFrame(pData, nSize, m_bHevc)) {
+        m_vData.clear();
+        m_vFrames.clear();
+        m_bValid = true;
+        // 关键帧不带参数集时在前面补上
+        bool bHasParamSet = false;
+        NaluUtil::forEachNalu(pData, nSize, [&](const uint8_t* pNalu, size_t nLen) {
+            (void)nLen;
+            bHasParamSet = NaluUtil::isParamSet(NaluUtil::naluType(pNalu, m_bHevc), m_bHevc);
+            return false;
+        });
+        if (bHasParamSet) {
+            m_vHeader.clear();
+            NaluUtil::extractParamSets(pData, nSize, m_bHevc, m_vHeader);
+        } else {
+            m_vData.insert(m_vData.end(), m_vHeader.begin(), m_vHeader.end());
+        }
+    } else if (!m_bValid) {
+        return;
+    }
+
+    if (m_vData.size() + nSize > m_nMaxCacheSize) {
+        // 超出上限，等下一个关键帧
+        m_bValid = false;
+        return;
+    }
+    StFrame stFrame;
+    stFrame.nOffset = m_vFrames.empty() ? 0 : m_vData.size();
+    m_vData.insert(m_vData.end(), pData, pData + nSize);
+    stFrame.nSize = m_vData.size() - stFrame.nOffset;
+    stFrame.nPts = pBuffer->getPUstimestamp();
+    m_vFrames.push_back(stFrame);
+}
+
+ModuleMedia::ConsumeResult ModuleGopCache::doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) {
+    (void)output_buffer;
+    if (input_buffer == nullptr || input_buffer->getActiveData() == nullptr || input_buffer->getActiveSize() == 0) {
+        return CONSUME_BYPASS;
+    }
+    pollClients();
+    std::lock_guard<std::mutex> deliver(m_deliverMutex);
+    std::vector<StSubscriber> vSubscribers;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (m_bCache) {
+            cacheFrame(input_buffer, (const uint8_t*)input_buffer->getActiveData(), input_buffer->getActiveSize());
+        }
+        vSubscribers = m_vSubscribers;
+    }
+    // 不持有m_mutex回调，回调中可以移除订阅者
+    m_deliverThread = std::this_thread::get_id();
+    for (StSubscriber& stSubscriber : vSubscribers) {
+        // 前面的回调可能已移除后面的订阅者
+        if (!isSubscribed(stSubscriber.nId)) {
+            continue;
+        }
+        stSubscriber.callback(stSubscriber.pCtx, input_buffer);
+    }
+    m_deliverThread = std::thread::id();
+    return CONSUME_BYPASS;
+}
+
+void ModuleGopCache::pollClients() {
+    if (!m_clientCountProvider) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_lastPoll < std::chrono::milliseconds(m_nPollMs)) {
+        return;
+    }
+    m_lastPoll = now;
+    int nCount = m_clientCountProvider();
+    if (nCount > m_nLastClientCount && m_onClientJoin) {
+        m_onClientJoin();
+    }
+    m_nLastClientCount = nCount;
+}
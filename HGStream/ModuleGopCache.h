@@ -0,0 +1,103 @@
+#ifndef MODULEGOPCACHE_H
+#define MODULEGOPCACHE_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "module/module_media.hpp"
+
+// 首帧加速组件，接在ModuleMppEnc之后、rtsp/rtmp服务端之前，透传码流。
+// 服务端客户端：rtsp/rtmp服务端为预编译库，没有按客户端注入数据的接口，无法回放缓存，这里轮询服务端的客户端数
+// (rtmp用getCurClientCount，rtsp用tcpClientCount统计端口上的连接)，有新客户端时回调请求关键帧(ModuleMppEncEx::requestIdr)，
+// 新客户端在下一帧即收到带参数集的IDR，不必等一个GOP，也不需要缩短GOP。
+// 进程内订阅者：开启缓存后保存从最近一个关键帧开始的所有帧及参数集，新订阅者加入时先同步回放缓存的GOP(首帧带SPS/PPS)，
+// 再接收实时帧。缓存默认关闭，关闭时不拷贝码流；缓存区按GOP复用，稳定后不再分配内存。
+class ModuleGopCache : public ModuleMedia {
+public:
+    // 返回服务端当前客户端数
+    using ClientCountProvider = std::function<int()>;
+
+public:
+    ModuleGopCache();
+    ~ModuleGopCache();
+
+    int init() override;
+    void setBufferCount(uint16_t buffer_count) { (void)buffer_count; }
+
+    // 缓存上限(字节)，超过后丢弃本GOP的缓存直到下一个关键帧，默认8MB
+    void setMaxCacheSize(size_t nBytes);
+    // 是否缓存GOP供新订阅者回放，默认关闭；开启后从下一个关键帧开始缓存，关闭时释放缓存
+    void setCacheEnable(bool bEnable);
+
+    // 设置服务端客户端数查询，每nPollMs毫秒(默认200)在组件线程中查询一次，客户端数增加时调用onJoin，需在start之前设置
+    void setClientWatch(ClientCountProvider provider, std::function<void()> onJoin, uint32_t nPollMs = 200);
+    // 本机nPort端口上已建立的tcp连接数(/proc/net/tcp、tcp6)，rtsp每个客户端保持一条控制连接
+    static int tcpClientCount(int nPort);
+
+    // 添加订阅者，返回id。缓存的GOP在本调用中同步回放，之后的实时帧在组件线程中回调，
+    // 数据只在回调期间有效，回调需尽快返回。回调中可以调用removeSubscriber，不能调用addSubscriber
+    int addSubscriber(void_object_p pCtx, callback_handler callback);
+    // 返回后不会再回调该订阅者
+    void removeSubscriber(int nId);
+    int getSubscriberCount();
+
+    // 丢弃缓存，直到下一个关键帧(如编码暂停后缓存已过期)
+    void dropCache();
+
+    // 当前缓存的帧数及字节数
+    int getCachedFrames();
+    size_t getCachedBytes();
+
+protected:
+    virtual ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override;
+
+private:
+    struct StFrame {
+        size_t nOffset;
+        size_t nSize;
+        int64_t nPts;
+    };
+
+    struct StSubscriber {
+        int nId;
+        void_object pCtx;
+        callback_handler callback;
+    };
+
+    void cacheFrame(shared_ptr<MediaBuffer> pBuffer, const uint8_t* pData, size_t nSize);
+    void replay(StSubscriber& stSubscriber, const std::vector<uint8_t>& vData, const std::vector<StFrame>& vFrames);
+    void pollClients();
+    bool isSubscribed(int nId);
+
+private:
+    bool m_bHevc = false;
+    bool m_bCache = false;
+    size_t m_nMaxCacheSize = 8 << 20;
+
+    std::mutex m_mutex;
+    // 参数集，来自编码器附加数据或码流内
+    std::vector<uint8_t> m_vHeader;
+    std::vector<uint8_t> m_vData;
+    std::vector<StFrame> m_vFrames;
+    // 缓存从关键帧开始且未溢出时有效
+    bool m_bValid = false;
+
+    std::vector<StSubscriber> m_vSubscribers;
+    int m_nNextId = 0;
+    // 回调期间持有，保证回放与实时帧不交错，也让removeSubscriber等到回调结束；回调不持有m_mutex
+    std::mutex m_deliverMutex;
+    std::atomic<std::thread::id> m_deliverThread{std::thread::id()};
+
+    // 只在组件线程中访问
+    ClientCountProvider m_clientCountProvider;
+    std::function<void()> m_onClientJoin;
+    uint32_t m_nPollMs = 200;
+    std::chrono::steady_clock::time_point m_lastPoll;
+    int m_nLastClientCount = 0;
+};
+
+#endif // MODULEGOPCACHE_H
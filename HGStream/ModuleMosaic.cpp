@@ -0,0 +1,219 @@
+#include "ModuleMosaic.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "BufferPool.h"
+
+namespace {
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+ModuleMosaic::ModuleMosaic(const ImagePara& output_para, uint32_t nRows, uint32_t nCols, uint32_t nFps)
+    : ModuleMedia("ModuleMosaic"), m_nFps(std::max(nFps, 1u)) {
+    this->output_para = output_para;
+    input_para = output_para;
+    buffer_count = 3;
+    m_nRows = std::max(nRows, 1u);
+    m_nCols = std::max(nCols, 1u);
+    while (m_nRows * m_nCols > MOSAIC_MAX_CELL_NUM) {
+        m_nRows > m_nCols ? m_nRows-- : m_nCols--;
+    }
+    m_nCellNum = m_nRows * m_nCols;
+    for (uint32_t i = 0; i < MOSAIC_MAX_CELL_NUM; ++i) {
+        StCell& stCell = m_stCells[i];
+        stCell.pMosaic = this;
+        stCell.nIndex = i;
+        stCell.x = stCell.y = stCell.w = stCell.h = 0;
+        stCell.nLastUs = 0;
+        stCell.nFrames = 0;
+        stCell.bBlank = true;
+    }
+    layoutGrid();
+}
+
+ModuleMosaic::~ModuleMosaic() {
+}
+
+void ModuleMosaic::layoutGrid() {
+    uint32_t nCellW = (output_para.width / m_nCols) & ~1u;
+    uint32_t nCellH = (output_para.height / m_nRows) & ~1u;
+    for (uint32_t i = 0; i < m_nCellNum; ++i) {
+        StCell& stCell = m_stCells[i];
+        stCell.x = (i % m_nCols) * nCellW;
+        stCell.y = (i / m_nCols) * nCellH;
+        stCell.w = nCellW;
+        stCell.h = nCellH;
+    }
+}
+
+int ModuleMosaic::init() {
+    if (output_para.width == 0 || output_para.height == 0) {
+        ff_error("mosaic: invalid output para\n");
+        return -1;
+    }
+    if (output_para.hstride < output_para.width || output_para.vstride < output_para.height) {
+        output_para.hstride = output_para.width;
+        output_para.vstride = output_para.height;
+        ModuleRga::alignStride(output_para.v4l2Fmt, output_para.hstride, output_para.vstride);
+    }
+    input_para = output_para;
+
+    m_pCanvas = BufferPool::getInstance()->acquire(output_para);
+    if (m_pCanvas == nullptr) {
+        ff_error("mosaic: failed to alloc canvas\n");
+        return -1;
+    }
+    m_pCanvas->fillWithBlack();
+
+    // 手动模式使用，不需要内部缓冲区
+    m_pCopyRga = make_shared<ModuleRga>(output_para, output_para, RGA_ROTATE_NONE);
+    m_pCopyRga->setBufferCount(0);
+    if (m_pCopyRga->init() < 0) {
+        ff_error("mosaic: failed to init rga\n");
+        return -1;
+    }
+    if (BufferPool::getInstance()->fill(buffer_pool, buffer_ptr_queue, buffer_count, output_para,
+                                        VideoBuffer::DRM_BUFFER_CACHEABLE) < 0) {
+        ff_error("mosaic: failed to alloc output buffers\n");
+        return -1;
+    }
+    return initBuffer(VideoBuffer::DRM_BUFFER_CACHEABLE);
+}
+
+int ModuleMosaic::setInput(uint32_t nCell, shared_ptr<ModuleMedia> pSource) {
+    if (nCell >= m_nCellNum || pSource == nullptr) {
+        return -1;
+    }
+    StCell& stCell = m_stCells[nCell];
+    stCell.pSource = pSource;
+    pSource->addExternalConsumer("ModuleMosaic", &stCell, onFrame);
+    return 0;
+}
+
+int ModuleMosaic::setCellRect(uint32_t nCell, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    if (nCell >= m_nCellNum || x + w > output_para.width || y + h > output_para.height) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> locker(m_canvasMutex);
+    StCell& stCell = m_stCells[nCell];
+    stCell.x = x & ~1u;
+    stCell.y = y & ~1u;
+    stCell.w = w & ~1u;
+    stCell.h = h & ~1u;
+    // 下一帧按新区域重建RGA
+    stCell.pRga = nullptr;
+    return 0;
+}
+
+void ModuleMosaic::setKeepAspect(bool bKeepAspect) {
+    m_bKeepAspect = bKeepAspect;
+}
+
+void ModuleMosaic::setStaleTimeout(uint32_t nTimeoutMs) {
+    m_nStaleTimeoutMs = nTimeoutMs;
+}
+
+void ModuleMosaic::setFps(uint32_t nFps) {
+    m_nFps = std::max(nFps, 1u);
+}
+
+uint64_t ModuleMosaic::getCellFrames(uint32_t nCell) const {
+    return nCell < m_nCellNum ? m_stCells[nCell].nFrames.load() : 0;
+}
+
+void ModuleMosaic::onFrame(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    if (pBuffer == nullptr || pBuffer->getMediaBufferType() != BUFFER_TYPE_VIDEO) {
+        return;
+    }
+    StCell* pCell = static_cast<StCell*>(pCtx);
+    pCell->pMosaic->drawCell(*pCell, static_pointer_cast<VideoBuffer>(pBuffer));
+}
+
+// 调用时已持有m_canvasMutex
+void ModuleMosaic::blankCell(StCell& stCell) {
+    m_pCanvas->fillWithBlack(stCell.x, stCell.y, stCell.w, stCell.h);
+    stCell.bBlank = true;
+}
+
+void ModuleMosaic::drawCell(StCell& stCell, shared_ptr<VideoBuffer> pFrame) {
+    ImagePara stInPara = pFrame->getImagePara();
+    if (stInPara.width == 0 || stInPara.height == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> locker(m_canvasMutex);
+    if (stCell.pRga == nullptr || !(stCell.stInPara == stInPara)) {
+        uint32_t dx = stCell.x, dy = stCell.y, dw = stCell.w, dh = stCell.h;
+        if (m_bKeepAspect) {
+            // 按较小缩放比例居中，四周留黑
+            if ((uint64_t)stInPara.width * stCell.h > (uint64_t)stInPara.height * stCell.w) {
+                dh = (uint32_t)((uint64_t)stCell.w * stInPara.height / stInPara.width) & ~1u;
+                dy = stCell.y + ((stCell.h - dh) / 2 & ~1u);
+            } else {
+                dw = (uint32_t)((uint64_t)stCell.h * stInPara.width / stInPara.height) & ~1u;
+                dx = stCell.x + ((stCell.w - dw) / 2 & ~1u);
+            }
+        }
+        stCell.pRga = make_shared<ModuleRga>(stInPara, output_para, RGA_ROTATE_NONE);
+        stCell.pRga->setBufferCount(0);
+        if (stCell.pRga->init() < 0) {
+            ff_error("mosaic: cell %u rga init failed\n", stCell.nIndex);
+            stCell.pRga = nullptr;
+            return;
+        }
+        stCell.pRga->setDstPara(output_para.v4l2Fmt, dx, dy, dw, dh, output_para.hstride, output_para.vstride);
+        stCell.stInPara = stInPara;
+        blankCell(stCell);
+    }
+    stCell.pRga->doConsume(pFrame, m_pCanvas);
+    stCell.bBlank = false;
+    stCell.nLastUs = nowUs();
+    stCell.nFrames++;
+}
+
+bool ModuleMosaic::setup() {
+    m_bStarted = false;
+    return true;
+}
+
+ModuleMedia::ProduceResult ModuleMosaic::doProduce(shared_ptr<MediaBuffer> output_buffer) {
+    if (output_buffer == nullptr) {
+        return PRODUCE_EMPTY;
+    }
+    // 固定帧率输出，落后超过两帧时重新对齐，不追帧
+    const std::chrono::microseconds period(1000000 / m_nFps);
+    if (!m_bStarted) {
+        m_nextTick = std::chrono::steady_clock::now();
+        m_bStarted = true;
+    }
+    std::this_thread::sleep_until(m_nextTick);
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    m_nextTick += period;
+    if (now > m_nextTick + period) {
+        m_nextTick = now + period;
+    }
+
+    shared_ptr<VideoBuffer> pOut = static_pointer_cast<VideoBuffer>(output_buffer);
+    int64_t nNowUs = nowUs();
+    {
+        std::lock_guard<std::mutex> locker(m_canvasMutex);
+        if (m_nStaleTimeoutMs > 0) {
+            for (uint32_t i = 0; i < m_nCellNum; ++i) {
+                StCell& stCell = m_stCells[i];
+                if (!stCell.bBlank && nNowUs - stCell.nLastUs > (int64_t)m_nStaleTimeoutMs * 1000) {
+                    blankCell(stCell);
+                }
+            }
+        }
+        if (m_pCopyRga->doConsume(m_pCanvas, pOut) != CONSUME_SUCCESS) {
+            return PRODUCE_EMPTY;
+        }
+    }
+    pOut->setPUstimestamp(nNowUs);
+    return PRODUCE_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#ifndef MODULEMOSAIC_H
+#define MODULEMOSAIC_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#include "module/module_media.hpp"
+#include "module/vp/module_rga.hpp"
+
+#define MOSAIC_MAX_CELL_NUM 64
+
+// 多路拼接组件，作为数据源组件使用：各路输入(如ModuleMppDec)以外部消费者方式接入，
+// 每来一帧就用RGA缩放写入共享画布中对应格子(setDstPara指定x/y/w/h)，每格只保留最新一帧；
+// 工作线程按固定帧率把画布拷贝到输出缓冲区，下游只需一个编码器。
+// 用法：
+//   auto pMosaic = make_shared<ModuleMosaic>(ImagePara(1920, 1080, 1920, 1080, V4L2_PIX_FMT_NV12), 3, 3, 25);
+//   pMosaic->init();
+//   pMosaic->setInput(0, pMppDec0); ...
+//   pMppEnc->setProductor(pMosaic); ...; pMosaic->start();
+class ModuleMosaic : public ModuleMedia {
+public:
+    ModuleMosaic(const ImagePara& output_para, uint32_t nRows, uint32_t nCols, uint32_t nFps = 25);
+    ~ModuleMosaic();
+
+    int init() override;
+
+    // 将输入组件接到第nCell格(行优先)，输入组件需已初始化
+    int setInput(uint32_t nCell, shared_ptr<ModuleMedia> pSource);
+    // 自定义格子区域，用于非均匀布局(如一大多小)，坐标按2对齐
+    int setCellRect(uint32_t nCell, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+    // 保持宽高比，格子内居中，默认拉伸铺满
+    void setKeepAspect(bool bKeepAspect);
+    // 超过nTimeoutMs没有新帧的格子填黑，0为保留最后一帧
+    void setStaleTimeout(uint32_t nTimeoutMs);
+    void setFps(uint32_t nFps);
+
+    uint32_t getCellCount() const { return m_nCellNum; }
+    // 某格累计写入的帧数
+    uint64_t getCellFrames(uint32_t nCell) const;
+
+protected:
+    virtual ProduceResult doProduce(shared_ptr<MediaBuffer> output_buffer) override;
+    virtual bool setup() override;
+
+private:
+    struct StCell {
+        ModuleMosaic* pMosaic;
+        uint32_t nIndex;
+        uint32_t x;
+        uint32_t y;
+        uint32_t w;
+        uint32_t h;
+        shared_ptr<ModuleMedia> pSource;
+        // 按输入参数创建的RGA，输入分辨率变化时重建
+        shared_ptr<ModuleRga> pRga;
+        ImagePara stInPara;
+        std::atomic<int64_t> nLastUs;
+        std::atomic<uint64_t> nFrames;
+        bool bBlank;
+    };
+
+    static void onFrame(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    void drawCell(StCell& stCell, shared_ptr<VideoBuffer> pFrame);
+    void blankCell(StCell& stCell);
+    void layoutGrid();
+
+private:
+    uint32_t m_nRows;
+    uint32_t m_nCols;
+    uint32_t m_nCellNum;
+    std::atomic<uint32_t> m_nFps;
+    bool m_bKeepAspect = false;
+    uint32_t m_nStaleTimeoutMs = 3000;
+
+    StCell m_stCells[MOSAIC_MAX_CELL_NUM];
+    // 画布由各路输入线程写入、工作线程读取，写格子和拷贝整图互斥
+    std::mutex m_canvasMutex;
+    shared_ptr<VideoBuffer> m_pCanvas;
+    shared_ptr<ModuleRga> m_pCopyRga;
+
+    std::chrono::steady_clock::time_point m_nextTick;
+    bool m_bStarted = false;
+};
+
+#endif // MODULEMOSAIC_H
@@ -0,0 +1,32 @@
+#include "ModuleMppEncEx.h"
+
+ModuleMppEncEx::ModuleMppEncEx(EncodeType type, int fps, int gop, int bps,
+                               EncodeRcMode mode, EncodeQuality quality, EncodeProfile profile)
+    : ModuleMppEnc(type, fps, gop, bps, mode, quality, profile) {
+}
+
+ModuleMppEncEx::~ModuleMppEncEx() {
+}
+
+void ModuleMppEncEx::requestIdr() {
+    m_bIdrPending = true;
+}
+
+void ModuleMppEncEx::setIdrMinInterval(uint32_t nIntervalMs) {
+    m_nIdrMinIntervalMs = nIntervalMs;
+}
+
+ModuleMedia::ConsumeResult ModuleMppEncEx::doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) {
+    auto now = std::chrono::steady_clock::now();
+    if (m_bIdrPending && now - m_lastIdr >= std::chrono::milliseconds(m_nIdrMinIntervalMs.load())) {
+        m_bIdrPending = false;
+        m_lastIdr = now;
+        // 基类setup只设置IDR标记，直接调用基类版本，不经过包装类的重载
+        if (!ModuleMppEnc::setup()) {
+            ff_warn("mppenc: failed to force idr\n");
+        } else {
+            m_nForcedIdr++;
+        }
+    }
+    return ModuleMppEnc::doConsume(input_buffer, output_buffer);
+}
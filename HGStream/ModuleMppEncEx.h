@@ -0,0 +1,37 @@
+#ifndef MODULEMPPENCEX_H
+#define MODULEMPPENCEX_H
+
+#include <atomic>
+#include <chrono>
+
+#include "module/vp/module_mppenc.hpp"
+
+// 编码组件扩展，支持按需插入关键帧。ModuleMppEnc没有公开的强制IDR接口(changeEncodeParameter只能在停止时调用，
+// 运行中直接返回失败)，它的setup()在线程启动时调用MppEncoder::setIdrFrame，这里在编码线程内、送入下一帧之前
+// 再调用一次，下一帧即为IDR，不重建编码器，也不打断编码线程。
+// 请求经过合并和限频，短时间内多个客户端同时加入只产生一个额外关键帧。服务端客户端的加入由ModuleGopCache轮询后请求。
+class ModuleMppEncEx : public ModuleMppEnc {
+public:
+    ModuleMppEncEx(EncodeType type, int fps = 30, int gop = 60, int bps = 2048,
+                   EncodeRcMode mode = ENCODE_RC_MODE_CBR, EncodeQuality quality = ENCODE_QUALITY_BEST,
+                   EncodeProfile profile = ENCODE_PROFILE_HIGH);
+    ~ModuleMppEncEx();
+
+    // 请求下一帧编码为关键帧，线程安全
+    void requestIdr();
+    // 两次强制关键帧的最小间隔，间隔内的请求合并到间隔结束后的第一帧，默认1000ms
+    void setIdrMinInterval(uint32_t nIntervalMs);
+
+    uint64_t getForcedIdrCount() const { return m_nForcedIdr; }
+
+protected:
+    virtual ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override;
+
+private:
+    std::atomic<bool> m_bIdrPending{false};
+    std::atomic<uint32_t> m_nIdrMinIntervalMs{1000};
+    std::chrono::steady_clock::time_point m_lastIdr;
+    std::atomic<uint64_t> m_nForcedIdr{0};
+};
+
+#endif // MODULEMPPENCEX_H
@@ -0,0 +1,223 @@
+#include "ModuleOsd.h"
+
+#include <stdint.h>
+#include <time.h>
+#include <algorithm>
+
+namespace {
+
+const OsdColor g_white = {255, 255, 255, 255};
+const OsdColor g_black = {0, 0, 0, 255};
+
+} // namespace
+
+ModuleOsd::ModuleOsd() : ModuleMedia("ModuleOsd") {
+    buffer_count = 0;
+}
+
+ModuleOsd::~ModuleOsd() {
+}
+
+int ModuleOsd::init() {
+    shared_ptr<ModuleMedia> pProductor = getProductor();
+    if (pProductor != nullptr) {
+        input_para = pProductor->getOutputImagePara();
+    }
+    output_para = input_para;
+    if (!OsdPainter::isSupported(input_para.v4l2Fmt)) {
+        ff_warn("osd: unsupported format %s, bypass\n", v4l2GetFmtName(input_para.v4l2Fmt));
+    }
+    return 0;
+}
+
+void ModuleOsd::setResultProvider(ResultProvider provider) {
+    m_resultProvider = provider;
+}
+
+void ModuleOsd::setResult(const DetectResult& stResult) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_stPushed.count = std::min(std::max(stResult.count, 0), HG_MAX_DETECT_NUM);
+    std::copy(stResult.boxes, stResult.boxes + m_stPushed.count, m_stPushed.boxes);
+    m_nPushedAge = 0;
+    if (m_pOverlay != nullptr) {
+        pushOverlay(m_stPushed);
+    }
+}
+
+void ModuleOsd::setHoldFrames(int nHoldFrames) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nHoldFrames = std::max(1, nHoldFrames);
+    if (m_pOverlay != nullptr) {
+        m_pOverlay->setExpireFrames(m_nHoldFrames);
+    }
+}
+
+void ModuleOsd::setLabels(const std::vector<std::string>& vLabels) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_vLabels = vLabels;
+}
+
+void ModuleOsd::setStyle(int nThickness, int nFontScale) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nThickness = std::max(1, nThickness);
+    m_nFontScale = OsdPainter::clampScale(nFontScale);
+}
+
+void ModuleOsd::setTimeEnable(bool bEnable) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_bTime = bEnable;
+    if (m_pOverlay != nullptr) {
+        m_pOverlay->setTimeEnable(bEnable, std::max(m_nFontScale, 2));
+    }
+}
+
+void ModuleOsd::setEnable(bool bEnable) {
+    m_bEnable = bEnable;
+}
+
+void ModuleOsd::setOverlay(shared_ptr<OverlayLayer> pOverlay) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_pOverlay != nullptr && m_pOverlay != pOverlay) {
+        m_pOverlay->setTimeEnable(false);
+        m_pOverlay->clear();
+    }
+    m_pOverlay = pOverlay;
+    if (m_pOverlay != nullptr) {
+        m_pOverlay->setExpireFrames(m_nHoldFrames);
+        m_pOverlay->setTimeEnable(m_bTime, std::max(m_nFontScale, 2));
+    }
+}
+
+// 调用时已持有m_mutex
+void ModuleOsd::pushOverlay(const DetectResult& stResult) {
+    m_pOverlay->beginFrame();
+    m_pOverlay->addDetections(stResult, m_vLabels, m_nThickness, m_nFontScale);
+    m_pOverlay->endFrame();
+}
+
+void ModuleOsd::drawResult(const DetectResult& stResult) {
+    char szLabel[64];
+    const int nTextH = OsdPainter::textHeight(m_nFontScale);
+    for (int i = 0; i < stResult.count; ++i) {
+        const DetectBox& box = stResult.boxes[i];
+        const OsdColor& stColor = OsdPainter::classColor(box.classId);
+        int x1 = (int)box.x1, y1 = (int)box.y1, x2 = (int)box.x2, y2 = (int)box.y2;
+        m_painter.setColor(stColor);
+        m_painter.drawRect(x1, y1, x2, y2, m_nThickness);
+
+        const char* pName = nullptr;
+        if (box.classId >= 0 && box.classId < (int)m_vLabels.size()) {
+            pName = m_vLabels[box.classId].c_str();
+        }
+        OsdPainter::formatLabel(szLabel, sizeof(szLabel), box, pName);
+        // 标签放在框上方，放不下时放在框内
+        int nTextW = OsdPainter::textWidth(szLabel, m_nFontScale);
+        int ty = y1 - nTextH >= 0 ? y1 - nTextH : y1;
+        m_painter.fillRect(x1, ty, nTextW + 4, nTextH);
+        int nLuma = stColor.r * 3 + stColor.g * 6 + stColor.b;
+        m_painter.setColor(nLuma > 1280 ? g_black : g_white);
+        m_painter.drawText(x1 + 2, ty, szLabel, m_nFontScale);
+    }
+}
+
+void ModuleOsd::drawTime() {
+    time_t nNow = time(nullptr);
+    if (nNow != m_nLastSecond) {
+        struct tm stTm;
+        localtime_r(&nNow, &stTm);
+        strftime(m_szTime, sizeof(m_szTime), "%Y-%m-%d %H:%M:%S", &stTm);
+        m_nLastSecond = nNow;
+    }
+    int nScale = std::max(m_nFontScale, 2);
+    m_painter.setColor(g_black);
+    m_painter.fillRect(8, 8, OsdPainter::textWidth(m_szTime, nScale) + 8, OsdPainter::textHeight(nScale));
+    m_painter.setColor(g_white);
+    m_painter.drawText(12, 8, m_szTime, nScale);
+}
+
+// 时间一段，检测框及标签合并为一段，每段在NV12上对应Y、UV两个区间
+int ModuleOsd::dirtyRanges(const ImagePara& stPara, size_t nBase, bool bResult, CpuAccess::StRange* pRanges) {
+    int nRanges = 0;
+    if (m_bTime) {
+        int nTimeH = OsdPainter::textHeight(std::max(m_nFontScale, 2));
+        int n = CpuAccess::rowRanges(stPara, nBase, 8, 8 + nTimeH, pRanges);
+        if (n < 0) {
+            return -1;
+        }
+        nRanges += n;
+    }
+    if (bResult && m_stResult.count > 0) {
+        const int nTextH = OsdPainter::textHeight(m_nFontScale);
+        int y0 = INT32_MAX;
+        int y1 = INT32_MIN;
+        for (int i = 0; i < m_stResult.count; ++i) {
+            const DetectBox& box = m_stResult.boxes[i];
+            y0 = std::min(y0, std::min((int)box.y1 - nTextH, (int)box.y1 - m_nThickness));
+            y1 = std::max(y1, std::max((int)box.y2, (int)box.y1 + nTextH) + m_nThickness);
+        }
+        int n = CpuAccess::rowRanges(stPara, nBase, y0, y1, pRanges + nRanges);
+        if (n < 0) {
+            return -1;
+        }
+        nRanges += n;
+    }
+    return nRanges;
+}
+
+ModuleMedia::ConsumeResult ModuleOsd::doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) {
+    (void)output_buffer;
+    if (!m_bEnable || input_buffer == nullptr || input_buffer->getMediaBufferType() != BUFFER_TYPE_VIDEO) {
+        return CONSUME_BYPASS;
+    }
+    bool bOverlay = false;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        bOverlay = m_pOverlay != nullptr;
+    }
+    if (bOverlay) {
+        // 叠加层自己比较变化，结果不变时没有重画开销
+        if (m_resultProvider && m_resultProvider(input_buffer, &m_stResult)) {
+            std::lock_guard<std::mutex> locker(m_mutex);
+            if (m_pOverlay != nullptr) {
+                pushOverlay(m_stResult);
+            }
+        }
+        return CONSUME_BYPASS;
+    }
+    std::shared_ptr<VideoBuffer> pFrameBuf = static_pointer_cast<VideoBuffer>(input_buffer);
+    if (!m_painter.attach(pFrameBuf->getActiveData(), pFrameBuf->getImagePara())) {
+        return CONSUME_BYPASS;
+    }
+
+    bool bHasResult = false;
+    if (m_resultProvider && m_resultProvider(input_buffer, &m_stResult)) {
+        bHasResult = true;
+    }
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (!bHasResult && m_nPushedAge < m_nHoldFrames) {
+        m_stResult.count = m_stPushed.count;
+        std::copy(m_stPushed.boxes, m_stPushed.boxes + m_stPushed.count, m_stResult.boxes);
+        m_nPushedAge++;
+        bHasResult = m_stResult.count > 0;
+    }
+    if (!bHasResult && !m_bTime) {
+        return CONSUME_BYPASS;
+    }
+
+    // 只同步画到的行，析构时回写
+    size_t nBase = (uint8_t*)pFrameBuf->getActiveData() - (uint8_t*)pFrameBuf->getData();
+    CpuAccess::StRange vRanges[CpuAccess::MAX_RANGES];
+    int nRanges = dirtyRanges(pFrameBuf->getImagePara(), nBase, bHasResult, vRanges);
+    if (nRanges < 0) {
+        vRanges[0] = {nBase, pFrameBuf->getActiveSize()};
+        nRanges = 1;
+    }
+    CpuAccess access(pFrameBuf.get(), CpuAccess::READ_WRITE, vRanges, nRanges);
+    if (bHasResult) {
+        drawResult(m_stResult);
+    }
+    if (m_bTime) {
+        drawTime();
+    }
+    return CONSUME_BYPASS;
+}
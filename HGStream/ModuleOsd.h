@@ -0,0 +1,76 @@
+#ifndef MODULEOSD_H
+#define MODULEOSD_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+#include "libExportStream.h"
+#include "CpuAccess.h"
+#include "OsdPainter.h"
+#include "OverlayLayer.h"
+
+// 叠加组件，接在ModuleRga/ModuleMppDec与ModuleMppEnc之间，透传图像，
+// 在图像内存上直接绘制检测框、标签和时间，不经过BGR转换和主机内存往返。
+class ModuleOsd : public ModuleMedia {
+public:
+    // 检测结果提供者(如ModuleTracker::getResult)，返回true表示该帧有结果
+    using ResultProvider = std::function<bool(shared_ptr<MediaBuffer>, DetectResult*)>;
+
+public:
+    ModuleOsd();
+    ~ModuleOsd();
+
+    int init() override;
+    void setBufferCount(uint16_t buffer_count) { (void)buffer_count; }
+
+    void setResultProvider(ResultProvider provider);
+    // 外部推送检测结果，保持显示nHoldFrames帧(默认30)，线程安全
+    void setResult(const DetectResult& stResult);
+    void setHoldFrames(int nHoldFrames);
+    // 类别名称，下标为classId，为空时显示classId
+    void setLabels(const std::vector<std::string>& vLabels);
+    // 线宽及字体放大倍数(1~4)
+    void setStyle(int nThickness, int nFontScale);
+    // 左上角显示本地时间，默认不显示
+    void setTimeEnable(bool bEnable);
+    void setEnable(bool bEnable);
+    // 设置RGA混合叠加层，设置后检测框和时间交给叠加层由RGA合成，本组件不再修改图像。
+    // 叠加层挂在上游ModuleRga上，结果会比同一帧晚一帧显示
+    void setOverlay(shared_ptr<OverlayLayer> pOverlay);
+
+protected:
+    virtual ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override;
+
+private:
+    void drawResult(const DetectResult& stResult);
+    void drawTime();
+    // 本帧要画的行对应的区间，不支持的格式返回-1
+    int dirtyRanges(const ImagePara& stPara, size_t nBase, bool bResult, CpuAccess::StRange* pRanges);
+    void pushOverlay(const DetectResult& stResult);
+
+private:
+    OsdPainter m_painter;
+    shared_ptr<OverlayLayer> m_pOverlay;
+    ResultProvider m_resultProvider;
+
+    std::mutex m_mutex;
+    DetectResult m_stPushed;
+    int m_nPushedAge = 0;
+    int m_nHoldFrames = 30;
+    std::vector<std::string> m_vLabels;
+    int m_nThickness = 2;
+    int m_nFontScale = 1;
+    std::atomic<bool> m_bTime{false};
+    std::atomic<bool> m_bEnable{true};
+
+    DetectResult m_stResult;
+    // 时间字符串按秒缓存
+    long m_nLastSecond = -1;
+    char m_szTime[32] = {0};
+};
+
+#endif // MODULEOSD_H
@@ -0,0 +1,266 @@
+#include "ModuleRecordReader.h"
+
+#include <algorithm>
+#include <thread>
+
+// 当前分段预留的映射大小，分段仍在写入时地址不变
+#define RECORD_MAP_RESERVE (1ull << 30)
+
+ModuleRecordReader::ModuleRecordReader(const std::string& sDir, const std::string& sPrefix, uint32_t nFps)
+    : ModuleMedia("ModuleRecordReader"), m_sDir(sDir), m_sPrefix(sPrefix), m_nFps(std::max(nFps, 1u)) {
+    buffer_count = 4;
+    memset(&m_stNextKey, 0, sizeof(m_stNextKey));
+}
+
+ModuleRecordReader::~ModuleRecordReader() {
+}
+
+int ModuleRecordReader::init() {
+    if (m_index.open(m_sDir, m_sPrefix, false) < 0) {
+        ff_error("record reader: no index in %s\n", m_sDir.c_str());
+        return -1;
+    }
+    uint32_t nWidth, nHeight, nFmt;
+    m_index.getStreamInfo(nWidth, nHeight, nFmt);
+    if (nWidth == 0 || nHeight == 0 || (nFmt != V4L2_PIX_FMT_H264 && nFmt != V4L2_PIX_FMT_HEVC)) {
+        ff_error("record reader: invalid stream info in index\n");
+        return -1;
+    }
+    output_para = ImagePara(nWidth, nHeight, nWidth, nHeight, nFmt);
+    input_para = output_para;
+    m_readAhead.setDisk(IoPool::diskOf(m_sDir));
+    // 输出缓冲区只是外壳，指向分段文件的映射
+    return initBuffer(VideoBuffer::EXTERNAL_BUFFER);
+}
+
+int ModuleRecordReader::seek(int64_t nWallMs) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nSeekUs = nWallMs * 1000;
+    return 0;
+}
+
+void ModuleRecordReader::setSpeed(int nSpeed) {
+    m_nSpeed = nSpeed == 0 ? 1 : nSpeed;
+}
+
+void ModuleRecordReader::setRealtime(bool bRealtime) {
+    m_bRealtime = bRealtime;
+}
+
+int ModuleRecordReader::getTimeRange(int64_t& nBeginMs, int64_t& nEndMs) {
+    uint64_t nFirst, nEnd;
+    m_index.getRange(nFirst, nEnd);
+    SegmentIndex::StKeyFrame stFirst, stLast;
+    if (nFirst == nEnd || !m_index.getKeyFrame(nFirst, stFirst) || !m_index.getKeyFrame(nEnd - 1, stLast)) {
+        return -1;
+    }
+    nBeginMs = stFirst.nWallUs / 1000;
+    nEndMs = stLast.nWallUs / 1000;
+    return 0;
+}
+
+bool ModuleRecordReader::setup() {
+    m_nextTick = std::chrono::steady_clock::now();
+    return true;
+}
+
+bool ModuleRecordReader::openSegment(uint32_t nSegId, uint64_t nOffset) {
+    if (m_pFile != nullptr && m_nSegId == nSegId) {
+        m_nOffset = nOffset;
+        return true;
+    }
+    std::string sPath = m_index.getSegmentPath(nSegId);
+    if (sPath.empty()) {
+        return false;
+    }
+    shared_ptr<AnnexBFile> pFile = std::make_shared<AnnexBFile>();
+    if (pFile->open(sPath, output_para.v4l2Fmt == V4L2_PIX_FMT_HEVC, RECORD_MAP_RESERVE) < 0) {
+        return false;
+    }
+    m_pPrevFile = m_pFile;
+    m_nPrevHold = buffer_count;
+    m_pFile = pFile;
+    m_nSegId = nSegId;
+    m_nOffset = nOffset;
+    m_readAhead.reset();
+    return true;
+}
+
+bool ModuleRecordReader::seekToKey(uint64_t nPos) {
+    SegmentIndex::StKeyFrame stKey;
+    // 分段已被删除时往后找
+    uint64_t nFirst, nEnd;
+    m_index.getRange(nFirst, nEnd);
+    for (nPos = std::max(nPos, nFirst); nPos < nEnd; ++nPos) {
+        if (m_index.getKeyFrame(nPos, stKey) && openSegment(stKey.nSegId, stKey.nOffset)) {
+            m_nNextKeyPos = nPos;
+            loadNextKey();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModuleRecordReader::loadNextKey() {
+    m_bHasNextKey = m_index.getKeyFrame(m_nNextKeyPos, m_stNextKey);
+}
+
+void ModuleRecordReader::fillOutput(shared_ptr<MediaBuffer> pBuffer, const uint8_t* pData, size_t nSize) {
+    shared_ptr<VideoBuffer> pOutput = static_pointer_cast<VideoBuffer>(pBuffer);
+    pOutput->initWithExternalBuffer((void*)pData, nSize, -1);
+    pOutput->setActiveData((void*)pData);
+    pOutput->setActiveSize(nSize);
+    pOutput->setPUstimestamp(m_nPts);
+    pOutput->setImagePara(output_para);
+    pOutput->setMediaBufferType(BUFFER_TYPE_VIDEO);
+    if (m_nPrevHold > 0 && --m_nPrevHold == 0) {
+        m_pPrevFile = nullptr;
+    }
+}
+
+void ModuleRecordReader::pace(int64_t nIntervalUs) {
+    if (!m_bRealtime) {
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    auto interval = std::chrono::microseconds(nIntervalUs);
+    m_nextTick += interval;
+    if (m_nextTick < now - interval * 2) {
+        // 下游阻塞过久，不追赶
+        m_nextTick = now;
+    }
+    std::this_thread::sleep_until(m_nextTick);
+}
+
+ModuleMedia::ProduceResult ModuleRecordReader::doProduce(shared_ptr<MediaBuffer> output_buffer) {
+    int64_t nSeekUs;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        nSeekUs = m_nSeekUs;
+        m_nSeekUs = -1;
+    }
+    int nSpeed = m_nSpeed;
+    if (nSeekUs >= 0) {
+        int64_t nPos = m_index.findKeyFrame(nSeekUs);
+        if (nPos < 0 || !seekToKey(nPos)) {
+            ff_warn("record reader: nothing recorded at %lld ms\n", (long long)(nSeekUs / 1000));
+        }
+        m_nTrickPos = nPos;
+        m_nTrickShown = -1;
+    }
+    if (nSpeed != 1) {
+        return produceKeyFrame(output_buffer, nSpeed);
+    }
+    if (m_nTrickShown >= 0) {
+        // 退出快进快退，从最后输出的关键帧开始正常播放
+        seekToKey(m_nTrickShown);
+    }
+    m_nTrickPos = -1;
+    m_nTrickShown = -1;
+    if (m_pFile == nullptr) {
+        // 未指定位置时从最早的录像开始
+        uint64_t nFirst, nEnd;
+        m_index.getRange(nFirst, nEnd);
+        if (nFirst == nEnd || !seekToKey(nFirst)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            return PRODUCE_EMPTY;
+        }
+    }
+
+    bool bKey = false;
+    bool bAtEnd = false;
+    size_t nLen = m_pFile->accessUnit(m_nOffset, &bKey, &bAtEnd);
+    if (nLen == 0 || bAtEnd) {
+        // 已有下一个分段说明当前分段已写完，末尾的帧是完整的
+        bool bClosed = !m_index.getSegmentPath(m_nSegId + 1).empty();
+        if (!bClosed && m_pFile->remap()) {
+            nLen = m_pFile->accessUnit(m_nOffset, &bKey, &bAtEnd);
+        }
+        if (nLen == 0 || (bAtEnd && !bClosed)) {
+            if (bClosed) {
+                if (!openSegment(m_nSegId + 1, 0)) {
+                    seekToKey(m_nNextKeyPos);
+                }
+            } else {
+                // 追上正在录制的分段，等待新数据
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            }
+            return PRODUCE_EMPTY;
+        }
+    }
+
+    const uint8_t* pData = m_pFile->data() + m_nOffset;
+    int64_t nFrameUs = 1000000 / m_nFps;
+    if (!m_bHasNextKey) {
+        // 正在录制时下一个关键帧可能刚加入索引
+        loadNextKey();
+    }
+    if (m_bHasNextKey && m_stNextKey.nSegId == m_nSegId && m_stNextKey.nOffset == m_nOffset) {
+        m_nPts = m_stNextKey.nPts;
+        m_nPositionUs = m_stNextKey.nWallUs;
+        m_nNextKeyPos++;
+        loadNextKey();
+    } else {
+        m_nPts += nFrameUs;
+        m_nPositionUs += nFrameUs;
+    }
+    fillOutput(output_buffer, pData, nLen);
+    m_nOffset += nLen;
+    m_readAhead.advance(m_pFile, m_pFile->data(), m_pFile->size(), m_nOffset);
+    pace(nFrameUs);
+    return PRODUCE_SUCCESS;
+}
+
+// 快进快退：按索引逐个取关键帧，输出间隔为两个关键帧的录制间隔除以倍速
+ModuleMedia::ProduceResult ModuleRecordReader::produceKeyFrame(shared_ptr<MediaBuffer> pBuffer, int nSpeed) {
+    int nStep = nSpeed > 0 ? 1 : -1;
+    uint64_t nFirst, nEnd;
+    m_index.getRange(nFirst, nEnd);
+    if (m_nTrickPos < 0 && m_nTrickShown < 0) {
+        // 从正常播放进入，从当前GOP的关键帧开始
+        m_nTrickPos = m_pFile != nullptr && m_nNextKeyPos > nFirst ? (int64_t)m_nNextKeyPos - 1 : (int64_t)nFirst;
+    } else if (m_nTrickShown >= 0 && m_nTrickPos != m_nTrickShown + nStep) {
+        // 中途改变方向
+        m_nTrickPos = m_nTrickShown + nStep;
+    }
+    if (nStep > 0 && m_nTrickPos < (int64_t)nFirst) {
+        // 已被删除的部分跳到最早的录像
+        m_nTrickPos = nFirst;
+    }
+    if (m_nTrickPos < (int64_t)nFirst || m_nTrickPos >= (int64_t)nEnd) {
+        // 快退到最早的录像或快进追上正在录制的位置，停在最后输出的画面
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        return PRODUCE_EMPTY;
+    }
+
+    SegmentIndex::StKeyFrame stKey;
+    bool bKey = false;
+    size_t nLen = 0;
+    if (m_index.getKeyFrame(m_nTrickPos, stKey) && openSegment(stKey.nSegId, stKey.nOffset)) {
+        m_pFile->remap();
+        nLen = m_pFile->accessUnit(m_nOffset, &bKey);
+    }
+    if (nLen == 0 || !bKey) {
+        // 分段已删除，跳过
+        m_nTrickShown = m_nTrickPos;
+        m_nTrickPos += nStep;
+        return PRODUCE_EMPTY;
+    }
+
+    // 显示时长取到下一个关键帧的录制间隔除以倍速，最短一帧，录像中断处最长1秒
+    int64_t nIntervalUs = 1000000 / m_nFps;
+    SegmentIndex::StKeyFrame stNext;
+    if (m_nTrickPos + nStep >= (int64_t)nFirst && m_index.getKeyFrame(m_nTrickPos + nStep, stNext)) {
+        nIntervalUs = std::max(std::abs(stNext.nWallUs - stKey.nWallUs) / std::abs(nSpeed), nIntervalUs);
+        nIntervalUs = std::min(nIntervalUs, (int64_t)1000000);
+    }
+    // pts按实际输出间隔连续递增，与录制时的pts无关
+    m_nPts += m_nTrickIntervalUs;
+    m_nTrickIntervalUs = nIntervalUs;
+    m_nPositionUs = stKey.nWallUs;
+    fillOutput(pBuffer, m_pFile->data() + m_nOffset, nLen);
+    m_nTrickShown = m_nTrickPos;
+    m_nTrickPos += nStep;
+    pace(nIntervalUs);
+    return PRODUCE_SUCCESS;
+}
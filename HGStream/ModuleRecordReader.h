@@ -0,0 +1,88 @@
+#ifndef MODULERECORDREADER_H
+#define MODULERECORDREADER_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "module/module_media.hpp"
+#include "AnnexBFile.h"
+#include "IoPool.h"
+#include "SegmentIndex.h"
+
+// 录像回放组件，作为数据源接ModuleMppDec。读取ModuleSegmentRecorder写的分段和索引，
+// seek时在索引中二分查找不晚于目标时间的关键帧，直接从该分段的对应偏移开始输出，
+// 不需要逐个打开分段文件。分段用mmap映射，输出缓冲区直接指向映射内存，正常播放时由共享的IoPool
+// 按录像目录所在磁盘限流预读，工作线程只按帧率休眠。
+// 用法：
+//   auto pReader = make_shared<ModuleRecordReader>("/data/record");
+//   pReader->init(); pReader->seek(nWallMs);
+//   pMppDec = make_shared<ModuleMppDec>(pReader->getOutputImagePara()); pMppDec->setProductor(pReader); ...
+// 快进快退(setSpeed)时只按索引取关键帧送解码，按关键帧间隔除以倍速输出，pts重新连续编号，
+// 解码量只有正常播放的1/GOP。
+class ModuleRecordReader : public ModuleMedia {
+public:
+    ModuleRecordReader(const std::string& sDir, const std::string& sPrefix = "seg", uint32_t nFps = 25);
+    ~ModuleRecordReader();
+
+    int init() override;
+
+    // 定位到墙上时间nWallMs(毫秒)，从之前最近的关键帧开始输出，线程安全
+    int seek(int64_t nWallMs);
+    // 播放速度，1为正常播放，其他值只输出关键帧，如8/16快进，-8/-16快退
+    void setSpeed(int nSpeed);
+    int getSpeed() const { return m_nSpeed; }
+    // 按帧率输出(默认)，关闭后按下游处理速度输出
+    void setRealtime(bool bRealtime);
+    // 最近输出帧的墙上时间(毫秒)
+    int64_t getPosition() const { return m_nPositionUs / 1000; }
+    // 录像的时间范围(毫秒)，没有录像返回-1
+    int getTimeRange(int64_t& nBeginMs, int64_t& nEndMs);
+
+protected:
+    virtual ProduceResult doProduce(shared_ptr<MediaBuffer> output_buffer) override;
+    virtual bool setup() override;
+
+private:
+    bool openSegment(uint32_t nSegId, uint64_t nOffset);
+    bool seekToKey(uint64_t nPos);
+    void loadNextKey();
+    void fillOutput(shared_ptr<MediaBuffer> pBuffer, const uint8_t* pData, size_t nSize);
+    void pace(int64_t nIntervalUs);
+    ProduceResult produceKeyFrame(shared_ptr<MediaBuffer> pBuffer, int nSpeed);
+
+private:
+    std::string m_sDir;
+    std::string m_sPrefix;
+    uint32_t m_nFps;
+    bool m_bRealtime = true;
+    SegmentIndex m_index;
+
+    std::mutex m_mutex;
+    int64_t m_nSeekUs = -1;
+    std::atomic<int> m_nSpeed{1};
+
+    // 以下只在工作线程中访问
+    shared_ptr<AnnexBFile> m_pFile;
+    // 切换分段后旧映射还可能被下游引用，再输出buffer_count帧后释放
+    shared_ptr<AnnexBFile> m_pPrevFile;
+    uint32_t m_nPrevHold = 0;
+    uint32_t m_nSegId = 0;
+    size_t m_nOffset = 0;
+    // 下一个索引关键帧，到达时用它的pts和墙上时间校准
+    uint64_t m_nNextKeyPos = 0;
+    SegmentIndex::StKeyFrame m_stNextKey;
+    bool m_bHasNextKey = false;
+    int64_t m_nPts = 0;
+    // 快进快退时下一个/最后输出的关键帧在索引中的位置，<0为未定位
+    int64_t m_nTrickPos = -1;
+    int64_t m_nTrickShown = -1;
+    int64_t m_nTrickIntervalUs = 0;
+    std::atomic<int64_t> m_nPositionUs{0};
+    std::chrono::steady_clock::time_point m_nextTick;
+    IoReadAhead m_readAhead;
+};
+
+#endif // MODULERECORDREADER_H
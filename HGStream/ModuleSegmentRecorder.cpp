@@ -0,0 +1,361 @@
+#include "ModuleSegmentRecorder.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "NaluUtil.h"
+
+#define SEGMENT_CHUNK_SIZE (1 << 20)
+#define SEGMENT_IO_ALIGN 4096
+
+ModuleSegmentRecorder::ModuleSegmentRecorder(const std::string& sDir, const std::string& sPrefix)
+    : ModuleMedia("ModuleSegmentRecorder"), m_sDir(sDir), m_sPrefix(sPrefix) {
+    buffer_count = 0;
+}
+
+ModuleSegmentRecorder::~ModuleSegmentRecorder() {
+    teardown();
+    for (uint8_t* pData : m_vFreeChunks) {
+        free(pData);
+    }
+}
+
+int ModuleSegmentRecorder::init() {
+    shared_ptr<ModuleMedia> pProductor = getProductor();
+    if (pProductor != nullptr) {
+        input_para = pProductor->getOutputImagePara();
+    }
+    if (input_para.v4l2Fmt != V4L2_PIX_FMT_H264 && input_para.v4l2Fmt != V4L2_PIX_FMT_HEVC) {
+        ff_error("segment recorder: input must be h264/h265\n");
+        return -1;
+    }
+    m_bHevc = input_para.v4l2Fmt == V4L2_PIX_FMT_HEVC;
+    m_sExt = m_bHevc ? ".h265" : ".h264";
+    output_para = input_para;
+    if (mkdir(m_sDir.c_str(), 0755) < 0 && errno != EEXIST) {
+        ff_error("segment recorder: failed to create %s\n", m_sDir.c_str());
+        return -1;
+    }
+    if (m_index.open(m_sDir, m_sPrefix, true) < 0) {
+        ff_warn("segment recorder: index disabled\n");
+    }
+    m_index.setStreamInfo(input_para.width, input_para.height, input_para.v4l2Fmt);
+    if (!m_bStarted) {
+        m_ioQueue.setDisk(IoPool::diskOf(m_sDir));
+    }
+    return 0;
+}
+
+void ModuleSegmentRecorder::setSegmentLimit(uint32_t nSeconds, uint64_t nBytes) {
+    m_nSegmentUs = (uint64_t)std::max(nSeconds, 1u) * 1000000;
+    m_nSegmentBytes = nBytes;
+}
+
+void ModuleSegmentRecorder::setRetention(uint64_t nMaxBytes) {
+    m_nRetentionBytes = nMaxBytes;
+}
+
+void ModuleSegmentRecorder::setDirectIo(bool bEnable) {
+    m_bDirectIo = bEnable;
+}
+
+void ModuleSegmentRecorder::setMaxPendingBytes(size_t nBytes) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nMaxPending = std::max(nBytes, (size_t)SEGMENT_CHUNK_SIZE);
+}
+
+bool ModuleSegmentRecorder::setup() {
+    if (!m_bStarted) {
+        m_bStarted = true;
+        m_ioQueue.post([this]() { scanSegments(); });
+    }
+    return true;
+}
+
+bool ModuleSegmentRecorder::teardown() {
+    // 编码线程已停止，把当前文件剩余数据交给IO线程，等待写完
+    if (m_bInSegment) {
+        closeSegment();
+    }
+    if (m_bStarted) {
+        m_ioQueue.post([this]() { closeFile(); });
+        m_ioQueue.drain();
+        m_bStarted = false;
+    }
+    return true;
+}
+
+uint8_t* ModuleSegmentRecorder::allocChunk() {
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (!m_vFreeChunks.empty()) {
+            uint8_t* pData = m_vFreeChunks.back();
+            m_vFreeChunks.pop_back();
+            return pData;
+        }
+    }
+    void* pData = nullptr;
+    if (posix_memalign(&pData, SEGMENT_IO_ALIGN, SEGMENT_CHUNK_SIZE) != 0) {
+        return nullptr;
+    }
+    return (uint8_t*)pData;
+}
+
+// 调用时已持有m_mutex
+void ModuleSegmentRecorder::freeChunk(uint8_t* pData) {
+    if (pData == nullptr) {
+        return;
+    }
+    // 空闲块最多保留积压上限对应的数量
+    if (m_vFreeChunks.size() < m_nMaxPending / SEGMENT_CHUNK_SIZE) {
+        m_vFreeChunks.push_back(pData);
+    } else {
+        free(pData);
+    }
+}
+
+// 以下在编码线程中调用
+
+void ModuleSegmentRecorder::submit(bool bClose) {
+    m_stCurrent.bClose = bClose;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_nPendingBytes += m_stCurrent.nSize;
+        m_dqPending.push_back(std::move(m_stCurrent));
+    }
+    m_ioQueue.post([this]() { writePending(); });
+    m_stCurrent = {nullptr, 0, "", false, {}};
+}
+
+void ModuleSegmentRecorder::append(const uint8_t* pData, size_t nSize) {
+    while (nSize > 0) {
+        if (m_stCurrent.pData == nullptr) {
+            m_stCurrent.pData = allocChunk();
+            if (m_stCurrent.pData == nullptr) {
+                ff_error("segment recorder: out of memory\n");
+                return;
+            }
+        }
+        size_t nCopy = std::min(nSize, (size_t)SEGMENT_CHUNK_SIZE - m_stCurrent.nSize);
+        memcpy(m_stCurrent.pData + m_stCurrent.nSize, pData, nCopy);
+        m_stCurrent.nSize += nCopy;
+        pData += nCopy;
+        nSize -= nCopy;
+        if (m_stCurrent.nSize == SEGMENT_CHUNK_SIZE) {
+            submit(false);
+        }
+    }
+}
+
+void ModuleSegmentRecorder::openSegment(int64_t nPts) {
+    char szTime[32];
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    struct tm stTm;
+    localtime_r(&ts.tv_sec, &stTm);
+    strftime(szTime, sizeof(szTime), "%Y%m%d_%H%M%S", &stTm);
+    char szMs[8];
+    snprintf(szMs, sizeof(szMs), "_%03d", (int)(ts.tv_nsec / 1000000));
+
+    m_stCurrent.sOpenFile = m_sDir + "/" + m_sPrefix + "_" + szTime + szMs + m_sExt;
+    m_nSegmentStartPts = nPts;
+    m_nSegmentSize = 0;
+    m_bInSegment = true;
+}
+
+void ModuleSegmentRecorder::closeSegment() {
+    submit(true);
+    m_bInSegment = false;
+}
+
+ModuleMedia::ConsumeResult ModuleSegmentRecorder::doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) {
+    (void)output_buffer;
+    if (input_buffer == nullptr || input_buffer->getActiveData() == nullptr || input_buffer->getActiveSize() == 0) {
+        return CONSUME_BYPASS;
+    }
+    const uint8_t* pData = (const uint8_t*)input_buffer->getActiveData();
+    size_t nSize = input_buffer->getActiveSize();
+    int64_t nPts = input_buffer->getPUstimestamp();
+    bool bKey = NaluUtil::isKeyFrame(pData, nSize, m_bHevc);
+
+    shared_ptr<MediaBuffer> pExtra = input_buffer->getExtraData();
+    if (pExtra != nullptr && pExtra->getActiveData() != nullptr && pExtra->getActiveSize() > 0) {
+        const uint8_t* pExtraData = (const uint8_t*)pExtra->getActiveData();
+        m_vHeader.assign(pExtraData, pExtraData + pExtra->getActiveSize());
+    }
+
+    if (bKey) {
+        if (m_bInSegment && (nPts - m_nSegmentStartPts >= (int64_t)m_nSegmentUs || m_nSegmentSize >= m_nSegmentBytes)) {
+            closeSegment();
+        }
+        m_bGap = false;
+    }
+    if (m_bGap) {
+        return CONSUME_BYPASS;
+    }
+
+    size_t nPending;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        nPending = m_nPendingBytes;
+    }
+    if (nPending + nSize > m_nMaxPending) {
+        // 磁盘跟不上，丢到下一个关键帧，不阻塞编码
+        if (m_nDropped++ == 0 || m_nDropped % 100 == 0) {
+            ff_warn("segment recorder: disk too slow, %llu frames dropped\n", (unsigned long long)m_nDropped.load());
+        }
+        m_bGap = true;
+        return CONSUME_BYPASS;
+    }
+
+    if (!m_bInSegment) {
+        openSegment(nPts);
+    }
+    if (bKey) {
+        // 帧(或补在前面的参数集)的第一个字节在当前块中
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        int64_t nWallUs = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+        m_stCurrent.vKeys.push_back({nWallUs, nPts, m_nSegmentSize});
+        std::vector<uint8_t> vParamSets;
+        if (NaluUtil::extractParamSets(pData, nSize, m_bHevc, vParamSets) == 0) {
+            // 参数集只在附加数据中时补在每个关键帧前，回放跳转到任一关键帧都能重建解码器
+            append(m_vHeader.data(), m_vHeader.size());
+            m_nSegmentSize += m_vHeader.size();
+        }
+    }
+    append(pData, nSize);
+    m_nSegmentSize += nSize;
+    return CONSUME_BYPASS;
+}
+
+// 以下在IO线程中调用
+
+// 每个提交的数据块对应一次投递，每次只写一块，同一磁盘上的其他录像可以轮流写入
+void ModuleSegmentRecorder::writePending() {
+    std::unique_lock<std::mutex> locker(m_mutex);
+    if (m_dqPending.empty()) {
+        return;
+    }
+    StChunk stChunk = std::move(m_dqPending.front());
+    m_dqPending.pop_front();
+    locker.unlock();
+    writeChunk(stChunk);
+    locker.lock();
+    m_nPendingBytes -= stChunk.nSize;
+    freeChunk(stChunk.pData);
+}
+
+bool ModuleSegmentRecorder::writeChunk(StChunk& stChunk) {
+    if (!stChunk.sOpenFile.empty()) {
+        closeFile();
+        int nFlags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        m_nFd = m_bDirectIo ? open(stChunk.sOpenFile.c_str(), nFlags | O_DIRECT, 0644) : -1;
+        m_bFdDirect = m_nFd >= 0;
+        if (m_nFd < 0) {
+            // 文件系统不支持O_DIRECT时退回普通写
+            m_nFd = open(stChunk.sOpenFile.c_str(), nFlags, 0644);
+        }
+        m_stOpen = {stChunk.sOpenFile, 0};
+        if (m_nFd < 0) {
+            // 不加入索引，打开失败的分段不会进入m_dqSegments，加入后索引表头永远删不掉
+            ff_error("segment recorder: failed to open %s: %s\n", stChunk.sOpenFile.c_str(), strerror(errno));
+            m_nSegId = 0;
+        } else {
+            m_nSegId = m_index.addSegment(stChunk.sOpenFile);
+        }
+    }
+
+    bool bRet = true;
+    if (m_nFd >= 0 && stChunk.nSize > 0) {
+        if (m_bFdDirect && stChunk.nSize % SEGMENT_IO_ALIGN != 0) {
+            // 文件最后一块不是对齐大小，关掉O_DIRECT再写
+            fcntl(m_nFd, F_SETFL, fcntl(m_nFd, F_GETFL) & ~O_DIRECT);
+            m_bFdDirect = false;
+        }
+        size_t nDone = 0;
+        while (nDone < stChunk.nSize) {
+            ssize_t nRet = write(m_nFd, stChunk.pData + nDone, stChunk.nSize - nDone);
+            if (nRet < 0 && errno == EINTR) {
+                continue;
+            }
+            if (nRet <= 0) {
+                ff_error("segment recorder: write %s failed: %s\n", m_stOpen.sPath.c_str(), strerror(errno));
+                bRet = false;
+                break;
+            }
+            nDone += nRet;
+        }
+        m_stOpen.nSize += nDone;
+        m_nWritten += nDone;
+    }
+    for (const StKeyRef& stKey : stChunk.vKeys) {
+        if (m_nSegId == 0) {
+            break;
+        }
+        m_index.addKeyFrame(m_nSegId, stKey.nWallUs, stKey.nPts, stKey.nOffset);
+    }
+    if (stChunk.bClose) {
+        closeFile();
+    }
+    return bRet;
+}
+
+void ModuleSegmentRecorder::closeFile() {
+    if (m_nFd < 0) {
+        return;
+    }
+    close(m_nFd);
+    m_nFd = -1;
+    m_dqSegments.push_back(m_stOpen);
+    m_nTotalBytes += m_stOpen.nSize;
+    m_stOpen = {"", 0};
+    m_index.sync();
+    applyRetention();
+}
+
+// 启动时把目录中已有的分段计入保留额度，文件名按时间命名，排序即为时间顺序
+void ModuleSegmentRecorder::scanSegments() {
+    DIR* pDir = opendir(m_sDir.c_str());
+    if (pDir == nullptr) {
+        return;
+    }
+    std::vector<std::string> vNames;
+    std::string sPrefix = m_sPrefix + "_";
+    while (struct dirent* pEntry = readdir(pDir)) {
+        std::string sName = pEntry->d_name;
+        if (sName.size() > sPrefix.size() + m_sExt.size() && sName.compare(0, sPrefix.size(), sPrefix) == 0
+            && sName.compare(sName.size() - m_sExt.size(), m_sExt.size(), m_sExt) == 0) {
+            vNames.push_back(sName);
+        }
+    }
+    closedir(pDir);
+    std::sort(vNames.begin(), vNames.end());
+
+    m_dqSegments.clear();
+    m_nTotalBytes = 0;
+    for (const std::string& sName : vNames) {
+        struct stat st;
+        std::string sPath = m_sDir + "/" + sName;
+        if (stat(sPath.c_str(), &st) == 0) {
+            m_dqSegments.push_back({sPath, (uint64_t)st.st_size});
+            m_nTotalBytes += st.st_size;
+        }
+    }
+    applyRetention();
+}
+
+void ModuleSegmentRecorder::applyRetention() {
+    uint64_t nLimit = m_nRetentionBytes;
+    while (nLimit > 0 && m_nTotalBytes > nLimit && !m_dqSegments.empty()) {
+        const StSegment& stOldest = m_dqSegments.front();
+        if (unlink(stOldest.sPath.c_str()) < 0 && errno != ENOENT) {
+            ff_warn("segment recorder: failed to delete %s\n", stOldest.sPath.c_str());
+        }
+        m_index.removeSegment(stOldest.sPath);
+        m_nTotalBytes -= stOldest.nSize;
+        m_dqSegments.pop_front();
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef MODULESEGMENTRECORDER_H
+#define MODULESEGMENTRECORDER_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+#include "IoPool.h"
+#include "SegmentIndex.h"
+
+// 分段录像组件，接在ModuleMppEnc之后，把H264/H265码流按时长或大小切成Annex-B文件(.h264/.h265)，
+// 只在关键帧处切分，每个文件都能独立解码。
+// 编码线程只把码流拷贝进1MB对齐的数据块，文件写入、切换和过期删除作为串行任务在共享的IoPool中按所在磁盘限流完成(下称IO线程)，
+// 写入以整块为单位，可选O_DIRECT绕过页缓存。磁盘变慢导致积压超过上限时丢帧直到下一个关键帧，
+// 不会阻塞编码。每个关键帧的时间和文件内偏移写入SegmentIndex，供ModuleRecordReader按时间定位。
+class ModuleSegmentRecorder : public ModuleMedia {
+public:
+    // 文件名为 sDir/sPrefix_YYYYmmdd_HHMMSS.h264
+    ModuleSegmentRecorder(const std::string& sDir, const std::string& sPrefix = "seg");
+    ~ModuleSegmentRecorder();
+
+    int init() override;
+    void setBufferCount(uint16_t buffer_count) { (void)buffer_count; }
+
+    // 分段时长(秒)与大小(字节)，任一满足即在下一个关键帧切分，默认60秒、256MB
+    void setSegmentLimit(uint32_t nSeconds, uint64_t nBytes = 256ull << 20);
+    // 目录中本组件文件的总大小上限，超出删除最旧的，0为不限制
+    void setRetention(uint64_t nMaxBytes);
+    // 使用O_DIRECT写入，需在init之前设置
+    void setDirectIo(bool bEnable);
+    // 等待写入的数据上限，默认32MB
+    void setMaxPendingBytes(size_t nBytes);
+
+    uint64_t getDroppedFrames() const { return m_nDropped; }
+    uint64_t getWrittenBytes() const { return m_nWritten; }
+
+protected:
+    virtual ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override;
+    virtual bool setup() override;
+    virtual bool teardown() override;
+
+private:
+    struct StKeyRef {
+        int64_t nWallUs;
+        int64_t nPts;
+        uint64_t nOffset;
+    };
+
+    struct StChunk {
+        uint8_t* pData;
+        size_t nSize;
+        // 非空表示从这一块开始写入新文件
+        std::string sOpenFile;
+        // 写完这一块后关闭文件
+        bool bClose;
+        // 从这一块开始的关键帧，写完后加入索引
+        std::vector<StKeyRef> vKeys;
+    };
+
+    struct StSegment {
+        std::string sPath;
+        uint64_t nSize;
+    };
+
+    uint8_t* allocChunk();
+    void freeChunk(uint8_t* pData);
+    void append(const uint8_t* pData, size_t nSize);
+    void submit(bool bClose);
+    void openSegment(int64_t nPts);
+    void closeSegment();
+
+    void writePending();
+    bool writeChunk(StChunk& stChunk);
+    void closeFile();
+    void scanSegments();
+    void applyRetention();
+
+private:
+    std::string m_sDir;
+    std::string m_sPrefix;
+    std::string m_sExt = ".h264";
+    bool m_bHevc = false;
+    uint64_t m_nSegmentUs = 60ull * 1000000;
+    uint64_t m_nSegmentBytes = 256ull << 20;
+    std::atomic<uint64_t> m_nRetentionBytes{0};
+    bool m_bDirectIo = false;
+    size_t m_nMaxPending = 32 << 20;
+
+    // 以下只在编码线程中访问
+    bool m_bInSegment = false;
+    bool m_bGap = true;
+    std::vector<uint8_t> m_vHeader;
+    int64_t m_nSegmentStartPts = 0;
+    uint64_t m_nSegmentSize = 0;
+    StChunk m_stCurrent = {nullptr, 0, "", false, {}};
+
+    // 编码线程与IO线程之间的队列
+    std::mutex m_mutex;
+    std::deque<StChunk> m_dqPending;
+    size_t m_nPendingBytes = 0;
+    std::vector<uint8_t*> m_vFreeChunks;
+    bool m_bStarted = false;
+    IoQueue m_ioQueue;
+
+    // 以下只在IO线程中访问
+    int m_nFd = -1;
+    SegmentIndex m_index;
+    uint32_t m_nSegId = 0;
+    bool m_bFdDirect = false;
+    StSegment m_stOpen = {"", 0};
+    std::deque<StSegment> m_dqSegments;
+    uint64_t m_nTotalBytes = 0;
+
+    std::atomic<uint64_t> m_nDropped{0};
+    std::atomic<uint64_t> m_nWritten{0};
+};
+
+#endif // MODULESEGMENTRECORDER_H
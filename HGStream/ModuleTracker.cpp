@@ -0,0 +1,300 @@
+#include "ModuleTracker.h"
+
+#include <algorithm>
+
+namespace {
+
+inline float boxIou(float ax1, float ay1, float ax2, float ay2, const DetectBox& b) {
+    float w = std::min(ax2, b.x2) - std::max(ax1, b.x1);
+    float h = std::min(ay2, b.y2) - std::max(ay1, b.y1);
+    if (w <= 0.f || h <= 0.f) {
+        return 0.f;
+    }
+    float fInter = w * h;
+    float fUnion = (ax2 - ax1) * (ay2 - ay1) + (b.x2 - b.x1) * (b.y2 - b.y1) - fInter;
+    return fUnion > 0.f ? fInter / fUnion : 0.f;
+}
+
+// 噪声随目标高度缩放
+inline void kalmanPredict(float& p, float& v, float& P00, float& P01, float& P11, float fScale) {
+    float qp = 0.05f * fScale;
+    float qv = 0.00625f * fScale;
+    p += v;
+    P00 += 2.f * P01 + P11 + qp * qp;
+    P01 += P11;
+    P11 += qv * qv;
+}
+
+inline void kalmanUpdate(float& p, float& v, float& P00, float& P01, float& P11, float z, float fScale) {
+    float r = 0.05f * fScale;
+    float S = P00 + r * r;
+    float K0 = P00 / S;
+    float K1 = P01 / S;
+    float y = z - p;
+    p += K0 * y;
+    v += K1 * y;
+    P11 -= K1 * P01;
+    P01 -= K0 * P01;
+    P00 -= K0 * P00;
+}
+
+} // namespace
+
+ModuleTracker::ModuleTracker() : ModuleMedia("ModuleTracker") {
+    buffer_count = 0;
+    resetTracks();
+}
+
+ModuleTracker::~ModuleTracker() {
+}
+
+int ModuleTracker::init() {
+    shared_ptr<ModuleMedia> pProductor = getProductor();
+    if (pProductor != nullptr) {
+        input_para = pProductor->getOutputImagePara();
+    }
+    output_para = input_para;
+    return 0;
+}
+
+void ModuleTracker::setDetectProvider(DetectProvider provider) {
+    m_detectProvider = provider;
+}
+
+void ModuleTracker::pushDetections(const DetectResult& stResult) {
+    std::lock_guard<std::mutex> locker(m_pendingMutex);
+    m_stPending.count = std::min(stResult.count, HG_MAX_DETECT_NUM);
+    std::copy(stResult.boxes, stResult.boxes + m_stPending.count, m_stPending.boxes);
+    m_bPending = true;
+}
+
+void ModuleTracker::setTrackCallback(TrackCallback callback) {
+    m_trackCallback = callback;
+}
+
+void ModuleTracker::setTrackPara(float fHighScore, float fIouThreshold, int nMinHits, int nMaxAge) {
+    m_fHighScore = fHighScore;
+    m_fIouThreshold = fIouThreshold;
+    m_nMinHits = std::max(1, nMinHits);
+    m_nMaxAge = std::max(0, nMaxAge);
+}
+
+void ModuleTracker::setMaxPredictFrames(int nFrames) {
+    m_nMaxPredictFrames = std::max(1, nFrames);
+}
+
+void ModuleTracker::resetTracks() {
+    for (int i = 0; i < MAX_TRACK_NUM; ++i) {
+        m_stTracks[i].bUsed = false;
+    }
+    std::lock_guard<std::mutex> locker(m_resultMutex);
+    for (int i = 0; i < TRACK_HISTORY_NUM; ++i) {
+        m_stResults[i].count = 0;
+        m_nResultPts[i] = -1;
+    }
+}
+
+bool ModuleTracker::getResult(int64_t pts, DetectResult* pResult) {
+    std::lock_guard<std::mutex> locker(m_resultMutex);
+    for (int i = 0; i < TRACK_HISTORY_NUM; ++i) {
+        if (m_nResultPts[i] == pts) {
+            pResult->count = m_stResults[i].count;
+            std::copy(m_stResults[i].boxes, m_stResults[i].boxes + pResult->count, pResult->boxes);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModuleTracker::getLatestResult(DetectResult* pResult) {
+    std::lock_guard<std::mutex> locker(m_resultMutex);
+    const DetectResult& stLatest = m_stResults[(m_nResultPos + TRACK_HISTORY_NUM - 1) % TRACK_HISTORY_NUM];
+    pResult->count = stLatest.count;
+    std::copy(stLatest.boxes, stLatest.boxes + stLatest.count, pResult->boxes);
+}
+
+void ModuleTracker::getTrackBox(const StTrack& stTrack, float& x1, float& y1, float& x2, float& y2) {
+    float w = std::max(stTrack.kf[2].p, 1.f);
+    float h = std::max(stTrack.kf[3].p, 1.f);
+    x1 = stTrack.kf[0].p - w * 0.5f;
+    y1 = stTrack.kf[1].p - h * 0.5f;
+    x2 = x1 + w;
+    y2 = y1 + h;
+}
+
+void ModuleTracker::predict() {
+    for (int i = 0; i < MAX_TRACK_NUM; ++i) {
+        StTrack& t = m_stTracks[i];
+        if (!t.bUsed) {
+            continue;
+        }
+        if (++t.nPredicted > m_nMaxPredictFrames) {
+            t.bUsed = false;
+            continue;
+        }
+        float fScale = std::max(t.kf[3].p, 1.f);
+        for (int k = 0; k < 4; ++k) {
+            StKalman1D& kf = t.kf[k];
+            kalmanPredict(kf.p, kf.v, kf.P00, kf.P01, kf.P11, fScale);
+        }
+    }
+}
+
+void ModuleTracker::startTrack(const DetectBox& stBox) {
+    for (int i = 0; i < MAX_TRACK_NUM; ++i) {
+        StTrack& t = m_stTracks[i];
+        if (t.bUsed) {
+            continue;
+        }
+        float z[4] = {(stBox.x1 + stBox.x2) * 0.5f, (stBox.y1 + stBox.y2) * 0.5f,
+                      stBox.x2 - stBox.x1, stBox.y2 - stBox.y1};
+        float fScale = std::max(z[3], 1.f);
+        for (int k = 0; k < 4; ++k) {
+            float sp = 0.1f * fScale;
+            float sv = 0.05f * fScale;
+            t.kf[k] = {z[k], 0.f, sp * sp, 0.f, sv * sv};
+        }
+        t.bUsed = true;
+        t.bConfirmed = m_nMinHits <= 1;
+        t.nId = m_nNextId++;
+        t.nClassId = stBox.classId;
+        t.fScore = stBox.score;
+        t.nHits = 1;
+        t.nMissed = 0;
+        t.nPredicted = 0;
+        return;
+    }
+}
+
+void ModuleTracker::associate(const DetectResult& stDets, bool bHigh, bool bConfirmedOnly) {
+    int nPairs = 0;
+    for (int i = 0; i < MAX_TRACK_NUM; ++i) {
+        StTrack& t = m_stTracks[i];
+        // 本轮已匹配的跟踪nMissed为-1
+        if (!t.bUsed || t.nMissed < 0 || (bConfirmedOnly && !t.bConfirmed)) {
+            continue;
+        }
+        float x1, y1, x2, y2;
+        getTrackBox(t, x1, y1, x2, y2);
+        for (int j = 0; j < stDets.count; ++j) {
+            const DetectBox& d = stDets.boxes[j];
+            if (m_bDetMatched[j] || d.classId != t.nClassId || (d.score >= m_fHighScore) != bHigh) {
+                continue;
+            }
+            float fIou = boxIou(x1, y1, x2, y2, d);
+            if (fIou >= m_fIouThreshold) {
+                m_stPairs[nPairs++] = {fIou, (short)i, (short)j};
+            }
+        }
+    }
+    std::sort(m_stPairs, m_stPairs + nPairs, [](const StPair& a, const StPair& b) {
+        return a.fIou > b.fIou;
+    });
+    for (int k = 0; k < nPairs; ++k) {
+        StTrack& t = m_stTracks[m_stPairs[k].nTrack];
+        int j = m_stPairs[k].nDet;
+        if (t.nMissed < 0 || m_bDetMatched[j]) {
+            continue;
+        }
+        const DetectBox& d = stDets.boxes[j];
+        float z[4] = {(d.x1 + d.x2) * 0.5f, (d.y1 + d.y2) * 0.5f, d.x2 - d.x1, d.y2 - d.y1};
+        float fScale = std::max(t.kf[3].p, 1.f);
+        for (int c = 0; c < 4; ++c) {
+            StKalman1D& kf = t.kf[c];
+            kalmanUpdate(kf.p, kf.v, kf.P00, kf.P01, kf.P11, z[c], fScale);
+        }
+        t.fScore = d.score;
+        t.nHits++;
+        t.nMissed = -1;
+        t.nPredicted = 0;
+        if (t.nHits >= m_nMinHits) {
+            t.bConfirmed = true;
+        }
+        m_bDetMatched[j] = true;
+    }
+}
+
+void ModuleTracker::update(const DetectResult& stDets) {
+    const int nDets = std::min(stDets.count, HG_MAX_DETECT_NUM);
+    std::fill(m_bDetMatched, m_bDetMatched + nDets, false);
+    // 第一轮高分检测匹配所有跟踪，第二轮低分检测只匹配剩余的已确认跟踪
+    associate(stDets, true, false);
+    associate(stDets, false, true);
+
+    for (int i = 0; i < MAX_TRACK_NUM; ++i) {
+        StTrack& t = m_stTracks[i];
+        if (!t.bUsed) {
+            continue;
+        }
+        if (t.nMissed < 0) {
+            t.nMissed = 0;
+        } else if (!t.bConfirmed || ++t.nMissed > m_nMaxAge) {
+            t.bUsed = false;
+        }
+    }
+    for (int j = 0; j < nDets; ++j) {
+        if (!m_bDetMatched[j] && stDets.boxes[j].score >= m_fHighScore) {
+            startTrack(stDets.boxes[j]);
+        }
+    }
+}
+
+void ModuleTracker::makeResult(DetectResult& stResult) {
+    const float fMaxX = input_para.width > 0 ? (float)input_para.width : 1e9f;
+    const float fMaxY = input_para.height > 0 ? (float)input_para.height : 1e9f;
+    int nCount = 0;
+    for (int i = 0; i < MAX_TRACK_NUM && nCount < HG_MAX_DETECT_NUM; ++i) {
+        const StTrack& t = m_stTracks[i];
+        if (!t.bUsed || !t.bConfirmed) {
+            continue;
+        }
+        DetectBox& box = stResult.boxes[nCount++];
+        getTrackBox(t, box.x1, box.y1, box.x2, box.y2);
+        box.x1 = std::min(std::max(box.x1, 0.f), fMaxX);
+        box.y1 = std::min(std::max(box.y1, 0.f), fMaxY);
+        box.x2 = std::min(std::max(box.x2, 0.f), fMaxX);
+        box.y2 = std::min(std::max(box.y2, 0.f), fMaxY);
+        box.score = t.fScore;
+        box.classId = t.nClassId;
+        box.trackId = t.nId;
+    }
+    stResult.count = nCount;
+}
+
+ModuleMedia::ConsumeResult ModuleTracker::doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) {
+    (void)output_buffer;
+    if (input_buffer == nullptr || input_buffer->getMediaBufferType() != BUFFER_TYPE_VIDEO) {
+        return CONSUME_BYPASS;
+    }
+    predict();
+
+    bool bFresh = false;
+    if (m_detectProvider && m_detectProvider(input_buffer, &m_stDets) > 0) {
+        bFresh = true;
+    } else {
+        std::lock_guard<std::mutex> locker(m_pendingMutex);
+        if (m_bPending) {
+            m_stDets.count = m_stPending.count;
+            std::copy(m_stPending.boxes, m_stPending.boxes + m_stPending.count, m_stDets.boxes);
+            m_bPending = false;
+            bFresh = true;
+        }
+    }
+    if (bFresh) {
+        update(m_stDets);
+    }
+
+    // 结果槽位只由本线程写，解锁后回调不会被覆盖
+    DetectResult* pResult = nullptr;
+    {
+        std::lock_guard<std::mutex> locker(m_resultMutex);
+        pResult = &m_stResults[m_nResultPos];
+        makeResult(*pResult);
+        m_nResultPts[m_nResultPos] = input_buffer->getPUstimestamp();
+        m_nResultPos = (m_nResultPos + 1) % TRACK_HISTORY_NUM;
+    }
+    if (m_trackCallback) {
+        m_trackCallback(input_buffer, *pResult);
+    }
+    return CONSUME_BYPASS;
+}
@@ -0,0 +1,116 @@
+#ifndef MODULETRACKER_H
+#define MODULETRACKER_H
+
+#include <functional>
+#include <mutex>
+
+#include "module/module_media.hpp"
+#include "libExportStream.h"
+
+#define MAX_TRACK_NUM 64
+#define TRACK_HISTORY_NUM 8
+
+// 多目标跟踪组件，接在ModuleInference之后，透传图像。
+// 有检测结果的帧做卡尔曼更新+IoU关联(ByteTrack式高低分两轮贪心匹配)，
+// 没有推理的帧只做卡尔曼预测，保证框连续、id稳定。跟踪表固定容量，运行时不分配内存。
+class ModuleTracker : public ModuleMedia {
+public:
+    // 检测结果提供者，返回大于0表示该帧有新的检测结果
+    using DetectProvider = std::function<int(shared_ptr<MediaBuffer>, DetectResult*)>;
+    // 每帧跟踪结果回调
+    using TrackCallback = std::function<void(shared_ptr<MediaBuffer>, const DetectResult&)>;
+
+public:
+    ModuleTracker();
+    ~ModuleTracker();
+
+    int init() override;
+    void setBufferCount(uint16_t buffer_count) { (void)buffer_count; }
+
+    // 设置检测结果提供者，每帧调用
+    void setDetectProvider(DetectProvider provider);
+    // 外部推送检测结果，在下一帧生效，线程安全
+    void pushDetections(const DetectResult& stResult);
+    void setTrackCallback(TrackCallback callback);
+
+    // 设置高分阈值、关联IoU阈值、确认所需命中次数、最大丢失检测轮数
+    void setTrackPara(float fHighScore, float fIouThreshold, int nMinHits, int nMaxAge);
+    // 设置无检测更新时最多预测的帧数，超过则删除跟踪
+    void setMaxPredictFrames(int nFrames);
+
+    // 获取指定时间戳帧的跟踪结果，找不到返回false
+    bool getResult(int64_t pts, DetectResult* pResult);
+    // 获取最近一帧的跟踪结果
+    void getLatestResult(DetectResult* pResult);
+    // 清空跟踪表
+    void resetTracks();
+
+protected:
+    virtual ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override;
+
+private:
+    // 单维度匀速卡尔曼滤波
+    struct StKalman1D {
+        float p;
+        float v;
+        float P00;
+        float P01;
+        float P11;
+    };
+
+    struct StTrack {
+        bool bUsed;
+        bool bConfirmed;
+        int nId;
+        int nClassId;
+        float fScore;
+        int nHits;
+        // 连续未匹配的检测轮数
+        int nMissed;
+        // 距上次匹配的帧数
+        int nPredicted;
+        // cx, cy, w, h
+        StKalman1D kf[4];
+    };
+
+    struct StPair {
+        float fIou;
+        short nTrack;
+        short nDet;
+    };
+
+    void predict();
+    void update(const DetectResult& stDets);
+    void associate(const DetectResult& stDets, bool bHigh, bool bConfirmedOnly);
+    void startTrack(const DetectBox& stBox);
+    void getTrackBox(const StTrack& stTrack, float& x1, float& y1, float& x2, float& y2);
+    void makeResult(DetectResult& stResult);
+
+private:
+    float m_fHighScore = 0.5f;
+    float m_fIouThreshold = 0.3f;
+    int m_nMinHits = 2;
+    int m_nMaxAge = 5;
+    int m_nMaxPredictFrames = 90;
+    int m_nNextId = 0;
+
+    StTrack m_stTracks[MAX_TRACK_NUM];
+    bool m_bDetMatched[HG_MAX_DETECT_NUM];
+    StPair m_stPairs[MAX_TRACK_NUM * HG_MAX_DETECT_NUM];
+    DetectResult m_stDets;
+
+    DetectProvider m_detectProvider;
+    TrackCallback m_trackCallback;
+
+    std::mutex m_pendingMutex;
+    DetectResult m_stPending;
+    bool m_bPending = false;
+
+    // 按时间戳保存最近的结果，供下游(如叠加组件)按帧取用
+    std::mutex m_resultMutex;
+    DetectResult m_stResults[TRACK_HISTORY_NUM];
+    int64_t m_nResultPts[TRACK_HISTORY_NUM];
+    int m_nResultPos = 0;
+};
+
+#endif // MODULETRACKER_H
@@ -0,0 +1,386 @@
+#include "NaluUtil.h"
+
+#include <string.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HG_USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HG_USE_SSE2 1
+#endif
+
+namespace {
+
+// 查找00 00 01的位置，找不到返回end
+const uint8_t* scanStartCode(const uint8_t* p, const uint8_t* end) {
+#if defined(HG_USE_NEON) || defined(HG_USE_SSE2)
+    // 同时比较p、p+1、p+2开始的16字节，三者分别为0、0、1的位置即为起始码
+    while (end - p >= 18) {
+#if defined(HG_USE_NEON)
+        uint8x16_t m = vandq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), vdupq_n_u8(0)), vceqq_u8(vld1q_u8(p + 1), vdupq_n_u8(0))),
+                                vceqq_u8(vld1q_u8(p + 2), vdupq_n_u8(1)));
+#if defined(__aarch64__)
+        bool bFound = vmaxvq_u8(m) != 0;
+#else
+        uint64x2_t m64 = vreinterpretq_u64_u8(m);
+        bool bFound = (vgetq_lane_u64(m64, 0) | vgetq_lane_u64(m64, 1)) != 0;
+#endif
+        if (bFound) {
+            for (int i = 0;; ++i) {
+                if (p[i] == 0 && p[i + 1] == 0 && p[i + 2] == 1) {
+                    return p + i;
+                }
+            }
+        }
+#else
+        __m128i zero = _mm_setzero_si128();
+        __m128i m = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)p), zero),
+                                                _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 1)), zero)),
+                                  _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p + 2)), _mm_set1_epi8(1)));
+        int nMask = _mm_movemask_epi8(m);
+        if (nMask != 0) {
+            return p + __builtin_ctz(nMask);
+        }
+#endif
+        p += 16;
+    }
+#endif
+    while (end - p >= 3) {
+        // 先用memchr跳到下一个0，第三个字节为1时才可能是起始码
+        const uint8_t* z = (const uint8_t*)memchr(p, 0, end - p - 2);
+        if (z == nullptr) {
+            break;
+        }
+        if (z[1] == 0 && z[2] == 1) {
+            return z;
+        }
+        p = z + 1;
+    }
+    return end;
+}
+
+// 参数集按位读取，去掉防竞争字节(00 00 03)
+class BitReader {
+public:
+    BitReader(const uint8_t* pData, size_t nSize) {
+        m_vData.reserve(nSize);
+        for (size_t i = 0; i < nSize; ++i) {
+            if (i >= 2 && pData[i] == 3 && pData[i - 1] == 0 && pData[i - 2] == 0) {
+                continue;
+            }
+            m_vData.push_back(pData[i]);
+        }
+    }
+
+    uint32_t u(int nBits) {
+        uint32_t v = 0;
+        for (int i = 0; i < nBits; ++i) {
+            v <<= 1;
+            if (m_nPos < m_vData.size() * 8) {
+                v |= (m_vData[m_nPos >> 3] >> (7 - (m_nPos & 7))) & 1;
+            }
+            m_nPos++;
+        }
+        return v;
+    }
+
+    void skip(size_t nBits) { m_nPos += nBits; }
+
+    uint32_t ue() {
+        int nZeros = 0;
+        while (u(1) == 0 && nZeros < 32 && !overrun()) {
+            nZeros++;
+        }
+        return nZeros == 0 ? 0 : ((1u << nZeros) - 1 + u(nZeros));
+    }
+
+    int32_t se() {
+        uint32_t v = ue();
+        return (v & 1) ? (int32_t)((v + 1) / 2) : -(int32_t)(v / 2);
+    }
+
+    bool overrun() const { return m_nPos > m_vData.size() * 8; }
+
+private:
+    std::vector<uint8_t> m_vData;
+    size_t m_nPos = 0;
+};
+
+void skipScalingList(BitReader& br, int nSize) {
+    int nLast = 8, nNext = 8;
+    for (int i = 0; i < nSize; ++i) {
+        if (nNext != 0) {
+            nNext = (nLast + br.se() + 256) % 256;
+        }
+        nLast = nNext == 0 ? nLast : nNext;
+    }
+}
+
+bool parseH264Sps(const uint8_t* pNalu, size_t nLen, NaluUtil::StStreamInfo& stInfo) {
+    BitReader br(pNalu + 1, nLen - 1);
+    uint32_t nProfile = br.u(8);
+    br.skip(16);
+    br.ue();
+    uint32_t nChroma = 1;
+    if (nProfile == 100 || nProfile == 110 || nProfile == 122 || nProfile == 244 || nProfile == 44 || nProfile == 83 ||
+        nProfile == 86 || nProfile == 118 || nProfile == 128 || nProfile == 138 || nProfile == 139 || nProfile == 134 ||
+        nProfile == 135) {
+        nChroma = br.ue();
+        if (nChroma == 3) {
+            br.skip(1);
+        }
+        br.ue();
+        br.ue();
+        br.skip(1);
+        if (br.u(1)) {
+            for (int i = 0; i < (nChroma == 3 ? 12 : 8); ++i) {
+                if (br.u(1)) {
+                    skipScalingList(br, i < 6 ? 16 : 64);
+                }
+            }
+        }
+    }
+    br.ue();
+    uint32_t nPocType = br.ue();
+    if (nPocType == 0) {
+        br.ue();
+    } else if (nPocType == 1) {
+        br.skip(1);
+        br.se();
+        br.se();
+        uint32_t nCycle = br.ue();
+        for (uint32_t i = 0; i < nCycle && !br.overrun(); ++i) {
+            br.se();
+        }
+    }
+    br.ue();
+    br.skip(1);
+    uint32_t nWidthMbs = br.ue() + 1;
+    uint32_t nHeightMapUnits = br.ue() + 1;
+    uint32_t nFrameMbsOnly = br.u(1);
+    if (!nFrameMbsOnly) {
+        br.skip(1);
+    }
+    br.skip(1);
+    uint32_t nCrop[4] = {0, 0, 0, 0};
+    if (br.u(1)) {
+        for (int i = 0; i < 4; ++i) {
+            nCrop[i] = br.ue();
+        }
+    }
+    uint32_t nCropX = nChroma == 0 || nChroma == 3 ? 1 : 2;
+    uint32_t nCropY = (nChroma == 1 ? 2 : 1) * (2 - nFrameMbsOnly);
+    stInfo.nWidth = nWidthMbs * 16 - nCropX * (nCrop[0] + nCrop[1]);
+    stInfo.nHeight = (2 - nFrameMbsOnly) * nHeightMapUnits * 16 - nCropY * (nCrop[2] + nCrop[3]);
+    stInfo.fFps = 0;
+    if (br.u(1)) {
+        // vui
+        if (br.u(1) && br.u(8) == 255) {
+            br.skip(32);
+        }
+        if (br.u(1)) {
+            br.skip(1);
+        }
+        if (br.u(1)) {
+            br.skip(4);
+            if (br.u(1)) {
+                br.skip(24);
+            }
+        }
+        if (br.u(1)) {
+            br.ue();
+            br.ue();
+        }
+        if (br.u(1)) {
+            uint32_t nUnits = br.u(32);
+            uint32_t nScale = br.u(32);
+            // 以场为单位，一帧两个tick
+            if (nUnits != 0 && !br.overrun()) {
+                stInfo.fFps = nScale / (2.0 * nUnits);
+            }
+        }
+    }
+    return !br.overrun() && stInfo.nWidth > 0 && stInfo.nHeight > 0;
+}
+
+void skipProfileTierLevel(BitReader& br, uint32_t nMaxSubLayersMinus1) {
+    br.skip(96);
+    bool bProfile[8], bLevel[8];
+    for (uint32_t i = 0; i < nMaxSubLayersMinus1; ++i) {
+        bProfile[i] = br.u(1);
+        bLevel[i] = br.u(1);
+    }
+    if (nMaxSubLayersMinus1 > 0) {
+        br.skip(2 * (8 - nMaxSubLayersMinus1));
+    }
+    for (uint32_t i = 0; i < nMaxSubLayersMinus1; ++i) {
+        br.skip((bProfile[i] ? 88 : 0) + (bLevel[i] ? 8 : 0));
+    }
+}
+
+bool parseH265Sps(const uint8_t* pNalu, size_t nLen, NaluUtil::StStreamInfo& stInfo) {
+    BitReader br(pNalu + 2, nLen - 2);
+    br.skip(4);
+    uint32_t nMaxSubLayersMinus1 = br.u(3);
+    br.skip(1);
+    skipProfileTierLevel(br, nMaxSubLayersMinus1);
+    br.ue();
+    uint32_t nChroma = br.ue();
+    if (nChroma == 3) {
+        br.skip(1);
+    }
+    uint32_t nWidth = br.ue();
+    uint32_t nHeight = br.ue();
+    if (br.u(1)) {
+        uint32_t nSubW = nChroma == 1 || nChroma == 2 ? 2 : 1;
+        uint32_t nSubH = nChroma == 1 ? 2 : 1;
+        uint32_t nLeft = br.ue(), nRight = br.ue(), nTop = br.ue(), nBottom = br.ue();
+        nWidth -= nSubW * (nLeft + nRight);
+        nHeight -= nSubH * (nTop + nBottom);
+    }
+    stInfo.nWidth = nWidth;
+    stInfo.nHeight = nHeight;
+    return !br.overrun() && nWidth > 0 && nHeight > 0;
+}
+
+// H265的帧率取VPS中的timing info，SPS的VUI在长期参考帧等字段之后，不解析
+double parseH265VpsFps(const uint8_t* pNalu, size_t nLen) {
+    BitReader br(pNalu + 2, nLen - 2);
+    br.skip(12);
+    uint32_t nMaxSubLayersMinus1 = br.u(3);
+    br.skip(17);
+    skipProfileTierLevel(br, nMaxSubLayersMinus1);
+    bool bOrderingInfo = br.u(1);
+    for (uint32_t i = bOrderingInfo ? 0 : nMaxSubLayersMinus1; i <= nMaxSubLayersMinus1; ++i) {
+        br.ue();
+        br.ue();
+        br.ue();
+    }
+    uint32_t nMaxLayerId = br.u(6);
+    uint32_t nLayerSets = br.ue() + 1;
+    if (nLayerSets > 1024) {
+        return 0;
+    }
+    br.skip((size_t)(nLayerSets - 1) * (nMaxLayerId + 1));
+    if (!br.u(1)) {
+        return 0;
+    }
+    uint32_t nUnits = br.u(32);
+    uint32_t nScale = br.u(32);
+    return nUnits != 0 && !br.overrun() ? (double)nScale / nUnits : 0;
+}
+
+} // namespace
+
+namespace NaluUtil {
+
+const uint8_t* findStartCode(const uint8_t* p, const uint8_t* end, int* pLen) {
+    const uint8_t* begin = p;
+    const uint8_t* z = scanStartCode(p, end);
+    if (z == end) {
+        *pLen = 0;
+        return end;
+    }
+    if (z > begin && z[-1] == 0) {
+        *pLen = 4;
+        return z - 1;
+    }
+    *pLen = 3;
+    return z;
+}
+
+bool isKeyFrame(const uint8_t* pData, size_t nSize, bool bHevc) {
+    bool bKey = false;
+    forEachNalu(pData, nSize, [&](const uint8_t* pNalu, size_t nLen) {
+        (void)nLen;
+        int nType = naluType(pNalu, bHevc);
+        if (bHevc ? (nType >= NALU_H265_IRAP_BEGIN && nType <= NALU_H265_IRAP_END) : nType == NALU_H264_IDR) {
+            bKey = true;
+            return false;
+        }
+        // 只跳过参数集、SEI、AUD，遇到第一个slice即可判断
+        return bHevc ? nType >= NALU_H265_VPS
+                     : (nType == NALU_H264_SPS || nType == NALU_H264_PPS || nType == NALU_H264_SEI || nType == NALU_H264_AUD);
+    });
+    return bKey;
+}
+
+bool isParamSet(int nType, bool bHevc) {
+    if (bHevc) {
+        return nType == NALU_H265_VPS || nType == NALU_H265_SPS || nType == NALU_H265_PPS;
+    }
+    return nType == NALU_H264_SPS || nType == NALU_H264_PPS;
+}
+
+int extractParamSets(const uint8_t* pData, size_t nSize, bool bHevc, std::vector<uint8_t>& vOut) {
+    static const uint8_t startCode[4] = {0, 0, 0, 1};
+    int nCount = 0;
+    forEachNalu(pData, nSize, [&](const uint8_t* pNalu, size_t nLen) {
+        int nType = naluType(pNalu, bHevc);
+        if (isParamSet(nType, bHevc)) {
+            vOut.insert(vOut.end(), startCode, startCode + 4);
+            vOut.insert(vOut.end(), pNalu, pNalu + nLen);
+            nCount++;
+            return true;
+        }
+        // 遇到帧数据后不再有参数集
+        return bHevc ? nType >= NALU_H265_VPS : (nType == NALU_H264_SEI || nType == NALU_H264_AUD);
+    });
+    return nCount;
+}
+
+size_t nextAccessUnit(const uint8_t* pData, size_t nSize, bool bHevc, bool* pKey) {
+    const uint8_t* end = pData + nSize;
+    int nLen = 0;
+    const uint8_t* p = findStartCode(pData, end, &nLen);
+    bool bHasVcl = false;
+    bool bKey = false;
+    while (p < end) {
+        const uint8_t* pNalu = p + nLen;
+        const uint8_t* pNext = findStartCode(pNalu, end, &nLen);
+        if (pNalu < pNext) {
+            int nType = naluType(pNalu, bHevc);
+            bool bVcl = isVcl(nType, bHevc);
+            // 已有slice后，遇到非slice或新一帧的第一个slice即为下一帧的开始
+            if (bHasVcl && (!bVcl || isFirstSlice(pNalu, pNext - pNalu, bHevc))) {
+                break;
+            }
+            if (bVcl) {
+                bHasVcl = true;
+                bKey = bKey || (bHevc ? (nType >= NALU_H265_IRAP_BEGIN && nType <= NALU_H265_IRAP_END) : nType == NALU_H264_IDR);
+            }
+        }
+        p = pNext;
+    }
+    if (!bHasVcl) {
+        return 0;
+    }
+    if (pKey != nullptr) {
+        *pKey = bKey;
+    }
+    return p - pData;
+}
+
+bool parseStreamInfo(const uint8_t* pData, size_t nSize, bool bHevc, StStreamInfo& stInfo) {
+    bool bFound = false;
+    double fVpsFps = 0;
+    forEachNalu(pData, nSize, [&](const uint8_t* pNalu, size_t nLen) {
+        int nType = naluType(pNalu, bHevc);
+        if (bHevc && nType == NALU_H265_VPS && nLen > 2) {
+            fVpsFps = parseH265VpsFps(pNalu, nLen);
+        } else if (bHevc && nType == NALU_H265_SPS && nLen > 2) {
+            bFound = parseH265Sps(pNalu, nLen, stInfo);
+        } else if (!bHevc && nType == NALU_H264_SPS && nLen > 4) {
+            bFound = parseH264Sps(pNalu, nLen, stInfo);
+        }
+        // 参数集在第一帧之前
+        return !bFound && !isVcl(nType, bHevc);
+    });
+    if (bFound && bHevc) {
+        stInfo.fFps = fVpsFps;
+    }
+    return bFound;
+}
+
+} // namespace NaluUtil
@@ -0,0 +1,87 @@
+#ifndef NALUUTIL_H
+#define NALUUTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// H264 nal类型
+#define NALU_H264_IDR 5
+#define NALU_H264_SEI 6
+#define NALU_H264_SPS 7
+#define NALU_H264_PPS 8
+#define NALU_H264_AUD 9
+// H265 nal类型
+#define NALU_H265_IRAP_BEGIN 16
+#define NALU_H265_IRAP_END 23
+#define NALU_H265_VPS 32
+#define NALU_H265_SPS 33
+#define NALU_H265_PPS 34
+#define NALU_H265_AUD 35
+#define NALU_H265_SEI_PREFIX 39
+
+// Annex-B码流解析工具
+namespace NaluUtil {
+
+// 码流参数，从SPS(H265帧率在VPS)中解析
+struct StStreamInfo {
+    uint32_t nWidth;
+    uint32_t nHeight;
+    // 码流中记录的帧率，没有时为0
+    double fFps;
+};
+
+// 从p开始查找起始码(00 00 01或00 00 00 01)，返回起始码位置，pLen返回起始码长度，找不到返回end。
+// 支持NEON/SSE2时每次比较16字节
+const uint8_t* findStartCode(const uint8_t* p, const uint8_t* end, int* pLen);
+
+// 遍历码流中的nal，回调参数为nal头位置(不含起始码)及长度，回调返回false停止遍历
+template <typename Func>
+void forEachNalu(const uint8_t* pData, size_t nSize, Func func) {
+    const uint8_t* end = pData + nSize;
+    int nLen = 0;
+    const uint8_t* p = findStartCode(pData, end, &nLen);
+    while (p < end) {
+        const uint8_t* pNalu = p + nLen;
+        p = findStartCode(pNalu, end, &nLen);
+        if (pNalu < p && !func(pNalu, (size_t)(p - pNalu))) {
+            return;
+        }
+    }
+}
+
+inline int naluType(const uint8_t* pNalu, bool bHevc) {
+    return bHevc ? (pNalu[0] >> 1) & 0x3f : pNalu[0] & 0x1f;
+}
+
+// 是否为图像数据(slice)
+inline bool isVcl(int nType, bool bHevc) {
+    return bHevc ? nType < 32 : (nType >= 1 && nType <= 5);
+}
+
+// 是否为IDR/IRAP slice
+inline bool isKeyNalu(int nType, bool bHevc) {
+    return bHevc ? (nType >= NALU_H265_IRAP_BEGIN && nType <= NALU_H265_IRAP_END) : nType == NALU_H264_IDR;
+}
+
+// slice是否为一帧的第一个slice(H264 first_mb_in_slice为0，H265 first_slice_segment_in_pic_flag)
+inline bool isFirstSlice(const uint8_t* pNalu, size_t nLen, bool bHevc) {
+    size_t nHeader = bHevc ? 2 : 1;
+    return nLen > nHeader && (pNalu[nHeader] & 0x80) != 0;
+}
+
+// 从pData开始取一个访问单元(一帧及其前面的参数集/SEI)，返回长度，pKey返回是否关键帧，没有完整的帧返回0
+size_t nextAccessUnit(const uint8_t* pData, size_t nSize, bool bHevc, bool* pKey);
+
+// 是否包含IDR/IRAP帧
+bool isKeyFrame(const uint8_t* pData, size_t nSize, bool bHevc);
+// 是否为参数集(VPS/SPS/PPS)
+bool isParamSet(int nType, bool bHevc);
+// 提取码流中的参数集(带起始码)追加到vOut，返回提取的nal个数
+int extractParamSets(const uint8_t* pData, size_t nSize, bool bHevc, std::vector<uint8_t>& vOut);
+// 解析码流开头参数集中的分辨率和帧率，没有SPS返回false
+bool parseStreamInfo(const uint8_t* pData, size_t nSize, bool bHevc, StStreamInfo& stInfo);
+
+} // namespace NaluUtil
+
+#endif // NALUUTIL_H
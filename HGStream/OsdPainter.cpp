@@ -0,0 +1,521 @@
+#include "OsdPainter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+// 8x16点阵ASCII字库(0x20~0x7e)，每字节一行，高位在左
+const uint8_t g_font8x16[95][OSD_FONT_H] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // space
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x00, 0x00},  // !
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x64, 0x64, 0x64, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // "
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x12, 0x16, 0x7f, 0x24, 0x2c, 0xfe, 0x68, 0x48, 0x00, 0x00},  // #
+    {0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x3c, 0x78, 0x70, 0x3c, 0x1e, 0x16, 0x7e, 0x3c, 0x10, 0x10},  // $
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0xd0, 0xd0, 0x72, 0x18, 0x4e, 0x0b, 0x0b, 0x0e, 0x00, 0x00},  // %
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x64, 0x30, 0x30, 0x7b, 0xcf, 0xce, 0x6e, 0x3f, 0x00, 0x00},  // &
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // quote
+    {0x00, 0x00, 0x00, 0x0c, 0x18, 0x18, 0x18, 0x10, 0x30, 0x30, 0x10, 0x18, 0x18, 0x18, 0x0c, 0x00},  // (
+    {0x00, 0x00, 0x00, 0x30, 0x10, 0x18, 0x18, 0x18, 0x08, 0x08, 0x18, 0x18, 0x18, 0x10, 0x30, 0x00},  // )
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x5a, 0x3c, 0x3c, 0x5a, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00},  // *
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0xfe, 0xfe, 0x18, 0x18, 0x18, 0x00, 0x00},  // +
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x30},  // ,
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x3c, 0x00, 0x00, 0x00, 0x00, 0x00},  // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00},  // .
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x04, 0x0c, 0x0c, 0x08, 0x18, 0x10, 0x30, 0x20, 0x60, 0x40},  // /
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x66, 0x7e, 0x7e, 0x66, 0x66, 0x66, 0x3c, 0x00, 0x00},  // 0
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x00, 0x00},  // 1
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x4e, 0x06, 0x0e, 0x0c, 0x18, 0x30, 0x60, 0x7e, 0x00, 0x00},  // 2
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x46, 0x06, 0x3c, 0x0e, 0x06, 0x06, 0x46, 0x3c, 0x00, 0x00},  // 3
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x1c, 0x3c, 0x6c, 0x4c, 0x7e, 0x0c, 0x0c, 0x0c, 0x00, 0x00},  // 4
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x60, 0x60, 0x7c, 0x4e, 0x06, 0x06, 0x4e, 0x3c, 0x00, 0x00},  // 5
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x60, 0x60, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x3c, 0x00, 0x00},  // 6
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x06, 0x0c, 0x0c, 0x1c, 0x18, 0x18, 0x30, 0x30, 0x00, 0x00},  // 7
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x66, 0x3c, 0x66, 0x66, 0x66, 0x66, 0x3c, 0x00, 0x00},  // 8
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x6e, 0x66, 0x66, 0x6e, 0x3e, 0x06, 0x4c, 0x38, 0x00, 0x00},  // 9
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00},  // :
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x30},  // ;
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x1e, 0x78, 0xe0, 0x78, 0x1e, 0x02, 0x00, 0x00},  // <
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0xfe, 0x00, 0xfe, 0xfe, 0x00, 0x00, 0x00},  // =
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x70, 0x1e, 0x06, 0x1e, 0x70, 0x40, 0x00, 0x00},  // >
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x46, 0x06, 0x0c, 0x18, 0x18, 0x00, 0x18, 0x18, 0x00, 0x00},  // ?
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x62, 0x5e, 0xd2, 0xb2, 0xb2, 0xb2, 0xd2, 0x5e, 0x62, 0x1e},  // @
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x3c, 0x3c, 0x2c, 0x64, 0x7e, 0x66, 0x46, 0xc3, 0x00, 0x00},  // A
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x66, 0x66, 0x7c, 0x66, 0x66, 0x66, 0x7c, 0x00, 0x00},  // B
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x32, 0x60, 0x60, 0x60, 0x60, 0x60, 0x32, 0x1c, 0x00, 0x00},  // C
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x6e, 0x66, 0x66, 0x66, 0x66, 0x66, 0x6e, 0x7c, 0x00, 0x00},  // D
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x60, 0x60, 0x60, 0x7e, 0x60, 0x60, 0x60, 0x7e, 0x00, 0x00},  // E
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x60, 0x60, 0x60, 0x7e, 0x60, 0x60, 0x60, 0x60, 0x00, 0x00},  // F
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x72, 0x60, 0x60, 0x6e, 0x66, 0x66, 0x36, 0x3e, 0x00, 0x00},  // G
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x7e, 0x66, 0x66, 0x66, 0x66, 0x00, 0x00},  // H
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x00, 0x00},  // I
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x4c, 0x7c, 0x00, 0x00},  // J
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x6c, 0x7c, 0x78, 0x78, 0x6c, 0x6c, 0x66, 0x67, 0x00, 0x00},  // K
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x7e, 0x00, 0x00},  // L
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0xe6, 0xe6, 0xfe, 0xfe, 0xda, 0xda, 0xc2, 0xc2, 0xc2, 0x00, 0x00},  // M
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x76, 0x76, 0x5e, 0x4e, 0x4e, 0x4e, 0x46, 0x00, 0x00},  // N
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3c, 0x00, 0x00},  // O
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x7c, 0x60, 0x60, 0x60, 0x00, 0x00},  // P
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3c, 0x0e, 0x04},  // Q
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x7c, 0x6c, 0x66, 0x67, 0x00, 0x00},  // R
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x62, 0x60, 0x70, 0x3c, 0x0e, 0x06, 0x46, 0x3c, 0x00, 0x00},  // S
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00},  // T
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3c, 0x00, 0x00},  // U
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0xc6, 0x66, 0x66, 0x66, 0x64, 0x3c, 0x3c, 0x3c, 0x38, 0x00, 0x00},  // V
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0xc3, 0xc3, 0xdb, 0xda, 0x5a, 0x7e, 0x6e, 0x66, 0x66, 0x00, 0x00},  // W
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0xe6, 0x66, 0x3c, 0x3c, 0x18, 0x3c, 0x3c, 0x66, 0xc6, 0x00, 0x00},  // X
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0xc7, 0x66, 0x6e, 0x3c, 0x38, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00},  // Y
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x06, 0x0e, 0x1c, 0x18, 0x38, 0x70, 0x60, 0x7e, 0x00, 0x00},  // Z
+    {0x00, 0x00, 0x00, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1c, 0x00},  // [
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x60, 0x20, 0x30, 0x10, 0x18, 0x08, 0x0c, 0x0c, 0x04, 0x06},  // backslash
+    {0x00, 0x00, 0x00, 0x38, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x38, 0x00},  // ]
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x3c, 0x6c, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x00},  // _
+    {0x00, 0x00, 0x00, 0x00, 0x30, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},  // `
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x46, 0x06, 0x7e, 0x66, 0x66, 0x7e, 0x00, 0x00},  // a
+    {0x00, 0x00, 0x00, 0x60, 0x60, 0x60, 0x60, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7c, 0x00, 0x00},  // b
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x32, 0x60, 0x60, 0x60, 0x32, 0x1c, 0x00, 0x00},  // c
+    {0x00, 0x00, 0x00, 0x06, 0x06, 0x06, 0x06, 0x3e, 0x6e, 0x66, 0x66, 0x66, 0x6e, 0x3e, 0x00, 0x00},  // d
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x66, 0x7e, 0x60, 0x62, 0x3c, 0x00, 0x00},  // e
+    {0x00, 0x00, 0x00, 0x0e, 0x18, 0x18, 0x18, 0x7e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x00},  // f
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x6e, 0x66, 0x66, 0x66, 0x6e, 0x3e, 0x06, 0x46},  // g
+    {0x00, 0x00, 0x00, 0x60, 0x60, 0x60, 0x60, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x00, 0x00},  // h
+    {0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7e, 0x00, 0x00},  // i
+    {0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x38, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},  // j
+    {0x00, 0x00, 0x00, 0x60, 0x60, 0x60, 0x60, 0x66, 0x6c, 0x78, 0x78, 0x6c, 0x66, 0x66, 0x00, 0x00},  // k
+    {0x00, 0x00, 0x00, 0x70, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x30, 0x18, 0x1e, 0x00, 0x00},  // l
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xfe, 0xda, 0xda, 0xda, 0xda, 0xda, 0xda, 0x00, 0x00},  // m
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x00, 0x00},  // n
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x3c, 0x00, 0x00},  // o
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7c, 0x66, 0x66, 0x66, 0x66, 0x66, 0x7c, 0x60, 0x60},  // p
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x6e, 0x66, 0x66, 0x66, 0x6e, 0x3e, 0x06, 0x06},  // q
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3e, 0x38, 0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x00},  // r
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x64, 0x70, 0x3c, 0x0e, 0x46, 0x3c, 0x00, 0x00},  // s
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x7e, 0x30, 0x30, 0x30, 0x30, 0x18, 0x1e, 0x00, 0x00},  // t
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x66, 0x66, 0x6e, 0x3e, 0x00, 0x00},  // u
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x66, 0x66, 0x2c, 0x3c, 0x3c, 0x18, 0x00, 0x00},  // v
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc3, 0xc3, 0xda, 0x5a, 0x7e, 0x6e, 0x66, 0x00, 0x00},  // w
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x3c, 0x3c, 0x18, 0x3c, 0x6c, 0x66, 0x00, 0x00},  // x
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xe6, 0x66, 0x66, 0x3c, 0x3c, 0x3c, 0x18, 0x18, 0x38},  // y
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7e, 0x0e, 0x1c, 0x18, 0x30, 0x70, 0x7e, 0x00, 0x00},  // z
+    {0x00, 0x00, 0x00, 0x0e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x70, 0x18, 0x18, 0x18, 0x18, 0x0e, 0x00},  // {
+    {0x00, 0x00, 0x00, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18},  // |
+    {0x00, 0x00, 0x00, 0x70, 0x18, 0x18, 0x18, 0x18, 0x18, 0x0e, 0x18, 0x18, 0x18, 0x18, 0x70, 0x00},  // }
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x0e, 0x00, 0x00, 0x00, 0x00, 0x00},  // ~
+};
+
+// 某一放大倍数下的字形掩码，亮度按像素、色度按2x2块(任一像素命中即写)
+struct GlyphAtlas {
+    int nW;
+    int nH;
+    std::vector<uint8_t> vLuma;
+    std::vector<uint8_t> vChroma;
+};
+
+std::atomic<GlyphAtlas*> g_atlas[OSD_MAX_FONT_SCALE];
+std::mutex g_atlasMutex;
+
+GlyphAtlas* buildAtlas(int nScale) {
+    GlyphAtlas* pAtlas = new GlyphAtlas();
+    pAtlas->nW = OSD_FONT_W * nScale;
+    pAtlas->nH = OSD_FONT_H * nScale;
+    const int nLuma = pAtlas->nW * pAtlas->nH;
+    const int nChroma = (pAtlas->nW / 2) * (pAtlas->nH / 2);
+    pAtlas->vLuma.assign(95 * nLuma, 0);
+    pAtlas->vChroma.assign(95 * nChroma, 0);
+    for (int c = 0; c < 95; ++c) {
+        uint8_t* pLuma = pAtlas->vLuma.data() + c * nLuma;
+        for (int y = 0; y < pAtlas->nH; ++y) {
+            uint8_t nBits = g_font8x16[c][y / nScale];
+            for (int x = 0; x < pAtlas->nW; ++x) {
+                pLuma[y * pAtlas->nW + x] = (nBits & (0x80 >> (x / nScale))) ? 0xff : 0;
+            }
+        }
+        uint8_t* pChroma = pAtlas->vChroma.data() + c * nChroma;
+        for (int y = 0; y < pAtlas->nH / 2; ++y) {
+            for (int x = 0; x < pAtlas->nW / 2; ++x) {
+                const uint8_t* p = pLuma + (y * 2) * pAtlas->nW + x * 2;
+                pChroma[y * (pAtlas->nW / 2) + x] = p[0] | p[1] | p[pAtlas->nW] | p[pAtlas->nW + 1];
+            }
+        }
+    }
+    return pAtlas;
+}
+
+const GlyphAtlas* getAtlas(int nScale) {
+    GlyphAtlas* pAtlas = g_atlas[nScale - 1].load(std::memory_order_acquire);
+    if (pAtlas != nullptr) {
+        return pAtlas;
+    }
+    std::lock_guard<std::mutex> locker(g_atlasMutex);
+    pAtlas = g_atlas[nScale - 1].load(std::memory_order_relaxed);
+    if (pAtlas == nullptr) {
+        // 进程内常驻，不释放
+        pAtlas = buildAtlas(nScale);
+        g_atlas[nScale - 1].store(pAtlas, std::memory_order_release);
+    }
+    return pAtlas;
+}
+
+// Cohen-Sutherland裁剪，线段完全在区域外返回false
+int outCode(int x, int y, int nMinX, int nMinY, int nMaxX, int nMaxY) {
+    int nCode = 0;
+    if (x < nMinX) {
+        nCode |= 1;
+    } else if (x > nMaxX) {
+        nCode |= 2;
+    }
+    if (y < nMinY) {
+        nCode |= 4;
+    } else if (y > nMaxY) {
+        nCode |= 8;
+    }
+    return nCode;
+}
+
+bool clipLine(int& x0, int& y0, int& x1, int& y1, int nMinX, int nMinY, int nMaxX, int nMaxY) {
+    int nCode0 = outCode(x0, y0, nMinX, nMinY, nMaxX, nMaxY);
+    int nCode1 = outCode(x1, y1, nMinX, nMinY, nMaxX, nMaxY);
+    while (true) {
+        if ((nCode0 | nCode1) == 0) {
+            return true;
+        }
+        if (nCode0 & nCode1) {
+            return false;
+        }
+        int nCode = nCode0 ? nCode0 : nCode1;
+        double x = 0, y = 0;
+        double dx = x1 - x0;
+        double dy = y1 - y0;
+        if (nCode & 8) {
+            x = x0 + dx * (nMaxY - y0) / dy;
+            y = nMaxY;
+        } else if (nCode & 4) {
+            x = x0 + dx * (nMinY - y0) / dy;
+            y = nMinY;
+        } else if (nCode & 2) {
+            y = y0 + dy * (nMaxX - x0) / dx;
+            x = nMaxX;
+        } else {
+            y = y0 + dy * (nMinX - x0) / dx;
+            x = nMinX;
+        }
+        if (nCode == nCode0) {
+            x0 = (int)x;
+            y0 = (int)y;
+            nCode0 = outCode(x0, y0, nMinX, nMinY, nMaxX, nMaxY);
+        } else {
+            x1 = (int)x;
+            y1 = (int)y;
+            nCode1 = outCode(x1, y1, nMinX, nMinY, nMaxX, nMaxY);
+        }
+    }
+}
+
+const OsdColor g_palette[] = {
+    {255, 56, 56, 255}, {255, 157, 151, 255}, {255, 112, 31, 255}, {255, 178, 29, 255},
+    {72, 249, 10, 255}, {26, 147, 52, 255}, {0, 212, 187, 255}, {52, 69, 147, 255},
+    {0, 24, 236, 255}, {132, 56, 255, 255}, {203, 56, 255, 255}, {255, 149, 200, 255},
+};
+const int g_nPaletteSize = sizeof(g_palette) / sizeof(g_palette[0]);
+
+} // namespace
+
+OsdPainter::OsdPainter() {
+}
+
+bool OsdPainter::isSupported(uint32_t v4l2Fmt) {
+    switch (v4l2Fmt) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_BGR24:
+    case V4L2_PIX_FMT_RGB24:
+    case V4L2_PIX_FMT_BGR32:
+    case V4L2_PIX_FMT_ABGR32:
+    case V4L2_PIX_FMT_XBGR32:
+    case V4L2_PIX_FMT_ARGB32:
+    case V4L2_PIX_FMT_XRGB32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int OsdPainter::clampScale(int nScale) {
+    return std::min(std::max(nScale, 1), OSD_MAX_FONT_SCALE);
+}
+
+bool OsdPainter::attach(void* pData, const ImagePara& stPara) {
+    if (pData == nullptr || !isSupported(stPara.v4l2Fmt)) {
+        m_pData = nullptr;
+        return false;
+    }
+    m_pData = (uint8_t*)pData;
+    m_nFmt = stPara.v4l2Fmt;
+    m_nWidth = stPara.width;
+    m_nHeight = stPara.height;
+    resetClip();
+    m_nStride = std::max(stPara.hstride, stPara.width);
+    m_nVStride = std::max(stPara.vstride, stPara.height);
+    m_bYuv = false;
+    m_nOffA = -1;
+    switch (m_nFmt) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+        m_bYuv = true;
+        m_nPixelBytes = 1;
+        break;
+    case V4L2_PIX_FMT_BGR24:
+        m_nPixelBytes = 3;
+        m_nOffB = 0, m_nOffG = 1, m_nOffR = 2;
+        break;
+    case V4L2_PIX_FMT_RGB24:
+        m_nPixelBytes = 3;
+        m_nOffR = 0, m_nOffG = 1, m_nOffB = 2;
+        break;
+    case V4L2_PIX_FMT_BGR32:
+    case V4L2_PIX_FMT_ABGR32:
+    case V4L2_PIX_FMT_XBGR32:
+        m_nPixelBytes = 4;
+        m_nOffB = 0, m_nOffG = 1, m_nOffR = 2, m_nOffA = 3;
+        break;
+    default:
+        // ARGB32/XRGB32
+        m_nPixelBytes = 4;
+        m_nOffA = 0, m_nOffR = 1, m_nOffG = 2, m_nOffB = 3;
+        break;
+    }
+    return true;
+}
+
+void OsdPainter::setClip(int x, int y, int w, int h) {
+    m_nClipX0 = std::max(x, 0);
+    m_nClipY0 = std::max(y, 0);
+    m_nClipX1 = std::min(x + w, m_nWidth);
+    m_nClipY1 = std::min(y + h, m_nHeight);
+}
+
+void OsdPainter::resetClip() {
+    m_nClipX0 = 0;
+    m_nClipY0 = 0;
+    m_nClipX1 = m_nWidth;
+    m_nClipY1 = m_nHeight;
+}
+
+void OsdPainter::setColor(const OsdColor& stColor) {
+    // BT.601 limited range
+    int r = stColor.r, g = stColor.g, b = stColor.b;
+    m_nY = (uint8_t)(16 + ((66 * r + 129 * g + 25 * b + 128) >> 8));
+    uint8_t u = (uint8_t)(128 + ((-38 * r - 74 * g + 112 * b + 128) >> 8));
+    uint8_t v = (uint8_t)(128 + ((112 * r - 94 * g - 18 * b + 128) >> 8));
+    m_nUV[0] = m_nFmt == V4L2_PIX_FMT_NV21 ? v : u;
+    m_nUV[1] = m_nFmt == V4L2_PIX_FMT_NV21 ? u : v;
+    m_nPixel[m_nOffR] = stColor.r;
+    m_nPixel[m_nOffG] = stColor.g;
+    m_nPixel[m_nOffB] = stColor.b;
+    if (m_nOffA >= 0) {
+        m_nPixel[m_nOffA] = stColor.a;
+    }
+}
+
+void OsdPainter::fillRect(int x, int y, int w, int h) {
+    if (m_pData == nullptr || w <= 0 || h <= 0) {
+        return;
+    }
+    int x0 = std::max(x, m_nClipX0);
+    int y0 = std::max(y, m_nClipY0);
+    int x1 = std::min(x + w, m_nClipX1);
+    int y1 = std::min(y + h, m_nClipY1);
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    if (m_bYuv) {
+        fillRectYuv(x0, y0, x1, y1);
+    } else {
+        fillRectPacked(x0, y0, x1, y1);
+    }
+}
+
+void OsdPainter::fillRectYuv(int x0, int y0, int x1, int y1) {
+    for (int y = y0; y < y1; ++y) {
+        memset(m_pData + (size_t)y * m_nStride + x0, m_nY, x1 - x0);
+    }
+    uint8_t* pUV = m_pData + (size_t)m_nStride * m_nVStride;
+    const int cx0 = x0 >> 1;
+    const int cx1 = (x1 + 1) >> 1;
+    for (int cy = y0 >> 1; cy < (y1 + 1) >> 1; ++cy) {
+        uint8_t* p = pUV + (size_t)cy * m_nStride + cx0 * 2;
+        for (int cx = cx0; cx < cx1; ++cx, p += 2) {
+            p[0] = m_nUV[0];
+            p[1] = m_nUV[1];
+        }
+    }
+}
+
+void OsdPainter::fillRectPacked(int x0, int y0, int x1, int y1) {
+    const int nBpp = m_nPixelBytes;
+    const size_t nLine = (size_t)m_nStride * nBpp;
+    uint8_t* pFirst = m_pData + (size_t)y0 * nLine + (size_t)x0 * nBpp;
+    // 先填第一行，其余行整行拷贝
+    for (int x = x0; x < x1; ++x) {
+        memcpy(pFirst + (x - x0) * nBpp, m_nPixel, nBpp);
+    }
+    for (int y = y0 + 1; y < y1; ++y) {
+        memcpy(m_pData + (size_t)y * nLine + (size_t)x0 * nBpp, pFirst, (size_t)(x1 - x0) * nBpp);
+    }
+}
+
+void OsdPainter::drawRect(int x1, int y1, int x2, int y2, int nThickness) {
+    if (x1 > x2) {
+        std::swap(x1, x2);
+    }
+    if (y1 > y2) {
+        std::swap(y1, y2);
+    }
+    int t = std::max(nThickness, 1);
+    int w = x2 - x1 + 1;
+    int h = y2 - y1 + 1;
+    if (w <= 2 * t || h <= 2 * t) {
+        fillRect(x1, y1, w, h);
+        return;
+    }
+    fillRect(x1, y1, w, t);
+    fillRect(x1, y2 - t + 1, w, t);
+    fillRect(x1, y1 + t, t, h - 2 * t);
+    fillRect(x2 - t + 1, y1 + t, t, h - 2 * t);
+}
+
+void OsdPainter::drawLine(int x0, int y0, int x1, int y1, int nThickness) {
+    if (m_pData == nullptr) {
+        return;
+    }
+    int t = std::max(nThickness, 1);
+    int r = t / 2;
+    if (x0 == x1 || y0 == y1) {
+        fillRect(std::min(x0, x1) - r, std::min(y0, y1) - r, abs(x1 - x0) + t, abs(y1 - y0) + t);
+        return;
+    }
+    if (!clipLine(x0, y0, x1, y1, m_nClipX0 - t, m_nClipY0 - t, m_nClipX1 + t, m_nClipY1 + t)) {
+        return;
+    }
+    // Bresenham，每点画t*t方块
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int nErr = dx + dy;
+    while (true) {
+        fillRect(x0 - r, y0 - r, t, t);
+        if (x0 == x1 && y0 == y1) {
+            break;
+        }
+        int e2 = 2 * nErr;
+        if (e2 >= dy) {
+            nErr += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            nErr += dx;
+            y0 += sy;
+        }
+    }
+}
+
+const OsdColor& OsdPainter::classColor(int nClassId) {
+    return g_palette[(nClassId & 0x7fffffff) % g_nPaletteSize];
+}
+
+int OsdPainter::formatLabel(char* pLabel, int nSize, const DetectBox& stBox, const char* pName) {
+    int nScore = (int)(stBox.score * 100.f + 0.5f);
+    if (stBox.trackId >= 0) {
+        if (pName != nullptr) {
+            return snprintf(pLabel, nSize, "%s#%d %d%%", pName, stBox.trackId, nScore);
+        }
+        return snprintf(pLabel, nSize, "%d#%d %d%%", stBox.classId, stBox.trackId, nScore);
+    }
+    if (pName != nullptr) {
+        return snprintf(pLabel, nSize, "%s %d%%", pName, nScore);
+    }
+    return snprintf(pLabel, nSize, "%d %d%%", stBox.classId, nScore);
+}
+
+int OsdPainter::textWidth(const char* pText, int nScale) {
+    return pText == nullptr ? 0 : (int)strlen(pText) * OSD_FONT_W * clampScale(nScale);
+}
+
+int OsdPainter::drawText(int x, int y, const char* pText, int nScale) {
+    if (m_pData == nullptr || pText == nullptr) {
+        return 0;
+    }
+    nScale = clampScale(nScale);
+    if (m_bYuv) {
+        // 对齐到色度块
+        x &= ~1;
+        y &= ~1;
+    }
+    const int nAdvance = OSD_FONT_W * nScale;
+    int nX = x;
+    for (const char* p = pText; *p != '\0'; ++p, nX += nAdvance) {
+        if (nX >= m_nClipX1) {
+            break;
+        }
+        int c = (unsigned char)*p;
+        if (c > 0x20 && c < 0x7f && nX + nAdvance > m_nClipX0) {
+            drawGlyph(nX, y, c - 0x20, nScale);
+        }
+    }
+    return nX - x;
+}
+
+void OsdPainter::drawGlyph(int x, int y, int nChar, int nScale) {
+    const GlyphAtlas* pAtlas = getAtlas(nScale);
+    const int gx0 = std::max(0, m_nClipX0 - x);
+    const int gy0 = std::max(0, m_nClipY0 - y);
+    const int gx1 = std::min(pAtlas->nW, m_nClipX1 - x);
+    const int gy1 = std::min(pAtlas->nH, m_nClipY1 - y);
+    if (gx0 >= gx1 || gy0 >= gy1) {
+        return;
+    }
+    const uint8_t* pMask = pAtlas->vLuma.data() + (size_t)nChar * pAtlas->nW * pAtlas->nH;
+    if (m_bYuv) {
+        const uint8_t nY = m_nY;
+        for (int gy = gy0; gy < gy1; ++gy) {
+            const uint8_t* m = pMask + gy * pAtlas->nW;
+            uint8_t* d = m_pData + (size_t)(y + gy) * m_nStride + x;
+            for (int gx = gx0; gx < gx1; ++gx) {
+                // 掩码为0x00/0xff，无分支选择
+                d[gx] = (uint8_t)((d[gx] & ~m[gx]) | (nY & m[gx]));
+            }
+        }
+        const int cw = pAtlas->nW / 2;
+        const uint8_t* pChroma = pAtlas->vChroma.data() + (size_t)nChar * cw * (pAtlas->nH / 2);
+        uint8_t* pUV = m_pData + (size_t)m_nStride * m_nVStride;
+        for (int cy = gy0 / 2; cy < (gy1 + 1) / 2; ++cy) {
+            const uint8_t* m = pChroma + cy * cw;
+            uint8_t* d = pUV + (size_t)(y / 2 + cy) * m_nStride + x;
+            for (int cx = gx0 / 2; cx < (gx1 + 1) / 2; ++cx) {
+                if (m[cx]) {
+                    d[cx * 2] = m_nUV[0];
+                    d[cx * 2 + 1] = m_nUV[1];
+                }
+            }
+        }
+        return;
+    }
+    const int nBpp = m_nPixelBytes;
+    const size_t nLine = (size_t)m_nStride * nBpp;
+    for (int gy = gy0; gy < gy1; ++gy) {
+        const uint8_t* m = pMask + gy * pAtlas->nW;
+        uint8_t* d = m_pData + (size_t)(y + gy) * nLine + (size_t)x * nBpp;
+        for (int gx = gx0; gx < gx1; ++gx) {
+            if (m[gx]) {
+                memcpy(d + gx * nBpp, m_nPixel, nBpp);
+            }
+        }
+    }
+}
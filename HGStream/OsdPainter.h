@@ -0,0 +1,83 @@
+#ifndef OSDPAINTER_H
+#define OSDPAINTER_H
+
+#include <stdint.h>
+
+#include "base/pixel_fmt.hpp"
+#include "libExportStream.h"
+
+// 字库单元大小，scale倍放大
+#define OSD_FONT_W 8
+#define OSD_FONT_H 16
+#define OSD_MAX_FONT_SCALE 4
+
+struct OsdColor {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    // 仅带透明通道的格式有效，0为全透明
+    uint8_t a;
+};
+
+// 直接在图像内存上绘制框、线、文字，支持NV12/NV21及BGR24/RGB24/32位RGB格式。
+// 所有图元都按图像边界裁剪；NV12的色度平面按2x2块写入，文字使用缓存的字形掩码(各放大倍数各一份)。
+// 不做缓存一致性处理，DRM内存由调用者在绘制前后invalidate/flush。
+class OsdPainter {
+public:
+    OsdPainter();
+
+    static bool isSupported(uint32_t v4l2Fmt);
+
+    // 设置绘制目标，stPara的hstride/vstride为像素单位
+    bool attach(void* pData, const ImagePara& stPara);
+    void setColor(const OsdColor& stColor);
+    // 设置裁剪区域，之后的图元只写入该区域内，attach时重置为整幅图像
+    void setClip(int x, int y, int w, int h);
+    void resetClip();
+
+    void fillRect(int x, int y, int w, int h);
+    // 画矩形边框，坐标为左上、右下角
+    void drawRect(int x1, int y1, int x2, int y2, int nThickness);
+    void drawLine(int x0, int y0, int x1, int y1, int nThickness);
+    // 以(x, y)为左上角绘制ASCII文字，不可见字符按空格处理，返回文字宽度
+    int drawText(int x, int y, const char* pText, int nScale);
+
+    static int textWidth(const char* pText, int nScale);
+    static int textHeight(int nScale) { return OSD_FONT_H * clampScale(nScale); }
+    static int clampScale(int nScale);
+
+    // 按类别取框颜色
+    static const OsdColor& classColor(int nClassId);
+    // 生成检测框标签，如"person#3 87%"，pName为空时显示classId
+    static int formatLabel(char* pLabel, int nSize, const DetectBox& stBox, const char* pName);
+
+private:
+    void fillRectYuv(int x0, int y0, int x1, int y1);
+    void fillRectPacked(int x0, int y0, int x1, int y1);
+    void drawGlyph(int x, int y, int nChar, int nScale);
+
+private:
+    uint8_t* m_pData = nullptr;
+    uint32_t m_nFmt = 0;
+    int m_nWidth = 0;
+    int m_nHeight = 0;
+    int m_nStride = 0;
+    int m_nVStride = 0;
+    bool m_bYuv = false;
+    int m_nClipX0 = 0;
+    int m_nClipY0 = 0;
+    int m_nClipX1 = 0;
+    int m_nClipY1 = 0;
+    // 32位/24位格式每像素字节数及各通道偏移，a偏移-1表示无透明通道
+    int m_nPixelBytes = 0;
+    int m_nOffR = 0;
+    int m_nOffG = 0;
+    int m_nOffB = 0;
+    int m_nOffA = -1;
+
+    uint8_t m_nPixel[4] = {0};
+    uint8_t m_nY = 0;
+    uint8_t m_nUV[2] = {0};
+};
+
+#endif // OSDPAINTER_H
@@ -0,0 +1,319 @@
+#include "OverlayLayer.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+
+#include "BufferPool.h"
+#include "CpuAccess.h"
+
+namespace {
+
+// 脏矩形相距小于该值时合并，减少重画次数
+const int g_nMergeGap = 16;
+
+// RGA的SRC_OVER按预乘alpha计算
+OsdColor premultiply(const OsdColor& c) {
+    OsdColor p;
+    p.r = (uint8_t)((c.r * c.a + 127) / 255);
+    p.g = (uint8_t)((c.g * c.a + 127) / 255);
+    p.b = (uint8_t)((c.b * c.a + 127) / 255);
+    p.a = c.a;
+    return p;
+}
+
+} // namespace
+
+OverlayLayer::OverlayLayer() : m_nUpdateFrames(0), m_nRedrawPixels(0) {
+}
+
+OverlayLayer::~OverlayLayer() {
+}
+
+int OverlayLayer::init(uint32_t nWidth, uint32_t nHeight, uint32_t v4l2Fmt) {
+    if (nWidth == 0 || nHeight == 0 || !OsdPainter::isSupported(v4l2Fmt) ||
+        v4l2Fmt == V4L2_PIX_FMT_NV12 || v4l2Fmt == V4L2_PIX_FMT_NV21) {
+        ff_error("overlay: invalid canvas %ux%u %s\n", nWidth, nHeight, v4l2GetFmtName(v4l2Fmt));
+        return -1;
+    }
+    uint32_t nHStride = nWidth;
+    uint32_t nVStride = nHeight;
+    ModuleRga::alignStride(v4l2Fmt, nHStride, nVStride);
+    m_stPara = ImagePara(nWidth, nHeight, nHStride, nVStride, v4l2Fmt);
+    m_pCanvas = BufferPool::getInstance()->acquire(m_stPara);
+    if (m_pCanvas == nullptr) {
+        ff_error("overlay: failed to alloc canvas\n");
+        m_pCanvas = nullptr;
+        return -1;
+    }
+    {
+        CpuAccess access(m_pCanvas.get(), CpuAccess::WRITE);
+        memset(m_pCanvas->getData(), 0, m_pCanvas->getActiveSize());
+    }
+    m_vDrawn.clear();
+    return 0;
+}
+
+int OverlayLayer::attach(shared_ptr<ModuleRga> pRga) {
+    if (pRga == nullptr) {
+        return -1;
+    }
+    if (m_pCanvas == nullptr) {
+        ImagePara stOutPara = pRga->getOutputImagePara();
+        if (init(stOutPara.width, stOutPara.height) < 0) {
+            return -1;
+        }
+    }
+    m_pRga = pRga;
+    pRga->setPatPara(m_stPara.v4l2Fmt, 0, 0, m_stPara.width, m_stPara.height, m_stPara.hstride, m_stPara.vstride);
+    pRga->setPatBuffer(m_pCanvas->getBufFd(), ModuleRga::BLEND_SRC_OVER);
+    pRga->setBlendCallback(this, onBlend);
+    return 0;
+}
+
+int OverlayLayer::getCanvasFd() const {
+    return m_pCanvas != nullptr ? m_pCanvas->getBufFd() : -1;
+}
+
+void OverlayLayer::onBlend(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    (void)pBuffer;
+    OverlayLayer* pLayer = static_cast<OverlayLayer*>(pCtx);
+    if (pLayer->m_pCanvas == nullptr) {
+        return;
+    }
+    pLayer->update();
+    pLayer->m_pRga->setPatBuffer(pLayer->m_pCanvas->getBufFd(), ModuleRga::BLEND_SRC_OVER);
+}
+
+void OverlayLayer::beginFrame() {
+    m_vBuilding.clear();
+}
+
+OverlayLayer::StItem OverlayLayer::makeItem(int nType, int x, int y, int w, int h, const OsdColor& stColor) {
+    StItem stItem;
+    memset(&stItem, 0, sizeof(stItem));
+    stItem.nType = nType;
+    stItem.x = x;
+    stItem.y = y;
+    stItem.w = w;
+    stItem.h = h;
+    stItem.stColor = premultiply(stColor);
+    return stItem;
+}
+
+OverlayLayer::StItem OverlayLayer::makeText(int x, int y, const char* pText, int nScale, const OsdColor& stColor) {
+    StItem stItem = makeItem(ITEM_TEXT, x, y, 0, 0, stColor);
+    stItem.nScale = OsdPainter::clampScale(nScale);
+    strncpy(stItem.szText, pText, OVERLAY_TEXT_LEN - 1);
+    stItem.w = OsdPainter::textWidth(stItem.szText, stItem.nScale);
+    stItem.h = OsdPainter::textHeight(stItem.nScale);
+    return stItem;
+}
+
+void OverlayLayer::addRect(int x1, int y1, int x2, int y2, const OsdColor& stColor, int nThickness) {
+    StItem stItem = makeItem(ITEM_RECT, std::min(x1, x2), std::min(y1, y2), abs(x2 - x1) + 1, abs(y2 - y1) + 1, stColor);
+    stItem.nThickness = std::max(nThickness, 1);
+    m_vBuilding.push_back(stItem);
+}
+
+void OverlayLayer::addFill(int x, int y, int w, int h, const OsdColor& stColor) {
+    if (w > 0 && h > 0) {
+        m_vBuilding.push_back(makeItem(ITEM_FILL, x, y, w, h, stColor));
+    }
+}
+
+void OverlayLayer::addText(int x, int y, const char* pText, int nScale, const OsdColor& stColor) {
+    if (pText != nullptr && pText[0] != '\0') {
+        m_vBuilding.push_back(makeText(x, y, pText, nScale, stColor));
+    }
+}
+
+void OverlayLayer::addDetections(const DetectResult& stResult, const std::vector<std::string>& vLabels,
+                                 int nThickness, int nFontScale) {
+    static const OsdColor stWhite = {255, 255, 255, 255};
+    static const OsdColor stBlack = {0, 0, 0, 255};
+    char szLabel[OVERLAY_TEXT_LEN];
+    const int nTextH = OsdPainter::textHeight(nFontScale);
+    for (int i = 0; i < stResult.count && i < HG_MAX_DETECT_NUM; ++i) {
+        const DetectBox& box = stResult.boxes[i];
+        const OsdColor& stColor = OsdPainter::classColor(box.classId);
+        int x1 = (int)box.x1, y1 = (int)box.y1;
+        addRect(x1, y1, (int)box.x2, (int)box.y2, stColor, nThickness);
+
+        const char* pName = nullptr;
+        if (box.classId >= 0 && box.classId < (int)vLabels.size()) {
+            pName = vLabels[box.classId].c_str();
+        }
+        OsdPainter::formatLabel(szLabel, sizeof(szLabel), box, pName);
+        int ty = y1 - nTextH >= 0 ? y1 - nTextH : y1;
+        addFill(x1, ty, OsdPainter::textWidth(szLabel, nFontScale) + 4, nTextH, stColor);
+        int nLuma = stColor.r * 3 + stColor.g * 6 + stColor.b;
+        addText(x1 + 2, ty, szLabel, nFontScale, nLuma > 1280 ? stBlack : stWhite);
+    }
+}
+
+void OverlayLayer::endFrame() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_vCommitted.swap(m_vBuilding);
+    m_bCommitted = true;
+    m_nAge = 0;
+}
+
+void OverlayLayer::clear() {
+    beginFrame();
+    endFrame();
+}
+
+void OverlayLayer::setExpireFrames(int nFrames) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_nExpireFrames = std::max(0, nFrames);
+}
+
+void OverlayLayer::setTimeEnable(bool bEnable, int nFontScale) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    m_bTime = bEnable;
+    m_nTimeScale = OsdPainter::clampScale(nFontScale);
+}
+
+bool OverlayLayer::sameItem(const StItem& a, const StItem& b) {
+    // 图元构造时已清零，可整体比较
+    return memcmp(&a, &b, sizeof(StItem)) == 0;
+}
+
+OverlayLayer::StRect OverlayLayer::itemBounds(const StItem& stItem) {
+    return {stItem.x, stItem.y, stItem.x + stItem.w, stItem.y + stItem.h};
+}
+
+void OverlayLayer::addDirty(const StRect& stRect) {
+    StRect r = {std::max(stRect.x0, 0), std::max(stRect.y0, 0),
+                std::min(stRect.x1, (int)m_stPara.width), std::min(stRect.y1, (int)m_stPara.height)};
+    if (r.x0 >= r.x1 || r.y0 >= r.y1) {
+        return;
+    }
+    // 与相邻的脏矩形合并，合并后可能与其他矩形相邻，重新检查
+    int i = 0;
+    while (i < m_nDirty) {
+        const StRect& d = m_stDirty[i];
+        if (r.x0 <= d.x1 + g_nMergeGap && d.x0 <= r.x1 + g_nMergeGap &&
+            r.y0 <= d.y1 + g_nMergeGap && d.y0 <= r.y1 + g_nMergeGap) {
+            r = {std::min(r.x0, d.x0), std::min(r.y0, d.y0), std::max(r.x1, d.x1), std::max(r.y1, d.y1)};
+            m_stDirty[i] = m_stDirty[--m_nDirty];
+            i = 0;
+            continue;
+        }
+        ++i;
+    }
+    if (m_nDirty == OVERLAY_MAX_DIRTY_NUM) {
+        // 矩形过多，全部合并为一个
+        for (int k = 0; k < m_nDirty; ++k) {
+            const StRect& d = m_stDirty[k];
+            r = {std::min(r.x0, d.x0), std::min(r.y0, d.y0), std::max(r.x1, d.x1), std::max(r.y1, d.y1)};
+        }
+        m_nDirty = 0;
+    }
+    m_stDirty[m_nDirty++] = r;
+}
+
+void OverlayLayer::drawItem(const StItem& stItem) {
+    m_painter.setColor(stItem.stColor);
+    switch (stItem.nType) {
+    case ITEM_RECT:
+        m_painter.drawRect(stItem.x, stItem.y, stItem.x + stItem.w - 1, stItem.y + stItem.h - 1, stItem.nThickness);
+        break;
+    case ITEM_FILL:
+        m_painter.fillRect(stItem.x, stItem.y, stItem.w, stItem.h);
+        break;
+    default:
+        m_painter.drawText(stItem.x, stItem.y, stItem.szText, stItem.nScale);
+        break;
+    }
+}
+
+void OverlayLayer::makeTimeItem(std::vector<StItem>& vItems, int nScale) {
+    time_t nNow = time(nullptr);
+    if (nNow != m_nLastSecond) {
+        struct tm stTm;
+        localtime_r(&nNow, &stTm);
+        strftime(m_szTime, sizeof(m_szTime), "%Y-%m-%d %H:%M:%S", &stTm);
+        m_nLastSecond = nNow;
+    }
+    vItems.push_back(makeItem(ITEM_FILL, 8, 8, OsdPainter::textWidth(m_szTime, nScale) + 8,
+                              OsdPainter::textHeight(nScale), {0, 0, 0, 160}));
+    vItems.push_back(makeText(12, 8, m_szTime, nScale, {255, 255, 255, 255}));
+}
+
+int OverlayLayer::update() {
+    if (m_pCanvas == nullptr) {
+        return 0;
+    }
+    bool bTime = false;
+    int nTimeScale = 2;
+    {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        if (m_bCommitted) {
+            m_vScene.swap(m_vCommitted);
+            m_bCommitted = false;
+        }
+        if (m_nExpireFrames > 0 && m_nAge <= m_nExpireFrames && ++m_nAge > m_nExpireFrames) {
+            m_vScene.clear();
+        }
+        bTime = m_bTime;
+        nTimeScale = m_nTimeScale;
+    }
+    m_vNext = m_vScene;
+    if (bTime) {
+        makeTimeItem(m_vNext, nTimeScale);
+    }
+
+    // 按下标比较，变化图元的新旧区域都需要重画
+    const size_t nCount = std::max(m_vNext.size(), m_vDrawn.size());
+    for (size_t i = 0; i < nCount; ++i) {
+        bool bNew = i < m_vNext.size();
+        bool bOld = i < m_vDrawn.size();
+        if (bNew && bOld && sameItem(m_vNext[i], m_vDrawn[i])) {
+            continue;
+        }
+        if (bNew) {
+            addDirty(itemBounds(m_vNext[i]));
+        }
+        if (bOld) {
+            addDirty(itemBounds(m_vDrawn[i]));
+        }
+    }
+    if (m_nDirty == 0) {
+        return 0;
+    }
+
+    // 画布只有CPU写、RGA读，不需要invalidate，结束时只回写脏区域所在的行
+    // 半平面格式每个矩形Y、UV各一个区间
+    CpuAccess::StRange vRanges[2 * OVERLAY_MAX_DIRTY_NUM];
+    int nRanges = 0;
+    for (int k = 0; k < m_nDirty; ++k) {
+        int n = CpuAccess::rowRanges(m_stPara, 0, m_stDirty[k].y0, m_stDirty[k].y1, vRanges + nRanges);
+        nRanges += std::max(n, 0);
+    }
+    CpuAccess access(m_pCanvas.get(), CpuAccess::WRITE, vRanges, nRanges);
+    m_painter.attach(m_pCanvas->getData(), m_stPara);
+    int nPixels = 0;
+    for (int k = 0; k < m_nDirty; ++k) {
+        const StRect& d = m_stDirty[k];
+        m_painter.setClip(d.x0, d.y0, d.x1 - d.x0, d.y1 - d.y0);
+        m_painter.setColor({0, 0, 0, 0});
+        m_painter.fillRect(d.x0, d.y0, d.x1 - d.x0, d.y1 - d.y0);
+        for (const StItem& stItem : m_vNext) {
+            StRect b = itemBounds(stItem);
+            if (b.x0 < d.x1 && d.x0 < b.x1 && b.y0 < d.y1 && d.y0 < b.y1) {
+                drawItem(stItem);
+            }
+        }
+        nPixels += (d.x1 - d.x0) * (d.y1 - d.y0);
+    }
+    m_painter.resetClip();
+    m_nDirty = 0;
+    access.end();
+    m_vDrawn.swap(m_vNext);
+    m_nUpdateFrames++;
+    m_nRedrawPixels += nPixels;
+    return nPixels;
+}
@@ -0,0 +1,121 @@
+#ifndef OVERLAYLAYER_H
+#define OVERLAYLAYER_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module/vp/module_rga.hpp"
+#include "libExportStream.h"
+#include "OsdPainter.h"
+
+#define OVERLAY_MAX_DIRTY_NUM 16
+#define OVERLAY_TEXT_LEN 48
+
+// RGA混合叠加层，保存一张ARGB画布，挂到ModuleRga的混合回调上，由硬件以BLEND_SRC_OVER合成到输出图像。
+// 调用者每次用beginFrame/add*/endFrame提交完整的图元列表，叠加层与画布上已有的图元逐个比较，
+// 只清除并重画变化图元覆盖的区域(脏矩形)，画面不变时每帧几乎没有CPU开销。
+// 画布写入和RGA读取都在RGA线程的混合回调中串行进行，无需双缓冲。
+class OverlayLayer {
+public:
+    OverlayLayer();
+    ~OverlayLayer();
+
+    // 申请画布，v4l2Fmt为带透明通道的32位格式
+    int init(uint32_t nWidth, uint32_t nHeight, uint32_t v4l2Fmt = V4L2_PIX_FMT_ABGR32);
+    // 挂到ModuleRga上，画布大小需与其输出一致；未init时按RGA输出大小申请
+    int attach(shared_ptr<ModuleRga> pRga);
+
+    // 提交一组图元，beginFrame到endFrame之间不可与其他线程交错调用
+    void beginFrame();
+    void addRect(int x1, int y1, int x2, int y2, const OsdColor& stColor, int nThickness);
+    void addFill(int x, int y, int w, int h, const OsdColor& stColor);
+    void addText(int x, int y, const char* pText, int nScale, const OsdColor& stColor);
+    // 检测框及标签，布局与ModuleOsd一致
+    void addDetections(const DetectResult& stResult, const std::vector<std::string>& vLabels,
+                       int nThickness, int nFontScale);
+    void endFrame();
+    // 清空图元
+    void clear();
+
+    // 提交的图元在nFrames帧后自动清除，0为一直显示
+    void setExpireFrames(int nFrames);
+    // 左上角显示本地时间，每秒只重画时间区域
+    void setTimeEnable(bool bEnable, int nFontScale = 2);
+
+    // 在混合回调中调用：重画脏区域并刷新缓存，返回本次重画的像素数
+    int update();
+
+    int getCanvasFd() const;
+    // 累计统计：更新的帧数、重画的像素总数
+    uint64_t getUpdateFrames() const { return m_nUpdateFrames; }
+    uint64_t getRedrawPixels() const { return m_nRedrawPixels; }
+
+private:
+    enum ITEM_TYPE {
+        ITEM_RECT = 0,
+        ITEM_FILL,
+        ITEM_TEXT,
+    };
+
+    struct StItem {
+        int nType;
+        int x;
+        int y;
+        int w;
+        int h;
+        OsdColor stColor;
+        int nThickness;
+        int nScale;
+        char szText[OVERLAY_TEXT_LEN];
+    };
+
+    struct StRect {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    static void onBlend(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    static StItem makeItem(int nType, int x, int y, int w, int h, const OsdColor& stColor);
+    static StItem makeText(int x, int y, const char* pText, int nScale, const OsdColor& stColor);
+    static bool sameItem(const StItem& a, const StItem& b);
+    static StRect itemBounds(const StItem& stItem);
+    void addDirty(const StRect& stRect);
+    void drawItem(const StItem& stItem);
+    void makeTimeItem(std::vector<StItem>& vItems, int nScale);
+
+private:
+    shared_ptr<VideoBuffer> m_pCanvas;
+    ImagePara m_stPara;
+    shared_ptr<ModuleRga> m_pRga;
+    OsdPainter m_painter;
+
+    std::mutex m_mutex;
+    // 调用者正在构建的图元
+    std::vector<StItem> m_vBuilding;
+    // 已提交、待RGA线程取走的图元
+    std::vector<StItem> m_vCommitted;
+    bool m_bCommitted = false;
+    int m_nExpireFrames = 0;
+    int m_nAge = 0;
+    bool m_bTime = false;
+    int m_nTimeScale = 2;
+
+    // 以下只在RGA线程访问
+    // 当前提交的图元，m_vNext为加上时间后的本帧图元，m_vDrawn为画布上已有的图元
+    std::vector<StItem> m_vScene;
+    std::vector<StItem> m_vNext;
+    std::vector<StItem> m_vDrawn;
+    StRect m_stDirty[OVERLAY_MAX_DIRTY_NUM];
+    int m_nDirty = 0;
+    long m_nLastSecond = -1;
+    char m_szTime[32] = {0};
+
+    std::atomic<uint64_t> m_nUpdateFrames;
+    std::atomic<uint64_t> m_nRedrawPixels;
+};
+
+#endif // OVERLAYLAYER_H
@@ -0,0 +1,206 @@
+#include "PipeTrace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "base/ff_log.h"
+
+#define TRACE_NAME_LEN 24
+
+namespace {
+
+struct StEvent {
+    int64_t nStartUs;
+    uint32_t nDurUs;
+    int16_t nInput;
+    int16_t nOutput;
+    int8_t eKind;
+    int8_t nResult;
+    char sName[TRACE_NAME_LEN];
+};
+
+// 只有所属线程写，nHead为已写入的事件总数
+struct StRing {
+    std::atomic<uint64_t> nHead{0};
+    std::atomic<bool> bFree{false};
+    pid_t nTid = 0;
+    char sThread[16] = {0};
+    StEvent vEvents[PipeTrace::RING_EVENTS];
+};
+
+std::mutex g_mutex;
+std::vector<StRing*> g_vRings;
+std::atomic<int64_t> g_nEnableUs{0};
+std::atomic<uint64_t> g_nDropped{0};
+
+const char* g_vKinds[] = {"produce", "consume", "call"};
+const char* g_vConsumeResults[] = {"success", "wait_for_consumer", "wait_for_productor", "need_repeat",
+                                   "skip", "bypass", "eos", "failed"};
+const char* g_vProduceResults[] = {"success", "continue", "empty", "bypass", "eos", "failed"};
+
+// 线程退出时归还缓冲区
+struct StRingHolder {
+    StRing* pRing = nullptr;
+    ~StRingHolder() {
+        if (pRing != nullptr) {
+            pRing->bFree = true;
+        }
+    }
+};
+
+thread_local StRingHolder t_stHolder;
+
+StRing* threadRing() {
+    if (t_stHolder.pRing != nullptr) {
+        return t_stHolder.pRing;
+    }
+    std::lock_guard<std::mutex> locker(g_mutex);
+    StRing* pRing = nullptr;
+    for (StRing* p : g_vRings) {
+        if (p->bFree) {
+            pRing = p;
+            break;
+        }
+    }
+    if (pRing == nullptr) {
+        if (g_vRings.size() >= PipeTrace::MAX_THREADS) {
+            return nullptr;
+        }
+        // 不释放，导出时线程可能已退出
+        pRing = new StRing();
+        g_vRings.push_back(pRing);
+    }
+    pRing->nHead.store(0, std::memory_order_relaxed);
+    pRing->nTid = (pid_t)syscall(SYS_gettid);
+    memset(pRing->sThread, 0, sizeof(pRing->sThread));
+    prctl(PR_GET_NAME, pRing->sThread);
+    pRing->bFree = false;
+    t_stHolder.pRing = pRing;
+    return pRing;
+}
+
+void writeName(FILE* pFile, const char* pName) {
+    // 组件名不含需要转义的字符，保险起见替换掉
+    for (const char* p = pName; *p != '\0'; ++p) {
+        fputc((*p == '"' || *p == '\\' || (unsigned char)*p < 0x20) ? '_' : *p, pFile);
+    }
+}
+
+const char* resultName(const StEvent& stEvent) {
+    if (stEvent.eKind == PipeTrace::CONSUME && stEvent.nResult >= 0 &&
+        stEvent.nResult < (int)(sizeof(g_vConsumeResults) / sizeof(g_vConsumeResults[0]))) {
+        return g_vConsumeResults[stEvent.nResult];
+    }
+    if (stEvent.eKind == PipeTrace::PRODUCE && stEvent.nResult >= 0 &&
+        stEvent.nResult < (int)(sizeof(g_vProduceResults) / sizeof(g_vProduceResults[0]))) {
+        return g_vProduceResults[stEvent.nResult];
+    }
+    return nullptr;
+}
+
+} // namespace
+
+std::atomic<bool> PipeTrace::s_bEnable{false};
+
+void PipeTrace::setEnable(bool bEnable) {
+    if (bEnable && !s_bEnable) {
+        g_nEnableUs = nowUs();
+        g_nDropped = 0;
+    }
+    s_bEnable = bEnable;
+}
+
+int64_t PipeTrace::nowUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void PipeTrace::record(const char* pName, Kind eKind, int64_t nStartUs, int nInput, int nOutput, int nResult) {
+    StRing* pRing = threadRing();
+    if (pRing == nullptr) {
+        g_nDropped++;
+        return;
+    }
+    uint64_t nHead = pRing->nHead.load(std::memory_order_relaxed);
+    StEvent& stEvent = pRing->vEvents[nHead % RING_EVENTS];
+    stEvent.nStartUs = nStartUs;
+    stEvent.nDurUs = (uint32_t)std::max<int64_t>(nowUs() - nStartUs, 0);
+    stEvent.nInput = nInput;
+    stEvent.nOutput = nOutput;
+    stEvent.eKind = eKind;
+    stEvent.nResult = nResult;
+    strncpy(stEvent.sName, pName != nullptr ? pName : "?", TRACE_NAME_LEN - 1);
+    stEvent.sName[TRACE_NAME_LEN - 1] = '\0';
+    pRing->nHead.store(nHead + 1, std::memory_order_release);
+}
+
+int PipeTrace::dump(const char* pPath) {
+    FILE* pFile = fopen(pPath, "w");
+    if (pFile == nullptr) {
+        ff_error("pipe trace: failed to open %s\n", pPath);
+        return -1;
+    }
+    int64_t nSince = g_nEnableUs;
+    int nPid = getpid();
+    int nCount = 0;
+    bool bFirst = true;
+    std::vector<StEvent> vEvents;
+    fprintf(pFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    std::lock_guard<std::mutex> locker(g_mutex);
+    for (StRing* pRing : g_vRings) {
+        // 复制期间写线程可能覆盖最旧的事件(包括正在写的下一个)，复制后按新的写位置丢掉这部分
+        uint64_t nHead = pRing->nHead.load(std::memory_order_acquire);
+        uint64_t nBegin = nHead > RING_EVENTS ? nHead - RING_EVENTS : 0;
+        vEvents.clear();
+        for (uint64_t i = nBegin; i < nHead; ++i) {
+            vEvents.push_back(pRing->vEvents[i % RING_EVENTS]);
+        }
+        uint64_t nNewHead = pRing->nHead.load(std::memory_order_acquire);
+        size_t nSkip = nNewHead + 1 > nBegin + RING_EVENTS
+                           ? std::min<uint64_t>(nNewHead + 1 - nBegin - RING_EVENTS, vEvents.size())
+                           : 0;
+        if (vEvents.size() == nSkip) {
+            continue;
+        }
+        fprintf(pFile, "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"",
+                bFirst ? "" : ",", nPid, pRing->nTid);
+        writeName(pFile, pRing->sThread);
+        fprintf(pFile, "\"}}");
+        bFirst = false;
+        for (size_t i = nSkip; i < vEvents.size(); ++i) {
+            const StEvent& stEvent = vEvents[i];
+            if (stEvent.nStartUs < nSince) {
+                continue;
+            }
+            fprintf(pFile, ",\n{\"ph\":\"X\",\"name\":\"");
+            writeName(pFile, stEvent.sName);
+            fprintf(pFile, "\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%lld,\"dur\":%u,\"args\":{\"input\":%d,\"output\":%d,",
+                    g_vKinds[stEvent.eKind], nPid, pRing->nTid, (long long)stEvent.nStartUs, stEvent.nDurUs,
+                    stEvent.nInput, stEvent.nOutput);
+            const char* pResult = resultName(stEvent);
+            if (pResult != nullptr) {
+                fprintf(pFile, "\"result\":\"%s\"}}", pResult);
+            } else {
+                fprintf(pFile, "\"result\":%d}}", stEvent.nResult);
+            }
+            nCount++;
+        }
+    }
+    fprintf(pFile, "\n]}\n");
+    fclose(pFile);
+    if (g_nDropped > 0) {
+        ff_warn("pipe trace: %llu events dropped, more than %u threads\n", (unsigned long long)g_nDropped.load(),
+                MAX_THREADS);
+    }
+    ff_info("pipe trace: %d events written to %s\n", nCount, pPath);
+    return nCount;
+}
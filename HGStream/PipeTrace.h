@@ -0,0 +1,78 @@
+#ifndef PIPETRACE_H
+#define PIPETRACE_H
+
+#include <stdint.h>
+
+#include <atomic>
+
+#include "module/module_media.hpp"
+
+// 管道逐帧事件跟踪，导出Chrome trace JSON(chrome://tracing或ui.perfetto.dev打开)。dumpPipeSummary只有累计值，
+// 这里记录每个组件每次生产/消费的起止时间和缓冲区索引，能直接看到某一帧卡在哪个组件、消费者等待了多久。
+// 每个线程一个定长无锁环形缓冲区，只有本线程写，写满后覆盖最旧的事件；导出时复制各线程缓冲区。
+// 始终编译，运行时开启，关闭时每次生产/消费只多一次原子读。
+// ff_media的组件无法修改，用TracedModule<T>包装后在doConsume/doProduce前后记录，两次消费之间的空白即等待时间。
+// 用法：
+//   auto pRga = make_shared<TracedModule<ModuleRga>>(stInput, stOutput, RGA_ROTATE_NONE);
+//   PipeTrace::setEnable(true);
+//   PipeTrace::dump("/tmp/pipe.json");
+class PipeTrace {
+public:
+    enum Kind {
+        PRODUCE = 0,
+        CONSUME,
+        // 组件外的调用，如HG_PutFrame等待送数完成
+        CALL,
+    };
+
+    // 每个线程保留的事件数
+    static const uint32_t RING_EVENTS = 4096;
+    // 最多跟踪的线程数，线程退出后缓冲区给新线程复用
+    static const uint32_t MAX_THREADS = 128;
+
+public:
+    // 开启时只导出之后的事件
+    static void setEnable(bool bEnable);
+    static bool isEnabled() { return s_bEnable.load(std::memory_order_relaxed); }
+    static int64_t nowUs();
+    // 记录一段从nStartUs到当前的事件，nInput/nOutput为缓冲区索引，没有时为-1
+    static void record(const char* pName, Kind eKind, int64_t nStartUs, int nInput, int nOutput, int nResult);
+    // 写出JSON，返回写出的事件数，失败返回-1
+    static int dump(const char* pPath);
+
+private:
+    static std::atomic<bool> s_bEnable;
+};
+
+// 在组件的doConsume/doProduce前后记录事件，未开启时直接调用
+template <typename T>
+class TracedModule : public T {
+public:
+    using T::T;
+
+protected:
+    typename T::ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer,
+                                        shared_ptr<MediaBuffer> output_buffer) override {
+        if (!PipeTrace::isEnabled()) {
+            return T::doConsume(input_buffer, output_buffer);
+        }
+        int64_t nStart = PipeTrace::nowUs();
+        typename T::ConsumeResult eResult = T::doConsume(input_buffer, output_buffer);
+        PipeTrace::record(this->getName(), PipeTrace::CONSUME, nStart, input_buffer != nullptr ? input_buffer->getIndex() : -1,
+                          output_buffer != nullptr ? output_buffer->getIndex() : -1, eResult);
+        return eResult;
+    }
+
+    typename T::ProduceResult doProduce(shared_ptr<MediaBuffer> buffer) override {
+        if (!PipeTrace::isEnabled()) {
+            return T::doProduce(buffer);
+        }
+        int64_t nStart = PipeTrace::nowUs();
+        typename T::ProduceResult eResult = T::doProduce(buffer);
+        PipeTrace::record(this->getName(), PipeTrace::PRODUCE, nStart, -1, buffer != nullptr ? buffer->getIndex() : -1,
+                          eResult);
+        return eResult;
+    }
+};
+
+#endif // PIPETRACE_H
@@ -0,0 +1,636 @@
+#include "PipelineGraph.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "module/vi/module_rtspClient.hpp"
+#include "module/vi/module_fileReader.hpp"
+#include "module/vp/module_mppdec.hpp"
+#include "module/vp/module_rga.hpp"
+#include "module/vo/module_rtspServer.hpp"
+#include "module/vo/module_rtmpServer.hpp"
+#include "module/vo/module_fileWriter.hpp"
+
+#include "AdmissionControl.h"
+#include "BufferPool.h"
+#include "ModuleAnnexBSource.h"
+#include "ModuleMppEncEx.h"
+#include "ModuleRecordReader.h"
+#include "ModuleSegmentRecorder.h"
+#include "PipeTrace.h"
+
+namespace {
+
+// 节点对输入的要求
+enum NodeKind {
+    KIND_SOURCE = 0,
+    // 码流输入，输出图像
+    KIND_DECODER,
+    // 图像输入，输出图像
+    KIND_CONVERTER,
+    // 图像输入，输出码流
+    KIND_ENCODER,
+    // H264/H265码流输入
+    KIND_SINK,
+    KIND_UNKNOWN,
+};
+
+NodeKind nodeKind(const std::string& sType) {
+    if (sType == "rtsp_client" || sType == "annexb_source" || sType == "file_reader" || sType == "record_reader") {
+        return KIND_SOURCE;
+    }
+    if (sType == "mpp_dec") {
+        return KIND_DECODER;
+    }
+    if (sType == "rga") {
+        return KIND_CONVERTER;
+    }
+    if (sType == "mpp_enc") {
+        return KIND_ENCODER;
+    }
+    if (sType == "rtsp_server" || sType == "rtmp_server" || sType == "file_writer" || sType == "segment_recorder") {
+        return KIND_SINK;
+    }
+    return KIND_UNKNOWN;
+}
+
+bool isStreamFmt(uint32_t nFmt) {
+    return nFmt == V4L2_PIX_FMT_H264 || nFmt == V4L2_PIX_FMT_HEVC;
+}
+
+bool isDecodableFmt(uint32_t nFmt) {
+    return isStreamFmt(nFmt) || nFmt == V4L2_PIX_FMT_MJPEG;
+}
+
+// mpp编码器可直接输入的格式
+bool isEncodableFmt(uint32_t nFmt) {
+    switch (nFmt) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV61:
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_YVU420:
+    case V4L2_PIX_FMT_YUYV:
+    case V4L2_PIX_FMT_UYVY:
+    case V4L2_PIX_FMT_RGB565:
+    case V4L2_PIX_FMT_RGB24:
+    case V4L2_PIX_FMT_BGR24:
+    case V4L2_PIX_FMT_RGB32:
+    case V4L2_PIX_FMT_BGR32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint32_t parseFormat(const JsonValue& stValue, uint32_t nDefault) {
+    std::string sFmt = stValue.asString();
+    if (sFmt.empty()) {
+        return nDefault;
+    }
+    return v4l2GetFmtByName(sFmt.c_str());
+}
+
+// 宽高及步长，步长按RGA要求对齐
+ImagePara makePara(uint32_t nWidth, uint32_t nHeight, uint32_t nFmt) {
+    ImagePara stPara(nWidth, nHeight, nWidth, nHeight, nFmt);
+    ModuleRga::alignStride(nFmt, stPara.hstride, stPara.vstride);
+    return stPara;
+}
+
+// 转换节点的输出参数，宽高格式缺省时与输入相同
+bool rgaOutput(const JsonValue& stConfig, const ImagePara& stInput, ImagePara& stOutput, RgaRotate& eRotate) {
+    uint32_t nFmt = parseFormat(stConfig["format"], stInput.v4l2Fmt);
+    if (nFmt == 0) {
+        return false;
+    }
+    int nRotate = stConfig["rotate"].asInt(0);
+    eRotate = nRotate == 90 ? RGA_ROTATE_90
+            : (nRotate == 180 ? RGA_ROTATE_180 : (nRotate == 270 ? RGA_ROTATE_270 : RGA_ROTATE_NONE));
+    stOutput = makePara(stConfig["width"].asInt(stInput.width), stConfig["height"].asInt(stInput.height), nFmt);
+    return true;
+}
+
+// 步长只影响内存布局，下游按每帧的参数读取
+bool sameImage(const ImagePara& a, const ImagePara& b) {
+    return a.width == b.width && a.height == b.height && a.v4l2Fmt == b.v4l2Fmt;
+}
+
+JsonValue substitute(const JsonValue& stValue, const JsonValue& stVars) {
+    if (stValue.isString()) {
+        std::string s = stValue.asString();
+        for (const std::string& sKey : stVars.keys()) {
+            std::string sPattern = "${" + sKey + "}";
+            std::string sValue = stVars[sKey].asString();
+            for (size_t nPos = s.find(sPattern); nPos != std::string::npos; nPos = s.find(sPattern, nPos + sValue.size())) {
+                s.replace(nPos, sPattern.size(), sValue);
+            }
+        }
+        return JsonValue::makeString(s);
+    }
+    if (stValue.isObject()) {
+        JsonValue stResult = JsonValue::makeObject();
+        for (const std::string& sKey : stValue.keys()) {
+            stResult.set(sKey, substitute(stValue[sKey], stVars));
+        }
+        return stResult;
+    }
+    if (stValue.isArray()) {
+        JsonValue stResult = JsonValue::makeArray();
+        for (size_t i = 0; i < stValue.size(); ++i) {
+            stResult.append(substitute(stValue[i], stVars));
+        }
+        return stResult;
+    }
+    return stValue;
+}
+
+} // namespace
+
+PipelineGraph::PipelineGraph() {
+    char szSession[32];
+    snprintf(szSession, sizeof(szSession), "graph@%p", (void*)this);
+    m_sSession = szSession;
+}
+
+PipelineGraph::~PipelineGraph() {
+    stop();
+    release();
+}
+
+int PipelineGraph::loadFile(const std::string& sPath) {
+    JsonValue stConfig;
+    std::string sError;
+    if (!JsonValue::parseFile(sPath, stConfig, sError)) {
+        ff_error("graph: %s: %s\n", sPath.c_str(), sError.c_str());
+        return -1;
+    }
+    return load(stConfig);
+}
+
+int PipelineGraph::load(const JsonValue& stConfig) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_bRunning) {
+        ff_error("graph: stop before reloading\n");
+        return -1;
+    }
+    release();
+    std::vector<StNode> vNodes;
+    m_bOptimize = stConfig["optimize"].asBool(true);
+    if (expand(stConfig, vNodes) < 0 || sortNodes(vNodes) < 0) {
+        return -1;
+    }
+    if (m_bOptimize) {
+        fuseConversions(vNodes);
+    }
+    if (build(vNodes) < 0) {
+        release();
+        return -1;
+    }
+    ff_info("graph: %zu modules ready\n", m_vNodes.size());
+    return 0;
+}
+
+int PipelineGraph::expand(const JsonValue& stConfig, std::vector<StNode>& vNodes) {
+    if (!stConfig.isObject()) {
+        ff_error("graph: config must be an object\n");
+        return -1;
+    }
+    const JsonValue& stNodes = stConfig["nodes"];
+    for (size_t i = 0; i < stNodes.size(); ++i) {
+        StNode stNode;
+        if (parseNode(stNodes[i], stNode) < 0) {
+            return -1;
+        }
+        vNodes.push_back(stNode);
+    }
+    // 每路按模板展开
+    const JsonValue& stTemplate = stConfig["template"];
+    const JsonValue& stStreams = stConfig["streams"];
+    for (size_t s = 0; s < stStreams.size(); ++s) {
+        for (size_t i = 0; i < stTemplate.size(); ++i) {
+            StNode stNode;
+            if (parseNode(substitute(stTemplate[i], stStreams[s]), stNode) < 0) {
+                return -1;
+            }
+            vNodes.push_back(stNode);
+        }
+    }
+    if (vNodes.empty()) {
+        ff_error("graph: no nodes\n");
+        return -1;
+    }
+    return 0;
+}
+
+int PipelineGraph::parseNode(const JsonValue& stItem, StNode& stNode) {
+    stNode.sName = stItem["name"].asString();
+    stNode.sType = stItem["type"].asString();
+    stNode.sInput = stItem["input"].asString();
+    stNode.stConfig = stItem;
+    if (stNode.sName.empty()) {
+        ff_error("graph: node without name\n");
+        return -1;
+    }
+    NodeKind eKind = nodeKind(stNode.sType);
+    if (eKind == KIND_UNKNOWN) {
+        ff_error("graph: %s: unknown type '%s'\n", stNode.sName.c_str(), stNode.sType.c_str());
+        return -1;
+    }
+    if ((eKind == KIND_SOURCE) != stNode.sInput.empty()) {
+        ff_error("graph: %s: %s\n", stNode.sName.c_str(), eKind == KIND_SOURCE ? "source can't have input" : "missing input");
+        return -1;
+    }
+    if (stItem.has("cores") || stItem.has("sched")) {
+        std::string sSched = stItem["sched"].asString("other");
+        stNode.bHasPolicy = true;
+        stNode.stPolicy.vCores = ThreadPlacement::parseCores(stItem["cores"].asString());
+        stNode.stPolicy.nSched = sSched == "rr" ? SCHED_RR : (sSched == "fifo" ? SCHED_FIFO : SCHED_OTHER);
+        stNode.stPolicy.nPriority = stItem["priority"].asInt(0);
+    }
+    return 0;
+}
+
+// 按拓扑顺序排列，上游在前
+int PipelineGraph::sortNodes(std::vector<StNode>& vNodes) {
+    std::map<std::string, size_t> mIndex;
+    for (size_t i = 0; i < vNodes.size(); ++i) {
+        if (!mIndex.emplace(vNodes[i].sName, i).second) {
+            ff_error("graph: duplicate node '%s'\n", vNodes[i].sName.c_str());
+            return -1;
+        }
+    }
+    // 每个节点只有一个上游，沿上游链求深度
+    std::vector<int> vDepth(vNodes.size(), -1);
+    for (size_t i = 0; i < vNodes.size(); ++i) {
+        std::vector<size_t> vChain;
+        size_t nCur = i;
+        while (vDepth[nCur] < 0 && !vNodes[nCur].sInput.empty()) {
+            auto it = mIndex.find(vNodes[nCur].sInput);
+            if (it == mIndex.end()) {
+                ff_error("graph: %s: input '%s' not found\n", vNodes[nCur].sName.c_str(), vNodes[nCur].sInput.c_str());
+                return -1;
+            }
+            if (std::find(vChain.begin(), vChain.end(), nCur) != vChain.end()) {
+                ff_error("graph: cycle at '%s'\n", vNodes[nCur].sName.c_str());
+                return -1;
+            }
+            vChain.push_back(nCur);
+            nCur = it->second;
+        }
+        int nDepth = vDepth[nCur] < 0 ? 0 : vDepth[nCur];
+        vDepth[nCur] = nDepth;
+        for (auto it = vChain.rbegin(); it != vChain.rend(); ++it) {
+            vDepth[*it] = ++nDepth;
+        }
+    }
+    std::vector<size_t> vOrder(vNodes.size());
+    for (size_t i = 0; i < vOrder.size(); ++i) {
+        vOrder[i] = i;
+    }
+    std::stable_sort(vOrder.begin(), vOrder.end(), [&](size_t a, size_t b) { return vDepth[a] < vDepth[b]; });
+    std::vector<StNode> vSorted;
+    vSorted.reserve(vNodes.size());
+    for (size_t i : vOrder) {
+        vSorted.push_back(vNodes[i]);
+    }
+    vNodes.swap(vSorted);
+    return 0;
+}
+
+// 上游RGA节点只有一个消费者且也是RGA时合并为一次转换，宽高格式取后者，后者未指定的取前者，旋转角度相加
+void PipelineGraph::fuseConversions(std::vector<StNode>& vNodes) {
+    std::map<std::string, int> mConsumers;
+    for (const StNode& stNode : vNodes) {
+        mConsumers[stNode.sInput]++;
+    }
+    std::vector<StNode> vResult;
+    std::map<std::string, size_t> mIndex;
+    for (StNode& stNode : vNodes) {
+        auto it = mIndex.find(stNode.sInput);
+        if (stNode.sType == "rga" && it != mIndex.end() && vResult[it->second].sType == "rga" && mConsumers[stNode.sInput] == 1) {
+            StNode stPrev = vResult[it->second];
+            for (const char* pKey : {"width", "height", "format"}) {
+                if (!stNode.stConfig.has(pKey) && stPrev.stConfig.has(pKey)) {
+                    stNode.stConfig.set(pKey, stPrev.stConfig[pKey]);
+                }
+            }
+            int nRotate = (stPrev.stConfig["rotate"].asInt(0) + stNode.stConfig["rotate"].asInt(0)) % 360;
+            stNode.stConfig.set("rotate", JsonValue::makeNumber(nRotate));
+            if (!stNode.bHasPolicy && stPrev.bHasPolicy) {
+                stNode.bHasPolicy = true;
+                stNode.stPolicy = stPrev.stPolicy;
+            }
+            stNode.sInput = stPrev.sInput;
+            ff_info("graph: fuse %s into %s\n", stPrev.sName.c_str(), stNode.sName.c_str());
+            m_mAlias[stPrev.sName] = stNode.sName;
+            // 当前节点接替被合并节点的位置，仍保持拓扑顺序
+            size_t nPos = it->second;
+            mIndex.erase(it);
+            mIndex[stNode.sName] = nPos;
+            vResult[nPos] = stNode;
+            continue;
+        }
+        mIndex[stNode.sName] = vResult.size();
+        vResult.push_back(stNode);
+    }
+    vNodes.swap(vResult);
+}
+
+// 检查上游输出能否直接输入，需要转换时stRequired为转换后的参数并返回1，不能连接返回-1
+int PipelineGraph::checkInput(const StNode& stNode, const ImagePara& stInput, ImagePara& stRequired) {
+    const char* pFmt = v4l2GetFmtName(stInput.v4l2Fmt);
+    switch (nodeKind(stNode.sType)) {
+    case KIND_DECODER:
+        if (!isDecodableFmt(stInput.v4l2Fmt)) {
+            ff_error("graph: %s: decoder input is %s, need H264/H265/MJPEG\n", stNode.sName.c_str(), pFmt);
+            return -1;
+        }
+        return 0;
+    case KIND_SINK:
+        if (!isStreamFmt(stInput.v4l2Fmt)) {
+            ff_error("graph: %s: input is %s, need H264/H265 (add mpp_enc)\n", stNode.sName.c_str(), pFmt);
+            return -1;
+        }
+        return 0;
+    case KIND_CONVERTER:
+    case KIND_ENCODER:
+        break;
+    default:
+        return -1;
+    }
+    if (v4l2fmtIsCompressed(stInput.v4l2Fmt)) {
+        ff_error("graph: %s: input is %s, need raw image (add mpp_dec)\n", stNode.sName.c_str(), pFmt);
+        return -1;
+    }
+    if (nodeKind(stNode.sType) == KIND_CONVERTER) {
+        return 0;
+    }
+    // 编码器：格式不支持或与input_*要求不同时插入RGA
+    const JsonValue& stConfig = stNode.stConfig;
+    uint32_t nFmt = parseFormat(stConfig["input_format"], stInput.v4l2Fmt);
+    if (nFmt == 0) {
+        ff_error("graph: %s: unknown input_format\n", stNode.sName.c_str());
+        return -1;
+    }
+    if (!isEncodableFmt(nFmt)) {
+        nFmt = V4L2_PIX_FMT_NV12;
+    }
+    uint32_t nWidth = stConfig["input_width"].asInt(stInput.width);
+    uint32_t nHeight = stConfig["input_height"].asInt(stInput.height);
+    if (nFmt == stInput.v4l2Fmt && nWidth == stInput.width && nHeight == stInput.height) {
+        return 0;
+    }
+    // YUV420需要偶数宽高
+    stRequired = makePara(nWidth & ~1u, nHeight & ~1u, nFmt);
+    return 1;
+}
+
+// 按节点类型估算输出缓冲区，预算不够时未指定buffers的RGA/编码器可减少个数，图像尺寸由配置决定不缩小
+int PipelineGraph::admitNode(const StNode& stNode, const ImagePara& stInput, const ImagePara& stOutput) {
+    AdmissionControl::StStage stStage;
+    stStage.sName = stNode.sName;
+    stStage.nBuffers = stNode.pModule->getBufferCount();
+    stStage.nMinBuffers = stStage.nBuffers;
+    stStage.bScalable = false;
+    bool bFixed = stNode.stConfig.has("buffers");
+    switch (nodeKind(stNode.sType)) {
+    case KIND_DECODER:
+        stStage.stPara = AdmissionControl::decodedPara(stInput);
+        break;
+    case KIND_CONVERTER:
+        stStage.stPara = stOutput;
+        if (!bFixed) {
+            stStage.nMinBuffers = std::min<uint16_t>(stStage.nBuffers, 2);
+        }
+        break;
+    case KIND_ENCODER:
+        stStage.stPara = stInput;
+        stStage.stPara.v4l2Fmt = V4L2_PIX_FMT_H264;
+        if (!bFixed) {
+            stStage.nMinBuffers = std::min<uint16_t>(stStage.nBuffers, 4);
+        }
+        break;
+    default:
+        // 数据源和输出的缓冲区很小，不计入
+        return 0;
+    }
+    std::vector<AdmissionControl::StStage> vStages = {stStage};
+    if (AdmissionControl::getInstance()->admit(m_sSession, vStages) < 0) {
+        ff_error("graph: %s: exceeds memory budget\n", stNode.sName.c_str());
+        return -1;
+    }
+    if (vStages[0].nBuffers != stStage.nBuffers) {
+        stNode.pModule->setBufferCount(vStages[0].nBuffers);
+    }
+    return 0;
+}
+
+shared_ptr<ModuleMedia> PipelineGraph::createModule(const StNode& stNode, const ImagePara& stInput) {
+    const JsonValue& stConfig = stNode.stConfig;
+    const std::string& sType = stNode.sType;
+    if (sType == "rtsp_client") {
+        std::string sTransport = stConfig["transport"].asString("tcp");
+        RTSP_STREAM_TYPE eType = sTransport == "udp" ? RTSP_STREAM_TYPE_UDP
+                               : (sTransport == "multicast" ? RTSP_STREAM_TYPE_MULTICAST : RTSP_STREAM_TYPE_TCP);
+        return make_shared<TracedModule<PlacedModule<ModuleRtspClient>>>(stConfig["url"].asString(), eType, true, false);
+    }
+    if (sType == "annexb_source") {
+        return make_shared<TracedModule<PlacedModule<ModuleAnnexBSource>>>(stConfig["path"].asString(), stConfig["fps"].asDouble(0),
+                                               stConfig["loop"].asBool(true));
+    }
+    if (sType == "file_reader") {
+        return make_shared<TracedModule<PlacedModule<ModuleFileReader>>>(stConfig["path"].asString(), stConfig["loop"].asBool(false));
+    }
+    if (sType == "record_reader") {
+        return make_shared<TracedModule<PlacedModule<ModuleRecordReader>>>(stConfig["dir"].asString(), stConfig["prefix"].asString("seg"),
+                                               stConfig["fps"].asInt(25));
+    }
+    if (sType == "mpp_dec") {
+        return make_shared<TracedModule<PlacedModule<ModuleMppDec>>>(stInput);
+    }
+    if (sType == "mpp_enc") {
+        std::string sCodec = stConfig["codec"].asString("h264");
+        EncodeType eType = sCodec == "h265" ? ENCODE_TYPE_H265 : (sCodec == "mjpeg" ? ENCODE_TYPE_MJPEG : ENCODE_TYPE_H264);
+        EncodeRcMode eMode = stConfig["rc"].asString("cbr") == "vbr" ? ENCODE_RC_MODE_VBR : ENCODE_RC_MODE_CBR;
+        return make_shared<TracedModule<PlacedModule<ModuleMppEncEx>>>(eType, stConfig["fps"].asInt(30), stConfig["gop"].asInt(60),
+                                           stConfig["bitrate"].asInt(2048), eMode);
+    }
+    if (sType == "rtsp_server") {
+        auto pServer = make_shared<TracedModule<PlacedModule<ModuleRtspServer>>>(stConfig["path"].asString("/live/0").c_str(),
+                                                                    stConfig["port"].asInt(554));
+        pServer->setBufferCount(0);
+        return pServer;
+    }
+    if (sType == "rtmp_server") {
+        auto pServer = make_shared<TracedModule<PlacedModule<ModuleRtmpServer>>>(stConfig["path"].asString("/live/0").c_str(),
+                                                                    stConfig["port"].asInt(1935));
+        pServer->setBufferCount(0);
+        return pServer;
+    }
+    if (sType == "file_writer") {
+        return make_shared<TracedModule<PlacedModule<ModuleFileWriter>>>(stConfig["path"].asString());
+    }
+    if (sType == "segment_recorder") {
+        auto pRecorder = make_shared<TracedModule<PlacedModule<ModuleSegmentRecorder>>>(stConfig["dir"].asString(),
+                                                                           stConfig["prefix"].asString("seg"));
+        pRecorder->setSegmentLimit(stConfig["segment_sec"].asInt(60));
+        pRecorder->setRetention((uint64_t)std::max(stConfig["retention_mb"].asInt(0), 0) << 20);
+        return pRecorder;
+    }
+    return nullptr;
+}
+
+int PipelineGraph::build(std::vector<StNode>& vNodes) {
+    std::map<std::string, std::vector<size_t>> mConsumers;
+    for (size_t i = 0; i < vNodes.size(); ++i) {
+        mConsumers[vNodes[i].sInput].push_back(i);
+    }
+    for (StNode& stNode : vNodes) {
+        shared_ptr<ModuleMedia> pInput;
+        ImagePara stInput;
+        if (!stNode.sInput.empty()) {
+            stNode.sInput = resolve(stNode.sInput);
+            pInput = m_vNodes[m_mIndex[stNode.sInput]].pModule;
+            stInput = pInput->getOutputImagePara();
+            ImagePara stRequired;
+            int nCheck = checkInput(stNode, stInput, stRequired);
+            if (nCheck < 0) {
+                return -1;
+            }
+            if (nCheck > 0) {
+                StNode stConvert;
+                stConvert.sName = stNode.sName + ".convert";
+                stConvert.sType = "rga";
+                stConvert.sInput = stNode.sInput;
+                stConvert.bAuto = true;
+                stConvert.pModule =
+                    make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(stInput, stRequired, RGA_ROTATE_NONE);
+                stConvert.pModule->setProductor(pInput);
+                if (admitNode(stConvert, stInput, stRequired) < 0 || stConvert.pModule->init() < 0) {
+                    ff_error("graph: %s: init failed\n", stConvert.sName.c_str());
+                    return -1;
+                }
+                ff_info("graph: insert %s (%s %ux%u -> %s %ux%u)\n", stConvert.sName.c_str(),
+                        v4l2GetFmtName(stInput.v4l2Fmt), stInput.width, stInput.height,
+                        v4l2GetFmtName(stRequired.v4l2Fmt), stRequired.width, stRequired.height);
+                pInput = stConvert.pModule;
+                stInput = pInput->getOutputImagePara();
+                stNode.sInput = stConvert.sName;
+                m_mIndex[stConvert.sName] = m_vNodes.size();
+                m_vNodes.push_back(stConvert);
+            }
+        }
+        ImagePara stOutput = stInput;
+        if (stNode.sType == "rga") {
+            RgaRotate eRotate;
+            if (!rgaOutput(stNode.stConfig, stInput, stOutput, eRotate)) {
+                ff_error("graph: %s: unknown format\n", stNode.sName.c_str());
+                return -1;
+            }
+            const std::vector<size_t>& vNext = mConsumers[stNode.sName];
+            ImagePara stRequired;
+            if (m_bOptimize && vNext.size() == 1 && nodeKind(vNodes[vNext[0]].sType) == KIND_ENCODER &&
+                checkInput(vNodes[vNext[0]], stOutput, stRequired) > 0) {
+                // 直接输出编码器需要的格式，不再另插转换
+                stOutput = stRequired;
+            }
+            if (m_bOptimize && eRotate == RGA_ROTATE_NONE && sameImage(stInput, stOutput)) {
+                ff_info("graph: drop identity conversion %s\n", stNode.sName.c_str());
+                m_mAlias[stNode.sName] = stNode.sInput;
+                continue;
+            }
+            stNode.pModule = make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(stInput, stOutput, eRotate);
+        } else {
+            stNode.pModule = createModule(stNode, stInput);
+        }
+        if (stNode.pModule == nullptr) {
+            return -1;
+        }
+        if (pInput != nullptr) {
+            stNode.pModule->setProductor(pInput);
+        }
+        // 录像组件不使用输出缓冲区，setBufferCount不是虚函数，这里跳过
+        if (stNode.stConfig.has("buffers") && stNode.sType != "segment_recorder") {
+            stNode.pModule->setBufferCount(stNode.stConfig["buffers"].asInt(0));
+        }
+        if (admitNode(stNode, stInput, stOutput) < 0 || stNode.pModule->init() < 0) {
+            ff_error("graph: %s: init failed\n", stNode.sName.c_str());
+            stNode.pModule = nullptr;
+            return -1;
+        }
+        m_mIndex[stNode.sName] = m_vNodes.size();
+        m_vNodes.push_back(stNode);
+    }
+    return 0;
+}
+
+int PipelineGraph::start(ThreadPlacement::PolicyProvider fnDefault) {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (m_vNodes.empty()) {
+        return -1;
+    }
+    if (m_bRunning) {
+        return 0;
+    }
+    std::map<ModuleMedia*, const ThreadPlacement::StPolicy*> mPolicy;
+    for (const StNode& stNode : m_vNodes) {
+        if (stNode.bHasPolicy) {
+            mPolicy[stNode.pModule.get()] = &stNode.stPolicy;
+        }
+    }
+    auto fnPolicy = [&](ModuleMedia* pModule) -> const ThreadPlacement::StPolicy* {
+        auto it = mPolicy.find(pModule);
+        if (it != mPolicy.end()) {
+            return it->second;
+        }
+        return fnDefault ? fnDefault(pModule) : nullptr;
+    };
+    // 全部组件都已init成功，从各数据源启动整条管道
+    for (const StNode& stNode : m_vNodes) {
+        if (stNode.sInput.empty()) {
+            ThreadPlacement::startPipe(stNode.pModule, fnPolicy);
+        }
+    }
+    m_bRunning = true;
+    return 0;
+}
+
+void PipelineGraph::stop() {
+    std::lock_guard<std::mutex> locker(m_mutex);
+    if (!m_bRunning) {
+        return;
+    }
+    // 停止数据源时一并停止下游
+    for (auto it = m_vNodes.rbegin(); it != m_vNodes.rend(); ++it) {
+        if (it->sInput.empty()) {
+            it->pModule->stop();
+        }
+    }
+    m_bRunning = false;
+}
+
+std::string PipelineGraph::resolve(const std::string& sName) const {
+    std::string sResult = sName;
+    for (auto it = m_mAlias.find(sResult); it != m_mAlias.end(); it = m_mAlias.find(sResult)) {
+        sResult = it->second;
+    }
+    return sResult;
+}
+
+shared_ptr<ModuleMedia> PipelineGraph::getModule(const std::string& sName) const {
+    auto it = m_mIndex.find(resolve(sName));
+    return it != m_mIndex.end() ? m_vNodes[it->second].pModule : nullptr;
+}
+
+void PipelineGraph::release() {
+    // 先释放下游
+    while (!m_vNodes.empty()) {
+        m_vNodes.pop_back();
+    }
+    m_mIndex.clear();
+    m_mAlias.clear();
+    AdmissionControl::getInstance()->release(m_sSession);
+}
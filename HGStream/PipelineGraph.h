@@ -0,0 +1,89 @@
+#ifndef PIPELINEGRAPH_H
+#define PIPELINEGRAPH_H
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+#include "JsonValue.h"
+#include "ThreadPlacement.h"
+
+// 按配置文件搭建管道。每个节点给出类型、参数及上游节点名，按拓扑顺序创建组件并以上游实际的输出参数init，
+// 检查每条边的格式是否匹配(解码器要码流，RGA/编码器要图像，推流和写文件要H264/H265)，
+// 编码器不支持的图像格式或尺寸与input_*要求不同时自动插入RGA转换。全部init成功后才启动，任一失败则全部释放。
+// 配置格式：
+//   {
+//     "nodes": [ 公共节点 ],
+//     "template": [ 每路的节点，字符串中的${key}用streams中对应的值替换 ],
+//     "streams": [ {"id": "0", "url": "rtsp://..."}, ... ]
+//   }
+// 节点：{"name": "dec${id}", "type": "mpp_dec", "input": "cam${id}", "buffers": 8, "cores": "big", "sched": "rr", "priority": 10}
+// 类型及参数：
+//   rtsp_client(url, transport: udp/tcp/multicast)  annexb_source(path, fps, loop)  file_reader(path, loop)
+//   record_reader(dir, prefix, fps)  mpp_dec  rga(width, height, format, rotate)
+//   mpp_enc(codec: h264/h265/mjpeg, fps, gop, bitrate(kbps), rc: cbr/vbr, input_width, input_height, input_format)
+//   rtsp_server(path, port)  rtmp_server(path, port)  file_writer(path)  segment_recorder(dir, prefix, segment_sec, retention_mb)
+// 用法：
+//   PipelineGraph graph;
+//   if (graph.loadFile("cameras.json") == 0) { graph.start(); ... graph.stop(); }
+// 每个组件只有一个上游，多路输入的组件(如ModuleMosaic)不支持。
+class PipelineGraph {
+public:
+    struct StNode {
+        std::string sName;
+        std::string sType;
+        // 上游节点名，数据源为空
+        std::string sInput;
+        JsonValue stConfig;
+        // 自动插入的转换
+        bool bAuto = false;
+        bool bHasPolicy = false;
+        ThreadPlacement::StPolicy stPolicy;
+        shared_ptr<ModuleMedia> pModule;
+    };
+
+public:
+    PipelineGraph();
+    ~PipelineGraph();
+
+    // 解析配置并创建、init全部组件，失败返回-1且不保留任何组件
+    int loadFile(const std::string& sPath);
+    int load(const JsonValue& stConfig);
+    // 先启动全部下游再启动数据源，没有配置cores/sched的节点使用fnDefault返回的策略
+    int start(ThreadPlacement::PolicyProvider fnDefault = nullptr);
+    void stop();
+    bool isRunning() const { return m_bRunning; }
+
+    shared_ptr<ModuleMedia> getModule(const std::string& sName) const;
+    // 按拓扑顺序，包含自动插入的节点
+    const std::vector<StNode>& getNodes() const { return m_vNodes; }
+
+private:
+    int expand(const JsonValue& stConfig, std::vector<StNode>& vNodes);
+    int parseNode(const JsonValue& stItem, StNode& stNode);
+    int sortNodes(std::vector<StNode>& vNodes);
+    void fuseConversions(std::vector<StNode>& vNodes);
+    int build(std::vector<StNode>& vNodes);
+    int checkInput(const StNode& stNode, const ImagePara& stInput, ImagePara& stRequired);
+    shared_ptr<ModuleMedia> createModule(const StNode& stNode, const ImagePara& stInput);
+    // 按预算接入节点的缓冲区，降级时修改缓冲区个数
+    int admitNode(const StNode& stNode, const ImagePara& stInput, const ImagePara& stOutput);
+    // 被合并或去掉的节点名对应到实际的节点
+    std::string resolve(const std::string& sName) const;
+    void release();
+
+private:
+    std::mutex m_mutex;
+    std::vector<StNode> m_vNodes;
+    std::map<std::string, size_t> m_mIndex;
+    std::map<std::string, std::string> m_mAlias;
+    bool m_bOptimize = true;
+    // 内存预算中的会话名
+    std::string m_sSession;
+    bool m_bRunning = false;
+};
+
+#endif // PIPELINEGRAPH_H
@@ -0,0 +1,114 @@
+#ifndef RKNNTENSORADAPTER_H
+#define RKNNTENSORADAPTER_H
+
+// ModuleInference输出转换为TensorInfo，依赖rknn_api.h，仅在使用推理模块时包含
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "module/vp/module_inference.hpp"
+#include "libExportStream.h"
+#include "YoloPostProcess.h"
+
+// 将rknn_tensor_attr/rknn_tensor_mem填充为TensorInfo，不拷贝数据，成功返回张量数量
+inline int getInferenceTensors(const std::shared_ptr<ModuleInference>& pInference, std::vector<TensorInfo>& vTensors) {
+    vTensors.clear();
+    if (pInference == nullptr) {
+        return -1;
+    }
+    std::vector<rknn_tensor_mem*> vMem = pInference->getOutputMem();
+    std::vector<rknn_tensor_attr*> vAttr = pInference->getOutputAttr();
+    if (vMem.size() != vAttr.size()) {
+        return -1;
+    }
+    for (size_t i = 0; i < vMem.size(); ++i) {
+        const rknn_tensor_attr* pAttr = vAttr[i];
+        TensorInfo stTensor;
+        stTensor.pData = vMem[i]->virt_addr;
+        switch (pAttr->type) {
+        case RKNN_TENSOR_INT8:
+            stTensor.type = HG_TENSOR_TYPE_INT8;
+            break;
+        case RKNN_TENSOR_FLOAT16:
+            stTensor.type = HG_TENSOR_TYPE_FP16;
+            break;
+        case RKNN_TENSOR_FLOAT32:
+            stTensor.type = HG_TENSOR_TYPE_FP32;
+            break;
+        default:
+            return -1;
+        }
+        if (pAttr->n_dims != 4) {
+            return -1;
+        }
+        if (pAttr->fmt == RKNN_TENSOR_NHWC) {
+            stTensor.fmt = HG_TENSOR_FMT_NHWC;
+            stTensor.h = pAttr->dims[1];
+            stTensor.w = pAttr->dims[2];
+            stTensor.c = pAttr->dims[3];
+        } else if (pAttr->fmt == RKNN_TENSOR_NCHW) {
+            stTensor.fmt = HG_TENSOR_FMT_NCHW;
+            stTensor.c = pAttr->dims[1];
+            stTensor.h = pAttr->dims[2];
+            stTensor.w = pAttr->dims[3];
+        } else {
+            return -1;
+        }
+        stTensor.zp = pAttr->zp;
+        stTensor.scale = pAttr->scale;
+        vTensors.push_back(stTensor);
+    }
+    return (int)vTensors.size();
+}
+
+// 推理组件包装，由这里按间隔跳帧，基类始终每帧推理；每完成一次推理序号加1，供下游判断输出张量是否为新的结果。
+// setInferenceInterval隐藏了基类的同名接口，须通过本类指针调用
+class SequencedInference : public ModuleInference {
+public:
+    using ModuleInference::ModuleInference;
+
+    // 每推理一帧后跳过nInterval帧，0为每帧推理
+    void setInferenceInterval(uint32_t nInterval) { m_nInterval = nInterval; }
+    // 已完成的推理次数
+    uint64_t getSequence() const { return m_nSequence.load(std::memory_order_acquire); }
+
+protected:
+    ConsumeResult doConsume(shared_ptr<MediaBuffer> input_buffer, shared_ptr<MediaBuffer> output_buffer) override {
+        if (m_nSkipped < m_nInterval) {
+            m_nSkipped++;
+            return CONSUME_BYPASS;
+        }
+        m_nSkipped = 0;
+        ConsumeResult eResult = ModuleInference::doConsume(input_buffer, output_buffer);
+        if (eResult != CONSUME_FAILED) {
+            m_nSequence.fetch_add(1, std::memory_order_release);
+        }
+        return eResult;
+    }
+
+private:
+    std::atomic<uint32_t> m_nInterval{0};
+    uint32_t m_nSkipped = 0;
+    std::atomic<uint64_t> m_nSequence{0};
+};
+
+// 生成ModuleTracker的检测结果提供者，推理序号没有变化(跳过推理的帧)时返回0
+inline std::function<int(shared_ptr<MediaBuffer>, DetectResult*)> makeInferenceProvider(
+    std::shared_ptr<SequencedInference> pInference, std::shared_ptr<YoloPostProcess> pPostProcess) {
+    auto pLastSequence = std::make_shared<uint64_t>(0);
+    auto pTensors = std::make_shared<std::vector<TensorInfo>>();
+    return [pInference, pPostProcess, pLastSequence, pTensors](shared_ptr<MediaBuffer> pBuffer, DetectResult* pResult) {
+        (void)pBuffer;
+        uint64_t nSequence = pInference->getSequence();
+        if (nSequence == *pLastSequence) {
+            return 0;
+        }
+        *pLastSequence = nSequence;
+        if (getInferenceTensors(pInference, *pTensors) <= 0) {
+            return 0;
+        }
+        return pPostProcess->process(pTensors->data(), (int)pTensors->size(), pResult) >= 0 ? 1 : 0;
+    };
+}
+
+#endif // RKNNTENSORADAPTER_H
@@ -0,0 +1,193 @@
+#include "SceneActivity.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "CpuAccess.h"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HG_USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HG_USE_SSE2 1
+#endif
+
+// 块内隔行采样，降低读内存量
+#define ROW_STEP 4
+
+namespace {
+
+// 16字节绝对差之和
+inline uint32_t sad16(const uint8_t* a, const uint8_t* b) {
+#if defined(HG_USE_NEON)
+    uint8x16_t d = vabdq_u8(vld1q_u8(a), vld1q_u8(b));
+#if defined(__aarch64__)
+    return vaddlvq_u8(d);
+#else
+    uint64x2_t s = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(d)));
+    return (uint32_t)(vgetq_lane_u64(s, 0) + vgetq_lane_u64(s, 1));
+#endif
+#elif defined(HG_USE_SSE2)
+    __m128i s = _mm_sad_epu8(_mm_loadu_si128((const __m128i*)a), _mm_loadu_si128((const __m128i*)b));
+    return (uint32_t)(_mm_cvtsi128_si32(s) + _mm_extract_epi16(s, 4));
+#else
+    uint32_t s = 0;
+    for (int i = 0; i < 16; ++i) {
+        s += (uint32_t)abs((int)a[i] - (int)b[i]);
+    }
+    return s;
+#endif
+}
+
+bool isLumaFirst(uint32_t v4l2Fmt) {
+    switch (v4l2Fmt) {
+    case V4L2_PIX_FMT_NV12:
+    case V4L2_PIX_FMT_NV21:
+    case V4L2_PIX_FMT_NV16:
+    case V4L2_PIX_FMT_NV61:
+    case V4L2_PIX_FMT_YUV420:
+    case V4L2_PIX_FMT_YVU420:
+    case V4L2_PIX_FMT_GREY:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+SceneActivity::SceneActivity() : m_nInterval(0), m_fActivity(1.f) {
+}
+
+SceneActivity::~SceneActivity() {
+}
+
+void SceneActivity::setIntervalRange(uint32_t nMinInterval, uint32_t nMaxInterval) {
+    m_nMinInterval = nMinInterval;
+    m_nMaxInterval = std::max(nMinInterval, nMaxInterval);
+    m_nInterval = m_nMinInterval;
+}
+
+void SceneActivity::setHysteresis(float fHigh, float fLow, uint32_t nQuietFrames) {
+    m_fHigh = fHigh;
+    m_fLow = std::min(fLow, fHigh);
+    m_nQuietFrames = nQuietFrames;
+}
+
+void SceneActivity::setBlockPara(uint32_t nBlockSize, uint32_t nDiffThreshold) {
+    m_nBlockSize = std::max(16u, nBlockSize & ~15u);
+    m_nDiffThreshold = nDiffThreshold;
+    m_bHasPrev = false;
+}
+
+shared_ptr<ModuleMedia> SceneActivity::attach(shared_ptr<ModuleMedia> pSource, std::function<void(uint32_t)> fnSetInterval) {
+    if (pSource == nullptr) {
+        return nullptr;
+    }
+    // 换新的数据源后重新开始
+    m_bHasPrev = false;
+    m_nQuietCount = 0;
+    m_nInterval = m_nMinInterval;
+    m_fnSetInterval = fnSetInterval;
+    if (m_fnSetInterval) {
+        m_fnSetInterval(m_nInterval);
+    }
+    return pSource->addExternalConsumer("SceneActivity", this, onFrame);
+}
+
+void SceneActivity::onFrame(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+    static_cast<SceneActivity*>(pCtx)->update(pBuffer);
+}
+
+uint32_t SceneActivity::update(shared_ptr<MediaBuffer> pBuffer) {
+    if (pBuffer == nullptr || pBuffer->getMediaBufferType() != BUFFER_TYPE_VIDEO) {
+        return m_nInterval;
+    }
+    std::shared_ptr<VideoBuffer> pFrameBuf = static_pointer_cast<VideoBuffer>(pBuffer);
+    ImagePara stPara = pFrameBuf->getImagePara();
+    if (!isLumaFirst(stPara.v4l2Fmt) || pFrameBuf->getActiveData() == nullptr) {
+        return m_nInterval;
+    }
+    // 只读Y平面，解码器输出不可缓存时不同步
+    size_t nBase = (uint8_t*)pFrameBuf->getActiveData() - (uint8_t*)pFrameBuf->getData();
+    CpuAccess::beginRead(pFrameBuf.get(), nBase, (size_t)std::max(stPara.hstride, stPara.width) * stPara.height);
+    return update((const uint8_t*)pFrameBuf->getActiveData(), stPara.width, stPara.height, stPara.hstride);
+}
+
+uint32_t SceneActivity::countChanged(const uint8_t* pLuma, uint32_t nWidth, uint32_t nHeight, uint32_t nStride) {
+    uint32_t nBlocksW = nWidth / m_nBlockSize;
+    uint32_t nBlocksH = nHeight / m_nBlockSize;
+    const uint32_t nRowBytes = nBlocksW * m_nBlockSize;
+    const uint32_t nRowsPerBlock = m_nBlockSize / ROW_STEP;
+    if (nBlocksW != m_nBlocksW || nBlocksH != m_nBlocksH) {
+        m_nBlocksW = nBlocksW;
+        m_nBlocksH = nBlocksH;
+        m_vPrev.assign((size_t)nRowBytes * nRowsPerBlock * nBlocksH, 0);
+        m_bHasPrev = false;
+    }
+    const uint32_t nChunks = m_nBlockSize / 16;
+    // 块内平均绝对差超过阈值视为变化
+    const uint32_t nLimit = m_nDiffThreshold * m_nBlockSize * nRowsPerBlock;
+    std::vector<uint32_t>& vAcc = m_vAcc;
+    vAcc.resize(nBlocksW);
+    uint8_t* pPrev = m_vPrev.data();
+    uint32_t nChanged = 0;
+    for (uint32_t by = 0; by < nBlocksH; ++by) {
+        std::fill(vAcc.begin(), vAcc.end(), 0);
+        for (uint32_t y = 0; y < m_nBlockSize; y += ROW_STEP) {
+            const uint8_t* pRow = pLuma + (size_t)(by * m_nBlockSize + y) * nStride;
+            if (m_bHasPrev) {
+                for (uint32_t bx = 0; bx < nBlocksW; ++bx) {
+                    const uint32_t nOffset = bx * m_nBlockSize;
+                    for (uint32_t c = 0; c < nChunks; ++c) {
+                        vAcc[bx] += sad16(pRow + nOffset + c * 16, pPrev + nOffset + c * 16);
+                    }
+                }
+            }
+            // 比较完的行留作下一帧的参考
+            memcpy(pPrev, pRow, nRowBytes);
+            pPrev += nRowBytes;
+        }
+        for (uint32_t bx = 0; bx < nBlocksW; ++bx) {
+            if (vAcc[bx] > nLimit) {
+                nChanged++;
+            }
+        }
+    }
+    return nChanged;
+}
+
+uint32_t SceneActivity::update(const uint8_t* pLuma, uint32_t nWidth, uint32_t nHeight, uint32_t nStride) {
+    if (pLuma == nullptr || nWidth < m_nBlockSize || nHeight < m_nBlockSize) {
+        return m_nInterval;
+    }
+    bool bHasPrev = m_bHasPrev;
+    uint32_t nChanged = countChanged(pLuma, nWidth, nHeight, nStride);
+    // 首帧或尺寸变化时没有参考，按全部变化处理
+    float fActivity = (bHasPrev && m_bHasPrev) ? (float)nChanged / (m_nBlocksW * m_nBlocksH) : 1.f;
+    m_bHasPrev = true;
+    m_fActivity = fActivity;
+
+    // 快速恢复，缓慢放宽
+    uint32_t nInterval = m_nInterval;
+    if (fActivity >= m_fHigh) {
+        nInterval = m_nMinInterval;
+        m_nQuietCount = 0;
+    } else if (fActivity < m_fLow) {
+        if (++m_nQuietCount >= m_nQuietFrames) {
+            m_nQuietCount = 0;
+            nInterval = std::min(m_nMaxInterval, std::max(nInterval * 2, nInterval + 1));
+        }
+    } else {
+        m_nQuietCount = 0;
+    }
+    if (nInterval != m_nInterval) {
+        m_nInterval = nInterval;
+        if (m_fnSetInterval) {
+            m_fnSetInterval(nInterval);
+        }
+    }
+    return nInterval;
+}
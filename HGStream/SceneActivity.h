@@ -0,0 +1,67 @@
+#ifndef SCENEACTIVITY_H
+#define SCENEACTIVITY_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "module/module_media.hpp"
+
+// 场景活跃度估计，在NV12的Y平面上隔行采样，按块与上一帧同位置像素求绝对差之和(SAD)，块内平均差超过阈值记为变化块，
+// 按活跃度带滞回地调整推理间隔：画面变化立即恢复逐帧推理，静止一段时间后逐步拉长间隔。
+// 用法(每路流一个对象)：
+//   pActivity->attach(pMppDec, [pInference](uint32_t n) { pInference->setInferenceInterval(n); });
+// 拉流时由HG_SetSceneActivity开启，挂在解码器上，推理方用HG_GetInferenceInterval取当前间隔。
+class SceneActivity {
+public:
+    SceneActivity();
+    ~SceneActivity();
+
+    // 设置推理间隔范围，0为每帧推理
+    void setIntervalRange(uint32_t nMinInterval, uint32_t nMaxInterval);
+    // 设置滞回参数：活跃度高于fHigh立即恢复最小间隔；连续nQuietFrames帧低于fLow则间隔翻倍
+    void setHysteresis(float fHigh, float fLow, uint32_t nQuietFrames);
+    // 设置块大小(像素，16的倍数)及判定块变化的块内平均绝对差
+    void setBlockPara(uint32_t nBlockSize, uint32_t nDiffThreshold);
+
+    // 作为外部消费者挂到输出NV12的模块(如ModuleMppDec)上，间隔变化时回调fnSetInterval
+    shared_ptr<ModuleMedia> attach(shared_ptr<ModuleMedia> pSource, std::function<void(uint32_t)> fnSetInterval);
+
+    // 处理一帧Y平面，返回当前推理间隔
+    uint32_t update(const uint8_t* pLuma, uint32_t nWidth, uint32_t nHeight, uint32_t nStride);
+    uint32_t update(shared_ptr<MediaBuffer> pBuffer);
+
+    uint32_t getInterval() const { return m_nInterval; }
+    // 最近一帧变化块比例，0~1
+    float getActivity() const { return m_fActivity; }
+
+private:
+    static void onFrame(void* pCtx, shared_ptr<MediaBuffer> pBuffer);
+    // 与上一帧比较并保存本帧采样行，返回变化块数
+    uint32_t countChanged(const uint8_t* pLuma, uint32_t nWidth, uint32_t nHeight, uint32_t nStride);
+
+private:
+    uint32_t m_nMinInterval = 0;
+    uint32_t m_nMaxInterval = 8;
+    float m_fHigh = 0.02f;
+    float m_fLow = 0.005f;
+    uint32_t m_nQuietFrames = 30;
+    uint32_t m_nBlockSize = 16;
+    uint32_t m_nDiffThreshold = 6;
+
+    std::atomic<uint32_t> m_nInterval;
+    std::atomic<float> m_fActivity;
+    uint32_t m_nQuietCount = 0;
+    std::function<void(uint32_t)> m_fnSetInterval;
+
+    // 上一帧的采样行(每块ROW_STEP行取一行)，逐行紧排
+    std::vector<uint8_t> m_vPrev;
+    // 一行块的SAD累加
+    std::vector<uint32_t> m_vAcc;
+    uint32_t m_nBlocksW = 0;
+    uint32_t m_nBlocksH = 0;
+    bool m_bHasPrev = false;
+};
+
+#endif // SCENEACTIVITY_H
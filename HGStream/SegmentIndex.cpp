@@ -0,0 +1,366 @@
+#include "SegmentIndex.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "base/ff_log.h"
+
+#define SEGMENT_INDEX_MAGIC "HGSIDX1"
+#define SEGMENT_INDEX_VERSION 1
+#define SEGMENT_INDEX_INIT_CAPACITY 4096
+
+SegmentIndex::SegmentIndex() {
+}
+
+SegmentIndex::~SegmentIndex() {
+    close();
+}
+
+int SegmentIndex::open(const std::string& sDir, const std::string& sPrefix, bool bWrite) {
+    close();
+    m_sDir = sDir;
+    m_bWrite = bWrite;
+    if (openTable(m_stKeys, sDir + "/" + sPrefix + ".idx", sizeof(StKeyFrame), bWrite) < 0
+        || openTable(m_stSegments, sDir + "/" + sPrefix + ".seg", sizeof(StSegmentRecord), bWrite) < 0) {
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+void SegmentIndex::close() {
+    closeTable(m_stKeys);
+    closeTable(m_stSegments);
+}
+
+int SegmentIndex::openTable(StTable& stTable, const std::string& sPath, uint32_t nRecordSize, bool bWrite) {
+    stTable.nFd = ::open(sPath.c_str(), bWrite ? (O_RDWR | O_CREAT | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC), 0644);
+    if (stTable.nFd < 0) {
+        ff_error("segment index: failed to open %s: %s\n", sPath.c_str(), strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    fstat(stTable.nFd, &st);
+    bool bCreate = (size_t)st.st_size < sizeof(StHeader);
+    if (bCreate) {
+        if (!bWrite) {
+            ff_error("segment index: %s is empty\n", sPath.c_str());
+            return -1;
+        }
+        if (ftruncate(stTable.nFd, sizeof(StHeader) + (size_t)nRecordSize * SEGMENT_INDEX_INIT_CAPACITY) < 0) {
+            return -1;
+        }
+    }
+    if (!remapTable(stTable)) {
+        return -1;
+    }
+    StHeader* pHeader = stTable.pHeader;
+    if (bCreate) {
+        memset(pHeader, 0, sizeof(StHeader));
+        memcpy(pHeader->szMagic, SEGMENT_INDEX_MAGIC, sizeof(pHeader->szMagic));
+        pHeader->nVersion = SEGMENT_INDEX_VERSION;
+        pHeader->nRecordSize = nRecordSize;
+        pHeader->nCapacity = SEGMENT_INDEX_INIT_CAPACITY;
+    } else if (memcmp(pHeader->szMagic, SEGMENT_INDEX_MAGIC, sizeof(pHeader->szMagic)) != 0
+               || pHeader->nVersion != SEGMENT_INDEX_VERSION || pHeader->nRecordSize != nRecordSize) {
+        ff_error("segment index: %s has a wrong format\n", sPath.c_str());
+        return -1;
+    }
+    if (bWrite && (pHeader->nGeneration & 1)) {
+        // 上次前移过程中退出，记录区已完整，只需恢复代数号
+        pHeader->nGeneration++;
+    }
+    return 0;
+}
+
+void SegmentIndex::closeTable(StTable& stTable) {
+    if (stTable.pHeader != nullptr) {
+        munmap(stTable.pHeader, stTable.nMapSize);
+        stTable.pHeader = nullptr;
+        stTable.nMapSize = 0;
+    }
+    if (stTable.nFd >= 0) {
+        ::close(stTable.nFd);
+        stTable.nFd = -1;
+    }
+}
+
+bool SegmentIndex::remapTable(StTable& stTable) {
+    struct stat st;
+    if (fstat(stTable.nFd, &st) < 0 || (size_t)st.st_size < sizeof(StHeader)) {
+        return false;
+    }
+    if ((size_t)st.st_size == stTable.nMapSize) {
+        return true;
+    }
+    if (stTable.pHeader != nullptr) {
+        munmap(stTable.pHeader, stTable.nMapSize);
+        stTable.pHeader = nullptr;
+    }
+    int nProt = m_bWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+    void* pMap = mmap(nullptr, st.st_size, nProt, MAP_SHARED, stTable.nFd, 0);
+    if (pMap == MAP_FAILED) {
+        ff_error("segment index: mmap failed: %s\n", strerror(errno));
+        stTable.nMapSize = 0;
+        return false;
+    }
+    stTable.pHeader = (StHeader*)pMap;
+    stTable.nMapSize = st.st_size;
+    return true;
+}
+
+uint8_t* SegmentIndex::record(StTable& stTable, uint64_t nPos) {
+    StHeader* pHeader = stTable.pHeader;
+    uint64_t nPhysical = nPos - pHeader->nBase;
+    size_t nOffset = sizeof(StHeader) + nPhysical * pHeader->nRecordSize;
+    if (nOffset + pHeader->nRecordSize > stTable.nMapSize) {
+        // 写入方已扩容，读取方重新映射
+        if (!remapTable(stTable) || nOffset + stTable.pHeader->nRecordSize > stTable.nMapSize) {
+            return nullptr;
+        }
+    }
+    return (uint8_t*)stTable.pHeader + nOffset;
+}
+
+// 读取过程中表头被前移时重试
+template <typename Func>
+bool SegmentIndex::readConsistent(StTable& stTable, Func func) {
+    if (stTable.pHeader == nullptr) {
+        return false;
+    }
+    for (int i = 0; i < 100; ++i) {
+        uint32_t nGeneration = __atomic_load_n(&stTable.pHeader->nGeneration, __ATOMIC_ACQUIRE);
+        if ((nGeneration & 1) == 0) {
+            bool bRet = func();
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&stTable.pHeader->nGeneration, __ATOMIC_RELAXED) == nGeneration) {
+                return bRet;
+            }
+        }
+        usleep(100);
+    }
+    return false;
+}
+
+// ---- 写入 ----
+
+uint8_t* SegmentIndex::appendRecord(StTable& stTable) {
+    StHeader* pHeader = stTable.pHeader;
+    if (pHeader == nullptr || !m_bWrite) {
+        return nullptr;
+    }
+    if (pHeader->nEnd - pHeader->nBase >= pHeader->nCapacity) {
+        uint64_t nValid = pHeader->nEnd - pHeader->nFirst;
+        if (nValid * 2 <= pHeader->nCapacity) {
+            // 一半以上是已删除的记录，整体前移
+            dropFirst(stTable, 0);
+        } else {
+            uint64_t nCapacity = pHeader->nCapacity * 2;
+            if (ftruncate(stTable.nFd, sizeof(StHeader) + nCapacity * pHeader->nRecordSize) < 0 || !remapTable(stTable)) {
+                ff_error("segment index: failed to grow: %s\n", strerror(errno));
+                return nullptr;
+            }
+            stTable.pHeader->nCapacity = nCapacity;
+        }
+    }
+    return record(stTable, stTable.pHeader->nEnd);
+}
+
+void SegmentIndex::commitRecord(StTable& stTable) {
+    // 记录写完后再更新nEnd，读取方不会看到半条记录
+    __atomic_store_n(&stTable.pHeader->nEnd, stTable.pHeader->nEnd + 1, __ATOMIC_RELEASE);
+}
+
+// 逻辑删除前nCount条记录，已删除的超过一半时把剩余记录移到开头
+void SegmentIndex::dropFirst(StTable& stTable, uint64_t nCount) {
+    StHeader* pHeader = stTable.pHeader;
+    __atomic_store_n(&pHeader->nFirst, pHeader->nFirst + nCount, __ATOMIC_RELEASE);
+    uint64_t nDropped = pHeader->nFirst - pHeader->nBase;
+    if (nDropped == 0 || nDropped * 2 < pHeader->nCapacity) {
+        return;
+    }
+    __atomic_store_n(&pHeader->nGeneration, pHeader->nGeneration + 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint8_t* pRecords = (uint8_t*)pHeader + sizeof(StHeader);
+    memmove(pRecords, pRecords + nDropped * pHeader->nRecordSize, (pHeader->nEnd - pHeader->nFirst) * pHeader->nRecordSize);
+    pHeader->nBase = pHeader->nFirst;
+    __atomic_store_n(&pHeader->nGeneration, pHeader->nGeneration + 1, __ATOMIC_RELEASE);
+}
+
+void SegmentIndex::setStreamInfo(uint32_t nWidth, uint32_t nHeight, uint32_t nFmt) {
+    if (m_stKeys.pHeader == nullptr || !m_bWrite) {
+        return;
+    }
+    m_stKeys.pHeader->nWidth = nWidth;
+    m_stKeys.pHeader->nHeight = nHeight;
+    m_stKeys.pHeader->nFmt = nFmt;
+}
+
+uint32_t SegmentIndex::addSegment(const std::string& sPath) {
+    uint8_t* pRecord = appendRecord(m_stSegments);
+    if (pRecord == nullptr) {
+        return 0;
+    }
+    // 分段id即逻辑位置加1，连续且不重复
+    uint32_t nSegId = (uint32_t)m_stSegments.pHeader->nEnd + 1;
+    StSegmentRecord* pSegment = (StSegmentRecord*)pRecord;
+    memset(pSegment, 0, sizeof(StSegmentRecord));
+    pSegment->nSegId = nSegId;
+    size_t nSlash = sPath.rfind('/');
+    std::string sName = nSlash == std::string::npos ? sPath : sPath.substr(nSlash + 1);
+    strncpy(pSegment->szName, sName.c_str(), sizeof(pSegment->szName) - 1);
+    commitRecord(m_stSegments);
+    return nSegId;
+}
+
+int SegmentIndex::addKeyFrame(uint32_t nSegId, int64_t nWallUs, int64_t nPts, uint64_t nOffset) {
+    StHeader* pHeader = m_stKeys.pHeader;
+    if (pHeader == nullptr) {
+        return -1;
+    }
+    // 保证按时间有序，墙上时间回退时沿用上一条的时间
+    if (pHeader->nEnd > pHeader->nFirst) {
+        int64_t nLast = ((StKeyFrame*)record(m_stKeys, pHeader->nEnd - 1))->nWallUs;
+        nWallUs = nWallUs < nLast ? nLast : nWallUs;
+    }
+    StKeyFrame* pKey = (StKeyFrame*)appendRecord(m_stKeys);
+    if (pKey == nullptr) {
+        return -1;
+    }
+    pKey->nWallUs = nWallUs;
+    pKey->nPts = nPts;
+    pKey->nSegId = nSegId;
+    pKey->nFlags = 0;
+    pKey->nOffset = nOffset;
+    commitRecord(m_stKeys);
+    return 0;
+}
+
+void SegmentIndex::removeSegment(const std::string& sPath) {
+    StHeader* pSegHeader = m_stSegments.pHeader;
+    if (pSegHeader == nullptr || !m_bWrite || pSegHeader->nEnd == pSegHeader->nFirst) {
+        return;
+    }
+    size_t nSlash = sPath.rfind('/');
+    std::string sName = nSlash == std::string::npos ? sPath : sPath.substr(nSlash + 1);
+    // 表头可能有文件已不存在的分段(如被外部删除)，一并删到匹配的分段为止，找不到时不处理
+    uint64_t nSegments = 0;
+    uint32_t nSegId = 0;
+    for (uint64_t i = pSegHeader->nFirst; i < pSegHeader->nEnd; ++i) {
+        StSegmentRecord* pSegment = (StSegmentRecord*)record(m_stSegments, i);
+        if (sName == pSegment->szName) {
+            nSegments = i - pSegHeader->nFirst + 1;
+            nSegId = pSegment->nSegId;
+            break;
+        }
+    }
+    if (nSegments == 0) {
+        return;
+    }
+
+    StHeader* pKeyHeader = m_stKeys.pHeader;
+    uint64_t nCount = 0;
+    while (pKeyHeader->nFirst + nCount < pKeyHeader->nEnd
+           && ((StKeyFrame*)record(m_stKeys, pKeyHeader->nFirst + nCount))->nSegId <= nSegId) {
+        nCount++;
+    }
+    dropFirst(m_stKeys, nCount);
+    dropFirst(m_stSegments, nSegments);
+}
+
+void SegmentIndex::sync() {
+    if (m_stKeys.pHeader != nullptr) {
+        msync(m_stKeys.pHeader, m_stKeys.nMapSize, MS_ASYNC);
+    }
+    if (m_stSegments.pHeader != nullptr) {
+        msync(m_stSegments.pHeader, m_stSegments.nMapSize, MS_ASYNC);
+    }
+}
+
+// ---- 读取 ----
+
+void SegmentIndex::getStreamInfo(uint32_t& nWidth, uint32_t& nHeight, uint32_t& nFmt) {
+    nWidth = nHeight = nFmt = 0;
+    if (m_stKeys.pHeader != nullptr) {
+        nWidth = m_stKeys.pHeader->nWidth;
+        nHeight = m_stKeys.pHeader->nHeight;
+        nFmt = m_stKeys.pHeader->nFmt;
+    }
+}
+
+void SegmentIndex::getRange(uint64_t& nFirst, uint64_t& nEnd) {
+    nFirst = nEnd = 0;
+    if (m_stKeys.pHeader != nullptr) {
+        nFirst = __atomic_load_n(&m_stKeys.pHeader->nFirst, __ATOMIC_ACQUIRE);
+        nEnd = __atomic_load_n(&m_stKeys.pHeader->nEnd, __ATOMIC_ACQUIRE);
+    }
+}
+
+bool SegmentIndex::getKeyFrame(uint64_t nPos, StKeyFrame& stKey) {
+    return readConsistent(m_stKeys, [&]() {
+        StHeader* pHeader = m_stKeys.pHeader;
+        if (nPos < __atomic_load_n(&pHeader->nFirst, __ATOMIC_ACQUIRE) || nPos >= __atomic_load_n(&pHeader->nEnd, __ATOMIC_ACQUIRE)) {
+            return false;
+        }
+        uint8_t* pRecord = record(m_stKeys, nPos);
+        if (pRecord == nullptr) {
+            return false;
+        }
+        memcpy(&stKey, pRecord, sizeof(StKeyFrame));
+        return true;
+    });
+}
+
+int64_t SegmentIndex::findKeyFrame(int64_t nWallUs) {
+    int64_t nFound = -1;
+    readConsistent(m_stKeys, [&]() {
+        StHeader* pHeader = m_stKeys.pHeader;
+        uint64_t nFirst = __atomic_load_n(&pHeader->nFirst, __ATOMIC_ACQUIRE);
+        uint64_t nEnd = __atomic_load_n(&pHeader->nEnd, __ATOMIC_ACQUIRE);
+        if (nFirst == nEnd || record(m_stKeys, nEnd - 1) == nullptr) {
+            return false;
+        }
+        // 第一个晚于nWallUs的位置
+        uint64_t nLow = nFirst;
+        uint64_t nHigh = nEnd;
+        while (nLow < nHigh) {
+            uint64_t nMid = nLow + (nHigh - nLow) / 2;
+            if (((StKeyFrame*)record(m_stKeys, nMid))->nWallUs <= nWallUs) {
+                nLow = nMid + 1;
+            } else {
+                nHigh = nMid;
+            }
+        }
+        nFound = nLow > nFirst ? (int64_t)nLow - 1 : (int64_t)nFirst;
+        return true;
+    });
+    return nFound;
+}
+
+std::string SegmentIndex::getSegmentPath(uint32_t nSegId) {
+    std::string sPath;
+    readConsistent(m_stSegments, [&]() {
+        StHeader* pHeader = m_stSegments.pHeader;
+        uint64_t nFirst = __atomic_load_n(&pHeader->nFirst, __ATOMIC_ACQUIRE);
+        uint64_t nEnd = __atomic_load_n(&pHeader->nEnd, __ATOMIC_ACQUIRE);
+        if (nFirst == nEnd) {
+            return false;
+        }
+        // 分段id连续递增，直接计算位置
+        StSegmentRecord* pFirst = (StSegmentRecord*)record(m_stSegments, nFirst);
+        if (pFirst == nullptr || nSegId < pFirst->nSegId || nSegId - pFirst->nSegId >= nEnd - nFirst) {
+            return false;
+        }
+        StSegmentRecord* pSegment = (StSegmentRecord*)record(m_stSegments, nFirst + (nSegId - pFirst->nSegId));
+        if (pSegment == nullptr || pSegment->nSegId != nSegId) {
+            return false;
+        }
+        sPath = m_sDir + "/" + pSegment->szName;
+        return true;
+    });
+    return sPath;
+}
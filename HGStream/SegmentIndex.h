@@ -0,0 +1,100 @@
+#ifndef SEGMENTINDEX_H
+#define SEGMENTINDEX_H
+
+#include <stdint.h>
+#include <string>
+
+// 分段录像索引，每路一个，由ModuleSegmentRecorder维护，放在录像目录下：
+//   <prefix>.idx  关键帧表，按时间排序的{墙上时间, pts, 分段id, 文件内偏移}
+//   <prefix>.seg  分段表，{分段id, 文件名}
+// 两个文件都用mmap访问，写入只追加，过期分段从表头逻辑删除，表头积累过多时整体前移。
+// 读取方(可以在其他进程)用二分查找把时间映射到关键帧，O(log n)，不需要打开任何录像文件。
+// 位置为逻辑序号，前移后不变；前移期间读取方通过代数号重试。
+class SegmentIndex {
+public:
+    struct StKeyFrame {
+        int64_t nWallUs;
+        int64_t nPts;
+        uint32_t nSegId;
+        uint32_t nFlags;
+        uint64_t nOffset;
+    };
+
+public:
+    SegmentIndex();
+    ~SegmentIndex();
+
+    // bWrite为true时不存在则创建
+    int open(const std::string& sDir, const std::string& sPrefix, bool bWrite);
+    void close();
+    bool isOpen() const { return m_stKeys.pHeader != nullptr; }
+
+    // ---- 写入，只在一个线程中调用 ----
+    // 记录码流参数，供读取方创建解码器
+    void setStreamInfo(uint32_t nWidth, uint32_t nHeight, uint32_t nFmt);
+    // 新分段，sPath为完整路径，只记录文件名，返回分段id
+    uint32_t addSegment(const std::string& sPath);
+    int addKeyFrame(uint32_t nSegId, int64_t nWallUs, int64_t nPts, uint64_t nOffset);
+    // 删除最旧的分段及其关键帧，表头到sPath之间的分段一并删除，索引中没有sPath时不处理
+    void removeSegment(const std::string& sPath);
+    void sync();
+
+    // ---- 读取 ----
+    void getStreamInfo(uint32_t& nWidth, uint32_t& nHeight, uint32_t& nFmt);
+    // 有效关键帧的逻辑位置范围[nFirst, nEnd)
+    void getRange(uint64_t& nFirst, uint64_t& nEnd);
+    bool getKeyFrame(uint64_t nPos, StKeyFrame& stKey);
+    // 不晚于nWallUs的最后一个关键帧位置，早于全部时返回第一个，为空返回-1
+    int64_t findKeyFrame(int64_t nWallUs);
+    // 分段的完整路径，已删除返回空
+    std::string getSegmentPath(uint32_t nSegId);
+
+private:
+    struct StHeader {
+        char szMagic[8];
+        uint32_t nVersion;
+        uint32_t nRecordSize;
+        // 前移时为奇数
+        uint32_t nGeneration;
+        uint32_t nWidth;
+        uint32_t nHeight;
+        uint32_t nFmt;
+        // 逻辑位置：有效记录为[nFirst, nEnd)，物理第0条记录为nBase
+        uint64_t nFirst;
+        uint64_t nEnd;
+        uint64_t nBase;
+        uint64_t nCapacity;
+    };
+
+    struct StTable {
+        int nFd;
+        StHeader* pHeader;
+        size_t nMapSize;
+    };
+
+    struct StSegmentRecord {
+        uint32_t nSegId;
+        uint32_t nReserved;
+        char szName[120];
+    };
+
+    int openTable(StTable& stTable, const std::string& sPath, uint32_t nRecordSize, bool bWrite);
+    void closeTable(StTable& stTable);
+    // 读取方发现写入方扩容后重新映射
+    bool remapTable(StTable& stTable);
+    uint8_t* record(StTable& stTable, uint64_t nPos);
+    uint8_t* appendRecord(StTable& stTable);
+    void commitRecord(StTable& stTable);
+    void dropFirst(StTable& stTable, uint64_t nCount);
+
+    template <typename Func>
+    bool readConsistent(StTable& stTable, Func func);
+
+private:
+    std::string m_sDir;
+    bool m_bWrite = false;
+    StTable m_stKeys = {-1, nullptr, 0};
+    StTable m_stSegments = {-1, nullptr, 0};
+};
+
+#endif // SEGMENTINDEX_H
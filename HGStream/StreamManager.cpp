@@ -8,6 +8,11 @@
 const char *pVersion = "version 1.0.1";
 
 #define ALIGN(x, a) (((x) + (a)-1) & ~((a)-1))
+// 内存预算中拉流、推流会话的名称
+#define PULL_SESSION "pull"
+#define PUSH_SESSION "push"
+#define PUSH_RGA_BUFFERS 2
+#define PUSH_ENC_BUFFERS 8
 
 void funCallback(void* pStCb, std::shared_ptr<MediaBuffer> pBuffer) {
     if (pBuffer == nullptr || pBuffer->getMediaBufferType() != BUFFER_TYPE_VIDEO) {
@@ -20,7 +25,9 @@ void funCallback(void* pStCb, std::shared_ptr<MediaBuffer> pBuffer) {
 
     void* pFrame = pFrameBuf->getActiveData();
     size_t size = pFrameBuf->getActiveSize();
-    pFrameBuf->invalidateDrmBuf();
+    // 只无效化有效数据，池中的缓冲区按档位申请，比一帧大
+    CpuAccess::beginRead(pFrameBuf.get(), (uint8_t*)pFrame - (uint8_t*)pFrameBuf->getData(), size);
+    pManager->ProbeFrame(pBuffer);
     uint32_t nWidth = pFrameBuf->getImagePara().hstride;
     uint32_t nHeight = pFrameBuf->getImagePara().vstride;
 
@@ -38,6 +45,9 @@ StreamManager::StreamManager() {
     for (int i = 0; i < MAXQUEUESIZE; ++i) {
         m_pFrameList[i] = new Frame();
     }
+    m_pOsd = std::make_shared<TracedModule<PlacedModule<ModuleOsd>>>();
+    m_pGopCache = std::make_shared<TracedModule<PlacedModule<ModuleGopCache>>>();
+    initCpuPolicy();
 }
 // 释放资源
 StreamManager::~StreamManager() {
@@ -69,7 +79,7 @@ void StreamManager::AddFrame(unsigned char* pChar, int nWidth, int nHeight, int
 // 拉流初始化
 void* StreamManager::HG_GetRtspClient(const char* pUri, int rtptype) {
     if (strncmp(pUri, "rtsp", strlen("rtsp")) == 0) {
-        m_pRtspClient = make_shared<ModuleRtspClient>(pUri, (rtptype == 0 ? RTSP_STREAM_TYPE_UDP : RTSP_STREAM_TYPE_TCP), true, false);
+        m_pRtspClient = make_shared<TracedModule<PlacedModule<ModuleRtspClient>>>(pUri, (rtptype == 0 ? RTSP_STREAM_TYPE_UDP : RTSP_STREAM_TYPE_TCP), true, false);
         m_pRtspClient->setProductor(nullptr);
         // m_pRtspClient->setBufferCount(20);
         ret = m_pRtspClient->init();
@@ -81,21 +91,89 @@ void* StreamManager::HG_GetRtspClient(const char* pUri, int rtptype) {
         
     }
 
-    ImagePara stInputImagePara = m_pRtspClient->getOutputImagePara();
+    if (initPullChain(m_pRtspClient) < 0) {
+        return nullptr;
+    }
+    startPipe(m_pRtspClient);
+
+    return nullptr;
+}
+
+void* StreamManager::HG_GetRecordClient(const char* pDir, const long long nStartMs) {
+    m_pRecordReader = make_shared<TracedModule<PlacedModule<ModuleRecordReader>>>(pDir != nullptr ? pDir : "");
+    ret = m_pRecordReader->init();
+    if (ret < 0) {
+        ff_error("Failed to init record reader\n");
+        m_pRecordReader = nullptr;
+        return nullptr;
+    }
+    if (nStartMs > 0) {
+        m_pRecordReader->seek(nStartMs);
+    }
+    if (initPullChain(m_pRecordReader) < 0) {
+        m_pRecordReader = nullptr;
+        return nullptr;
+    }
+    startPipe(m_pRecordReader);
+    return m_pRecordReader.get();
+}
+
+bool StreamManager::HG_SeekRecord(void* pHandle, const long long nWallMs) {
+    if (m_pRecordReader == nullptr || pHandle != m_pRecordReader.get()) {
+        return false;
+    }
+    // ModuleMppDec没有清空接口，跳转前的参考帧和待输出帧会混在新位置之前，停止后重建解码和RGA，
+    // 重新初始化解码器约几十毫秒，期间没有输出
+    m_pRecordReader->stop();
+    {
+        std::lock_guard<std::mutex> locker(m_quMutex);
+        std::queue<Frame*>().swap(m_quFrames);
+    }
+    delete m_pcallback;
+    m_pcallback = nullptr;
+    if (m_pRecordReader->init() < 0 || m_pRecordReader->seek(nWallMs) < 0 || initPullChain(m_pRecordReader) < 0) {
+        // 保留已停止的回放对象，由HG_CloseClient释放
+        ff_error("Failed to restart record reader after seek\n");
+        return false;
+    }
+    startPipe(m_pRecordReader);
+    return true;
+}
+
+bool StreamManager::HG_SetRecordSpeed(void* pHandle, const int nSpeed) {
+    if (m_pRecordReader == nullptr || pHandle != m_pRecordReader.get()) {
+        return false;
+    }
+    m_pRecordReader->setSpeed(nSpeed);
+    return true;
+}
+
+// 拉流数据源之后接解码和RGA，输出BGR到帧队列
+int StreamManager::initPullChain(std::shared_ptr<ModuleMedia> pSource) {
+    ImagePara stInputImagePara = pSource->getOutputImagePara();
 
     if ((stInputImagePara.v4l2Fmt == V4L2_PIX_FMT_MJPEG) || 
         (stInputImagePara.v4l2Fmt == V4L2_PIX_FMT_H264) || 
         (stInputImagePara.v4l2Fmt == V4L2_PIX_FMT_HEVC)) {
-            m_pMppDec = make_shared<ModuleMppDec>(stInputImagePara);
-            m_pMppDec->setProductor(m_pRtspClient);
+            m_pMppDec = make_shared<TracedModule<PlacedModule<ModuleMppDec>>>(stInputImagePara);
+            m_pMppDec->setProductor(pSource);
             // m_pMppDec->setBufferCount(10);
+            // 解码参考帧不能少，只估算不降级
+            std::vector<AdmissionControl::StStage> vStages = {
+                {"decoder", AdmissionControl::decodedPara(stInputImagePara), m_pMppDec->getBufferCount(),
+                 m_pMppDec->getBufferCount(), false}};
+            AdmissionControl::getInstance()->release(PULL_SESSION);
+            if (AdmissionControl::getInstance()->admit(PULL_SESSION, vStages) < 0) {
+                return -1;
+            }
             ret = m_pMppDec->init();
             if (ret < 0) {
                 ff_error("Failed to init MppDec\n");
-                return nullptr;
+                AdmissionControl::getInstance()->release(PULL_SESSION);
+                return -1;
             }
         } else {
-            return nullptr;
+            return -1;
         }
 
     stInputImagePara = m_pMppDec->getOutputImagePara();
@@ -105,27 +183,48 @@ void* StreamManager::HG_GetRtspClient(const char* pUri, int rtptype) {
     stOutputImagePara.hstride = stOutputImagePara.width;
     stOutputImagePara.vstride = stOutputImagePara.height;
     stOutputImagePara.v4l2Fmt = V4L2_PIX_FMT_BGR24;
-    m_pRga = make_shared<ModuleRga>(stInputImagePara, stOutputImagePara, RGA_ROTATE_NONE);
-    m_pRga->setProductor(m_pMppDec);
+    m_pRga = make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(stInputImagePara, stOutputImagePara, RGA_ROTATE_NONE);
     // m_pRga->setBufferCount(2);
+    // 预算不够时先减RGA缓冲区，再缩小输出的BGR图像
+    std::vector<AdmissionControl::StStage> vStages = {
+        {"rga", stOutputImagePara, m_pRga->getBufferCount(), 2, true}};
+    if (AdmissionControl::getInstance()->admit(PULL_SESSION, vStages) < 0) {
+        AdmissionControl::getInstance()->release(PULL_SESSION);
+        return -1;
+    }
+    if (vStages[0].stPara.width != stOutputImagePara.width) {
+        m_pRga = make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(stInputImagePara, vStages[0].stPara, RGA_ROTATE_NONE);
+    }
+    m_pRga->setProductor(m_pMppDec);
+    m_pRga->setBufferCount(vStages[0].nBuffers);
     ret = m_pRga->init();
     if (ret < 0) {
         ff_error("rga init failed\n");
-        return nullptr;
+        AdmissionControl::getInstance()->release(PULL_SESSION);
+        return -1;
     }
 
     m_pcallback = new StCallback();
     m_pcallback->pManager = this;
     m_pRga->setOutputDataCallback(m_pcallback, funCallback);
-
-    m_pRtspClient->start();
-
-    return nullptr;
+    if (m_bSceneActivity) {
+        m_sceneActivity.attach(m_pMppDec, nullptr);
+    }
+    attachPullProbe(pSource);
+    return 0;
 }
 
 void StreamManager::HG_CloseClient(void* pHandle) {
-    m_pRtspClient->stop();
+    if (m_pRecordReader != nullptr && pHandle == m_pRecordReader.get()) {
+        m_pRecordReader->stop();
+        m_pRecordReader = nullptr;
+    } else if (m_pRtspClient != nullptr) {
+        m_pRtspClient->stop();
+        m_pRtspClient = nullptr;
+    }
+    AdmissionControl::getInstance()->release(PULL_SESSION);
     delete m_pcallback;
+    m_pcallback = nullptr;
 }
 
 Frame* StreamManager::HG_ReadFrame(void* pHandle) {
@@ -145,6 +244,19 @@ FrameInfo* StreamManager::HG_GetFrameInfo(void* pHandle) {
     return &info;
 }
 
+void StreamManager::HG_SetSceneActivity(const bool bEnable, const int nMinInterval, const int nMaxInterval) {
+    m_sceneActivity.setIntervalRange((uint32_t)std::max(nMinInterval, 0), (uint32_t)std::max(nMaxInterval, 0));
+    m_bSceneActivity = bEnable;
+}
+
+// 拉流只有一路，与HG_ReadFrame一样不区分句柄
+int StreamManager::HG_GetInferenceInterval(void* pHandle) {
+    if (!m_bSceneActivity) {
+        return 0;
+    }
+    return (int)m_sceneActivity.getInterval();
+}
+
 // ======================================
 
 bool StreamManager::HG_SetFrameInfo(const char* pPlayId, 
@@ -164,22 +276,47 @@ bool StreamManager::HG_SetFrameInfo(const char* pPlayId,
     printf("HG_SetFrameInfo\n");
 }
 
+// 推流链路：送数缓冲区(BGR32)、RGA输出、编码输出。预算不够时只减编码缓冲区，推流分辨率不变
+int StreamManager::admitPushChain(uint16_t& nRgaBuffers, uint16_t& nEncBuffers) {
+    ImagePara stBGRPara = m_stPushPara;
+    stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR32;
+    ImagePara stEncPara = m_stPushPara;
+    stEncPara.v4l2Fmt = V4L2_PIX_FMT_H264;
+    std::vector<AdmissionControl::StStage> vStages = {
+        {"input", stBGRPara, 1, 1, false},
+        {"rga", m_stPushPara, nRgaBuffers, nRgaBuffers, false},
+        {"encoder", stEncPara, nEncBuffers, 4, false}};
+    // 重建推流时替换上一次的估算
+    AdmissionControl::getInstance()->release(PUSH_SESSION);
+    if (AdmissionControl::getInstance()->admit(PUSH_SESSION, vStages) < 0) {
+        return -1;
+    }
+    nRgaBuffers = vStages[1].nBuffers;
+    nEncBuffers = vStages[2].nBuffers;
+    return 0;
+}
+
 bool StreamManager::HG_StartServer() {
     printf("HG_StartServer\n");
+    uint16_t nRgaBuffers = PUSH_RGA_BUFFERS;
+    uint16_t nEncBuffers = PUSH_ENC_BUFFERS;
+    if (admitPushChain(nRgaBuffers, nEncBuffers) < 0) {
+        return false;
+    }
     ImagePara stBGRPara = m_stPushPara;
     stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR32;
     // stBGRPara.v4l2Fmt = V4L2_PIX_FMT_NV12;
     // stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR24;
-    m_pVideoBuffer = std::make_shared<VideoBuffer>(VideoBuffer::DRM_BUFFER_CACHEABLE);
-    m_pVideoBuffer->allocBuffer(stBGRPara);
-    printf("buffer size %d\n", m_pVideoBuffer->getSize());
-    if (m_pVideoBuffer->getSize() <= 0) {
+    // 推流送数缓冲区从共享池取，重建推流时复用
+    m_pVideoBuffer = BufferPool::getInstance()->acquire(stBGRPara);
+    if (m_pVideoBuffer == nullptr) {
         ff_error("Failed to alloc buf\n");
         return false;
     }
+    printf("buffer size %d\n", m_pVideoBuffer->getSize());
     memset(m_pVideoBuffer->getData(), 0xff, m_pVideoBuffer->getSize());
 
-    m_pMemReader = std::make_shared<ModuleMemReader>(m_stPushPara);
+    m_pMemReader = std::make_shared<TracedModule<PlacedModule<ModuleMemReader>>>(m_stPushPara);
     ret = m_pMemReader->init();
     if (ret < 0) {
         ff_error("memory reader init failed\n");
@@ -187,28 +324,41 @@ bool StreamManager::HG_StartServer() {
     }
 
     // copy to rga
-    m_pRga = make_shared<ModuleRga>(m_stPushPara, RGA_ROTATE_NONE);
+    m_pRga = make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(m_stPushPara, RGA_ROTATE_NONE);
     m_pRga->setProductor(m_pMemReader);
-    m_pRga->setBufferCount(2);
+    m_pRga->setBufferCount(nRgaBuffers);
     m_pRga->setSrcBuffer(m_pVideoBuffer->getData());
+    attachOverlay();
     ret = m_pRga->init();
     if (ret < 0) {
         ff_error("Failed to init rga\n");
         return false;
     }
 
+    // 叠加检测框、时间
+    m_pOsd->setProductor(m_pRga);
+    m_pOsd->init();
+
     EncodeType eEncodeType = ENCODE_TYPE_H264;
-    m_pMppEnc = make_shared<ModuleMppEnc>(eEncodeType);
-    m_pMppEnc->setProductor(m_pRga);
-    m_pMppEnc->setBufferCount(8);
+    m_pMppEnc = make_shared<TracedModule<PlacedModule<ModuleMppEncEx>>>(eEncodeType);
+    m_pMppEnc->setProductor(m_pOsd);
+    m_pMppEnc->setBufferCount(nEncBuffers);
     ret = m_pMppEnc->init();
     if (ret < 0) {
         ff_error("Failed to init mppenc\n");
         return false;
     }
 
-    m_pRtspServer = make_shared<ModuleRtspServer>(m_sPushPath.c_str(), 8888);
-    m_pRtspServer->setProductor(m_pMppEnc);
+    m_pRtspServer = make_shared<TracedModule<PlacedModule<ModuleRtspServer>>>(m_sPushPath.c_str(), 8888);
+    setPushSink(PUSH_SINK_RTSP, 8888);
+    // 缓存最近的GOP，新订阅者无需等待关键帧
+    m_pGopCache->setProductor(m_pMppEnc);
+    m_pGopCache->init();
+    watchPushClients([]() { return ModuleGopCache::tcpClientCount(8888); });
+    attachRecorders();
+    attachPushProbe();
+
+    m_pRtspServer->setProductor(m_pGopCache);
     m_pRtspServer->setBufferCount(0);
     m_pRtspServer->init();
     if (ret < 0) {
@@ -216,17 +366,28 @@ bool StreamManager::HG_StartServer() {
         return false;
     }
 
-    m_pMemReader->start();
+    startPipe(m_pMemReader);
     return true;
 }
 
 bool StreamManager::HG_PutFrame(const char* playId, const unsigned char* pBuffer, const unsigned int size) {
-    m_pVideoBuffer->flushDrmBuf();
+    if (isPushIdle()) {
+        // 没有客户端，直接丢弃，不做拷贝、转换和编码
+        return true;
+    }
     void* pBuf = m_pVideoBuffer->getData();
-    memcpy((unsigned char*)pBuf, pBuffer, size);
+    {
+        // 拷贝完成后回写缓存，RGA才能读到新数据；只回写拷贝的部分
+        CpuAccess::StRange stRange = {0, size};
+        CpuAccess access(m_pVideoBuffer.get(), CpuAccess::WRITE, &stRange, 1);
+        memcpy((unsigned char*)pBuf, pBuffer, size);
+        m_latencyProbe.stamp((uint8_t*)pBuf, m_stPushPara.hstride * 3, 3, m_stPushPara.width, m_stPushPara.height);
+    }
     m_pRga->setSrcBuffer(pBuf);
 
-    ret = m_pMemReader->setInputBuffer(m_pVideoBuffer->getData(), m_pVideoBuffer->getSize(), m_pVideoBuffer->getBufFd());
+    int64_t nTraceStart = PipeTrace::isEnabled() ? PipeTrace::nowUs() : 0;
+    // 池中缓冲区按档位申请，可能比一帧大，只送一帧大小
+    ret = m_pMemReader->setInputBuffer(m_pVideoBuffer->getData(), m_pVideoBuffer->getActiveSize(), m_pVideoBuffer->getBufFd());
 
     if (ret != 0) {
         ff_error("Failed to set the input buf\n");
@@ -236,34 +397,86 @@ bool StreamManager::HG_PutFrame(const char* playId, const unsigned char* pBuffer
     if (ret != 0) {
         ff_warn("Wait timeout\n");
     }
+    if (nTraceStart > 0) {
+        // 送数到下游取走为止，超时的帧在跟踪中是一段2秒的长条
+        PipeTrace::record("HG_PutFrame", PipeTrace::CALL, nTraceStart, -1, -1, ret);
+    }
     return true;
 }
 
+// 切换推流服务端时释放另一种服务端，空闲判断不会再查询上一次会话已停止的服务端
+void StreamManager::setPushSink(PushSink eSink, int nPort) {
+    if (eSink != PUSH_SINK_RTSP) {
+        m_pRtspServer = nullptr;
+    }
+    if (eSink != PUSH_SINK_RTMP) {
+        m_pRtmpServer = nullptr;
+    }
+    m_ePushSink = eSink;
+    m_nPushPort = nPort;
+    m_bPushIdle = false;
+    m_bIdleRecheck = true;
+}
+
+// rtmp查询服务端的客户端数，rtsp统计推流端口上已建立的连接
+bool StreamManager::isPushIdle() {
+    if (!m_bIdleBypass || m_ePushSink == PUSH_SINK_NONE || m_pMppEnc == nullptr) {
+        return false;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (!m_bIdleRecheck.exchange(false) && now - m_lastIdlePoll < std::chrono::milliseconds(200)) {
+        return m_bPushIdle;
+    }
+    m_lastIdlePoll = now;
+    int nClients = m_ePushSink == PUSH_SINK_RTMP ? m_pRtmpServer->getCurClientCount()
+                                                 : ModuleGopCache::tcpClientCount(m_nPushPort);
+    bool bIdle = nClients == 0 && m_pGopCache->getSubscriberCount() == 0
+                 && m_pFileWriter == nullptr && m_pSegmentRecorder == nullptr;
+    if (bIdle && !m_bPushIdle) {
+        ff_info("push idle, pause encoding\n");
+        // 暂停后缓存的GOP已过期
+        m_pGopCache->dropCache();
+    } else if (!bIdle && m_bPushIdle) {
+        ff_info("push resumed\n");
+        m_pMppEnc->requestIdr();
+    }
+    m_bPushIdle = bIdle;
+    return m_bPushIdle;
+}
+
 void StreamManager::HG_StopSever() {
     if (m_pMemReader != nullptr) {
         m_pMemReader->setProcessStatus(ModuleMemReader::DATA_PROCESS_STATUS::PROCESS_STATUS_EXIT);
         m_pMemReader->stop();
         m_pMemReader = nullptr;
     }
+    detachPushChain();
+    setPushSink(PUSH_SINK_NONE, 0);
+    AdmissionControl::getInstance()->release(PUSH_SESSION);
 }
 
 // ======================================
 bool StreamManager::HG_CreateRtspSink(const char* pPlayId, int nPort) {
     m_sPushPath = std::string(pPlayId);
+    uint16_t nRgaBuffers = PUSH_RGA_BUFFERS;
+    uint16_t nEncBuffers = PUSH_ENC_BUFFERS;
+    if (admitPushChain(nRgaBuffers, nEncBuffers) < 0) {
+        return false;
+    }
     ImagePara stBGRPara = m_stPushPara;
     stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR32;
     // stBGRPara.v4l2Fmt = V4L2_PIX_FMT_NV12;
     // stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR24;
-    m_pVideoBuffer = std::make_shared<VideoBuffer>(VideoBuffer::DRM_BUFFER_CACHEABLE);
-    m_pVideoBuffer->allocBuffer(stBGRPara);
-    printf("buffer size %d\n", m_pVideoBuffer->getSize());
-    if (m_pVideoBuffer->getSize() <= 0) {
+    // 推流送数缓冲区从共享池取，重建推流时复用
+    m_pVideoBuffer = BufferPool::getInstance()->acquire(stBGRPara);
+    if (m_pVideoBuffer == nullptr) {
         ff_error("Failed to alloc buf\n");
         return false;
     }
+    printf("buffer size %d\n", m_pVideoBuffer->getSize());
     memset(m_pVideoBuffer->getData(), 0xff, m_pVideoBuffer->getSize());
 
-    m_pMemReader = std::make_shared<ModuleMemReader>(m_stPushPara);
+    m_pMemReader = std::make_shared<TracedModule<PlacedModule<ModuleMemReader>>>(m_stPushPara);
     ret = m_pMemReader->init();
     if (ret < 0) {
         ff_error("memory reader init failed\n");
@@ -271,28 +484,41 @@ bool StreamManager::HG_CreateRtspSink(const char* pPlayId, int nPort) {
     }
 
     // copy to rga
-    m_pRga = make_shared<ModuleRga>(m_stPushPara, RGA_ROTATE_NONE);
+    m_pRga = make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(m_stPushPara, RGA_ROTATE_NONE);
     m_pRga->setProductor(m_pMemReader);
-    m_pRga->setBufferCount(2);
+    m_pRga->setBufferCount(nRgaBuffers);
     m_pRga->setSrcBuffer(m_pVideoBuffer->getData());
+    attachOverlay();
     ret = m_pRga->init();
     if (ret < 0) {
         ff_error("Failed to init rga\n");
         return false;
     }
 
+    // 叠加检测框、时间
+    m_pOsd->setProductor(m_pRga);
+    m_pOsd->init();
+
     EncodeType eEncodeType = ENCODE_TYPE_H264;
-    m_pMppEnc = make_shared<ModuleMppEnc>(eEncodeType);
-    m_pMppEnc->setProductor(m_pRga);
-    m_pMppEnc->setBufferCount(8);
+    m_pMppEnc = make_shared<TracedModule<PlacedModule<ModuleMppEncEx>>>(eEncodeType);
+    m_pMppEnc->setProductor(m_pOsd);
+    m_pMppEnc->setBufferCount(nEncBuffers);
     ret = m_pMppEnc->init();
     if (ret < 0) {
         ff_error("Failed to init mppenc\n");
         return false;
     }
 
-    m_pRtspServer = make_shared<ModuleRtspServer>(m_sPushPath.c_str(), nPort);
-    m_pRtspServer->setProductor(m_pMppEnc);
+    m_pRtspServer = make_shared<TracedModule<PlacedModule<ModuleRtspServer>>>(m_sPushPath.c_str(), nPort);
+    setPushSink(PUSH_SINK_RTSP, nPort);
+    // 缓存最近的GOP，新订阅者无需等待关键帧
+    m_pGopCache->setProductor(m_pMppEnc);
+    m_pGopCache->init();
+    watchPushClients([nPort]() { return ModuleGopCache::tcpClientCount(nPort); });
+    attachRecorders();
+    attachPushProbe();
+
+    m_pRtspServer->setProductor(m_pGopCache);
     m_pRtspServer->setBufferCount(0);
     m_pRtspServer->init();
     if (ret < 0) {
@@ -300,26 +526,31 @@ bool StreamManager::HG_CreateRtspSink(const char* pPlayId, int nPort) {
         return false;
     }
 
-    m_pMemReader->start();
+    startPipe(m_pMemReader);
     return true;
 }
 
 void StreamManager::HG_CreateRtpSink(const char* pPeerURL) {
     printf("HG_CreateRtpSink\n");
+    uint16_t nRgaBuffers = PUSH_RGA_BUFFERS;
+    uint16_t nEncBuffers = PUSH_ENC_BUFFERS;
+    if (admitPushChain(nRgaBuffers, nEncBuffers) < 0) {
+        return;
+    }
     ImagePara stBGRPara = m_stPushPara;
     stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR32;
     // stBGRPara.v4l2Fmt = V4L2_PIX_FMT_NV12;
     // stBGRPara.v4l2Fmt = V4L2_PIX_FMT_BGR24;
-    m_pVideoBuffer = std::make_shared<VideoBuffer>(VideoBuffer::DRM_BUFFER_CACHEABLE);
-    m_pVideoBuffer->allocBuffer(stBGRPara);
-    printf("buffer size %d\n", m_pVideoBuffer->getSize());
-    if (m_pVideoBuffer->getSize() <= 0) {
+    // 推流送数缓冲区从共享池取，重建推流时复用
+    m_pVideoBuffer = BufferPool::getInstance()->acquire(stBGRPara);
+    if (m_pVideoBuffer == nullptr) {
         ff_error("Failed to alloc buf\n");
         return;
     }
+    printf("buffer size %d\n", m_pVideoBuffer->getSize());
     memset(m_pVideoBuffer->getData(), 0xff, m_pVideoBuffer->getSize());
 
-    m_pMemReader = std::make_shared<ModuleMemReader>(m_stPushPara);
+    m_pMemReader = std::make_shared<TracedModule<PlacedModule<ModuleMemReader>>>(m_stPushPara);
     ret = m_pMemReader->init();
     if (ret < 0) {
         ff_error("memory reader init failed\n");
@@ -327,36 +558,53 @@ void StreamManager::HG_CreateRtpSink(const char* pPeerURL) {
     }
 
     // copy to rga
-    m_pRga = make_shared<ModuleRga>(m_stPushPara, RGA_ROTATE_NONE);
+    m_pRga = make_shared<TracedModule<PlacedModule<PooledModule<ModuleRga>>>>(m_stPushPara, RGA_ROTATE_NONE);
     m_pRga->setProductor(m_pMemReader);
-    m_pRga->setBufferCount(2);
+    m_pRga->setBufferCount(nRgaBuffers);
     m_pRga->setSrcBuffer(m_pVideoBuffer->getData());
+    attachOverlay();
     ret = m_pRga->init();
     if (ret < 0) {
         ff_error("Failed to init rga\n");
         return ;
     }
 
+    // 叠加检测框、时间
+    m_pOsd->setProductor(m_pRga);
+    m_pOsd->init();
+
     EncodeType eEncodeType = ENCODE_TYPE_H264;
-    m_pMppEnc = make_shared<ModuleMppEnc>(eEncodeType);
-    m_pMppEnc->setProductor(m_pRga);
-    m_pMppEnc->setBufferCount(8);
+    m_pMppEnc = make_shared<TracedModule<PlacedModule<ModuleMppEncEx>>>(eEncodeType);
+    m_pMppEnc->setProductor(m_pOsd);
+    m_pMppEnc->setBufferCount(nEncBuffers);
     ret = m_pMppEnc->init();
     if (ret < 0) {
         ff_error("Failed to init mppenc\n");
         return ;
     }
 
-    m_pRtmpServer = make_shared<ModuleRtmpServer>(m_sPushPath.c_str(), 8888);
-    m_pRtmpServer->setProductor(m_pMppEnc);
+    m_pRtmpServer = make_shared<TracedModule<PlacedModule<ModuleRtmpServer>>>(m_sPushPath.c_str(), 8888);
+    setPushSink(PUSH_SINK_RTMP, 8888);
+    // 缓存最近的GOP，新订阅者无需等待关键帧
+    m_pGopCache->setProductor(m_pMppEnc);
+    m_pGopCache->init();
+    attachRecorders();
+    attachPushProbe();
+
+    m_pRtmpServer->setProductor(m_pGopCache);
     m_pRtmpServer->setBufferCount(0);
     m_pRtmpServer->init();
+    std::weak_ptr<ModuleRtmpServer> wpServer = m_pRtmpServer;
+    watchPushClients([wpServer]() {
+        auto pServer = wpServer.lock();
+        return pServer != nullptr ? pServer->getCurClientCount() : 0;
+    });
     if (ret < 0) {
         ff_error("Failed to init rtsp server\n");
         return ;
     }
 
-    m_pMemReader->start();
+    startPipe(m_pMemReader);
 }
 
 void StreamManager::HG_StopSink(const char* playId) {
@@ -365,8 +613,456 @@ void StreamManager::HG_StopSink(const char* playId) {
         m_pMemReader->stop();
         m_pMemReader = nullptr;
     }
+    detachPushChain();
+    setPushSink(PUSH_SINK_NONE, 0);
+    AdmissionControl::getInstance()->release(PUSH_SESSION);
+}
+
+void StreamManager::HG_SetOsdResult(const char* playId, const DetectResult* pResult) {
+    if (pResult == nullptr) {
+        return;
+    }
+    m_pOsd->setResult(*pResult);
+}
+
+void StreamManager::HG_SetOsdLabels(const char* playId, const char** ppLabels, const int nLabelNum) {
+    std::vector<std::string> vLabels;
+    for (int i = 0; ppLabels != nullptr && i < nLabelNum; ++i) {
+        vLabels.push_back(ppLabels[i] != nullptr ? ppLabels[i] : "");
+    }
+    m_pOsd->setLabels(vLabels);
+}
+
+void StreamManager::HG_SetOsdStyle(const char* playId, const int nThickness, const int nFontScale, const bool bShowTime) {
+    m_pOsd->setStyle(nThickness, nFontScale);
+    m_pOsd->setTimeEnable(bShowTime);
+}
+
+void StreamManager::HG_SetOsdBlend(const char* playId, const bool bEnable) {
+    m_bOsdBlend = bEnable;
+}
+
+// 混合模式下检测框画在ARGB叠加层上，由推流RGA合成；否则由ModuleOsd直接画在图像上
+void StreamManager::attachOverlay() {
+    if (!m_bOsdBlend) {
+        m_pOsd->setOverlay(nullptr);
+        return;
+    }
+    if (m_pOverlay == nullptr) {
+        m_pOverlay = std::make_shared<OverlayLayer>();
+    }
+    if (m_pOverlay->init(m_stPushPara.width, m_stPushPara.height) < 0 || m_pOverlay->attach(m_pRga) < 0) {
+        ff_error("Failed to init overlay, draw osd by cpu\n");
+        m_pOsd->setOverlay(nullptr);
+        return;
+    }
+    m_pOsd->setOverlay(m_pOverlay);
+}
+
+int StreamManager::HG_AddStreamSubscriber(const char* playId, HG_StreamCallback callback, void* pCtx) {
+    if (callback == nullptr) {
+        return -1;
+    }
+    // 暂停编码时立即恢复
+    m_bIdleRecheck = true;
+    // 没有可回放的GOP时请求关键帧，不必等满一个GOP
+    if (m_pGopCache->getCachedFrames() == 0) {
+        HG_RequestKeyFrame(playId);
+    }
+    return m_pGopCache->addSubscriber(pCtx, [callback](void* ctx, std::shared_ptr<MediaBuffer> pBuffer) {
+        const unsigned char* pData = (const unsigned char*)pBuffer->getActiveData();
+        size_t nSize = pBuffer->getActiveSize();
+        bool bHevc = pBuffer->getImagePara().v4l2Fmt == V4L2_PIX_FMT_HEVC;
+        callback(ctx, pData, nSize, pBuffer->getPUstimestamp(), NaluUtil::isKeyFrame(pData, nSize, bHevc) ? 1 : 0);
+    });
+}
+
+void StreamManager::HG_SetGopCache(const char* playId, const bool bEnable) {
+    m_pGopCache->setCacheEnable(bEnable);
+}
+
+void StreamManager::HG_RemoveStreamSubscriber(const char* playId, const int nId) {
+    m_pGopCache->removeSubscriber(nId);
+}
+
+void StreamManager::HG_RequestKeyFrame(const char* playId) {
+    if (m_pMppEnc != nullptr) {
+        m_pMppEnc->requestIdr();
+    }
+}
+
+void StreamManager::HG_SetIdleBypass(const char* playId, const bool bEnable) {
+    m_bIdleBypass = bEnable;
+    m_bIdleRecheck = true;
+}
+
+void StreamManager::HG_SetEventRecord(const char* playId, const char* pDir, const int nPreRollMs) {
+    m_sEventDir = pDir != nullptr ? pDir : "";
+    m_nPreRollMs = nPreRollMs;
+}
+
+bool StreamManager::HG_TriggerEventRecord(const char* playId, const char* pFileName, const int nPostMs) {
+    if (m_pEventRecorder == nullptr) {
+        ff_error("event record is not enabled\n");
+        return false;
+    }
+    std::string sFile;
+    if (pFileName != nullptr && pFileName[0] != '\0') {
+        sFile = pFileName;
+    } else {
+        char szName[64];
+        time_t now = time(nullptr);
+        strftime(szName, sizeof(szName), "/event_%Y%m%d_%H%M%S.ts", localtime(&now));
+        sFile = m_sEventDir + szName;
+    }
+    return m_pEventRecorder->trigger(sFile, nPostMs > 0 ? nPostMs : 0) == 0;
+}
+
+void StreamManager::HG_SetSegmentRecord(const char* playId, const char* pDir, const int nSegmentSec, const int nRetentionMB) {
+    m_sSegmentDir = pDir != nullptr ? pDir : "";
+    m_nSegmentSec = nSegmentSec;
+    m_nRetentionMB = nRetentionMB;
+}
+
+// 录像组件都接在编码器之后。事件录像持续缓存预录码流，分段录像持续写文件
+void StreamManager::attachRecorders() {
+    m_pSegmentRecorder = nullptr;
+    if (!m_sSegmentDir.empty()) {
+        auto pSegment = std::make_shared<TracedModule<PlacedModule<ModuleSegmentRecorder>>>(m_sSegmentDir);
+        pSegment->setSegmentLimit(m_nSegmentSec > 0 ? m_nSegmentSec : 60);
+        pSegment->setRetention((uint64_t)(m_nRetentionMB > 0 ? m_nRetentionMB : 0) << 20);
+        pSegment->setProductor(m_pMppEnc);
+        if (pSegment->init() < 0) {
+            ff_error("Failed to init segment recorder\n");
+            m_pMppEnc->removeConsumer(pSegment);
+        } else {
+            m_pSegmentRecorder = pSegment;
+        }
+    }
+
+    m_pEventRecorder = nullptr;
+    m_pFileWriter = nullptr;
+    if (m_sEventDir.empty() || m_nPreRollMs <= 0) {
+        return;
+    }
+    auto pRecorder = std::make_shared<TracedModule<PlacedModule<ModuleEventRecorder>>>(m_nPreRollMs);
+    pRecorder->setProductor(m_pMppEnc);
+    if (pRecorder->init() < 0) {
+        ff_error("Failed to init event recorder\n");
+        return;
+    }
+    auto pWriter = std::make_shared<TracedModule<PlacedModule<ModuleFileWriter>>>(m_sEventDir + "/event.ts");
+    pRecorder->setWriter(pWriter);
+    if (pWriter->init() < 0) {
+        ff_error("Failed to init event writer\n");
+        pRecorder->setWriter(nullptr);
+        m_pMppEnc->removeConsumer(pRecorder);
+        return;
+    }
+    m_pEventRecorder = pRecorder;
+    m_pFileWriter = pWriter;
 }
 
 float StreamManager::HG_GetVersion() {
     return 1.01;
-}
\ No newline at end of file
+}
+
+// 默认按big.LITTLE划分：网络收发和写盘放小核，解码、转换和编码放大核，各阶段都用普通调度(SCHED_OTHER)。
+// 同构的CPU不绑核
+void StreamManager::initCpuPolicy() {
+    std::vector<int> vBig, vLittle;
+    ThreadPlacement::detectClusters(vBig, vLittle);
+    for (int i = 0; i < CPU_STAGE_COUNT; ++i) {
+        m_stCpuPolicy[i] = {{}, SCHED_OTHER, 0};
+    }
+    if (vLittle.empty()) {
+        return;
+    }
+    m_stCpuPolicy[CPU_STAGE_CLIENT] = {vLittle, SCHED_OTHER, 0};
+    m_stCpuPolicy[CPU_STAGE_DECODER] = {vBig, SCHED_OTHER, 0};
+    // 实时调度需要CAP_SYS_NICE，默认只绑核，由HG_SetCpuPolicy开启
+    m_stCpuPolicy[CPU_STAGE_RGA] = {vBig, SCHED_OTHER, 0};
+    m_stCpuPolicy[CPU_STAGE_ENCODER] = {vBig, SCHED_OTHER, 0};
+    m_stCpuPolicy[CPU_STAGE_SERVER] = {vLittle, SCHED_OTHER, 0};
+}
+
+bool StreamManager::HG_SetCpuPolicy(const char* pStage, const char* pCores, const int nPolicy, const int nPriority) {
+    static const char* pNames[CPU_STAGE_COUNT] = {"client", "decoder", "rga", "encoder", "server"};
+    static const int nPolicies[] = {SCHED_OTHER, SCHED_FIFO, SCHED_RR};
+    if (pStage == nullptr || nPolicy < 0 || nPolicy > 2) {
+        return false;
+    }
+    ThreadPlacement::StPolicy stPolicy = {ThreadPlacement::parseCores(pCores != nullptr ? pCores : ""), nPolicies[nPolicy], nPriority};
+    bool bFound = false;
+    for (int i = 0; i < CPU_STAGE_COUNT; ++i) {
+        if (strcmp(pStage, "all") == 0 || strcmp(pStage, pNames[i]) == 0) {
+            m_stCpuPolicy[i] = stPolicy;
+            bFound = true;
+        }
+    }
+    if (!bFound) {
+        ff_error("unknown cpu stage %s\n", pStage);
+    }
+    return bFound;
+}
+
+void* StreamManager::HG_StartGraph(const char* pConfigPath) {
+    auto pGraph = std::make_shared<PipelineGraph>();
+    if (pConfigPath == nullptr || pGraph->loadFile(pConfigPath) < 0) {
+        ff_error("Failed to load graph %s\n", pConfigPath != nullptr ? pConfigPath : "");
+        return nullptr;
+    }
+    // 节点没有单独配置时按组件类型使用阶段策略
+    pGraph->start([this](ModuleMedia* pModule) -> const ThreadPlacement::StPolicy* {
+        int nStage = graphStage(pModule);
+        return nStage < 0 ? nullptr : &m_stCpuPolicy[nStage];
+    });
+    std::lock_guard<std::mutex> locker(m_graphMutex);
+    m_vGraphs.push_back(pGraph);
+    return pGraph.get();
+}
+
+void StreamManager::HG_StopGraph(void* pHandle) {
+    std::shared_ptr<PipelineGraph> pGraph;
+    {
+        std::lock_guard<std::mutex> locker(m_graphMutex);
+        for (auto it = m_vGraphs.begin(); it != m_vGraphs.end(); ++it) {
+            if (it->get() == pHandle) {
+                pGraph = *it;
+                m_vGraphs.erase(it);
+                break;
+            }
+        }
+    }
+    if (pGraph != nullptr) {
+        pGraph->stop();
+    }
+}
+
+void StreamManager::HG_SetBufferBudget(const long long nBytes) {
+    BufferPool::getInstance()->setBudget(nBytes > 0 ? (uint64_t)nBytes : 0);
+}
+
+bool StreamManager::HG_GetBufferStats(BufferStats* pStats) {
+    if (pStats == nullptr) {
+        return false;
+    }
+    BufferPool::StStats stStats = BufferPool::getInstance()->getStats();
+    pStats->budget = stStats.nBudget;
+    pStats->allocated = stStats.nAllocated;
+    pStats->inUse = stStats.nInUse;
+    pStats->idle = stStats.nIdle;
+    pStats->buffers = stStats.nBuffers;
+    pStats->hits = stStats.nHits;
+    pStats->misses = stStats.nMisses;
+    pStats->failures = stStats.nFailures;
+    return true;
+}
+
+void StreamManager::HG_TrimBufferPool() {
+    BufferPool::getInstance()->trim();
+}
+
+void StreamManager::HG_SetMemoryBudget(const long long nBytes, const bool bDegrade) {
+    AdmissionControl::getInstance()->setBudget(nBytes > 0 ? (uint64_t)nBytes : 0, bDegrade);
+}
+
+bool StreamManager::HG_GetMemoryStats(MemoryStats* pStats) {
+    if (pStats == nullptr) {
+        return false;
+    }
+    AdmissionControl::StStats stStats = AdmissionControl::getInstance()->getStats();
+    pStats->budget = stStats.nBudget;
+    pStats->reserved = stStats.nReserved;
+    pStats->headroom = stStats.nBudget == 0 ? -1 : (long long)stStats.nHeadroom;
+    pStats->sessions = stStats.nSessions;
+    pStats->admitted = stStats.nAdmitted;
+    pStats->degraded = stStats.nDegraded;
+    pStats->rejected = stStats.nRejected;
+    return true;
+}
+
+bool StreamManager::HG_GetSyncStats(SyncStats* pStats) {
+    if (pStats == nullptr) {
+        return false;
+    }
+    CpuAccess::StStats stStats = CpuAccess::getStats();
+    pStats->syncs = stStats.nSyncs;
+    pStats->partial = stStats.nPartial;
+    pStats->skipped = stStats.nSkipped;
+    pStats->bytes = stStats.nBytes;
+    pStats->timeUs = stStats.nTimeUs;
+    return true;
+}
+
+bool StreamManager::HG_SetHugePageArena(const long long nSlotBytes, const int nSlots) {
+    if (nSlotBytes < 0 || nSlots < 0) {
+        return false;
+    }
+    return HugePageArena::getInstance()->init(nSlotBytes, nSlots) == 0;
+}
+
+bool StreamManager::HG_GetHugePageStats(HugePageStats* pStats) {
+    if (pStats == nullptr) {
+        return false;
+    }
+    HugePageArena::StStats stStats = HugePageArena::getInstance()->getStats();
+    pStats->slotBytes = stStats.nSlotBytes;
+    pStats->slots = stStats.nSlots;
+    pStats->freeSlots = stStats.nFreeSlots;
+    pStats->hugeTlb = stStats.bHugeTlb;
+    pStats->allocs = stStats.nAllocs;
+    pStats->fallbacks = stStats.nFallbacks;
+    return true;
+}
+
+void* StreamManager::HG_AllocFrameBuffer(const long long nBytes) {
+    if (nBytes <= 0) {
+        return nullptr;
+    }
+    void* pData = HugePageArena::getInstance()->alloc(nBytes);
+    if (pData == nullptr && posix_memalign(&pData, 64, nBytes) != 0) {
+        ff_error("Failed to alloc frame buffer of %lld bytes\n", nBytes);
+        return nullptr;
+    }
+    return pData;
+}
+
+void StreamManager::HG_FreeFrameBuffer(void* pData) {
+    // 不在大页内存区的是posix_memalign申请的
+    if (pData != nullptr && !HugePageArena::getInstance()->free(pData)) {
+        free(pData);
+    }
+}
+
+void StreamManager::HG_SetLatencyProbe(const bool bEnable) {
+    m_latencyProbe.setEnable(bEnable);
+}
+
+bool StreamManager::HG_GetLatencyStats(LatencyStats* pStats) {
+    if (pStats == nullptr) {
+        return false;
+    }
+    LatencyProbe::StStats stStats = m_latencyProbe.getStats();
+    for (int i = 0; i < HG_LATENCY_STAGE_NUM && i < LatencyProbe::STAGE_NUM; ++i) {
+        const LatencyProbe::StStage& stStage = stStats.vStages[i];
+        LatencyStage& stOut = pStats->stages[i];
+        stOut.count = stStage.nCount;
+        stOut.avgMs = stStage.nCount > 0 ? stStage.nSumUs / 1000.0 / stStage.nCount : 0;
+        stOut.minMs = stStage.nMinUs / 1000.0;
+        stOut.maxMs = stStage.nMaxUs / 1000.0;
+        stOut.p50Ms = LatencyProbe::percentileMs(stStage, 0.5);
+        stOut.p99Ms = LatencyProbe::percentileMs(stStage, 0.99);
+        for (int j = 0; j < HG_LATENCY_BUCKET_NUM && j < LatencyProbe::BUCKET_NUM; ++j) {
+            stOut.buckets[j] = stStage.vBuckets[j];
+        }
+    }
+    pStats->stamped = stStats.nStamped;
+    pStats->measured = stStats.nMeasured;
+    pStats->missed = stStats.nMissed;
+    return true;
+}
+
+void StreamManager::HG_SetPipeTrace(const bool bEnable) {
+    PipeTrace::setEnable(bEnable);
+}
+
+int StreamManager::HG_DumpPipeTrace(const char* pPath) {
+    if (pPath == nullptr) {
+        return -1;
+    }
+    return PipeTrace::dump(pPath);
+}
+
+void StreamManager::ProbeFrame(std::shared_ptr<MediaBuffer> pBuffer) {
+    m_latencyProbe.onPullOutput(pBuffer);
+}
+
+// 服务端有新客户端时插入关键帧，服务端无法回放缓存的GOP，新客户端在下一帧即可解码
+void StreamManager::watchPushClients(ModuleGopCache::ClientCountProvider provider) {
+    std::weak_ptr<ModuleMppEncEx> wpEnc = m_pMppEnc;
+    m_pGopCache->setClientWatch(provider, [wpEnc]() {
+        auto pEnc = wpEnc.lock();
+        if (pEnc != nullptr) {
+            pEnc->requestIdr();
+        }
+    });
+}
+
+// m_pOsd(保留检测结果、标签和样式)和m_pGopCache(保留订阅者)跨推流会话复用，停止推流时摘掉本次会话的编码器、
+// 探针和服务端，否则下次startPipe会连带重启已停止的编码器和仍占着端口的服务端
+void StreamManager::detachPushChain() {
+    std::shared_ptr<ModuleMedia> vShared[] = {m_pOsd, m_pGopCache};
+    for (std::shared_ptr<ModuleMedia>& pModule : vShared) {
+        while (pModule->getConsumersCount() > 0) {
+            pModule->removeConsumer(pModule->getConsumer(0));
+        }
+    }
+    m_pProbeEncodeIn = nullptr;
+}
+
+// 探针开启时在OSD输出、编码输出上挂外部消费者，关闭时不挂，推流链路没有额外开销
+void StreamManager::attachPushProbe() {
+    if (m_pProbeEncodeIn != nullptr) {
+        m_pOsd->removeConsumer(m_pProbeEncodeIn);
+        m_pProbeEncodeIn = nullptr;
+    }
+    if (!m_latencyProbe.isEnabled()) {
+        return;
+    }
+    m_pProbeEncodeIn = m_pOsd->addExternalConsumer("LatencyEncodeIn", &m_latencyProbe, LatencyProbe::onEncodeInput);
+    m_pMppEnc->addExternalConsumer("LatencyEncodeOut", &m_latencyProbe, LatencyProbe::onEncodeOutput);
+}
+
+void StreamManager::attachPullProbe(std::shared_ptr<ModuleMedia> pSource) {
+    if (!m_latencyProbe.isEnabled()) {
+        return;
+    }
+    pSource->addExternalConsumer("LatencyReceive", &m_latencyProbe, LatencyProbe::onReceive);
+    m_pMppDec->addExternalConsumer("LatencyDecode", &m_latencyProbe, LatencyProbe::onDecodeOutput);
+}
+
+int StreamManager::cpuStage(ModuleMedia* pModule) {
+    if (pModule == nullptr) {
+        return -1;
+    }
+    if (pModule == m_pRtspClient.get() || pModule == m_pRecordReader.get()) {
+        return CPU_STAGE_CLIENT;
+    }
+    if (pModule == m_pMppDec.get()) {
+        return CPU_STAGE_DECODER;
+    }
+    if (pModule == m_pMemReader.get() || pModule == m_pRga.get() || pModule == m_pOsd.get()) {
+        return CPU_STAGE_RGA;
+    }
+    if (pModule == m_pMppEnc.get()) {
+        return CPU_STAGE_ENCODER;
+    }
+    if (pModule == m_pGopCache.get() || pModule == m_pRtspServer.get() || pModule == m_pRtmpServer.get() ||
+        pModule == m_pSegmentRecorder.get() || pModule == m_pEventRecorder.get() || pModule == m_pFileWriter.get()) {
+        return CPU_STAGE_SERVER;
+    }
+    return -1;
+}
+
+int StreamManager::graphStage(ModuleMedia* pModule) {
+    if (dynamic_cast<ModuleMppDec*>(pModule) != nullptr) {
+        return CPU_STAGE_DECODER;
+    }
+    if (dynamic_cast<ModuleRga*>(pModule) != nullptr) {
+        return CPU_STAGE_RGA;
+    }
+    if (dynamic_cast<ModuleMppEnc*>(pModule) != nullptr) {
+        return CPU_STAGE_ENCODER;
+    }
+    // 其余为数据源或推流/写文件
+    return pModule->getProductor() == nullptr ? CPU_STAGE_CLIENT : CPU_STAGE_SERVER;
+}
+
+// 启动整条管道，各组件的线程按所属阶段绑核
+void StreamManager::startPipe(std::shared_ptr<ModuleMedia> pSource) {
+    ThreadPlacement::startPipe(pSource, [this](ModuleMedia* pModule) -> const ThreadPlacement::StPolicy* {
+        int nStage = cpuStage(pModule);
+        return nStage < 0 ? nullptr : &m_stCpuPolicy[nStage];
+    });
+}
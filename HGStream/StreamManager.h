@@ -5,6 +5,7 @@
 #include <chrono>
 #include <queue>
 #include <mutex>
+#include <atomic>
 
 #include "module/vi/module_rtspClient.hpp"
 #include "module/vp/module_mppdec.hpp"
@@ -19,6 +20,22 @@
 #include "module/vi/module_fileReader.hpp"
 
 #include "libExportStream.h"
+#include "ModuleOsd.h"
+#include "ModuleGopCache.h"
+#include "ModuleMppEncEx.h"
+#include "ModuleEventRecorder.h"
+#include "ModuleSegmentRecorder.h"
+#include "ModuleRecordReader.h"
+#include "NaluUtil.h"
+#include "ThreadPlacement.h"
+#include "PipelineGraph.h"
+#include "AdmissionControl.h"
+#include "BufferPool.h"
+#include "CpuAccess.h"
+#include "HugePageArena.h"
+#include "LatencyProbe.h"
+#include "PipeTrace.h"
+#include "SceneActivity.h"
 
 namespace fs = std::experimental::filesystem;
 
@@ -35,6 +52,28 @@ struct StPushCallback {
 
 #define MAXQUEUESIZE 3
 
+// 绑核及调度策略按阶段配置
+enum CpuStage {
+    // 拉流/录像回放
+    CPU_STAGE_CLIENT = 0,
+    // 解码送数
+    CPU_STAGE_DECODER,
+    // 推流送数、RGA转换、OSD
+    CPU_STAGE_RGA,
+    // 编码
+    CPU_STAGE_ENCODER,
+    // 推流服务、GOP缓存、录像写盘
+    CPU_STAGE_SERVER,
+    CPU_STAGE_COUNT,
+};
+
+// 当前推流的服务端，决定空闲判断查询哪个服务端的客户端数
+enum PushSink {
+    PUSH_SINK_NONE = 0,
+    PUSH_SINK_RTSP,
+    PUSH_SINK_RTMP,
+};
+
 class StreamManager {
 public:
     static StreamManager *getInstance() {
@@ -50,6 +89,8 @@ public:
     void HG_CloseClient(void* pHandle);
     Frame* HG_ReadFrame(void* pHandle);
     FrameInfo* HG_GetFrameInfo(void* pHandle);
+    void HG_SetSceneActivity(const bool bEnable, const int nMinInterval, const int nMaxInterval);
+    int HG_GetInferenceInterval(void* pHandle);
 
     // ======================================
     bool HG_SetFrameInfo(const char* pPlayId, const int nWidth = 1920, const int nHeight = 1088,
@@ -64,8 +105,51 @@ public:
     void HG_CreateRtpSink(const char* pPeerURL);
     float HG_GetVersion();
 
+    // ======================================
+    void HG_SetOsdResult(const char* playId, const DetectResult* pResult);
+    void HG_SetOsdLabels(const char* playId, const char** ppLabels, const int nLabelNum);
+    void HG_SetOsdStyle(const char* playId, const int nThickness, const int nFontScale, const bool bShowTime);
+    void HG_SetOsdBlend(const char* playId, const bool bEnable);
+
+    // ======================================
+    int HG_AddStreamSubscriber(const char* playId, HG_StreamCallback callback, void* pCtx);
+    void HG_SetGopCache(const char* playId, const bool bEnable);
+    void HG_RemoveStreamSubscriber(const char* playId, const int nId);
+    void HG_RequestKeyFrame(const char* playId);
+    void HG_SetIdleBypass(const char* playId, const bool bEnable);
+    void HG_SetEventRecord(const char* playId, const char* pDir, const int nPreRollMs);
+    bool HG_TriggerEventRecord(const char* playId, const char* pFileName, const int nPostMs);
+    void HG_SetSegmentRecord(const char* playId, const char* pDir, const int nSegmentSec, const int nRetentionMB);
+    void* HG_GetRecordClient(const char* pDir, const long long nStartMs);
+    bool HG_SeekRecord(void* pHandle, const long long nWallMs);
+    bool HG_SetRecordSpeed(void* pHandle, const int nSpeed);
+
+    // ======================================
+    bool HG_SetCpuPolicy(const char* pStage, const char* pCores, const int nPolicy, const int nPriority);
+
+    // ======================================
+    void* HG_StartGraph(const char* pConfigPath);
+    void HG_StopGraph(void* pHandle);
+
+    // ======================================
+    void HG_SetBufferBudget(const long long nBytes);
+    bool HG_GetBufferStats(BufferStats* pStats);
+    void HG_TrimBufferPool();
+    void HG_SetMemoryBudget(const long long nBytes, const bool bDegrade);
+    bool HG_GetMemoryStats(MemoryStats* pStats);
+    bool HG_GetSyncStats(SyncStats* pStats);
+    bool HG_SetHugePageArena(const long long nSlotBytes, const int nSlots);
+    bool HG_GetHugePageStats(HugePageStats* pStats);
+    void* HG_AllocFrameBuffer(const long long nBytes);
+    void HG_FreeFrameBuffer(void* pData);
+    void HG_SetLatencyProbe(const bool bEnable);
+    bool HG_GetLatencyStats(LatencyStats* pStats);
+    void HG_SetPipeTrace(const bool bEnable);
+    int HG_DumpPipeTrace(const char* pPath);
+
     // ======================================
     void AddFrame(unsigned char* pChar, int nWidth, int nHeight, int size);
+    void ProbeFrame(std::shared_ptr<MediaBuffer> pBuffer);
 
 private:
     static StreamManager *m_pInstance;
@@ -76,6 +160,7 @@ private:
     // 拉流
     std::shared_ptr<ModuleRtspClient> m_pRtspClient = nullptr;
     std::shared_ptr<ModuleMppDec> m_pMppDec = nullptr;
+    std::shared_ptr<ModuleRecordReader> m_pRecordReader = nullptr;
     StCallback *m_pcallback = nullptr;
     StPushCallback *m_pstPushCallback = nullptr;
     ImagePara m_stInputPara;
@@ -89,9 +174,20 @@ private:
     // 推流
     std::shared_ptr<ModuleMemReader> m_pMemReader = nullptr;
     std::shared_ptr<ModuleRga> m_pRga = nullptr;
-    std::shared_ptr<ModuleMppEnc> m_pMppEnc = nullptr;
+    std::shared_ptr<ModuleOsd> m_pOsd = nullptr;
+    std::shared_ptr<OverlayLayer> m_pOverlay = nullptr;
+    bool m_bOsdBlend = false;
+    std::shared_ptr<ModuleMppEncEx> m_pMppEnc = nullptr;
+    std::shared_ptr<ModuleGopCache> m_pGopCache = nullptr;
     std::shared_ptr<ModuleRtspServer> m_pRtspServer = nullptr;
     std::shared_ptr<ModuleRtmpServer> m_pRtmpServer = nullptr;
+    PushSink m_ePushSink = PUSH_SINK_NONE;
+    int m_nPushPort = 0;
+    // 无人观看时跳过转换和编码
+    bool m_bIdleBypass = true;
+    bool m_bPushIdle = false;
+    std::atomic<bool> m_bIdleRecheck{true};
+    std::chrono::steady_clock::time_point m_lastIdlePoll;
     std::shared_ptr<VideoBuffer> m_pVideoBuffer = nullptr;
     std::string m_sPushPath = "/live/0";
     int m_nPort = 554;
@@ -99,7 +195,41 @@ private:
 
     // 
     std::shared_ptr<ModuleFileWriter> m_pFileWriter = nullptr;
+    // 事件录像
+    std::shared_ptr<ModuleEventRecorder> m_pEventRecorder = nullptr;
+    std::string m_sEventDir;
+    int m_nPreRollMs = 0;
+    // 分段录像
+    std::shared_ptr<ModuleSegmentRecorder> m_pSegmentRecorder = nullptr;
+    std::string m_sSegmentDir;
+    int m_nSegmentSec = 60;
+    int m_nRetentionMB = 0;
+    // 各阶段线程的绑核及调度策略，启动时设置
+    ThreadPlacement::StPolicy m_stCpuPolicy[CPU_STAGE_COUNT];
+    // 按配置文件搭建的管道
+    std::mutex m_graphMutex;
+    std::vector<std::shared_ptr<PipelineGraph>> m_vGraphs;
+    // 回环延迟探针，m_pOsd跨推流会话复用，它上面的外部消费者重建前或停止推流时移除
+    LatencyProbe m_latencyProbe;
+    std::shared_ptr<ModuleMedia> m_pProbeEncodeIn = nullptr;
+    // 拉流场景活跃度，挂在解码器上，解码器每次拉流重建
+    SceneActivity m_sceneActivity;
+    std::atomic<bool> m_bSceneActivity{false};
 
 private:
     StreamManager();
+    void attachOverlay();
+    bool isPushIdle();
+    void setPushSink(PushSink eSink, int nPort);
+    void attachRecorders();
+    void attachPushProbe();
+    void detachPushChain();
+    void watchPushClients(ModuleGopCache::ClientCountProvider provider);
+    void attachPullProbe(std::shared_ptr<ModuleMedia> pSource);
+    int initPullChain(std::shared_ptr<ModuleMedia> pSource);
+    int admitPushChain(uint16_t& nRgaBuffers, uint16_t& nEncBuffers);
+    void initCpuPolicy();
+    int cpuStage(ModuleMedia* pModule);
+    int graphStage(ModuleMedia* pModule);
+    void startPipe(std::shared_ptr<ModuleMedia> pSource);
 };
@@ -0,0 +1,138 @@
+#include "ThreadPlacement.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+
+long readCpuValue(int nCpu, const char* pName) {
+    std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(nCpu) + "/" + pName);
+    long nValue = 0;
+    if (!(file >> nValue)) {
+        return 0;
+    }
+    return nValue;
+}
+
+} // namespace
+
+void ThreadPlacement::startPipe(shared_ptr<ModuleMedia> pRoot, PolicyProvider fnPolicy) {
+    if (pRoot == nullptr) {
+        return;
+    }
+    startModule(pRoot, fnPolicy);
+}
+
+// ModuleMedia::start会递归启动未启动的消费者，先启动下游，保证每个组件启动前已拿到自己的策略
+void ThreadPlacement::startModule(shared_ptr<ModuleMedia> pModule, PolicyProvider& fnPolicy) {
+    for (uint16_t i = 0; i < pModule->getConsumersCount(); ++i) {
+        startModule(pModule->getConsumer(i), fnPolicy);
+    }
+    const StPolicy* pPolicy = fnPolicy ? fnPolicy(pModule.get()) : nullptr;
+    if (pPolicy != nullptr) {
+        PlacementTarget* pTarget = dynamic_cast<PlacementTarget*>(pModule.get());
+        if (pTarget != nullptr) {
+            pTarget->setPlacement(*pPolicy);
+        } else {
+            ff_warn("%s is not a PlacedModule, cpu policy ignored\n", pModule->getName());
+        }
+    }
+    pModule->start();
+}
+
+int ThreadPlacement::applySelf(const StPolicy& stPolicy) {
+    return apply((pid_t)syscall(SYS_gettid), stPolicy);
+}
+
+int ThreadPlacement::apply(pid_t nTid, const StPolicy& stPolicy) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (stPolicy.vCores.empty()) {
+        long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < nCpus && i < CPU_SETSIZE; ++i) {
+            CPU_SET(i, &set);
+        }
+    } else {
+        for (int nCpu : stPolicy.vCores) {
+            CPU_SET(nCpu, &set);
+        }
+    }
+    int nRet = 0;
+    if (sched_setaffinity(nTid, sizeof(set), &set) < 0) {
+        ff_warn("thread %d: set affinity failed: %s\n", nTid, strerror(errno));
+        nRet = -1;
+    }
+
+    struct sched_param stParam;
+    memset(&stParam, 0, sizeof(stParam));
+    bool bRealtime = stPolicy.nSched == SCHED_FIFO || stPolicy.nSched == SCHED_RR;
+    stParam.sched_priority = bRealtime ? std::min(std::max(stPolicy.nPriority, 1), 99) : 0;
+    if (sched_setscheduler(nTid, bRealtime ? stPolicy.nSched : SCHED_OTHER, &stParam) < 0) {
+        // 没有CAP_SYS_NICE时保留普通调度，绑核仍然有效
+        ff_warn("thread %d: set scheduler %d failed: %s\n", nTid, stPolicy.nSched, strerror(errno));
+        nRet = -1;
+    }
+    if (!bRealtime && stPolicy.nPriority != 0 && setpriority(PRIO_PROCESS, nTid, stPolicy.nPriority) < 0) {
+        ff_warn("thread %d: set nice %d failed: %s\n", nTid, stPolicy.nPriority, strerror(errno));
+        nRet = -1;
+    }
+    return nRet;
+}
+
+std::vector<int> ThreadPlacement::parseCores(const std::string& sCores) {
+    std::vector<int> vBig, vLittle;
+    if (sCores == "big" || sCores == "little") {
+        detectClusters(vBig, vLittle);
+        // 同构时都使用全部核
+        return sCores == "little" && !vLittle.empty() ? vLittle : vBig;
+    }
+    std::vector<int> vCores;
+    size_t nPos = 0;
+    while (nPos < sCores.size()) {
+        size_t nEnd = sCores.find(',', nPos);
+        if (nEnd == std::string::npos) {
+            nEnd = sCores.size();
+        }
+        std::string sItem = sCores.substr(nPos, nEnd - nPos);
+        size_t nDash = sItem.find('-');
+        int nFirst = atoi(sItem.c_str());
+        int nLast = nDash == std::string::npos ? nFirst : atoi(sItem.c_str() + nDash + 1);
+        for (int i = nFirst; i <= nLast && i < CPU_SETSIZE; ++i) {
+            if (i >= 0) {
+                vCores.push_back(i);
+            }
+        }
+        nPos = nEnd + 1;
+    }
+    return vCores;
+}
+
+void ThreadPlacement::detectClusters(std::vector<int>& vBig, std::vector<int>& vLittle) {
+    vBig.clear();
+    vLittle.clear();
+    long nCpus = sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<long> vCapacity;
+    for (long i = 0; i < nCpus; ++i) {
+        long nCapacity = readCpuValue(i, "cpu_capacity");
+        if (nCapacity == 0) {
+            nCapacity = readCpuValue(i, "cpufreq/cpuinfo_max_freq");
+        }
+        vCapacity.push_back(nCapacity);
+    }
+    long nMax = vCapacity.empty() ? 0 : *std::max_element(vCapacity.begin(), vCapacity.end());
+    // RK3588的A76集群之间频率略有差别，按最大值的80%划分
+    for (long i = 0; i < nCpus; ++i) {
+        if (nMax == 0 || vCapacity[i] * 5 >= nMax * 4) {
+            vBig.push_back(i);
+        } else {
+            vLittle.push_back(i);
+        }
+    }
+}
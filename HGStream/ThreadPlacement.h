@@ -0,0 +1,83 @@
+#ifndef THREADPLACEMENT_H
+#define THREADPLACEMENT_H
+
+#include <sched.h>
+#include <sys/types.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "module/module_media.hpp"
+
+// 组件工作线程的绑核及调度策略。组件线程由ModuleMedia::start创建，线程开始时先调用setup()，
+// 用PlacedModule<T>包装的组件在setup()中对本线程设置，之后该线程创建的线程(如mpp内部线程、录像IO线程)继承同样的设置。
+// startPipe按消费者优先的顺序逐个启动整条管道，启动前把策略交给组件；未包装的组件不设置。
+// 用法：
+//   auto pEnc = make_shared<PlacedModule<ModuleMppEncEx>>(ENCODE_TYPE_H264);
+//   ThreadPlacement::StPolicy stPolicy = {ThreadPlacement::parseCores("4-7"), SCHED_OTHER, 0};
+//   ThreadPlacement::startPipe(pSource, [&](ModuleMedia* pModule) { return pModule == pEnc.get() ? &stPolicy : nullptr; });
+class ThreadPlacement {
+public:
+    struct StPolicy {
+        // 为空时不限制
+        std::vector<int> vCores;
+        // SCHED_OTHER/SCHED_FIFO/SCHED_RR
+        int nSched;
+        // 实时策略为优先级(1-99)，SCHED_OTHER为nice值
+        int nPriority;
+    };
+
+    typedef std::function<const StPolicy*(ModuleMedia*)> PolicyProvider;
+
+public:
+    // 启动pRoot及其下游全部组件，fnPolicy返回nullptr的组件不设置
+    static void startPipe(shared_ptr<ModuleMedia> pRoot, PolicyProvider fnPolicy);
+    static int apply(pid_t nTid, const StPolicy& stPolicy);
+    // 设置调用线程
+    static int applySelf(const StPolicy& stPolicy);
+    // "0-3,6"格式，"big"/"little"取对应集群
+    static std::vector<int> parseCores(const std::string& sCores);
+    // 按cpu_capacity(没有时按最高频率)划分大小核，同构时vLittle为空
+    static void detectClusters(std::vector<int>& vBig, std::vector<int>& vLittle);
+
+private:
+    static void startModule(shared_ptr<ModuleMedia> pModule, PolicyProvider& fnPolicy);
+};
+
+// 可在自己的工作线程中设置策略的组件，由PlacedModule<T>实现
+class PlacementTarget {
+public:
+    virtual ~PlacementTarget() {}
+    // 在start之前调用
+    void setPlacement(const ThreadPlacement::StPolicy& stPolicy) {
+        m_stPlacement = stPolicy;
+        m_bPlacement = true;
+    }
+
+protected:
+    void applyPlacement() {
+        if (m_bPlacement) {
+            ThreadPlacement::applySelf(m_stPlacement);
+        }
+    }
+
+private:
+    ThreadPlacement::StPolicy m_stPlacement;
+    bool m_bPlacement = false;
+};
+
+// 在组件线程开始时(setup)设置绑核及调度策略
+template <typename T>
+class PlacedModule : public T, public PlacementTarget {
+public:
+    using T::T;
+
+protected:
+    bool setup() override {
+        applyPlacement();
+        return T::setup();
+    }
+};
+
+#endif // THREADPLACEMENT_H
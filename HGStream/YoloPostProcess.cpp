@@ -0,0 +1,634 @@
+#include "YoloPostProcess.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define HG_USE_NEON 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HG_USE_SSE2 1
+#endif
+
+#include "base/ff_log.h"
+
+namespace {
+
+// 录制张量文件头
+struct StTensorFileHeader {
+    char magic[4];
+    int32_t type;
+    int32_t fmt;
+    int32_t c;
+    int32_t h;
+    int32_t w;
+    int32_t zp;
+    float scale;
+};
+
+inline float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t mant = h & 0x3ff;
+    uint32_t f = 0;
+    if (exp == 0) {
+        if (mant == 0) {
+            f = sign;
+        } else {
+            // 非规格化数
+            exp = 127 - 15 + 1;
+            while ((mant & 0x400) == 0) {
+                mant <<= 1;
+                exp--;
+            }
+            mant &= 0x3ff;
+            f = sign | (exp << 23) | (mant << 13);
+        }
+    } else if (exp == 31) {
+        f = sign | 0x7f800000 | (mant << 13);
+    } else {
+        f = sign | ((exp + 112) << 23) | (mant << 13);
+    }
+    float v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+inline uint16_t floatToHalf(float v) {
+    uint32_t x;
+    memcpy(&x, &v, sizeof(x));
+    uint16_t sign = (x >> 16) & 0x8000;
+    int nExp = (int)((x >> 23) & 0xff);
+    uint32_t mant = x & 0x7fffff;
+    if (nExp == 0xff) {
+        return sign | 0x7c00 | (mant ? 0x200 : 0);
+    }
+    nExp = nExp - 127 + 15;
+    if (nExp >= 31) {
+        return sign | 0x7c00;
+    }
+    if (nExp <= 0) {
+        if (nExp < -10) {
+            return sign;
+        }
+        mant |= 0x800000;
+        return sign | (uint16_t)(mant >> (14 - nExp));
+    }
+    return sign | (uint16_t)(nExp << 10) | (uint16_t)(mant >> 13);
+}
+
+// fp16符号-幅值编码转为可直接按int16比较大小的key，该变换自逆
+inline int16_t halfKey(uint16_t h) {
+    return (int16_t)(h ^ ((uint16_t)((int16_t)h >> 15) & 0x7fff));
+}
+
+// 阈值转换为fp16 key，向下取整保证不漏检
+int16_t thresholdKey(float fThreshold) {
+    int16_t key = halfKey(floatToHalf(fThreshold));
+    while (key > INT16_MIN && halfToFloat((uint16_t)halfKey((uint16_t)key)) > fThreshold) {
+        key--;
+    }
+    return key;
+}
+
+// 阈值转换为int8量化值，向下取整保证不漏检
+int8_t thresholdInt8(float fThreshold, int zp, float scale) {
+    if (scale <= 0.f) {
+        scale = 1.f;
+    }
+    float q = floorf(fThreshold / scale + zp);
+    if (q < -128.f) {
+        return -128;
+    }
+    if (q > 127.f) {
+        return 127;
+    }
+    return (int8_t)q;
+}
+
+inline float sigmoid(float x) {
+    return 1.f / (1.f + expf(-x));
+}
+
+inline float logit(float p) {
+    p = std::min(std::max(p, 1e-6f), 1.f - 1e-6f);
+    return logf(p / (1.f - p));
+}
+
+inline int elemOffset(const TensorInfo& t, int c, int i) {
+    return t.fmt == HG_TENSOR_FMT_NHWC ? i * t.c + c : c * t.h * t.w + i;
+}
+
+inline float tensorValue(const TensorInfo& t, int nOffset) {
+    switch (t.type) {
+    case HG_TENSOR_TYPE_INT8:
+        return (((const int8_t*)t.pData)[nOffset] - t.zp) * t.scale;
+    case HG_TENSOR_TYPE_FP16:
+        return halfToFloat(((const uint16_t*)t.pData)[nOffset]);
+    default:
+        return ((const float*)t.pData)[nOffset];
+    }
+}
+
+// p[i] >= q 的位置写入pIdx
+int scanInt8(const int8_t* p, int n, int8_t q, int* pIdx) {
+    int i = 0;
+    int nCount = 0;
+#if defined(HG_USE_NEON)
+    int8x16_t vq = vdupq_n_s8(q);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t ge = vcgeq_s8(vld1q_s8(p + i), vq);
+        uint8x8_t any = vorr_u8(vget_low_u8(ge), vget_high_u8(ge));
+        if (vget_lane_u64(vreinterpret_u64_u8(any), 0) == 0) {
+            continue;
+        }
+        uint8_t lanes[16];
+        vst1q_u8(lanes, ge);
+        for (int j = 0; j < 16; ++j) {
+            if (lanes[j]) {
+                pIdx[nCount++] = i + j;
+            }
+        }
+    }
+#elif defined(HG_USE_SSE2)
+    __m128i vq = _mm_set1_epi8(q);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        int mask = ~_mm_movemask_epi8(_mm_cmpgt_epi8(vq, v)) & 0xffff;
+        while (mask) {
+            pIdx[nCount++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (p[i] >= q) {
+            pIdx[nCount++] = i;
+        }
+    }
+    return nCount;
+}
+
+// pDst[i] = max(pDst[i], p[i])
+void maxInt8(const int8_t* p, int8_t* pDst, int n) {
+    int i = 0;
+#if defined(HG_USE_NEON)
+    for (; i + 16 <= n; i += 16) {
+        vst1q_s8(pDst + i, vmaxq_s8(vld1q_s8(pDst + i), vld1q_s8(p + i)));
+    }
+#elif defined(HG_USE_SSE2)
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i d = _mm_loadu_si128((const __m128i*)(pDst + i));
+        __m128i gt = _mm_cmpgt_epi8(a, d);
+        d = _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, d));
+        _mm_storeu_si128((__m128i*)(pDst + i), d);
+    }
+#endif
+    for (; i < n; ++i) {
+        pDst[i] = std::max(pDst[i], p[i]);
+    }
+}
+
+// fp16转key，bMax为true时与pDst取最大值
+void toKey16(const uint16_t* p, int16_t* pDst, int n, bool bMax) {
+    int i = 0;
+#if defined(HG_USE_NEON)
+    int16x8_t m7 = vdupq_n_s16(0x7fff);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16((const int16_t*)(p + i));
+        int16x8_t k = veorq_s16(v, vandq_s16(vshrq_n_s16(v, 15), m7));
+        if (bMax) {
+            k = vmaxq_s16(k, vld1q_s16(pDst + i));
+        }
+        vst1q_s16(pDst + i, k);
+    }
+#elif defined(HG_USE_SSE2)
+    __m128i m7 = _mm_set1_epi16(0x7fff);
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        __m128i k = _mm_xor_si128(v, _mm_and_si128(_mm_srai_epi16(v, 15), m7));
+        if (bMax) {
+            k = _mm_max_epi16(k, _mm_loadu_si128((const __m128i*)(pDst + i)));
+        }
+        _mm_storeu_si128((__m128i*)(pDst + i), k);
+    }
+#endif
+    for (; i < n; ++i) {
+        int16_t k = halfKey(p[i]);
+        pDst[i] = bMax ? std::max(pDst[i], k) : k;
+    }
+}
+
+// p[i] >= key 的位置写入pIdx
+int scanKey16(const int16_t* p, int n, int16_t key, int* pIdx) {
+    int i = 0;
+    int nCount = 0;
+#if defined(HG_USE_NEON)
+    int16x8_t vk = vdupq_n_s16(key);
+    for (; i + 8 <= n; i += 8) {
+        uint16x8_t ge = vcgeq_s16(vld1q_s16(p + i), vk);
+        uint16x4_t any = vorr_u16(vget_low_u16(ge), vget_high_u16(ge));
+        if (vget_lane_u64(vreinterpret_u64_u16(any), 0) == 0) {
+            continue;
+        }
+        uint16_t lanes[8];
+        vst1q_u16(lanes, ge);
+        for (int j = 0; j < 8; ++j) {
+            if (lanes[j]) {
+                pIdx[nCount++] = i + j;
+            }
+        }
+    }
+#elif defined(HG_USE_SSE2)
+    __m128i vk = _mm_set1_epi16(key);
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+        int mask = ~_mm_movemask_epi8(_mm_cmplt_epi16(v, vk)) & 0xffff;
+        while (mask) {
+            int nBit = __builtin_ctz(mask);
+            pIdx[nCount++] = i + (nBit >> 1);
+            mask &= ~(3 << nBit);
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (p[i] >= key) {
+            pIdx[nCount++] = i;
+        }
+    }
+    return nCount;
+}
+
+} // namespace
+
+YoloPostProcess::YoloPostProcess(int nModelType, int nClassNum, int nInputW, int nInputH)
+    : m_nModelType(nModelType), m_nClassNum(nClassNum), m_nInputW(nInputW), m_nInputH(nInputH) {
+}
+
+YoloPostProcess::~YoloPostProcess() {
+}
+
+void YoloPostProcess::setThreshold(float fConfThreshold, float fNmsThreshold) {
+    m_fConfThreshold = fConfThreshold;
+    m_fNmsThreshold = fNmsThreshold;
+}
+
+void YoloPostProcess::setSigmoid(bool bSigmoid) {
+    m_bSigmoid = bSigmoid;
+}
+
+void YoloPostProcess::setAnchors(const float* pAnchors, int nNum) {
+    nNum = std::min(nNum, 18);
+    for (int i = 0; i < nNum; ++i) {
+        m_fAnchors[i] = pAnchors[i];
+    }
+}
+
+void YoloPostProcess::setMaxDetect(int nMaxDetect) {
+    m_nMaxDetect = std::max(1, std::min(nMaxDetect, HG_MAX_DETECT_NUM));
+}
+
+void YoloPostProcess::setMapping(int nSrcX, int nSrcY, int nSrcW, int nSrcH,
+                                 int nDstX, int nDstY, int nDstW, int nDstH) {
+    if (nSrcW <= 0 || nSrcH <= 0 || nDstW <= 0 || nDstH <= 0) {
+        m_fScaleX = m_fScaleY = 1.f;
+        m_fOffsetX = m_fOffsetY = 0.f;
+        m_fMaxX = m_fMaxY = 0.f;
+        return;
+    }
+    m_fScaleX = (float)nSrcW / nDstW;
+    m_fScaleY = (float)nSrcH / nDstH;
+    m_fOffsetX = nSrcX - nDstX * m_fScaleX;
+    m_fOffsetY = nSrcY - nDstY * m_fScaleY;
+    m_fMaxX = (float)(nSrcX + nSrcW);
+    m_fMaxY = (float)(nSrcY + nSrcH);
+}
+
+DetectResult* YoloPostProcess::process(const TensorInfo* pTensors, int nTensorNum) {
+    if (process(pTensors, nTensorNum, &m_stResult) < 0) {
+        m_stResult.count = 0;
+    }
+    return &m_stResult;
+}
+
+int YoloPostProcess::process(const TensorInfo* pTensors, int nTensorNum, DetectResult* pResult) {
+    if (pTensors == nullptr || pResult == nullptr) {
+        return -1;
+    }
+    pResult->count = 0;
+    m_vCandidates.clear();
+    int ret = -1;
+    if (m_nModelType == MODEL_YOLOV8) {
+        ret = processV8(pTensors, nTensorNum);
+    } else {
+        ret = processV5(pTensors, nTensorNum);
+    }
+    if (ret < 0) {
+        return ret;
+    }
+    nms(pResult);
+    return pResult->count;
+}
+
+int YoloPostProcess::scanPlane(const TensorInfo& stTensor, int nChannel, float fThreshold) {
+    int n = stTensor.h * stTensor.w;
+    if ((int)m_vIndex.size() < n) {
+        m_vIndex.resize(n);
+    }
+    int* pIdx = m_vIndex.data();
+    if (stTensor.fmt == HG_TENSOR_FMT_NCHW) {
+        size_t nOffset = (size_t)nChannel * n;
+        if (stTensor.type == HG_TENSOR_TYPE_INT8) {
+            const int8_t* p = (const int8_t*)stTensor.pData + nOffset;
+            return scanInt8(p, n, thresholdInt8(fThreshold, stTensor.zp, stTensor.scale), pIdx);
+        }
+        if (stTensor.type == HG_TENSOR_TYPE_FP16) {
+            if ((int)m_vScratch.size() < n) {
+                m_vScratch.resize(n);
+            }
+            toKey16((const uint16_t*)stTensor.pData + nOffset, m_vScratch.data(), n, false);
+            return scanKey16(m_vScratch.data(), n, thresholdKey(fThreshold), pIdx);
+        }
+    }
+    int nCount = 0;
+    for (int i = 0; i < n; ++i) {
+        if (tensorValue(stTensor, elemOffset(stTensor, nChannel, i)) >= fThreshold) {
+            pIdx[nCount++] = i;
+        }
+    }
+    return nCount;
+}
+
+int YoloPostProcess::scanChannelMax(const TensorInfo& stTensor, float fThreshold) {
+    int n = stTensor.h * stTensor.w;
+    if ((int)m_vIndex.size() < n) {
+        m_vIndex.resize(n);
+    }
+    if ((int)m_vScratch.size() < n) {
+        m_vScratch.resize(n);
+    }
+    int* pIdx = m_vIndex.data();
+    if (stTensor.fmt == HG_TENSOR_FMT_NCHW) {
+        if (stTensor.type == HG_TENSOR_TYPE_INT8) {
+            // 同一张量量化参数相同，量化域的最大值即为实际最大值
+            const int8_t* p = (const int8_t*)stTensor.pData;
+            int8_t* pMax = (int8_t*)m_vScratch.data();
+            memcpy(pMax, p, n);
+            for (int c = 1; c < stTensor.c; ++c) {
+                maxInt8(p + (size_t)c * n, pMax, n);
+            }
+            return scanInt8(pMax, n, thresholdInt8(fThreshold, stTensor.zp, stTensor.scale), pIdx);
+        }
+        if (stTensor.type == HG_TENSOR_TYPE_FP16) {
+            const uint16_t* p = (const uint16_t*)stTensor.pData;
+            for (int c = 0; c < stTensor.c; ++c) {
+                toKey16(p + (size_t)c * n, m_vScratch.data(), n, c > 0);
+            }
+            return scanKey16(m_vScratch.data(), n, thresholdKey(fThreshold), pIdx);
+        }
+    }
+    int nCount = 0;
+    for (int i = 0; i < n; ++i) {
+        for (int c = 0; c < stTensor.c; ++c) {
+            if (tensorValue(stTensor, elemOffset(stTensor, c, i)) >= fThreshold) {
+                pIdx[nCount++] = i;
+                break;
+            }
+        }
+    }
+    return nCount;
+}
+
+int YoloPostProcess::processV5(const TensorInfo* pTensors, int nTensorNum) {
+    if (nTensorNum != 3) {
+        ff_error("yolov5 need 3 output tensors, got %d\n", nTensorNum);
+        return -1;
+    }
+    const int nProp = 5 + m_nClassNum;
+    const float fRaw = m_bSigmoid ? logit(m_fConfThreshold) : m_fConfThreshold;
+    for (int b = 0; b < nTensorNum; ++b) {
+        const TensorInfo& t = pTensors[b];
+        if (t.pData == nullptr || t.c != 3 * nProp || t.h <= 0 || t.w <= 0) {
+            ff_error("yolov5 output %d shape mismatch: c = %d, class num = %d\n", b, t.c, m_nClassNum);
+            return -1;
+        }
+        const int nStride = m_nInputH / t.h;
+        for (int a = 0; a < 3; ++a) {
+            const int nBase = a * nProp;
+            int nCount = scanPlane(t, nBase + 4, fRaw);
+            for (int k = 0; k < nCount; ++k) {
+                int i = m_vIndex[k];
+                float fObj = tensorValue(t, elemOffset(t, nBase + 4, i));
+                int nClass = 0;
+                float fCls = tensorValue(t, elemOffset(t, nBase + 5, i));
+                for (int c = 1; c < m_nClassNum; ++c) {
+                    float v = tensorValue(t, elemOffset(t, nBase + 5 + c, i));
+                    if (v > fCls) {
+                        fCls = v;
+                        nClass = c;
+                    }
+                }
+                if (m_bSigmoid) {
+                    fObj = sigmoid(fObj);
+                    fCls = sigmoid(fCls);
+                }
+                float fScore = fObj * fCls;
+                if (fScore < m_fConfThreshold) {
+                    continue;
+                }
+                float bx = tensorValue(t, elemOffset(t, nBase + 0, i));
+                float by = tensorValue(t, elemOffset(t, nBase + 1, i));
+                float bw = tensorValue(t, elemOffset(t, nBase + 2, i));
+                float bh = tensorValue(t, elemOffset(t, nBase + 3, i));
+                if (m_bSigmoid) {
+                    bx = sigmoid(bx);
+                    by = sigmoid(by);
+                    bw = sigmoid(bw);
+                    bh = sigmoid(bh);
+                }
+                float cx = (bx * 2.f - 0.5f + i % t.w) * nStride;
+                float cy = (by * 2.f - 0.5f + i / t.w) * nStride;
+                bw = bw * 2.f;
+                bh = bh * 2.f;
+                bw = bw * bw * m_fAnchors[b * 6 + a * 2];
+                bh = bh * bh * m_fAnchors[b * 6 + a * 2 + 1];
+                m_vCandidates.push_back({cx - bw * 0.5f, cy - bh * 0.5f, cx + bw * 0.5f, cy + bh * 0.5f, fScore, nClass});
+            }
+        }
+    }
+    return 0;
+}
+
+int YoloPostProcess::processV8(const TensorInfo* pTensors, int nTensorNum) {
+    if (nTensorNum != 6 && nTensorNum != 9) {
+        ff_error("yolov8 need 6 or 9 output tensors, got %d\n", nTensorNum);
+        return -1;
+    }
+    const int nPerBranch = nTensorNum / 3;
+    const float fRaw = m_bSigmoid ? logit(m_fConfThreshold) : m_fConfThreshold;
+    float fDfl[64];
+    for (int b = 0; b < 3; ++b) {
+        const TensorInfo& box = pTensors[b * nPerBranch];
+        const TensorInfo& cls = pTensors[b * nPerBranch + 1];
+        const int nRegMax = box.c / 4;
+        if (box.pData == nullptr || cls.pData == nullptr || cls.c != m_nClassNum ||
+            nRegMax <= 0 || nRegMax > 64 || box.h != cls.h || box.w != cls.w) {
+            ff_error("yolov8 branch %d shape mismatch: box c = %d, cls c = %d\n", b, box.c, cls.c);
+            return -1;
+        }
+        const int nStride = m_nInputH / cls.h;
+        int nCount = 0;
+        if (nPerBranch == 3 && !m_bSigmoid) {
+            // score_sum >= 最大类别分数，用作更快的预筛选
+            nCount = scanPlane(pTensors[b * nPerBranch + 2], 0, fRaw);
+        } else {
+            nCount = scanChannelMax(cls, fRaw);
+        }
+        for (int k = 0; k < nCount; ++k) {
+            int i = m_vIndex[k];
+            int nClass = 0;
+            float fScore = tensorValue(cls, elemOffset(cls, 0, i));
+            for (int c = 1; c < m_nClassNum; ++c) {
+                float v = tensorValue(cls, elemOffset(cls, c, i));
+                if (v > fScore) {
+                    fScore = v;
+                    nClass = c;
+                }
+            }
+            if (m_bSigmoid) {
+                fScore = sigmoid(fScore);
+            }
+            if (fScore < m_fConfThreshold) {
+                continue;
+            }
+            float fDist[4];
+            for (int side = 0; side < 4; ++side) {
+                float fMax = -1e30f;
+                for (int j = 0; j < nRegMax; ++j) {
+                    fDfl[j] = tensorValue(box, elemOffset(box, side * nRegMax + j, i));
+                    fMax = std::max(fMax, fDfl[j]);
+                }
+                float fSum = 0.f;
+                float fAcc = 0.f;
+                for (int j = 0; j < nRegMax; ++j) {
+                    float e = expf(fDfl[j] - fMax);
+                    fSum += e;
+                    fAcc += e * j;
+                }
+                fDist[side] = fAcc / fSum;
+            }
+            float gx = i % cls.w + 0.5f;
+            float gy = i / cls.w + 0.5f;
+            m_vCandidates.push_back({(gx - fDist[0]) * nStride, (gy - fDist[1]) * nStride,
+                                     (gx + fDist[2]) * nStride, (gy + fDist[3]) * nStride, fScore, nClass});
+        }
+    }
+    return 0;
+}
+
+void YoloPostProcess::nms(DetectResult* pResult) {
+    const int n = (int)m_vCandidates.size();
+    m_vOrder.resize(n);
+    std::iota(m_vOrder.begin(), m_vOrder.end(), 0);
+    std::sort(m_vOrder.begin(), m_vOrder.end(), [this](int a, int b) {
+        return m_vCandidates[a].score > m_vCandidates[b].score;
+    });
+    m_vAreas.resize(n);
+    for (int i = 0; i < n; ++i) {
+        const StCandidate& c = m_vCandidates[i];
+        m_vAreas[i] = std::max(0.f, c.x2 - c.x1) * std::max(0.f, c.y2 - c.y1);
+    }
+    m_vSuppressed.assign(n, 0);
+
+    const float fMaxX = m_fMaxX > 0.f ? m_fMaxX : (float)m_nInputW;
+    const float fMaxY = m_fMaxY > 0.f ? m_fMaxY : (float)m_nInputH;
+    int nKeep = 0;
+    for (int oi = 0; oi < n && nKeep < m_nMaxDetect; ++oi) {
+        int i = m_vOrder[oi];
+        if (m_vSuppressed[i]) {
+            continue;
+        }
+        const StCandidate& a = m_vCandidates[i];
+        DetectBox& box = pResult->boxes[nKeep++];
+        box.x1 = std::min(std::max(a.x1 * m_fScaleX + m_fOffsetX, 0.f), fMaxX);
+        box.y1 = std::min(std::max(a.y1 * m_fScaleY + m_fOffsetY, 0.f), fMaxY);
+        box.x2 = std::min(std::max(a.x2 * m_fScaleX + m_fOffsetX, 0.f), fMaxX);
+        box.y2 = std::min(std::max(a.y2 * m_fScaleY + m_fOffsetY, 0.f), fMaxY);
+        box.score = a.score;
+        box.classId = a.classId;
+        box.trackId = -1;
+        // 按分数降序，只需抑制后面同类别的框
+        for (int oj = oi + 1; oj < n; ++oj) {
+            int j = m_vOrder[oj];
+            const StCandidate& c = m_vCandidates[j];
+            if (m_vSuppressed[j] || c.classId != a.classId) {
+                continue;
+            }
+            float w = std::min(a.x2, c.x2) - std::max(a.x1, c.x1);
+            float h = std::min(a.y2, c.y2) - std::max(a.y1, c.y1);
+            if (w <= 0.f || h <= 0.f) {
+                continue;
+            }
+            float fInter = w * h;
+            if (fInter > m_fNmsThreshold * (m_vAreas[i] + m_vAreas[j] - fInter)) {
+                m_vSuppressed[j] = 1;
+            }
+        }
+    }
+    pResult->count = nKeep;
+}
+
+int YoloPostProcess::getTensorElemSize(int nType) {
+    switch (nType) {
+    case HG_TENSOR_TYPE_INT8:
+        return 1;
+    case HG_TENSOR_TYPE_FP16:
+        return 2;
+    default:
+        return 4;
+    }
+}
+
+bool YoloPostProcess::saveTensor(const char* pPath, const TensorInfo& stTensor) {
+    FILE* fp = fopen(pPath, "wb");
+    if (fp == nullptr) {
+        return false;
+    }
+    StTensorFileHeader stHeader = {{'H', 'G', 'T', 'S'}, stTensor.type, stTensor.fmt,
+                                   stTensor.c, stTensor.h, stTensor.w, stTensor.zp, stTensor.scale};
+    size_t nSize = (size_t)stTensor.c * stTensor.h * stTensor.w * getTensorElemSize(stTensor.type);
+    bool bOk = fwrite(&stHeader, sizeof(stHeader), 1, fp) == 1 &&
+               fwrite(stTensor.pData, 1, nSize, fp) == nSize;
+    fclose(fp);
+    return bOk;
+}
+
+bool YoloPostProcess::loadTensor(const char* pPath, TensorInfo& stTensor, std::vector<uint8_t>& vData) {
+    FILE* fp = fopen(pPath, "rb");
+    if (fp == nullptr) {
+        return false;
+    }
+    StTensorFileHeader stHeader;
+    if (fread(&stHeader, sizeof(stHeader), 1, fp) != 1 || memcmp(stHeader.magic, "HGTS", 4) != 0) {
+        fclose(fp);
+        return false;
+    }
+    stTensor.type = stHeader.type;
+    stTensor.fmt = stHeader.fmt;
+    stTensor.c = stHeader.c;
+    stTensor.h = stHeader.h;
+    stTensor.w = stHeader.w;
+    stTensor.zp = stHeader.zp;
+    stTensor.scale = stHeader.scale;
+    size_t nSize = (size_t)stTensor.c * stTensor.h * stTensor.w * getTensorElemSize(stTensor.type);
+    vData.resize(nSize);
+    bool bOk = fread(vData.data(), 1, nSize, fp) == nSize;
+    fclose(fp);
+    stTensor.pData = vData.data();
+    return bOk;
+}
@@ -0,0 +1,94 @@
+#ifndef YOLOPOSTPROCESS_H
+#define YOLOPOSTPROCESS_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "libExportStream.h"
+
+// Yolov5/Yolov8后处理，支持int8/fp16/fp32输出张量。
+// 不依赖rknn，可在x86上用录制的张量文件验证。
+// yolov5: 3个输出，每个为[3*(5+C), H, W]
+// yolov8: 6或9个输出，每个分支依次为box[4*16, H, W]、cls[C, H, W]、(可选)score_sum[1, H, W]
+class YoloPostProcess {
+public:
+    enum ModelType {
+        MODEL_YOLOV5 = 5,
+        MODEL_YOLOV8 = 8,
+    };
+
+public:
+    YoloPostProcess(int nModelType, int nClassNum, int nInputW = 640, int nInputH = 640);
+    ~YoloPostProcess();
+
+    // 设置置信度及nms阈值
+    void setThreshold(float fConfThreshold, float fNmsThreshold);
+    // 模型输出未做sigmoid时开启，阈值比较在sigmoid前完成
+    void setSigmoid(bool bSigmoid);
+    // 设置yolov5 anchor，3个分支x3个anchor x (w, h)
+    void setAnchors(const float* pAnchors, int nNum);
+    // 设置最大输出框数量，不超过HG_MAX_DETECT_NUM
+    void setMaxDetect(int nMaxDetect);
+    // 设置模型输入区域(dst)到原图区域(src)的映射，默认不映射
+    void setMapping(int nSrcX, int nSrcY, int nSrcW, int nSrcH,
+                    int nDstX, int nDstY, int nDstW, int nDstH);
+
+    // 后处理，返回检测框数量，失败返回负数
+    int process(const TensorInfo* pTensors, int nTensorNum, DetectResult* pResult);
+    DetectResult* process(const TensorInfo* pTensors, int nTensorNum);
+
+    // 录制/读取张量文件，用于离线验证
+    static bool saveTensor(const char* pPath, const TensorInfo& stTensor);
+    static bool loadTensor(const char* pPath, TensorInfo& stTensor, std::vector<uint8_t>& vData);
+    static int getTensorElemSize(int nType);
+
+private:
+    struct StCandidate {
+        float x1;
+        float y1;
+        float x2;
+        float y2;
+        float score;
+        int classId;
+    };
+
+    int processV5(const TensorInfo* pTensors, int nTensorNum);
+    int processV8(const TensorInfo* pTensors, int nTensorNum);
+    // 找出plane中大于等于阈值的位置，返回数量
+    int scanPlane(const TensorInfo& stTensor, int nChannel, float fThreshold);
+    // 逐位置求所有通道的最大值，再找出大于等于阈值的位置
+    int scanChannelMax(const TensorInfo& stTensor, float fThreshold);
+    void nms(DetectResult* pResult);
+
+private:
+    int m_nModelType = MODEL_YOLOV5;
+    int m_nClassNum = 80;
+    int m_nInputW = 640;
+    int m_nInputH = 640;
+    float m_fConfThreshold = 0.25f;
+    float m_fNmsThreshold = 0.45f;
+    bool m_bSigmoid = false;
+    int m_nMaxDetect = HG_MAX_DETECT_NUM;
+    float m_fAnchors[18] = {10, 13, 16, 30, 33, 23,
+                            30, 61, 62, 45, 59, 119,
+                            116, 90, 156, 198, 373, 326};
+
+    // 映射参数 x_src = x_dst * scale + offset
+    float m_fScaleX = 1.f;
+    float m_fScaleY = 1.f;
+    float m_fOffsetX = 0.f;
+    float m_fOffsetY = 0.f;
+    float m_fMaxX = 0.f;
+    float m_fMaxY = 0.f;
+
+    // 复用内存，稳定后不再分配
+    std::vector<int> m_vIndex;
+    std::vector<int16_t> m_vScratch;
+    std::vector<StCandidate> m_vCandidates;
+    std::vector<int> m_vOrder;
+    std::vector<float> m_vAreas;
+    std::vector<uint8_t> m_vSuppressed;
+    DetectResult m_stResult;
+};
+
+#endif // YOLOPOSTPROCESS_H
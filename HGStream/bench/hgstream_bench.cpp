@@ -0,0 +1,398 @@
+// 多路回环压测：K路裸流回放 -> ModuleRtspServer(本机) -> ModuleRtspClient [-> ModuleMppDec]，
+// 统计每路帧率、丢帧率、延时分位数及每路CPU占用；ramp模式逐步增加路数直到饱和。
+// 用法：hgstream_bench file.h264 [-n 路数] [-t 统计秒数] [-w 预热秒数] [-p 端口] [-f 帧率] [-d] [-v]
+//                               [-r 每轮增加路数] [-m 最大路数] [-l 丢帧率上限%] [-L p99延时上限ms]
+#include "ModuleAnnexBSource.h"
+
+#include "module/vi/module_rtspClient.hpp"
+#include "module/vp/module_mppdec.hpp"
+#include "module/vo/module_rtspServer.hpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 发送时间表大小，回环延时内发送的帧数远小于它
+#define SEND_SLOTS 1024
+// 用帧尾部的字节识别同一帧，RTP打包/解包不改变最后一个nal的内容
+#define TAIL_BYTES 16
+
+struct StOptions {
+    std::string sFile;
+    int nStreams = 4;
+    int nSeconds = 10;
+    int nWarmup = 3;
+    int nPort = 8554;
+    double fFps = 0;
+    bool bDecode = false;
+    bool bVerbose = false;
+    int nRampStep = 0;
+    int nRampMax = 256;
+    double fDropLimit = 1.0;
+    double fLatencyLimit = 500;
+};
+
+struct StStats {
+    double fFps;
+    double fDrop;
+    double fP50;
+    double fP90;
+    double fP99;
+    size_t nSamples;
+};
+
+int64_t nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t processCpuUs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+uint64_t tailKey(shared_ptr<MediaBuffer> pBuffer) {
+    const uint8_t* pData = (const uint8_t*)pBuffer->getActiveData();
+    size_t nSize = pBuffer->getActiveSize();
+    if (pData == nullptr || nSize < TAIL_BYTES) {
+        return 0;
+    }
+    // FNV-1a
+    uint64_t nKey = 1469598103934665603ull;
+    for (size_t i = nSize - TAIL_BYTES; i < nSize; ++i) {
+        nKey = (nKey ^ pData[i]) * 1099511628211ull;
+    }
+    return nKey;
+}
+
+double percentile(std::vector<float>& vSorted, double fRatio) {
+    if (vSorted.empty()) {
+        return 0;
+    }
+    size_t nIndex = std::min(vSorted.size() - 1, (size_t)(fRatio * vSorted.size()));
+    return vSorted[nIndex];
+}
+
+class BenchStream {
+public:
+    BenchStream(int nIndex, const StOptions& stOptions) : m_nIndex(nIndex), m_stOptions(stOptions) {
+        memset(m_stSlots, 0, sizeof(m_stSlots));
+    }
+
+    ~BenchStream() {
+        stop();
+    }
+
+    // 回放源和推流，客户端在推流有数据后再连接
+    int startServer() {
+        m_pSource = make_shared<ModuleAnnexBSource>(m_stOptions.sFile, m_stOptions.fFps, true);
+        // 各路错开起始位置，避免关键帧同时到达
+        m_pSource->setStartFrame(m_nIndex * 7);
+        if (m_pSource->init() < 0) {
+            return -1;
+        }
+        m_pSendConsumer = m_pSource->addExternalConsumer("BenchSend", this, onSend);
+
+        m_sPath = "/bench/" + std::to_string(m_nIndex);
+        m_pServer = make_shared<ModuleRtspServer>(m_sPath.c_str(), m_stOptions.nPort);
+        m_pServer->setProductor(m_pSource);
+        m_pServer->setBufferCount(0);
+        if (m_pServer->init() < 0) {
+            return -1;
+        }
+        m_pSource->start();
+        return 0;
+    }
+
+    int startClient() {
+        std::string sUrl = "rtsp://127.0.0.1:" + std::to_string(m_stOptions.nPort) + m_sPath;
+        m_pClient = make_shared<ModuleRtspClient>(sUrl, RTSP_STREAM_TYPE_TCP, true, false);
+        if (m_pClient->init() < 0) {
+            printf("stream %d: open %s failed\n", m_nIndex, sUrl.c_str());
+            return -1;
+        }
+        m_pRecvConsumer = m_pClient->addExternalConsumer("BenchRecv", this, onRecv);
+        if (m_stOptions.bDecode) {
+            m_pDec = make_shared<ModuleMppDec>(m_pClient->getOutputImagePara());
+            m_pDec->setProductor(m_pClient);
+            if (m_pDec->init() < 0) {
+                return -1;
+            }
+            m_pDecConsumer = m_pDec->addExternalConsumer("BenchDecode", this, onDecode);
+        }
+        m_pClient->start();
+        return 0;
+    }
+
+    void stop() {
+        if (m_pClient != nullptr) {
+            m_pClient->stop();
+            m_pClient = nullptr;
+        }
+        if (m_pDec != nullptr) {
+            m_pDec->stop();
+            m_pDec = nullptr;
+        }
+        if (m_pSource != nullptr) {
+            m_pSource->stop();
+            m_pSource = nullptr;
+        }
+        m_pServer = nullptr;
+    }
+
+    // 开始一个统计窗口
+    void resetWindow() {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        m_nSentBase = m_nSent;
+        m_nRecvBase = m_nRecv;
+        m_nDecodedBase = m_nDecoded;
+        m_vLatency.clear();
+    }
+
+    StStats collect(double fSeconds) {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        uint64_t nSent = m_nSent - m_nSentBase;
+        uint64_t nRecv = m_nRecv - m_nRecvBase;
+        uint64_t nOut = m_stOptions.bDecode ? m_nDecoded - m_nDecodedBase : nRecv;
+        StStats stStats;
+        stStats.fFps = nOut / fSeconds;
+        stStats.fDrop = nSent == 0 ? 0 : std::max(0.0, 100.0 * (1.0 - (double)nOut / nSent));
+        std::sort(m_vLatency.begin(), m_vLatency.end());
+        stStats.fP50 = percentile(m_vLatency, 0.5);
+        stStats.fP90 = percentile(m_vLatency, 0.9);
+        stStats.fP99 = percentile(m_vLatency, 0.99);
+        stStats.nSamples = m_vLatency.size();
+        return stStats;
+    }
+
+    // 汇总各路延时样本
+    void appendLatency(std::vector<float>& vAll) {
+        std::lock_guard<std::mutex> locker(m_mutex);
+        vAll.insert(vAll.end(), m_vLatency.begin(), m_vLatency.end());
+    }
+
+    double getFps() const { return m_pSource != nullptr ? m_pSource->getFps() : 0; }
+
+private:
+    static void onSend(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+        BenchStream* pThis = static_cast<BenchStream*>(pCtx);
+        uint64_t nKey = tailKey(pBuffer);
+        std::lock_guard<std::mutex> locker(pThis->m_mutex);
+        pThis->m_nSent++;
+        StSlot& stSlot = pThis->m_stSlots[nKey % SEND_SLOTS];
+        stSlot.nKey = nKey;
+        stSlot.nTimeUs = nowUs();
+    }
+
+    static void onRecv(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+        BenchStream* pThis = static_cast<BenchStream*>(pCtx);
+        uint64_t nKey = tailKey(pBuffer);
+        int64_t nNow = nowUs();
+        std::lock_guard<std::mutex> locker(pThis->m_mutex);
+        pThis->m_nRecv++;
+        StSlot& stSlot = pThis->m_stSlots[nKey % SEND_SLOTS];
+        if (nKey != 0 && stSlot.nKey == nKey) {
+            pThis->m_vLatency.push_back((nNow - stSlot.nTimeUs) / 1000.f);
+            // 同一帧只统计一次
+            stSlot.nKey = 0;
+        }
+    }
+
+    static void onDecode(void* pCtx, shared_ptr<MediaBuffer> pBuffer) {
+        (void)pBuffer;
+        BenchStream* pThis = static_cast<BenchStream*>(pCtx);
+        std::lock_guard<std::mutex> locker(pThis->m_mutex);
+        pThis->m_nDecoded++;
+    }
+
+private:
+    struct StSlot {
+        uint64_t nKey;
+        int64_t nTimeUs;
+    };
+
+    int m_nIndex;
+    const StOptions& m_stOptions;
+    std::string m_sPath;
+    shared_ptr<ModuleAnnexBSource> m_pSource;
+    shared_ptr<ModuleRtspServer> m_pServer;
+    shared_ptr<ModuleRtspClient> m_pClient;
+    shared_ptr<ModuleMppDec> m_pDec;
+    shared_ptr<ModuleMedia> m_pSendConsumer;
+    shared_ptr<ModuleMedia> m_pRecvConsumer;
+    shared_ptr<ModuleMedia> m_pDecConsumer;
+
+    std::mutex m_mutex;
+    StSlot m_stSlots[SEND_SLOTS];
+    uint64_t m_nSent = 0;
+    uint64_t m_nRecv = 0;
+    uint64_t m_nDecoded = 0;
+    uint64_t m_nSentBase = 0;
+    uint64_t m_nRecvBase = 0;
+    uint64_t m_nDecodedBase = 0;
+    std::vector<float> m_vLatency;
+};
+
+void usage(const char* pName) {
+    printf("usage: %s file.h264|file.h265 [options]\n"
+           "  -n N    streams (default 4)\n"
+           "  -t SEC  measure window (default 10)\n"
+           "  -w SEC  warmup before each window (default 3)\n"
+           "  -p PORT rtsp port (default 8554)\n"
+           "  -f FPS  replay fps (default from stream, else 25)\n"
+           "  -d      decode pulled streams with MppDec\n"
+           "  -v      print every stream\n"
+           "  -r STEP ramp mode: add STEP streams per round until saturated\n"
+           "  -m N    ramp limit (default 256)\n"
+           "  -l PCT  ramp: max drop rate (default 1)\n"
+           "  -L MS   ramp: max p99 latency (default 500)\n",
+           pName);
+}
+
+bool parseOptions(int argc, char** argv, StOptions& stOptions) {
+    if (argc < 2 || argv[1][0] == '-') {
+        return false;
+    }
+    stOptions.sFile = argv[1];
+    for (int i = 2; i < argc; ++i) {
+        const char* pOpt = argv[i];
+        bool bHasValue = i + 1 < argc;
+        if (strcmp(pOpt, "-d") == 0) {
+            stOptions.bDecode = true;
+        } else if (strcmp(pOpt, "-v") == 0) {
+            stOptions.bVerbose = true;
+        } else if (!bHasValue) {
+            return false;
+        } else if (strcmp(pOpt, "-n") == 0) {
+            stOptions.nStreams = atoi(argv[++i]);
+        } else if (strcmp(pOpt, "-t") == 0) {
+            stOptions.nSeconds = atoi(argv[++i]);
+        } else if (strcmp(pOpt, "-w") == 0) {
+            stOptions.nWarmup = atoi(argv[++i]);
+        } else if (strcmp(pOpt, "-p") == 0) {
+            stOptions.nPort = atoi(argv[++i]);
+        } else if (strcmp(pOpt, "-f") == 0) {
+            stOptions.fFps = atof(argv[++i]);
+        } else if (strcmp(pOpt, "-r") == 0) {
+            stOptions.nRampStep = atoi(argv[++i]);
+        } else if (strcmp(pOpt, "-m") == 0) {
+            stOptions.nRampMax = atoi(argv[++i]);
+        } else if (strcmp(pOpt, "-l") == 0) {
+            stOptions.fDropLimit = atof(argv[++i]);
+        } else if (strcmp(pOpt, "-L") == 0) {
+            stOptions.fLatencyLimit = atof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return stOptions.nStreams > 0 && stOptions.nSeconds > 0;
+}
+
+int addStreams(std::vector<std::unique_ptr<BenchStream>>& vStreams, int nCount, const StOptions& stOptions) {
+    size_t nBegin = vStreams.size();
+    for (int i = 0; i < nCount; ++i) {
+        std::unique_ptr<BenchStream> pStream(new BenchStream((int)vStreams.size(), stOptions));
+        if (pStream->startServer() < 0) {
+            return -1;
+        }
+        vStreams.push_back(std::move(pStream));
+    }
+    // 等推流有了参数集再连接
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    for (size_t i = nBegin; i < vStreams.size(); ++i) {
+        if (vStreams[i]->startClient() < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// 统计一个窗口，返回汇总结果
+StStats measure(std::vector<std::unique_ptr<BenchStream>>& vStreams, const StOptions& stOptions, double& fMinFps) {
+    std::this_thread::sleep_for(std::chrono::seconds(stOptions.nWarmup));
+    for (auto& pStream : vStreams) {
+        pStream->resetWindow();
+    }
+    int64_t nWallBegin = nowUs();
+    int64_t nCpuBegin = processCpuUs();
+    std::this_thread::sleep_for(std::chrono::seconds(stOptions.nSeconds));
+    double fSeconds = (nowUs() - nWallBegin) / 1e6;
+    double fCpu = (processCpuUs() - nCpuBegin) / 1e6 / fSeconds * 100;
+
+    StStats stTotal = {0, 0, 0, 0, 0, 0};
+    fMinFps = 1e9;
+    std::vector<float> vAll;
+    for (size_t i = 0; i < vStreams.size(); ++i) {
+        StStats st = vStreams[i]->collect(fSeconds);
+        vStreams[i]->appendLatency(vAll);
+        if (stOptions.bVerbose) {
+            printf("  stream %3zu: fps %6.2f drop %5.2f%% latency p50 %6.1f p90 %6.1f p99 %6.1f ms (%zu samples)\n", i, st.fFps,
+                   st.fDrop, st.fP50, st.fP90, st.fP99, st.nSamples);
+        }
+        stTotal.fFps += st.fFps;
+        stTotal.fDrop = std::max(stTotal.fDrop, st.fDrop);
+        fMinFps = std::min(fMinFps, st.fFps);
+    }
+    std::sort(vAll.begin(), vAll.end());
+    stTotal.fFps /= vStreams.size();
+    stTotal.fP50 = percentile(vAll, 0.5);
+    stTotal.fP90 = percentile(vAll, 0.9);
+    stTotal.fP99 = percentile(vAll, 0.99);
+    stTotal.nSamples = vAll.size();
+    printf("streams %3zu: fps %6.2f (min %6.2f) max drop %5.2f%% latency p50 %6.1f p90 %6.1f p99 %6.1f ms, "
+           "cpu %5.1f%%/stream (%6.1f%% total)\n",
+           vStreams.size(), stTotal.fFps, fMinFps, stTotal.fDrop, stTotal.fP50, stTotal.fP90, stTotal.fP99,
+           fCpu / vStreams.size(), fCpu);
+    fflush(stdout);
+    return stTotal;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    StOptions stOptions;
+    if (!parseOptions(argc, argv, stOptions)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<BenchStream>> vStreams;
+    double fMinFps = 0;
+    if (stOptions.nRampStep <= 0) {
+        if (addStreams(vStreams, stOptions.nStreams, stOptions) < 0) {
+            return 1;
+        }
+        measure(vStreams, stOptions, fMinFps);
+        return 0;
+    }
+
+    // ramp：每轮增加nRampStep路，任一路丢帧、帧率不足或p99延时超限即认为饱和
+    int nSustained = 0;
+    while ((int)vStreams.size() + stOptions.nRampStep <= stOptions.nRampMax) {
+        if (addStreams(vStreams, stOptions.nRampStep, stOptions) < 0) {
+            printf("failed to add streams at %zu\n", vStreams.size());
+            break;
+        }
+        StStats st = measure(vStreams, stOptions, fMinFps);
+        double fTarget = vStreams.front()->getFps();
+        bool bSaturated = st.fDrop > stOptions.fDropLimit || fMinFps < fTarget * 0.95 || st.fP99 > stOptions.fLatencyLimit;
+        if (bSaturated) {
+            break;
+        }
+        nSustained = (int)vStreams.size();
+    }
+    printf("sustained %d streams\n", nSustained);
+    vStreams.clear();
+    return 0;
+}
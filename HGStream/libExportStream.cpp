@@ -2,6 +2,7 @@
 
 #include <fstream>
 #include "StreamManager.h"
+#include "YoloPostProcess.h"
 
 extern "C"
 // ======================================
@@ -21,6 +22,14 @@ FrameInfo* HG_GetFrameInfo(void* pHandle) {
     return StreamManager::getInstance()->HG_GetFrameInfo(pHandle);
 }
 
+void HG_SetSceneActivity(const bool bEnable, const int nMinInterval, const int nMaxInterval) {
+    StreamManager::getInstance()->HG_SetSceneActivity(bEnable, nMinInterval, nMaxInterval);
+}
+
+int HG_GetInferenceInterval(void* pHandle) {
+    return StreamManager::getInstance()->HG_GetInferenceInterval(pHandle);
+}
+
 // ======================================
 bool HG_SetFrameInfo(const char* pPlayId, const int nWidth, const int nHeight,
                     const int nPort, const int nEncodeType) {
@@ -52,6 +61,166 @@ void HG_StopSink(const char* playId) {
     StreamManager::getInstance()->HG_StopSink(playId);
 }
 
+void HG_SetOsdResult(const char* playId, const DetectResult* pResult) {
+    StreamManager::getInstance()->HG_SetOsdResult(playId, pResult);
+}
+
+void HG_SetOsdLabels(const char* playId, const char** ppLabels, const int nLabelNum) {
+    StreamManager::getInstance()->HG_SetOsdLabels(playId, ppLabels, nLabelNum);
+}
+
+void HG_SetOsdStyle(const char* playId, const int nThickness, const int nFontScale, const bool bShowTime) {
+    StreamManager::getInstance()->HG_SetOsdStyle(playId, nThickness, nFontScale, bShowTime);
+}
+
+void HG_SetOsdBlend(const char* playId, const bool bEnable) {
+    StreamManager::getInstance()->HG_SetOsdBlend(playId, bEnable);
+}
+
+int HG_AddStreamSubscriber(const char* playId, HG_StreamCallback callback, void* pCtx) {
+    return StreamManager::getInstance()->HG_AddStreamSubscriber(playId, callback, pCtx);
+}
+
+void HG_SetGopCache(const char* playId, const bool bEnable) {
+    StreamManager::getInstance()->HG_SetGopCache(playId, bEnable);
+}
+
+void HG_RemoveStreamSubscriber(const char* playId, const int nId) {
+    StreamManager::getInstance()->HG_RemoveStreamSubscriber(playId, nId);
+}
+
+void HG_RequestKeyFrame(const char* playId) {
+    StreamManager::getInstance()->HG_RequestKeyFrame(playId);
+}
+
+void HG_SetIdleBypass(const char* playId, const bool bEnable) {
+    StreamManager::getInstance()->HG_SetIdleBypass(playId, bEnable);
+}
+
+void HG_SetEventRecord(const char* playId, const char* pDir, const int nPreRollMs) {
+    StreamManager::getInstance()->HG_SetEventRecord(playId, pDir, nPreRollMs);
+}
+
+bool HG_TriggerEventRecord(const char* playId, const char* pFileName, const int nPostMs) {
+    return StreamManager::getInstance()->HG_TriggerEventRecord(playId, pFileName, nPostMs);
+}
+
+void HG_SetSegmentRecord(const char* playId, const char* pDir, const int nSegmentSec, const int nRetentionMB) {
+    StreamManager::getInstance()->HG_SetSegmentRecord(playId, pDir, nSegmentSec, nRetentionMB);
+}
+
+void* HG_GetRecordClient(const char* pDir, const long long nStartMs) {
+    return StreamManager::getInstance()->HG_GetRecordClient(pDir, nStartMs);
+}
+
+bool HG_SeekRecord(void* pHandle, const long long nWallMs) {
+    return StreamManager::getInstance()->HG_SeekRecord(pHandle, nWallMs);
+}
+
+bool HG_SetRecordSpeed(void* pHandle, const int nSpeed) {
+    return StreamManager::getInstance()->HG_SetRecordSpeed(pHandle, nSpeed);
+}
+
+bool HG_SetCpuPolicy(const char* pStage, const char* pCores, const int nPolicy, const int nPriority) {
+    return StreamManager::getInstance()->HG_SetCpuPolicy(pStage, pCores, nPolicy, nPriority);
+}
+
+void* HG_StartGraph(const char* pConfigPath) {
+    return StreamManager::getInstance()->HG_StartGraph(pConfigPath);
+}
+
+void HG_StopGraph(void* pHandle) {
+    StreamManager::getInstance()->HG_StopGraph(pHandle);
+}
+
+void HG_SetBufferBudget(const long long nBytes) {
+    StreamManager::getInstance()->HG_SetBufferBudget(nBytes);
+}
+
+bool HG_GetBufferStats(BufferStats* pStats) {
+    return StreamManager::getInstance()->HG_GetBufferStats(pStats);
+}
+
+void HG_TrimBufferPool() {
+    StreamManager::getInstance()->HG_TrimBufferPool();
+}
+
+void HG_SetMemoryBudget(const long long nBytes, const bool bDegrade) {
+    StreamManager::getInstance()->HG_SetMemoryBudget(nBytes, bDegrade);
+}
+
+bool HG_GetMemoryStats(MemoryStats* pStats) {
+    return StreamManager::getInstance()->HG_GetMemoryStats(pStats);
+}
+
+bool HG_GetSyncStats(SyncStats* pStats) {
+    return StreamManager::getInstance()->HG_GetSyncStats(pStats);
+}
+
+bool HG_SetHugePageArena(const long long nSlotBytes, const int nSlots) {
+    return StreamManager::getInstance()->HG_SetHugePageArena(nSlotBytes, nSlots);
+}
+
+bool HG_GetHugePageStats(HugePageStats* pStats) {
+    return StreamManager::getInstance()->HG_GetHugePageStats(pStats);
+}
+
+void* HG_AllocFrameBuffer(const long long nBytes) {
+    return StreamManager::getInstance()->HG_AllocFrameBuffer(nBytes);
+}
+
+void HG_FreeFrameBuffer(void* pData) {
+    StreamManager::getInstance()->HG_FreeFrameBuffer(pData);
+}
+
+void HG_SetLatencyProbe(const bool bEnable) {
+    StreamManager::getInstance()->HG_SetLatencyProbe(bEnable);
+}
+
+bool HG_GetLatencyStats(LatencyStats* pStats) {
+    return StreamManager::getInstance()->HG_GetLatencyStats(pStats);
+}
+
+void HG_SetPipeTrace(const bool bEnable) {
+    StreamManager::getInstance()->HG_SetPipeTrace(bEnable);
+}
+
+int HG_DumpPipeTrace(const char* pPath) {
+    return StreamManager::getInstance()->HG_DumpPipeTrace(pPath);
+}
+
 float HG_GetVersion() {
     return StreamManager::getInstance()->HG_GetVersion();
+}
+
+// ======================================
+void* HG_CreatePostProcess(const int nModelType, const int nClassNum, const int nInputW, const int nInputH) {
+    return new YoloPostProcess(nModelType, nClassNum, nInputW, nInputH);
+}
+
+void HG_SetPostProcessThreshold(void* pHandle, const float fConfThreshold, const float fNmsThreshold) {
+    if (pHandle == nullptr) {
+        return;
+    }
+    static_cast<YoloPostProcess*>(pHandle)->setThreshold(fConfThreshold, fNmsThreshold);
+}
+
+void HG_SetPostProcessMapping(void* pHandle,
+                    const int nSrcX, const int nSrcY, const int nSrcW, const int nSrcH,
+                    const int nDstX, const int nDstY, const int nDstW, const int nDstH) {
+    if (pHandle == nullptr) {
+        return;
+    }
+    static_cast<YoloPostProcess*>(pHandle)->setMapping(nSrcX, nSrcY, nSrcW, nSrcH, nDstX, nDstY, nDstW, nDstH);
+}
+
+DetectResult* HG_RunPostProcess(void* pHandle, const TensorInfo* pTensors, const int nTensorNum) {
+    if (pHandle == nullptr) {
+        return nullptr;
+    }
+    return static_cast<YoloPostProcess*>(pHandle)->process(pTensors, nTensorNum);
+}
+
+void HG_DestroyPostProcess(void* pHandle) {
+    delete static_cast<YoloPostProcess*>(pHandle);
 }
\ No newline at end of file
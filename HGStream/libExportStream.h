@@ -50,6 +50,128 @@ typedef struct stFrameInfo
 	int format;
 }FrameInfo;
 
+#define HG_MAX_DETECT_NUM 128
+
+// 模型输出张量数据类型
+#define HG_TENSOR_TYPE_INT8 0
+#define HG_TENSOR_TYPE_FP16 1
+#define HG_TENSOR_TYPE_FP32 2
+
+// 模型输出张量排布
+#define HG_TENSOR_FMT_NCHW 0
+#define HG_TENSOR_FMT_NHWC 1
+
+// 模型输出张量，可由rknn_tensor_attr和rknn_tensor_mem填充，也可从录制文件读取
+typedef struct stTensorInfo {
+    void* pData = nullptr;
+    // 数据类型 HG_TENSOR_TYPE_*
+    int type = HG_TENSOR_TYPE_INT8;
+    // 排布 HG_TENSOR_FMT_*
+    int fmt = HG_TENSOR_FMT_NCHW;
+    int c = 0;
+    int h = 0;
+    int w = 0;
+    // 量化参数，仅int8有效
+    int zp = 0;
+    float scale = 1.f;
+} TensorInfo;
+
+// 检测框，坐标为原图像坐标
+typedef struct stDetectBox {
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+    float score;
+    int classId;
+    // 跟踪id，未跟踪为-1
+    int trackId;
+} DetectBox;
+
+// 检测结果
+typedef struct stDetectResult {
+    int count = 0;
+    DetectBox boxes[HG_MAX_DETECT_NUM];
+} DetectResult;
+
+// 共享缓冲区池统计，单位字节
+typedef struct stBufferStats {
+    // 0为不限制
+    long long budget = 0;
+    // 已申请的总量，包括空闲的
+    long long allocated = 0;
+    long long inUse = 0;
+    long long idle = 0;
+    int buffers = 0;
+    // 复用次数、新申请次数、因预算或CMA不足失败的次数
+    long long hits = 0;
+    long long misses = 0;
+    long long failures = 0;
+} BufferStats;
+
+// 内存预算接入统计，单位字节
+typedef struct stMemoryStats {
+    // 0为不限制
+    long long budget = 0;
+    // 已接入会话的估算之和
+    long long reserved = 0;
+    // 剩余可接入，不限制时为-1
+    long long headroom = -1;
+    int sessions = 0;
+    // 接入的会话数，降级、拒绝的次数
+    long long admitted = 0;
+    long long degraded = 0;
+    long long rejected = 0;
+} MemoryStats;
+
+// CPU访问DRM缓冲区的缓存同步统计，进程内累计
+typedef struct stSyncStats {
+    long long syncs = 0;
+    // 其中按区间同步的次数
+    long long partial = 0;
+    // 不可缓存或malloc缓冲区跳过的次数
+    long long skipped = 0;
+    long long bytes = 0;
+    long long timeUs = 0;
+} SyncStats;
+
+// 大页内存区统计
+typedef struct stHugePageStats {
+    // 按2MB取整后的槽大小
+    long long slotBytes = 0;
+    int slots = 0;
+    int freeSlots = 0;
+    // true为hugetlbfs大页，false为透明大页
+    bool hugeTlb = false;
+    long long allocs = 0;
+    long long fallbacks = 0;
+} HugePageStats;
+
+// 回环延迟阶段：0推流RGA(含叠加) 1编码 2网络 3解码 4拉流RGA 5打标到拉流输出
+#define HG_LATENCY_STAGE_NUM 6
+// 直方图按毫秒2的幂分档：[0,1) [1,2) [2,4) ... 最后一档为更大的值
+#define HG_LATENCY_BUCKET_NUM 16
+
+typedef struct stLatencyStage {
+    long long count = 0;
+    double avgMs = 0;
+    double minMs = 0;
+    double maxMs = 0;
+    // 由直方图估计，为所在档的上界
+    double p50Ms = 0;
+    double p99Ms = 0;
+    int buckets[HG_LATENCY_BUCKET_NUM] = {0};
+} LatencyStage;
+
+// 回环延迟探针统计
+typedef struct stLatencyStats {
+    LatencyStage stages[HG_LATENCY_STAGE_NUM];
+    // 打标帧数、全部阶段都测到的帧数、中途未识别的帧数
+    long long stamped = 0;
+    long long measured = 0;
+    long long missed = 0;
+} LatencyStats;
+
 // ======================================
 // 拉流初始化，输入uri, nRtpType = 0:udp, 1:tcp
 D_EXTERN_C D_SHARE_EXPORT void* HG_GetRtspClient(const char* pUri, const int nRtpType = 0);
@@ -59,6 +181,10 @@ D_EXTERN_C D_SHARE_EXPORT void HG_CloseClient(void* pHandle);
 D_EXTERN_C D_SHARE_EXPORT Frame* HG_ReadFrame(void* pHandle);
 // 获取拉流帧信息
 D_EXTERN_C D_SHARE_EXPORT FrameInfo* HG_GetFrameInfo(void* pHandle);
+// 开启场景活跃度估计，按解码图像与上一帧的块SAD在[nMinInterval, nMaxInterval]间调整推理间隔，需在开始拉流前调用
+D_EXTERN_C D_SHARE_EXPORT void HG_SetSceneActivity(const bool bEnable, const int nMinInterval = 0, const int nMaxInterval = 8);
+// 获取当前推理间隔(每隔几帧推理一次，0为每帧推理)，未开启时返回0
+D_EXTERN_C D_SHARE_EXPORT int HG_GetInferenceInterval(void* pHandle);
 
 // ======================================
 // 设置推流参数
@@ -80,4 +206,102 @@ D_EXTERN_C D_SHARE_EXPORT void HG_StopSink(const char* playId);
 
 D_EXTERN_C D_SHARE_EXPORT float HG_GetVersion();
 
+// ======================================
+// 推流叠加检测框，结果在后续nHoldFrames帧(默认30)内保持显示，坐标为推流图像坐标
+D_EXTERN_C D_SHARE_EXPORT void HG_SetOsdResult(const char* playId, const DetectResult* pResult);
+// 设置类别名称，下标为classId
+D_EXTERN_C D_SHARE_EXPORT void HG_SetOsdLabels(const char* playId, const char** ppLabels, const int nLabelNum);
+// 设置框线宽、字体放大倍数(1~4)及是否显示时间(默认不显示)
+D_EXTERN_C D_SHARE_EXPORT void HG_SetOsdStyle(const char* playId, const int nThickness = 2, const int nFontScale = 1,
+                                            const bool bShowTime = false);
+// 是否用RGA混合叠加层绘制(只重画变化区域)，需在开始推流前调用
+D_EXTERN_C D_SHARE_EXPORT void HG_SetOsdBlend(const char* playId, const bool bEnable);
+
+// ======================================
+// 推流码流回调，pData为一帧Annex-B码流，仅在回调期间有效
+typedef void (*HG_StreamCallback)(void* pCtx, const unsigned char* pData, const unsigned int nSize,
+                                  const long long nPts, const int bKeyFrame);
+// 订阅推流的编码码流，返回订阅id，回调中可以取消订阅。开启GOP缓存时加入时先回放缓存的最近一个GOP(带SPS/PPS)，否则请求一个关键帧
+D_EXTERN_C D_SHARE_EXPORT int HG_AddStreamSubscriber(const char* playId, HG_StreamCallback callback, void* pCtx);
+// 是否缓存最近一个GOP供新订阅者立即回放，默认关闭，关闭时编码码流不做拷贝。rtsp/rtmp客户端不经过此缓存，连接时自动插入关键帧
+D_EXTERN_C D_SHARE_EXPORT void HG_SetGopCache(const char* playId, const bool bEnable);
+D_EXTERN_C D_SHARE_EXPORT void HG_RemoveStreamSubscriber(const char* playId, const int nId);
+// 请求尽快插入一个关键帧(如应用自行转发码流时)，1秒内的多次请求只产生一个关键帧
+D_EXTERN_C D_SHARE_EXPORT void HG_RequestKeyFrame(const char* playId);
+// 无客户端(rtmp/rtsp)且无订阅者时HG_PutFrame直接返回，暂停转换和编码，有人加入后以关键帧恢复，默认开启
+D_EXTERN_C D_SHARE_EXPORT void HG_SetIdleBypass(const char* playId, const bool bEnable);
+
+// ======================================
+// 开启事件录像，持续缓存最近nPreRollMs的码流，需在开始推流前调用，nPreRollMs为0关闭
+D_EXTERN_C D_SHARE_EXPORT void HG_SetEventRecord(const char* playId, const char* pDir, const int nPreRollMs = 5000);
+// 触发事件录像，文件包含触发前的预录及触发后nPostMs的码流，pFileName为空时在录像目录下按时间命名(ts)
+D_EXTERN_C D_SHARE_EXPORT bool HG_TriggerEventRecord(const char* playId, const char* pFileName, const int nPostMs = 10000);
+// 开启分段录像，按nSegmentSec秒在关键帧处切分为.h264文件，目录中录像总大小超过nRetentionMB时删除最旧的(0为不限制)，
+// 需在开始推流前调用，pDir为空关闭
+D_EXTERN_C D_SHARE_EXPORT void HG_SetSegmentRecord(const char* playId, const char* pDir, const int nSegmentSec = 60, const int nRetentionMB = 0);
+// 打开录像回放，从墙上时间nStartMs(毫秒，0为最早的录像)之前最近的关键帧开始解码，用HG_ReadFrame读取，HG_CloseClient关闭
+D_EXTERN_C D_SHARE_EXPORT void* HG_GetRecordClient(const char* pDir, const long long nStartMs = 0);
+// 回放跳转，按索引二分查找关键帧，清空解码器和未读取的帧后从新位置输出
+D_EXTERN_C D_SHARE_EXPORT bool HG_SeekRecord(void* pHandle, const long long nWallMs);
+// 回放倍速，1为正常播放，其他值只解码关键帧：8/16快进，-8/-16快退
+D_EXTERN_C D_SHARE_EXPORT bool HG_SetRecordSpeed(void* pHandle, const int nSpeed);
+
+// ======================================
+// 设置各阶段工作线程的绑核及调度策略，在开始拉流/推流前调用，启动时生效。
+// pStage: client/decoder/rga/encoder/server/all；pCores: "4-7"、"0,2"、"big"、"little"，为空不绑核；
+// nPolicy: 0-SCHED_OTHER(nPriority为nice值) 1-SCHED_FIFO 2-SCHED_RR(nPriority为1-99)
+D_EXTERN_C D_SHARE_EXPORT bool HG_SetCpuPolicy(const char* pStage, const char* pCores, const int nPolicy = 0, const int nPriority = 0);
+
+// ======================================
+// 按json配置文件搭建并启动管道(格式见PipelineGraph.h)，全部组件init成功才启动，失败返回nullptr
+D_EXTERN_C D_SHARE_EXPORT void* HG_StartGraph(const char* pConfigPath);
+// 停止并释放管道
+D_EXTERN_C D_SHARE_EXPORT void HG_StopGraph(void* pHandle);
+
+// ======================================
+// 设置共享缓冲区池总预算(字节)，0为不限制，超出时新的RGA输出/推流缓冲区申请失败
+D_EXTERN_C D_SHARE_EXPORT void HG_SetBufferBudget(const long long nBytes);
+// 获取共享缓冲区池统计
+D_EXTERN_C D_SHARE_EXPORT bool HG_GetBufferStats(BufferStats* pStats);
+// 释放池中全部空闲缓冲区
+D_EXTERN_C D_SHARE_EXPORT void HG_TrimBufferPool();
+// 设置新建拉流/推流/管道的内存预算(字节)，0为不限制。按图像参数、缓冲区个数估算每路占用，
+// 超出时bDegrade为true先减少缓冲区个数、缩小拉流输出尺寸，仍超出则拒绝
+D_EXTERN_C D_SHARE_EXPORT void HG_SetMemoryBudget(const long long nBytes, const bool bDegrade = true);
+// 获取已接入的估算占用及剩余预算
+D_EXTERN_C D_SHARE_EXPORT bool HG_GetMemoryStats(MemoryStats* pStats);
+// 获取缓存同步次数、字节数及耗时
+D_EXTERN_C D_SHARE_EXPORT bool HG_GetSyncStats(SyncStats* pStats);
+// 预先申请nSlots个nSlotBytes大小的2MB大页帧槽，HG_AllocFrameBuffer优先从中分配，nSlots为0时释放
+D_EXTERN_C D_SHARE_EXPORT bool HG_SetHugePageArena(const long long nSlotBytes, const int nSlots);
+// 获取大页内存区统计
+D_EXTERN_C D_SHARE_EXPORT bool HG_GetHugePageStats(HugePageStats* pStats);
+// 申请一帧的主机内存(如HG_PutFrame之前准备BGR图像)，优先放在大页帧槽上，不合适或用完时退回普通内存，用HG_FreeFrameBuffer释放
+D_EXTERN_C D_SHARE_EXPORT void* HG_AllocFrameBuffer(const long long nBytes);
+D_EXTERN_C D_SHARE_EXPORT void HG_FreeFrameBuffer(void* pData);
+// 开启回环延迟探针：推流帧左下角打标，本进程拉回后按阶段统计延迟，需在开始推流、拉流前开启，开启时清空统计
+D_EXTERN_C D_SHARE_EXPORT void HG_SetLatencyProbe(const bool bEnable);
+// 获取回环延迟统计
+D_EXTERN_C D_SHARE_EXPORT bool HG_GetLatencyStats(LatencyStats* pStats);
+// 开启管道逐帧事件跟踪，记录各组件每次生产/消费的起止时间和缓冲区索引，开启前的事件不导出
+D_EXTERN_C D_SHARE_EXPORT void HG_SetPipeTrace(const bool bEnable);
+// 将跟踪事件写为Chrome trace JSON(chrome://tracing或ui.perfetto.dev打开)，返回事件数，失败返回-1
+D_EXTERN_C D_SHARE_EXPORT int HG_DumpPipeTrace(const char* pPath);
+
+// ======================================
+// 后处理初始化，nModelType: 5-yolov5, 8-yolov8，nInputW/nInputH为模型输入大小
+D_EXTERN_C D_SHARE_EXPORT void* HG_CreatePostProcess(const int nModelType, const int nClassNum,
+                                            const int nInputW = 640, const int nInputH = 640);
+// 设置置信度及nms阈值
+D_EXTERN_C D_SHARE_EXPORT void HG_SetPostProcessThreshold(void* pHandle, const float fConfThreshold = 0.25f,
+                                            const float fNmsThreshold = 0.45f);
+// 设置模型输入区域(dst)到原图区域(src)的映射，对应ModuleInference的getOutputImageCrop/getInputImageCrop
+D_EXTERN_C D_SHARE_EXPORT void HG_SetPostProcessMapping(void* pHandle,
+                                            const int nSrcX, const int nSrcY, const int nSrcW, const int nSrcH,
+                                            const int nDstX, const int nDstY, const int nDstW, const int nDstH);
+// 后处理，输入模型输出张量，返回检测结果，结果内存由句柄持有
+D_EXTERN_C D_SHARE_EXPORT DetectResult* HG_RunPostProcess(void* pHandle, const TensorInfo* pTensors, const int nTensorNum);
+// 释放后处理
+D_EXTERN_C D_SHARE_EXPORT void HG_DestroyPostProcess(void* pHandle);
+
 #endif // LIBEXPORTSTREAM_H
\ No newline at end of file
@@ -1,4 +1,12 @@
 #include "libExportStream.h"
+#include "ModuleMosaic.h"
+
+#include "module/vi/module_rtspClient.hpp"
+#include "module/vp/module_mppdec.hpp"
+#include "module/vp/module_mppenc.hpp"
+#include "module/vo/module_rtspServer.hpp"
+
+#include <vector>
 
 #include <thread>
 #include <chrono>
@@ -50,6 +58,72 @@ void test_server() {
     HG_StopSever();
 }
 
+// 多路拼接推流，./HGStream mosaic rows cols rtsp://... rtsp://...，输出rtsp://ip:8888/live/mosaic
+void test_mosaic(int argc, char** argv) {
+    if (argc < 5) {
+        printf("usage: %s mosaic rows cols url0 url1 ...\n", argv[0]);
+        return;
+    }
+    uint32_t nRows = atoi(argv[2]);
+    uint32_t nCols = atoi(argv[3]);
+    ImagePara stOutPara(1920, 1080, 1920, 1088, V4L2_PIX_FMT_NV12);
+    auto pMosaic = make_shared<ModuleMosaic>(stOutPara, nRows, nCols, 25);
+    pMosaic->setKeepAspect(true);
+    if (pMosaic->init() < 0) {
+        return;
+    }
+
+    std::vector<shared_ptr<ModuleRtspClient>> vClients;
+    for (int i = 4; i < argc && (uint32_t)(i - 4) < pMosaic->getCellCount(); ++i) {
+        auto pClient = make_shared<ModuleRtspClient>(argv[i], RTSP_STREAM_TYPE_TCP, true, false);
+        if (pClient->init() < 0) {
+            printf("open %s failed\n", argv[i]);
+            continue;
+        }
+        auto pDec = make_shared<ModuleMppDec>(pClient->getOutputImagePara());
+        pDec->setProductor(pClient);
+        if (pDec->init() < 0) {
+            continue;
+        }
+        pMosaic->setInput(i - 4, pDec);
+        vClients.push_back(pClient);
+    }
+
+    auto pEnc = make_shared<ModuleMppEnc>(ENCODE_TYPE_H264);
+    pEnc->setProductor(pMosaic);
+    pEnc->setBufferCount(8);
+    if (pEnc->init() < 0) {
+        return;
+    }
+    auto pServer = make_shared<ModuleRtspServer>("/live/mosaic", 8888);
+    pServer->setProductor(pEnc);
+    pServer->setBufferCount(0);
+    pServer->init();
+
+    pMosaic->start();
+    for (auto& pClient : vClients) {
+        pClient->start();
+    }
+    getchar();
+    for (auto& pClient : vClients) {
+        pClient->stop();
+    }
+    pMosaic->stop();
+}
+
+void test_graph(int argc, char** argv) {
+    if (argc < 3) {
+        printf("usage: %s graph config.json\n", argv[0]);
+        return;
+    }
+    void* pGraph = HG_StartGraph(argv[2]);
+    if (pGraph == nullptr) {
+        return;
+    }
+    getchar();
+    HG_StopGraph(pGraph);
+}
+
 int main(int argc, char**argv) {
     if (argc < 2) {
         test_rtsp();  
@@ -59,6 +133,14 @@ int main(int argc, char**argv) {
         test_server();  
         return 0;
     }
+    if (strcmp(argv[1], "mosaic") == 0) {
+        test_mosaic(argc, argv);
+        return 0;
+    }
+    if (strcmp(argv[1], "graph") == 0) {
+        test_graph(argc, argv);
+        return 0;
+    }
 
     return 0;
 }
\ No newline at end of file
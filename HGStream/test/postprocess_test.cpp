@@ -0,0 +1,326 @@
+// 后处理测试：不带参数时用构造的张量检查yolov5/yolov8(int8/fp16/fp32、score_sum、sigmoid)的解码和nms，
+// 带参数时回放录制的张量文件并计时：postprocess_test 5|8 classNum tensor0.bin tensor1.bin ...
+#include "YoloPostProcess.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "base/ff_log.h"
+
+// 不链接ff_media，日志输出到stderr
+unsigned int ff_log_level = LOG_LEVEL_WARN;
+
+void _ff_log(const char* prefix, const char* tag, const char* fname, const char* fmt, ...) {
+    if (prefix != nullptr) {
+        fprintf(stderr, "[%s] %s: ", prefix, fname != nullptr ? fname : "");
+    }
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+namespace {
+
+int g_nFailed = 0;
+
+#define EXPECT(cond)                                                                  \
+    do {                                                                              \
+        if (!(cond)) {                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            g_nFailed++;                                                              \
+        }                                                                             \
+    } while (0)
+
+bool near(float a, float b, float fTol) {
+    return fabsf(a - b) <= fTol;
+}
+
+// 只处理测试中用到的规格化数
+uint16_t floatToHalf(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint16_t nSign = (x >> 16) & 0x8000;
+    int nExp = (int)((x >> 23) & 0xff) - 127 + 15;
+    if ((x & 0x7fffffff) == 0 || nExp <= 0) {
+        return nSign;
+    }
+    if (nExp >= 31) {
+        return nSign | 0x7c00;
+    }
+    // 尾数舍入进位时直接进到指数
+    return nSign + (uint16_t)((nExp << 10) + (((x & 0x7fffff) + 0x1000) >> 13));
+}
+
+struct StTensor {
+    TensorInfo stInfo;
+    std::vector<float> vFloat;
+    std::vector<int8_t> vInt8;
+    std::vector<uint16_t> vHalf;
+};
+
+// 全0张量，int8按zp=-128、scale=1/255量化，即[0, 1]
+void makeTensor(StTensor& stTensor, int nType, int c, int h, int w) {
+    stTensor.stInfo.type = nType;
+    stTensor.stInfo.fmt = HG_TENSOR_FMT_NCHW;
+    stTensor.stInfo.c = c;
+    stTensor.stInfo.h = h;
+    stTensor.stInfo.w = w;
+    if (nType == HG_TENSOR_TYPE_INT8) {
+        stTensor.stInfo.zp = -128;
+        stTensor.stInfo.scale = 1.f / 255;
+        stTensor.vInt8.assign((size_t)c * h * w, -128);
+        stTensor.stInfo.pData = stTensor.vInt8.data();
+    } else if (nType == HG_TENSOR_TYPE_FP16) {
+        stTensor.vHalf.assign((size_t)c * h * w, 0);
+        stTensor.stInfo.pData = stTensor.vHalf.data();
+    } else {
+        stTensor.vFloat.assign((size_t)c * h * w, 0.f);
+        stTensor.stInfo.pData = stTensor.vFloat.data();
+    }
+}
+
+void setValue(StTensor& stTensor, int c, int y, int x, float v) {
+    size_t nIndex = ((size_t)c * stTensor.stInfo.h + y) * stTensor.stInfo.w + x;
+    if (stTensor.stInfo.type == HG_TENSOR_TYPE_INT8) {
+        long q = lroundf(v / stTensor.stInfo.scale + stTensor.stInfo.zp);
+        stTensor.vInt8[nIndex] = (int8_t)std::min(std::max(q, -128L), 127L);
+    } else if (stTensor.stInfo.type == HG_TENSOR_TYPE_FP16) {
+        stTensor.vHalf[nIndex] = floatToHalf(v);
+    } else {
+        stTensor.vFloat[nIndex] = v;
+    }
+}
+
+// 80x80分支anchor 0上相邻两格各有一个目标(类别1)，框40x52，重叠较多，nms后只剩分数高的一个
+void testYolov5(int nType) {
+    const int nClass = 2;
+    const int nProp = 5 + nClass;
+    std::vector<StTensor> vTensors(3);
+    const int vSize[3] = {80, 40, 20};
+    for (int b = 0; b < 3; ++b) {
+        makeTensor(vTensors[b], nType, 3 * nProp, vSize[b], vSize[b]);
+    }
+    const float vObj[2] = {1.f, 0.8f};
+    for (int k = 0; k < 2; ++k) {
+        int x = 10 + k;
+        setValue(vTensors[0], 0, 20, x, 0.5f);
+        setValue(vTensors[0], 1, 20, x, 0.5f);
+        setValue(vTensors[0], 2, 20, x, 1.f);
+        setValue(vTensors[0], 3, 20, x, 1.f);
+        setValue(vTensors[0], 4, 20, x, vObj[k]);
+        setValue(vTensors[0], 5 + 1, 20, x, 1.f);
+    }
+    std::vector<TensorInfo> vInfos;
+    for (StTensor& stTensor : vTensors) {
+        vInfos.push_back(stTensor.stInfo);
+    }
+    YoloPostProcess post(YoloPostProcess::MODEL_YOLOV5, nClass);
+    DetectResult stResult;
+    int nCount = post.process(vInfos.data(), (int)vInfos.size(), &stResult);
+    EXPECT(nCount == 1);
+    if (nCount >= 1) {
+        const DetectBox& box = stResult.boxes[0];
+        // 中心(84, 164)，宽(2*1)^2*10，高(2*1)^2*13
+        EXPECT(box.classId == 1);
+        EXPECT(near(box.score, 1.f, 0.01f));
+        EXPECT(near(box.x1, 64.f, 0.5f) && near(box.x2, 104.f, 0.5f));
+        EXPECT(near(box.y1, 138.f, 0.5f) && near(box.y2, 190.f, 0.5f));
+    }
+    // 输出个数不对时报错
+    EXPECT(post.process(vInfos.data(), 2, &stResult) < 0);
+}
+
+// yolov8输出：每个分支box、cls，nPerBranch为3时再加score_sum。未做sigmoid时分数填logit
+struct StYolov8 {
+    std::vector<StTensor> vTensors;
+    int nPerBranch;
+    bool bSigmoid;
+
+    StYolov8(int nType, int nClass, int nPerBranch, bool bSigmoid) : nPerBranch(nPerBranch), bSigmoid(bSigmoid) {
+        const int vSize[3] = {80, 40, 20};
+        vTensors.resize(3 * nPerBranch);
+        for (int b = 0; b < 3; ++b) {
+            makeTensor(vTensors[b * nPerBranch], nType == HG_TENSOR_TYPE_INT8 ? HG_TENSOR_TYPE_FP32 : nType,
+                       4 * 16, vSize[b], vSize[b]);
+            makeTensor(vTensors[b * nPerBranch + 1], nType, nClass, vSize[b], vSize[b]);
+            if (nPerBranch == 3) {
+                makeTensor(vTensors[b * nPerBranch + 2], nType, 1, vSize[b], vSize[b]);
+            }
+            if (bSigmoid) {
+                // logit有正负，int8按zp=0、scale=0.1量化，即[-12.8, 12.7]
+                for (int i = 1; i < nPerBranch; ++i) {
+                    vTensors[b * nPerBranch + i].stInfo.zp = 0;
+                    vTensors[b * nPerBranch + i].stInfo.scale = 0.1f;
+                }
+                // 全0的logit为0.5，高于阈值，全部填成很小的logit
+                fill(vTensors[b * nPerBranch + 1], -10.f);
+            }
+        }
+    }
+
+    static void fill(StTensor& stTensor, float v) {
+        for (int c = 0; c < stTensor.stInfo.c; ++c) {
+            for (int y = 0; y < stTensor.stInfo.h; ++y) {
+                for (int x = 0; x < stTensor.stInfo.w; ++x) {
+                    setValue(stTensor, c, y, x, v);
+                }
+            }
+        }
+    }
+
+    // 80x80分支(x, y)格，四边的DFL分布集中在nDist
+    void setBox(int x, int y, int nDist) {
+        for (int side = 0; side < 4; ++side) {
+            setValue(vTensors[0], side * 16 + nDist, y, x, 20.f);
+        }
+    }
+
+    void setScore(int x, int y, int nClass, float fScore, float fScoreSum) {
+        setValue(vTensors[1], nClass, y, x, bSigmoid ? logf(fScore / (1.f - fScore)) : fScore);
+        if (nPerBranch == 3) {
+            setValue(vTensors[2], 0, y, x, fScoreSum);
+        }
+    }
+
+    std::vector<TensorInfo> infos() {
+        std::vector<TensorInfo> vInfos;
+        for (StTensor& stTensor : vTensors) {
+            vInfos.push_back(stTensor.stInfo);
+        }
+        return vInfos;
+    }
+};
+
+// 80x80分支(5, 5)格类别1分数0.9，四边的DFL分布集中在2，框为((5.5-2)*8, (5.5-2)*8, (5.5+2)*8, (5.5+2)*8)
+void expectYolov8Box(YoloPostProcess& post, const std::vector<TensorInfo>& vInfos) {
+    DetectResult stResult;
+    int nCount = post.process(vInfos.data(), (int)vInfos.size(), &stResult);
+    EXPECT(nCount == 1);
+    if (nCount >= 1) {
+        const DetectBox& box = stResult.boxes[0];
+        EXPECT(box.classId == 1);
+        EXPECT(near(box.score, 0.9f, 0.01f));
+        EXPECT(near(box.x1, 28.f, 0.5f) && near(box.y1, 28.f, 0.5f));
+        EXPECT(near(box.x2, 60.f, 0.5f) && near(box.y2, 60.f, 0.5f));
+    }
+}
+
+void testYolov8(int nType) {
+    StYolov8 model(nType, 2, 2, false);
+    model.setBox(5, 5, 2);
+    model.setScore(5, 5, 1, 0.9f, 0.9f);
+    YoloPostProcess post(YoloPostProcess::MODEL_YOLOV8, 2);
+    expectYolov8Box(post, model.infos());
+}
+
+// 9个输出时用score_sum预筛选：(30, 30)格类别分数高但score_sum为0，不会被选中
+void testYolov8ScoreSum(int nType) {
+    StYolov8 model(nType, 2, 3, false);
+    model.setBox(5, 5, 2);
+    model.setScore(5, 5, 1, 0.9f, 0.95f);
+    model.setBox(30, 30, 2);
+    model.setScore(30, 30, 0, 0.8f, 0.f);
+    YoloPostProcess post(YoloPostProcess::MODEL_YOLOV8, 2);
+    expectYolov8Box(post, model.infos());
+}
+
+// 输出为logit时在sigmoid前比较阈值，9个输出时不用score_sum(其值域不同)，逐类别取最大值
+void testYolov8Sigmoid(int nType, int nPerBranch) {
+    StYolov8 model(nType, 2, nPerBranch, true);
+    model.setBox(5, 5, 2);
+    model.setScore(5, 5, 1, 0.9f, 0.f);
+    // 低于阈值0.25
+    model.setBox(30, 30, 2);
+    model.setScore(30, 30, 0, 0.2f, 0.f);
+    YoloPostProcess post(YoloPostProcess::MODEL_YOLOV8, 2);
+    post.setSigmoid(true);
+    expectYolov8Box(post, model.infos());
+}
+
+// 录制的张量文件：写出后读回，结果与直接处理一致
+void testRecorded(int nType) {
+    StYolov8 model(nType, 2, 3, false);
+    model.setBox(5, 5, 2);
+    model.setScore(5, 5, 1, 0.9f, 0.95f);
+    std::vector<TensorInfo> vInfos = model.infos();
+    char szDir[] = "/tmp/postprocess_testXXXXXX";
+    if (mkdtemp(szDir) == nullptr) {
+        EXPECT(!"mkdtemp failed");
+        return;
+    }
+    std::vector<TensorInfo> vLoaded(vInfos.size());
+    std::vector<std::vector<uint8_t>> vData(vInfos.size());
+    for (size_t i = 0; i < vInfos.size(); ++i) {
+        char szPath[64];
+        snprintf(szPath, sizeof(szPath), "%s/tensor%zu.bin", szDir, i);
+        EXPECT(YoloPostProcess::saveTensor(szPath, vInfos[i]));
+        EXPECT(YoloPostProcess::loadTensor(szPath, vLoaded[i], vData[i]));
+        EXPECT(vLoaded[i].type == nType || i % 3 == 0);
+        unlink(szPath);
+    }
+    rmdir(szDir);
+    YoloPostProcess post(YoloPostProcess::MODEL_YOLOV8, 2);
+    expectYolov8Box(post, vLoaded);
+}
+
+int replay(int argc, char** argv) {
+    int nModelType = atoi(argv[1]);
+    int nClassNum = atoi(argv[2]);
+    int nTensorNum = argc - 3;
+    std::vector<TensorInfo> vTensors(nTensorNum);
+    std::vector<std::vector<uint8_t>> vData(nTensorNum);
+    for (int i = 0; i < nTensorNum; ++i) {
+        if (!YoloPostProcess::loadTensor(argv[3 + i], vTensors[i], vData[i])) {
+            printf("load tensor %s failed\n", argv[3 + i]);
+            return 1;
+        }
+    }
+    YoloPostProcess post(nModelType, nClassNum);
+    DetectResult* pResult = nullptr;
+    auto tStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; ++i) {
+        pResult = post.process(vTensors.data(), nTensorNum);
+    }
+    auto tEnd = std::chrono::steady_clock::now();
+    if (pResult == nullptr) {
+        return 1;
+    }
+    printf("postprocess %.3f ms\n", std::chrono::duration<double, std::milli>(tEnd - tStart).count() / 100);
+    for (int i = 0; i < pResult->count; ++i) {
+        DetectBox& box = pResult->boxes[i];
+        printf("class %d score %.3f box (%.1f, %.1f, %.1f, %.1f)\n", box.classId, box.score, box.x1, box.y1, box.x2, box.y2);
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc >= 4) {
+        return replay(argc, argv);
+    }
+    if (argc > 1) {
+        printf("usage: %s [5|8 classNum tensor0.bin ...]\n", argv[0]);
+        return 1;
+    }
+    const int vTypes[3] = {HG_TENSOR_TYPE_INT8, HG_TENSOR_TYPE_FP16, HG_TENSOR_TYPE_FP32};
+    for (int nType : vTypes) {
+        testYolov5(nType);
+        testYolov8(nType);
+        testYolov8ScoreSum(nType);
+        testYolov8Sigmoid(nType, 2);
+        testYolov8Sigmoid(nType, 3);
+        testRecorded(nType);
+    }
+    printf("%s\n", g_nFailed == 0 ? "all passed" : "FAILED");
+    return g_nFailed == 0 ? 0 : 1;
+}